@@ -0,0 +1,283 @@
+// atlas_stress -- churns the fontstash atlas with thousands of distinct glyphs
+//
+// Usage: atlas_stress [frames] [font.ttf ...]   (run from the repository root, it
+//                                               loads resources/Roboto-Regular.ttf
+//                                               and resources/FontAwesome-Solid.ttf)
+//
+// Each frame draws a window of distinct codepoints at several sizes, sliding
+// through Latin, Greek, Cyrillic, the FontAwesome icons and, when fonts
+// covering them are passed on the command line (e.g. NotoSansCJK and
+// NotoColorEmoji), CJK ideographs and emoji. The working set is far larger
+// than the atlas, so pages fill up and get re-packed all the time.
+//
+// The NanoVG back-end draws nothing but mirrors every texture on the CPU. At
+// draw time it checks that every glyph quad points at inked texels; at the
+// end of the frame, when a GPU back-end would actually render, that the
+// texture is still alive and those texels are unchanged (i.e. no glyph drawn
+// earlier in the frame was evicted or re-packed underneath), and that the
+// number of font textures stays within FONS_MAX_PAGES. Reports texture memory
+// per format and the time per frame. Exits with 1 if a check failed.
+
+#include <nanovg.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const int max_textures = 8; // FONS_MAX_PAGES
+
+struct Texture {
+    int type = 0, width = 0, height = 0;
+    std::vector<unsigned char> data;
+    int bpp() const { return type == NVG_TEXTURE_RGBA ? 4 : 1; }
+};
+
+struct Rect {
+    int image, x0, y0, x1, y1;
+    unsigned int hash, ink;
+};
+
+static std::map<int, Texture> textures;
+static std::vector<Rect> draws;
+static int failures = 0, max_live = 0;
+static long quads = 0;
+
+static void fail(const char* what, const Rect& r) {
+    if (failures++ < 10)
+        fprintf(stderr, "  FAILED: %s (image %d, %d,%d - %d,%d)\n", what, r.image, r.x0, r.y0, r.x1, r.y1);
+}
+
+// Hashes the texels inside `r` and ORs their coverage into `ink`
+static unsigned int texel_hash(const Texture& tex, const Rect& r, unsigned int& ink) {
+    int bpp = tex.bpp();
+    unsigned int hash = 2166136261u;
+    ink = 0;
+    for (int y = r.y0; y < r.y1; ++y)
+        for (int x = r.x0; x < r.x1; ++x)
+            for (int i = 0; i < bpp; ++i) {
+                unsigned char texel = tex.data[(y * tex.width + x) * bpp + i];
+                hash = (hash ^ texel) * 16777619u;
+                if (i == bpp - 1)
+                    ink |= texel;
+            }
+    return hash;
+}
+
+static void upload(Texture& tex, int x, int y, int w, int h, const unsigned char* data) {
+    int bpp = tex.bpp();
+    for (int row = y; row < y + h; ++row)
+        memcpy(&tex.data[(row * tex.width + x) * bpp], &data[(row * tex.width + x) * bpp], w * bpp);
+}
+
+// Back-end that draws nothing and checks what text rendering asks for
+static int check_create(void*) { return 1; }
+static int check_create_texture(void*, int type, int w, int h, int, const unsigned char* data) {
+    static int next_image = 1;
+    Texture& tex = textures[next_image];
+    tex.type = type;
+    tex.width = w;
+    tex.height = h;
+    tex.data.assign((size_t) w * h * tex.bpp(), 0);
+    if (data)
+        upload(tex, 0, 0, w, h, data);
+    max_live = std::max(max_live, (int) textures.size());
+    return next_image++;
+}
+static int check_delete_texture(void*, int image) {
+    textures.erase(image);
+    return 1;
+}
+static int check_update_texture(void*, int image, int x, int y, int w, int h, const unsigned char* data) {
+    auto it = textures.find(image);
+    if (it == textures.end())
+        return 0;
+    upload(it->second, x, y, w, h, data);
+    return 1;
+}
+static int check_texture_size(void*, int image, int* w, int* h) {
+    auto it = textures.find(image);
+    if (it == textures.end())
+        return 0;
+    *w = it->second.width;
+    *h = it->second.height;
+    return 1;
+}
+static void check_viewport(void*, float, float, float) { }
+static void check_cancel(void*) { }
+static void check_fill(void*, NVGpaint*, NVGcompositeOperationState, NVGscissor*, float,
+                       const float*, const NVGpath*, int) { }
+static void check_stroke(void*, NVGpaint*, NVGcompositeOperationState, NVGscissor*, float,
+                         float, const NVGpath*, int) { }
+static void check_triangles(void*, NVGpaint* paint, NVGcompositeOperationState, NVGscissor*,
+                            const NVGvertex* verts, int nverts, float) {
+    auto it = textures.find(paint->image);
+    if (it == textures.end()) {
+        fail("text drawn with a deleted texture", { paint->image, 0, 0, 0, 0, 0, 0 });
+        return;
+    }
+    const Texture& tex = it->second;
+    for (int i = 0; i + 6 <= nverts; i += 6) {
+        float u0 = 1, v0 = 1, u1 = 0, v1 = 0;
+        for (int j = i; j < i + 6; ++j) {
+            u0 = std::min(u0, verts[j].u); u1 = std::max(u1, verts[j].u);
+            v0 = std::min(v0, verts[j].v); v1 = std::max(v1, verts[j].v);
+        }
+        Rect r { paint->image, (int) (u0 * tex.width + 0.5f), (int) (v0 * tex.height + 0.5f),
+                 (int) (u1 * tex.width + 0.5f), (int) (v1 * tex.height + 0.5f), 0, 0 };
+        if (u0 < 0 || v0 < 0 || u1 > 1 || v1 > 1 || r.x0 >= r.x1 || r.y0 >= r.y1) {
+            fail("texture coordinates out of range", r);
+            continue;
+        }
+        r.hash = texel_hash(tex, r, r.ink);
+        if (!r.ink)
+            fail("glyph quad samples an empty region", r);
+        draws.push_back(r);
+        quads++;
+    }
+}
+
+// The frame is rendered now, with the textures as they are at this point
+static void check_flush(void*) {
+    for (const Rect& d : draws) {
+        auto it = textures.find(d.image);
+        if (it == textures.end()) {
+            fail("texture deleted before the frame was rendered", d);
+            continue;
+        }
+        unsigned int ink;
+        if (texel_hash(it->second, d, ink) != d.hash)
+            fail("glyph overwritten after it was drawn", d);
+    }
+    if ((int) textures.size() > max_textures)
+        fail("too many font textures", { 0, 0, 0, (int) textures.size(), 0, 0, 0 });
+    draws.clear();
+}
+static void check_delete(void*) { }
+
+static NVGcontext* create_checking_context() {
+    NVGparams params;
+    memset(&params, 0, sizeof(params));
+    params.edgeAntiAlias = 1;
+    params.renderCreate = check_create;
+    params.renderCreateTexture = check_create_texture;
+    params.renderDeleteTexture = check_delete_texture;
+    params.renderUpdateTexture = check_update_texture;
+    params.renderGetTextureSize = check_texture_size;
+    params.renderViewport = check_viewport;
+    params.renderCancel = check_cancel;
+    params.renderFlush = check_flush;
+    params.renderFill = check_fill;
+    params.renderStroke = check_stroke;
+    params.renderTriangles = check_triangles;
+    params.renderDelete = check_delete;
+    return nvgCreateInternal(&params);
+}
+
+static void append_utf8(std::string& s, unsigned int c) {
+    if (c < 0x80) {
+        s += (char) c;
+    } else if (c < 0x800) {
+        s += (char) (0xC0 | (c >> 6));
+        s += (char) (0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        s += (char) (0xE0 | (c >> 12));
+        s += (char) (0x80 | ((c >> 6) & 0x3F));
+        s += (char) (0x80 | (c & 0x3F));
+    } else {
+        s += (char) (0xF0 | (c >> 18));
+        s += (char) (0x80 | ((c >> 12) & 0x3F));
+        s += (char) (0x80 | ((c >> 6) & 0x3F));
+        s += (char) (0x80 | (c & 0x3F));
+    }
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 300;
+    if (frames <= 0) {
+        fprintf(stderr, "usage: %s [frames] [font.ttf ...]\n", argv[0]);
+        return 1;
+    }
+
+    NVGcontext* ctx = create_checking_context();
+    if (!ctx || nvgCreateFont(ctx, "sans", "resources/Roboto-Regular.ttf") == -1 ||
+        nvgCreateFont(ctx, "icons", "resources/FontAwesome-Solid.ttf") == -1) {
+        fprintf(stderr, "could not load the fonts in resources/ (run from the repository root)\n");
+        return 1;
+    }
+    nvgAddFallbackFont(ctx, "sans", "icons");
+    for (int i = 2; i < argc; ++i) {
+        std::string name = "extra" + std::to_string(i);
+        if (nvgCreateFont(ctx, name.c_str(), argv[i]) == -1) {
+            fprintf(stderr, "could not load %s\n", argv[i]);
+            return 1;
+        }
+        nvgAddFallbackFont(ctx, "sans", name.c_str());
+    }
+
+    // Latin, Greek, Cyrillic, FontAwesome; CJK and emoji when a font provides them
+    std::vector<unsigned int> codepoints;
+    const unsigned int ranges[][2] = {
+        { 0x21, 0x7E }, { 0xA1, 0x24F }, { 0x370, 0x3FF }, { 0x400, 0x4FF }, { 0xF000, 0xF8FF },
+        { 0x4E00, 0x5DFF }, { 0x1F300, 0x1F5FF }, { 0x1F900, 0x1F9FF }
+    };
+    for (auto& range : ranges)
+        for (unsigned int c = range[0]; c <= range[1]; ++c)
+            codepoints.push_back(c);
+
+    const float sizes[] = { 12.f, 16.f, 24.f, 36.f, 48.f };
+    const int per_frame = 400, per_line = 40;
+    size_t offset = 0;
+    double total_ms = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        auto start = Clock::now();
+        nvgBeginFrame(ctx, 1920.f, 1080.f, 1.f);
+        nvgFontFace(ctx, "sans");
+        nvgFillColor(ctx, nvgRGBA(255, 255, 255, 255));
+        nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+        float y = 0.f;
+        for (float size : sizes) {
+            nvgFontSize(ctx, size);
+            for (int i = 0; i < per_frame / (int) (sizeof(sizes) / sizeof(sizes[0])); i += per_line) {
+                std::string line;
+                for (int j = 0; j < per_line; ++j)
+                    append_utf8(line, codepoints[(offset + (size_t) (i + j) * 7919) % codepoints.size()]);
+                nvgText(ctx, 0.f, y, line.c_str(), nullptr);
+                y = std::fmod(y + size, 1080.f);
+            }
+        }
+        nvgEndFrame(ctx);
+        total_ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        offset += per_frame / 3; // two thirds of the glyphs were drawn in the previous frame
+    }
+
+    size_t alpha_bytes = 0, rgba_bytes = 0;
+    int alpha_pages = 0, rgba_pages = 0;
+    for (auto& it : textures) {
+        if (it.second.type == NVG_TEXTURE_RGBA) {
+            rgba_bytes += it.second.data.size();
+            rgba_pages++;
+        } else {
+            alpha_bytes += it.second.data.size();
+            alpha_pages++;
+        }
+    }
+    NVGtextCacheStats stats;
+    nvgTextCacheStats(ctx, &stats);
+
+    printf("%d frames, %zu distinct codepoints at %d sizes, %ld glyph quads checked\n",
+           frames, codepoints.size(), (int) (sizeof(sizes) / sizeof(sizes[0])), quads);
+    printf("  font textures: %d alpha (%.1f MB), %d RGBA (%.1f MB), at most %d alive\n",
+           alpha_pages, alpha_bytes / 1048576.0, rgba_pages, rgba_bytes / 1048576.0, max_live);
+    printf("  %.2f ms per frame, text cache %u hits, %u misses\n", total_ms / frames, stats.hits, stats.misses);
+    printf("  %s\n", failures ? "FAILED" : "ok");
+
+    nvgDeleteInternal(ctx);
+    return failures ? 1 : 0;
+}
@@ -7,6 +7,22 @@
 #include <limits.h>
 #include <ctype.h>
 #include <inttypes.h> // for PRId64
+#include <float.h>    // for FLT_EVAL_METHOD
+
+// The JSON scanner uses SSE2 (and AVX2 when the compiler targets it) to skip
+// whitespace and string bodies 16/32 bytes at a time. Define DICT_NO_SIMD to
+// force the scalar code path.
+#if !defined(DICT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#  define DICT_USE_SSE2 1
+#  include <emmintrin.h>
+#  if defined(__AVX2__)
+#    define DICT_USE_AVX2 1
+#    include <immintrin.h>
+#  endif
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  endif
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,6 +30,7 @@ extern "C" {
 
 #define MAX_KEY_LEN   (64 * 1024) // 8 KB max key length (bytes)
 #define MAX_VALUE_LEN 20000000  // 20 million chars max string value length (characters)
+#define DICT_INDEX_MIN_KEYS 8   // objects with more keys than this get a hash index
 
 typedef enum {
     DICT_NULL,
@@ -41,6 +58,11 @@ typedef struct {
     size_t count;
     size_t capacity;
     DictKeyValuePair *pairs;
+    // Open-addressing hash index over pairs: index[0] holds the slot mask
+    // (slot count - 1), the slots follow and store pair index + 1 (0 = empty).
+    // NULL until the object holds more than DICT_INDEX_MIN_KEYS keys; lookups
+    // fall back to a linear scan without it.
+    uint32_t *index;
 } DictObject;
 
 struct DictValue {
@@ -74,6 +96,7 @@ static void dict_object_init(DictObject *obj) {
 	if (!obj) return;
     obj->count = 0;
     obj->capacity = 4;
+    obj->index = NULL;
     obj->pairs = (DictKeyValuePair *)malloc(sizeof(DictKeyValuePair) * obj->capacity);
 	if (!obj->pairs) {
         obj->capacity = 0;
@@ -92,6 +115,8 @@ static void dict_object_clear(DictObject *obj) {
     obj->pairs = NULL;
     obj->count = 0;
     obj->capacity = 0;
+    free(obj->index);
+    obj->index = NULL;
 }
 
 // Resize pairs array if needed
@@ -258,15 +283,102 @@ static void dict_value_free(DictValue *val) {
     }
 }
 
-// Find index of key in object, returns size_t max if not found
-static size_t dict_object_find_key(const DictObject *obj, const char *key) {
+// --- Key index ---
+
+// FNV-1a hash of len bytes of key
+static uint32_t dict_key_hash(const char *key, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Does the NUL-terminated stored key equal the len-byte segment key?
+static int dict_key_equals(const char *stored, const char *key, size_t len) {
+    return strncmp(stored, key, len) == 0 && stored[len] == '\0';
+}
+
+// Slot count for an index over count keys (load factor <= 0.5)
+static uint32_t dict_index_slots_for(size_t count) {
+    uint32_t slots = 16;
+    while (slots < count * 2) slots <<= 1;
+    return slots;
+}
+
+// Insert pair i into the index (the index must have a free slot)
+static void dict_index_insert(DictObject *obj, size_t i) {
+    const char *key = obj->pairs[i].key;
+    uint32_t mask = obj->index[0], *slots = obj->index + 1;
+    uint32_t slot = dict_key_hash(key, strlen(key)) & mask;
+    while (slots[slot])
+        slot = (slot + 1) & mask;
+    slots[slot] = (uint32_t)(i + 1);
+}
+
+// Refill an already allocated index from the pairs array. When keys repeat
+// (possible in arena-parsed objects) only the first occurrence is indexed.
+static void dict_index_fill(DictObject *obj) {
+    uint32_t mask = obj->index[0], *slots = obj->index + 1;
+    memset(slots, 0, ((size_t)mask + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < obj->count; i++) {
+        const char *key = obj->pairs[i].key;
+        size_t len = strlen(key);
+        uint32_t slot = dict_key_hash(key, len) & mask;
+        int duplicate = 0;
+        while (slots[slot]) {
+            if (dict_key_equals(obj->pairs[slots[slot] - 1].key, key, len)) {
+                duplicate = 1;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        if (!duplicate)
+            slots[slot] = (uint32_t)(i + 1);
+    }
+}
+
+// (Re)build the index with room for at least min_count keys. On allocation
+// failure the index is dropped and lookups fall back to a linear scan.
+static void dict_index_rebuild(DictObject *obj, size_t min_count) {
+    free(obj->index);
+    obj->index = NULL;
+    if (min_count > UINT32_MAX / 4) return;
+
+    uint32_t slots = dict_index_slots_for(min_count);
+    obj->index = (uint32_t *)malloc(((size_t)slots + 1) * sizeof(uint32_t));
+    if (!obj->index) return;
+    obj->index[0] = slots - 1;
+    dict_index_fill(obj);
+}
+
+// Find index of the len-byte key segment in object, returns size_t max if not found
+static size_t dict_object_find_key_n(const DictObject *obj, const char *key, size_t len) {
     if (!obj || !key) return (size_t)-1;
+    if (obj->index) {
+        uint32_t mask = obj->index[0];
+        const uint32_t *slots = obj->index + 1;
+        uint32_t slot = dict_key_hash(key, len) & mask;
+        uint32_t entry;
+        while ((entry = slots[slot]) != 0) {
+            if (dict_key_equals(obj->pairs[entry - 1].key, key, len)) return entry - 1;
+            slot = (slot + 1) & mask;
+        }
+        return (size_t)-1;
+    }
     for (size_t i = 0; i < obj->count; i++) {
-        if (strcmp(obj->pairs[i].key, key) == 0) return i;
+        if (dict_key_equals(obj->pairs[i].key, key, len)) return i;
     }
     return (size_t)-1;
 }
 
+// Find index of key in object, returns size_t max if not found
+static size_t dict_object_find_key(const DictObject *obj, const char *key) {
+    if (!obj || !key) return (size_t)-1;
+    return dict_object_find_key_n(obj, key, strlen(key));
+}
+
 // Set or insert a key-value pair into an object.
 // If key exists, replaces old value with new value (caller owns new_val).
 // If key doesn't exist, inserts new key-value pair.
@@ -297,6 +409,12 @@ static int dict_object_set(DictValue *obj_val, const char *key, DictValue *new_v
     obj->pairs[obj->count].key = key_copy;
     obj->pairs[obj->count].value = new_val;
     obj->count++;
+
+    // Keep the index in sync, growing it before it gets more than half full
+    if (obj->index && obj->count * 2 <= (size_t)obj->index[0] + 1)
+        dict_index_insert(obj, obj->count - 1);
+    else if (obj->count > DICT_INDEX_MIN_KEYS)
+        dict_index_rebuild(obj, obj->count * 2);
     return 1;
 }
 
@@ -328,6 +446,10 @@ static int dict_object_remove(DictValue *obj_val, const char *key) {
         obj->pairs[idx] = obj->pairs[obj->count - 1];
     }
     obj->count--;
+
+    // Removal is rare: refill the index in place rather than tracking tombstones
+    if (obj->index)
+        dict_index_fill(obj);
     return 1;
 }
 
@@ -345,6 +467,8 @@ static void dict_object_sort_keys(DictValue *obj_val) {
     DictObject *obj = &obj_val->object_value;
     // qsort is not stable but good enough here
     qsort(obj->pairs, obj->count, sizeof(DictKeyValuePair), dict_key_compare);
+    if (obj->index)
+        dict_index_fill(obj);
 }
 
 // Internal helper: Append a string to buffer, updating cursor pointer and remaining size.
@@ -544,17 +668,11 @@ static DictValue *dict_find_path(const DictValue *root, const char *path) {
 
         if (len == 0) return NULL; // empty segment invalid
 
-        // Extract key segment string (not allocating, just comparing)
-        // We'll compare via strncmp with the key length.
+        // Look up the key segment in place (hashed when the object is indexed)
         const DictObject *obj = &current->object_value;
-        DictValue *next_val = NULL;
-        for (size_t i = 0; i < obj->count; i++) {
-            if (strncmp(obj->pairs[i].key, segment_start, len) == 0 && obj->pairs[i].key[len] == '\0') {
-                next_val = obj->pairs[i].value;
-                break;
-            }
-        }
-        if (!next_val) return NULL; // key not found
+        size_t idx = dict_object_find_key_n(obj, segment_start, len);
+        if (idx == (size_t)-1) return NULL; // key not found
+        DictValue *next_val = obj->pairs[idx].value;
 
         if (!slash) {
             // Last segment - return this value found
@@ -612,10 +730,108 @@ static int dict_parser_consume(DictJsonParser *p, char expect) {
     return 1;
 }
 
-static void dict_parser_skip_whitespace(DictJsonParser *p) {
-    while (p->pos < p->buffer_len && isspace((unsigned char)p->buffer[p->pos])) {
-        p->pos++;
+// --- Scanning helpers (vectorized where available) ---
+
+// Same set as isspace() in the C locale: ' ', \t, \n, \v, \f, \r
+static int dict_is_space(unsigned char c) {
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+// Characters that end a run of plain string bytes: '"', '\\' and controls
+static int dict_is_string_special(unsigned char c) {
+    return c == '"' || c == '\\' || c < 0x20;
+}
+
+#if defined(DICT_USE_SSE2)
+static unsigned int dict_ctz(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (unsigned int)idx;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+// Bit i set if byte i is whitespace
+static uint32_t dict_sse2_space_mask(__m128i c) {
+    __m128i sp = _mm_cmpeq_epi8(c, _mm_set1_epi8(' '));
+    __m128i t = _mm_sub_epi8(c, _mm_set1_epi8('\t'));
+    __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8('\r' - '\t')), t);
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(sp, ctl));
+}
+
+// Bit i set if byte i is '"', '\\' or below 0x20
+static uint32_t dict_sse2_special_mask(__m128i c) {
+    __m128i q = _mm_cmpeq_epi8(c, _mm_set1_epi8('"'));
+    __m128i bs = _mm_cmpeq_epi8(c, _mm_set1_epi8('\\'));
+    __m128i ctl = _mm_cmpeq_epi8(_mm_max_epu8(c, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F));
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(q, bs), ctl));
+}
+#endif
+
+#if defined(DICT_USE_AVX2)
+static uint32_t dict_avx2_space_mask(__m256i c) {
+    __m256i sp = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(' '));
+    __m256i t = _mm256_sub_epi8(c, _mm256_set1_epi8('\t'));
+    __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8('\r' - '\t')), t);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(sp, ctl));
+}
+
+static uint32_t dict_avx2_special_mask(__m256i c) {
+    __m256i q = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('"'));
+    __m256i bs = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\\'));
+    __m256i ctl = _mm256_cmpeq_epi8(_mm256_max_epu8(c, _mm256_set1_epi8(0x1F)), _mm256_set1_epi8(0x1F));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(q, bs), ctl));
+}
+#endif
+
+// Return the position of the first non-whitespace byte at or after pos
+static size_t dict_scan_whitespace(const char *buf, size_t pos, size_t len) {
+    // Most runs are empty or a single separator: settle those without SIMD
+    if (pos >= len || !dict_is_space((unsigned char)buf[pos])) return pos;
+    if (++pos >= len || !dict_is_space((unsigned char)buf[pos])) return pos;
+#if defined(DICT_USE_AVX2)
+    while (pos + 32 <= len) {
+        uint32_t other = ~dict_avx2_space_mask(_mm256_loadu_si256((const __m256i *)(buf + pos)));
+        if (other) return pos + dict_ctz(other);
+        pos += 32;
+    }
+#endif
+#if defined(DICT_USE_SSE2)
+    while (pos + 16 <= len) {
+        uint32_t other = ~dict_sse2_space_mask(_mm_loadu_si128((const __m128i *)(buf + pos))) & 0xFFFF;
+        if (other) return pos + dict_ctz(other);
+        pos += 16;
     }
+#endif
+    while (pos < len && dict_is_space((unsigned char)buf[pos])) pos++;
+    return pos;
+}
+
+// Return the position of the first '"', '\\' or control byte at or after pos
+// (len if there is none)
+static size_t dict_scan_string(const char *buf, size_t pos, size_t len) {
+#if defined(DICT_USE_AVX2)
+    while (pos + 32 <= len) {
+        uint32_t special = dict_avx2_special_mask(_mm256_loadu_si256((const __m256i *)(buf + pos)));
+        if (special) return pos + dict_ctz(special);
+        pos += 32;
+    }
+#endif
+#if defined(DICT_USE_SSE2)
+    while (pos + 16 <= len) {
+        uint32_t special = dict_sse2_special_mask(_mm_loadu_si128((const __m128i *)(buf + pos)));
+        if (special) return pos + dict_ctz(special);
+        pos += 16;
+    }
+#endif
+    while (pos < len && !dict_is_string_special((unsigned char)buf[pos])) pos++;
+    return pos;
+}
+
+static void dict_parser_skip_whitespace(DictJsonParser *p) {
+    p->pos = dict_scan_whitespace(p->buffer, p->pos, p->buffer_len);
 }
 
 // Parse literal keywords: true, false, null
@@ -629,6 +845,22 @@ static int dict_parse_literal(DictJsonParser *p, const char *literal) {
     return 0;
 }
 
+// Grow a malloc'd output buffer to hold at least need bytes (doubling).
+// Returns 1 on success, 0 on allocation failure (the buffer is left intact).
+static int dict_grow_buffer(char **buf, size_t *capacity, size_t need) {
+    if (need <= *capacity) return 1;
+    size_t new_capacity = *capacity ? *capacity : 64;
+    while (new_capacity < need) {
+        if (new_capacity > SIZE_MAX / 2) return 0;
+        new_capacity *= 2;
+    }
+    char *tmp = (char *)realloc(*buf, new_capacity);
+    if (!tmp) return 0;
+    *buf = tmp;
+    *capacity = new_capacity;
+    return 1;
+}
+
 // Parse JSON string with escapes, returns newly allocated C string or NULL on error
 // Advances p->pos beyond the string's closing quote if successful.
 static char *dict_parse_json_string(DictJsonParser *p) {
@@ -636,30 +868,35 @@ static char *dict_parse_json_string(DictJsonParser *p) {
         dict_parser_error(p, "Expected opening quote for string");
         return NULL;
     }
-    // Parse characters until closing quote or error
-    //size_t start_pos = p->pos;
-    size_t out_capacity = 64;
+    // Size the output for the plain run up to the first quote/escape
+    size_t run_end = dict_scan_string(p->buffer, p->pos, p->buffer_len);
+    size_t out_capacity = 0;
     size_t out_length = 0;
-    char *out = (char *)malloc(out_capacity);
-    if (!out) {
+    char *out = NULL;
+    if (!dict_grow_buffer(&out, &out_capacity, run_end - p->pos + 1)) {
         dict_parser_error(p, "Out of memory");
         return NULL;
     }
 
     while (p->pos < p->buffer_len) {
+        // Copy plain bytes in bulk
+        size_t run = run_end - p->pos;
+        if (run) {
+            if (!dict_grow_buffer(&out, &out_capacity, out_length + run + 1)) {
+                free(out);
+                dict_parser_error(p, "Out of memory");
+                return NULL;
+            }
+            memcpy(out + out_length, p->buffer + p->pos, run);
+            out_length += run;
+            p->pos = run_end;
+            if (p->pos >= p->buffer_len) break;
+        }
+
         char c = p->buffer[p->pos++];
 
         if (c == '"') {
-            // End of string
-            if (out_length >= out_capacity) {
-                char *tmp = (char *)realloc(out, out_length + 1);
-                if (!tmp) {
-                    free(out);
-                    dict_parser_error(p, "Out of memory");
-                    return NULL;
-                }
-                out = tmp;
-            }
+            // End of string (capacity always leaves room for the terminator)
             out[out_length] = '\0';
             return out;
         } else if (c == '\\') {
@@ -715,83 +952,125 @@ static char *dict_parse_json_string(DictJsonParser *p) {
                     dict_parser_error(p, "Invalid escape sequence");
                     return NULL;
             }
-            if (out_length + 1 >= out_capacity) {
-                size_t new_capacity = out_capacity * 2;
-                char *tmp = (char *)realloc(out, new_capacity);
-                if (!tmp) {
-                    free(out);
-                    dict_parser_error(p, "Out of memory");
-                    return NULL;
-                }
-                out = tmp;
-                out_capacity = new_capacity;
-            }
-            out[out_length++] = decoded;
-        } else {
-            // Normal char
-            if ((unsigned char)c < 0x20) {
+            if (!dict_grow_buffer(&out, &out_capacity, out_length + 2)) {
                 free(out);
-                dict_parser_error(p, "Unescaped control character in string");
+                dict_parser_error(p, "Out of memory");
                 return NULL;
             }
-            if (out_length + 1 >= out_capacity) {
-                size_t new_capacity = out_capacity * 2;
-                char *tmp = (char *)realloc(out, new_capacity);
-                if (!tmp) {
-                    free(out);
-                    dict_parser_error(p, "Out of memory");
-                    return NULL;
-                }
-                out = tmp;
-                out_capacity = new_capacity;
-            }
-            out[out_length++] = c;
+            out[out_length++] = decoded;
+        } else {
+            // Only control characters stop a plain run
+            free(out);
+            dict_parser_error(p, "Unescaped control character in string");
+            return NULL;
         }
+        run_end = dict_scan_string(p->buffer, p->pos, p->buffer_len);
     }
     free(out);
     dict_parser_error(p, "Unterminated string");
     return NULL;
 }
 
+// Exact powers of ten for the fast float path
+static const double dict_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
 // Parse a JSON number (integer or floating).
 // Returns 1 on success and sets *out_num, else 0 on failure.
 // Advances p->pos.
+// Integers of up to 19 digits are converted directly, as are decimals whose
+// digits fit in 53 bits with a power-of-ten scale of at most 22 (both exact,
+// so the result is identical to strtod); everything else goes through strtod.
 static int dict_parse_number(DictJsonParser *p, double *out_num) {
     size_t start_pos = p->pos;
     if (start_pos >= p->buffer_len) return 0;
 
     // JSON number pattern: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
-    // We'll scan chars that could belong to a JSON number.
-
+    // Scan it once, accumulating up to 19 significant digits on the way.
+    const char *buf = p->buffer;
+    size_t len = p->buffer_len;
     size_t pos = p->pos;
-    if (p->buffer[pos] == '-') pos++;
+    int negative = 0;
+    if (buf[pos] == '-') {
+        negative = 1;
+        pos++;
+    }
+
+    if (pos >= len) return 0;
 
-    if (pos >= p->buffer_len) return 0;
+    uint64_t mantissa = 0;
+    int digits = 0, frac_digits = 0, exponent = 0;
+    int exact = 1, is_integer = 1;
 
-    if (p->buffer[pos] == '0') {
+    if (buf[pos] == '0') {
         pos++;
-    } else if (isdigit((unsigned char)p->buffer[pos])) {
-        while (pos < p->buffer_len && isdigit((unsigned char)p->buffer[pos])) pos++;
+    } else if (buf[pos] >= '1' && buf[pos] <= '9') {
+        while (pos < len && buf[pos] >= '0' && buf[pos] <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(buf[pos] - '0');
+                digits++;
+            } else {
+                exact = 0;
+            }
+            pos++;
+        }
     } else {
         return 0;
     }
 
-    if (pos < p->buffer_len && p->buffer[pos] == '.') {
+    if (pos < len && buf[pos] == '.') {
         pos++;
-        if (pos >= p->buffer_len || !isdigit((unsigned char)p->buffer[pos])) return 0;
-        while (pos < p->buffer_len && isdigit((unsigned char)p->buffer[pos])) pos++;
+        is_integer = 0;
+        if (pos >= len || buf[pos] < '0' || buf[pos] > '9') return 0;
+        while (pos < len && buf[pos] >= '0' && buf[pos] <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(buf[pos] - '0');
+                digits++;
+                frac_digits++;
+            } else {
+                exact = 0;
+            }
+            pos++;
+        }
     }
 
-    if (pos < p->buffer_len && (p->buffer[pos] == 'e' || p->buffer[pos] == 'E')) {
+    if (pos < len && (buf[pos] == 'e' || buf[pos] == 'E')) {
         pos++;
-        if (pos < p->buffer_len && (p->buffer[pos] == '+' || p->buffer[pos] == '-')) pos++;
-        if (pos >= p->buffer_len || !isdigit((unsigned char)p->buffer[pos])) return 0;
-        while (pos < p->buffer_len && isdigit((unsigned char)p->buffer[pos])) pos++;
+        is_integer = 0;
+        int exp_negative = 0;
+        if (pos < len && (buf[pos] == '+' || buf[pos] == '-')) exp_negative = buf[pos++] == '-';
+        if (pos >= len || buf[pos] < '0' || buf[pos] > '9') return 0;
+        while (pos < len && buf[pos] >= '0' && buf[pos] <= '9') {
+            if (exponent < 100000) exponent = exponent * 10 + (buf[pos] - '0');
+            pos++;
+        }
+        if (exp_negative) exponent = -exponent;
     }
 
     size_t num_len = pos - p->pos;
     if (num_len == 0) return 0;
 
+    if (exact) {
+        if (is_integer) {
+            double val = (double)mantissa;
+            *out_num = negative ? -val : val;
+            p->pos = pos;
+            return 1;
+        }
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+        int scale = exponent - frac_digits;
+        if (mantissa <= ((uint64_t)1 << 53) && scale >= -22 && scale <= 22) {
+            double val = (double)mantissa;
+            val = scale < 0 ? val / dict_pow10[-scale] : val * dict_pow10[scale];
+            *out_num = negative ? -val : val;
+            p->pos = pos;
+            return 1;
+        }
+#endif
+    }
+
     // Copy the number substring into a null-terminated buffer
     char numbuf[64];
     if (num_len >= sizeof(numbuf)) {
@@ -1076,6 +1355,716 @@ static DictValue *dict_deserialize_json(const char *buffer, size_t buffer_len, s
     return result;
 }
 
+// --- Arena-backed JSON deserialization ---
+//
+// dict_deserialize_json() mallocs every node, key and string separately, which
+// dominates the cost of loading large documents. The arena parser below takes
+// a writable buffer and parses it in place: strings are unescaped inside the
+// input buffer and point straight into it, and every DictValue, array and
+// pairs table comes from a bump allocator. Teardown is dict_arena_release().
+//
+// Trees returned by dict_deserialize_json_arena() are read-only: never pass
+// them (or any node in them) to dict_destroy(), dict_object_set(),
+// dict_array_append() or dict_object_remove(). The input buffer must outlive
+// the tree.
+
+#define DICT_ARENA_ALIGN       8
+#define DICT_ARENA_MIN_BLOCK   (64 * 1024)
+
+typedef struct DictArenaBlock {
+    struct DictArenaBlock *next;
+    size_t capacity;
+    size_t used;
+} DictArenaBlock;
+
+typedef struct {
+    DictArenaBlock *head;   // block currently being filled (largest so far)
+    size_t bytes_used;      // total bytes handed out since the last reset
+} DictArena;
+
+// Initialize an empty arena; blocks are allocated lazily
+static void dict_arena_init(DictArena *arena) {
+    if (!arena) return;
+    arena->head = NULL;
+    arena->bytes_used = 0;
+}
+
+// Free every block owned by the arena
+static void dict_arena_release(DictArena *arena) {
+    if (!arena) return;
+    DictArenaBlock *block = arena->head;
+    while (block) {
+        DictArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arena->bytes_used = 0;
+}
+
+// Drop everything allocated so far but keep the largest block for reuse
+// (useful when the same document is reloaded repeatedly)
+static void dict_arena_reset(DictArena *arena) {
+    if (!arena || !arena->head) return;
+    DictArenaBlock *block = arena->head->next;
+    while (block) {
+        DictArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head->next = NULL;
+    arena->head->used = 0;
+    arena->bytes_used = 0;
+}
+
+// Make sure the head block can hold at least min_size more bytes.
+// Returns 1 on success, 0 on allocation failure.
+static int dict_arena_reserve(DictArena *arena, size_t min_size) {
+    if (arena->head && arena->head->capacity - arena->head->used >= min_size)
+        return 1;
+
+    size_t capacity = arena->head ? arena->head->capacity * 2 : DICT_ARENA_MIN_BLOCK;
+    if (capacity < min_size) capacity = min_size;
+    if (capacity > SIZE_MAX - sizeof(DictArenaBlock)) return 0;
+
+    DictArenaBlock *block = (DictArenaBlock *)malloc(sizeof(DictArenaBlock) + capacity);
+    if (!block) return 0;
+    block->next = arena->head;
+    block->capacity = capacity;
+    block->used = 0;
+    arena->head = block;
+    return 1;
+}
+
+// Bump-allocate size bytes (8-byte aligned). Returns NULL on failure.
+static void *dict_arena_alloc(DictArena *arena, size_t size) {
+    if (!arena) return NULL;
+    if (size > SIZE_MAX - DICT_ARENA_ALIGN) return NULL;
+    size = (size + (DICT_ARENA_ALIGN - 1)) & ~(size_t)(DICT_ARENA_ALIGN - 1);
+    if (!dict_arena_reserve(arena, size)) return NULL;
+
+    DictArenaBlock *block = arena->head;
+    void *ptr = (char *)(block + 1) + block->used;
+    block->used += size;
+    arena->bytes_used += size;
+    return ptr;
+}
+
+// Parser state for in-place parsing. Children of open arrays/objects are
+// collected on two scratch stacks and copied into the arena, exactly sized,
+// once the container closes.
+typedef struct {
+    DictJsonParser base;
+    char *insitu;               // writable alias of base.buffer
+    DictArena *arena;
+    DictValue **items;          // pending array items
+    size_t items_len, items_cap;
+    DictKeyValuePair *pairs;    // pending object members
+    size_t pairs_len, pairs_cap;
+} DictArenaParser;
+
+static DictValue *dict_arena_parse_value(DictArenaParser *ap);
+
+static DictValue *dict_arena_new_value(DictArenaParser *ap, DictType type) {
+    DictValue *val = (DictValue *)dict_arena_alloc(ap->arena, sizeof(DictValue));
+    if (!val) {
+        dict_parser_error(&ap->base, "Out of memory");
+        return NULL;
+    }
+    val->type = type;
+    return val;
+}
+
+// Parse a JSON string in place. Returns a pointer into the input buffer
+// (NUL-terminated where the closing quote was) or NULL on error.
+// Escapes are decoded with the same rules as dict_parse_json_string().
+static char *dict_arena_parse_string(DictArenaParser *ap) {
+    DictJsonParser *p = &ap->base;
+    if (!dict_parser_consume(p, '"')) {
+        dict_parser_error(p, "Expected opening quote for string");
+        return NULL;
+    }
+    char *buf = ap->insitu;
+    char *start = buf + p->pos;
+
+    // Fast path: no escapes, the string is used as-is
+    size_t pos = dict_scan_string(buf, p->pos, p->buffer_len);
+    if (pos < p->buffer_len && buf[pos] == '"') {
+        buf[pos] = '\0';
+        p->pos = pos + 1;
+        return start;
+    }
+
+    // Slow path: unescape in place, the output never outgrows the input
+    char *out = buf + pos;
+    p->pos = pos;
+    while (p->pos < p->buffer_len) {
+        size_t run_end = dict_scan_string(buf, p->pos, p->buffer_len);
+        if (run_end != p->pos) {
+            memmove(out, buf + p->pos, run_end - p->pos);
+            out += run_end - p->pos;
+            p->pos = run_end;
+            if (p->pos >= p->buffer_len) break;
+        }
+        char c = buf[p->pos++];
+        if (c == '"') {
+            *out = '\0';
+            return start;
+        } else if (c == '\\') {
+            if (p->pos >= p->buffer_len) {
+                dict_parser_error(p, "Unexpected end of input in escape sequence");
+                return NULL;
+            }
+            char esc = buf[p->pos++];
+            switch (esc) {
+                case '"': *out++ = '"'; break;
+                case '\\': *out++ = '\\'; break;
+                case '/': *out++ = '/'; break;
+                case 'b': *out++ = '\b'; break;
+                case 'f': *out++ = '\f'; break;
+                case 'n': *out++ = '\n'; break;
+                case 'r': *out++ = '\r'; break;
+                case 't': *out++ = '\t'; break;
+                case 'u': {
+                    if (p->pos + 4 > p->buffer_len) {
+                        dict_parser_error(p, "Incomplete unicode escape");
+                        return NULL;
+                    }
+                    unsigned int codepoint = 0;
+                    for (int i = 0; i < 4; i++) {
+                        char h = buf[p->pos++];
+                        unsigned int v = 0;
+                        if (h >= '0' && h <= '9') v = h - '0';
+                        else if (h >= 'a' && h <= 'f') v = h - 'a' + 10;
+                        else if (h >= 'A' && h <= 'F') v = h - 'A' + 10;
+                        else {
+                            dict_parser_error(p, "Invalid hex digit in unicode escape");
+                            return NULL;
+                        }
+                        codepoint = (codepoint << 4) | v;
+                    }
+                    *out++ = codepoint <= 0x7F ? (char)codepoint : '?';
+                    break;
+                }
+                default:
+                    dict_parser_error(p, "Invalid escape sequence");
+                    return NULL;
+            }
+        } else {
+            if ((unsigned char)c < 0x20) {
+                dict_parser_error(p, "Unescaped control character in string");
+                return NULL;
+            }
+            *out++ = c;
+        }
+    }
+    dict_parser_error(p, "Unterminated string");
+    return NULL;
+}
+
+// Grow one of the scratch stacks; returns 1 on success
+static int dict_arena_grow_stack(void **stack, size_t *cap, size_t elem_size) {
+    size_t new_cap = *cap ? *cap * 2 : 64;
+    if (new_cap > SIZE_MAX / elem_size) return 0;
+    void *tmp = realloc(*stack, new_cap * elem_size);
+    if (!tmp) return 0;
+    *stack = tmp;
+    *cap = new_cap;
+    return 1;
+}
+
+// Move the array items pushed since `mark` off the scratch stack into an
+// exactly sized arena block. Returns 1 on success.
+static int dict_arena_finish_array(DictArenaParser *ap, DictValue *array, size_t mark) {
+    size_t length = ap->items_len - mark;
+    DictValue **items = (DictValue **)dict_arena_alloc(ap->arena, length * sizeof(DictValue *));
+    if (!items) {
+        dict_parser_error(&ap->base, "Out of memory allocating array items");
+        return 0;
+    }
+    if (length)
+        memcpy(items, ap->items + mark, length * sizeof(DictValue *));
+    ap->items_len = mark;
+    array->array_value.items = items;
+    array->array_value.length = length;
+    return 1;
+}
+
+// Same for object members; large objects get their hash index from the
+// arena as well
+static int dict_arena_finish_object(DictArenaParser *ap, DictValue *obj, size_t mark) {
+    size_t count = ap->pairs_len - mark;
+    DictKeyValuePair *pairs = (DictKeyValuePair *)dict_arena_alloc(ap->arena, count * sizeof(DictKeyValuePair));
+    if (!pairs) {
+        dict_parser_error(&ap->base, "Out of memory creating object");
+        return 0;
+    }
+    if (count)
+        memcpy(pairs, ap->pairs + mark, count * sizeof(DictKeyValuePair));
+    ap->pairs_len = mark;
+    obj->object_value.pairs = pairs;
+    obj->object_value.count = count;
+    obj->object_value.capacity = count;
+
+    if (count > DICT_INDEX_MIN_KEYS && count <= UINT32_MAX / 4) {
+        uint32_t slots = dict_index_slots_for(count);
+        uint32_t *index = (uint32_t *)dict_arena_alloc(ap->arena, ((size_t)slots + 1) * sizeof(uint32_t));
+        if (index) {
+            index[0] = slots - 1;
+            obj->object_value.index = index;
+            dict_index_fill(&obj->object_value);
+        }
+    }
+    return 1;
+}
+
+static DictValue *dict_arena_parse_array(DictArenaParser *ap) {
+    DictJsonParser *p = &ap->base;
+    p->pos++; // consume '['
+
+    DictValue *array = dict_arena_new_value(ap, DICT_ARRAY);
+    if (!array) return NULL;
+    array->array_value.length = 0;
+    array->array_value.items = NULL;
+
+    dict_parser_skip_whitespace(p);
+    char c = 0;
+    if (dict_parser_peek(p, &c) && c == ']') {
+        p->pos++;
+        return array;
+    }
+
+    size_t mark = ap->items_len;
+    while (1) {
+        DictValue *item = dict_arena_parse_value(ap);
+        if (!item) return NULL;
+        if (ap->items_len == ap->items_cap &&
+            !dict_arena_grow_stack((void **)&ap->items, &ap->items_cap, sizeof(DictValue *))) {
+            dict_parser_error(p, "Out of memory resizing array");
+            return NULL;
+        }
+        ap->items[ap->items_len++] = item;
+
+        dict_parser_skip_whitespace(p);
+        if (!dict_parser_peek(p, &c)) {
+            dict_parser_error(p, "Unexpected end of input in array");
+            return NULL;
+        }
+        if (c == ',') {
+            p->pos++;
+            continue;
+        } else if (c == ']') {
+            p->pos++;
+            break;
+        }
+        dict_parser_error(p, "Expected ',' or ']' in array");
+        return NULL;
+    }
+
+    return dict_arena_finish_array(ap, array, mark) ? array : NULL;
+}
+
+static DictValue *dict_arena_parse_object(DictArenaParser *ap) {
+    DictJsonParser *p = &ap->base;
+    p->pos++; // consume '{'
+
+    DictValue *obj = dict_arena_new_value(ap, DICT_OBJECT);
+    if (!obj) return NULL;
+    obj->object_value.count = 0;
+    obj->object_value.capacity = 0;
+    obj->object_value.pairs = NULL;
+    obj->object_value.index = NULL;
+
+    dict_parser_skip_whitespace(p);
+    char c = 0;
+    if (dict_parser_peek(p, &c) && c == '}') {
+        p->pos++;
+        return obj;
+    }
+
+    size_t mark = ap->pairs_len;
+    while (1) {
+        dict_parser_skip_whitespace(p);
+        if (!dict_parser_peek(p, &c) || c != '"') {
+            dict_parser_error(p, "Expected string quote \" in object");
+            return NULL;
+        }
+        char *key = dict_arena_parse_string(ap);
+        if (!key) return NULL;
+        if (*key == '\0') {
+            dict_parser_error(p, "Empty key in object");
+            return NULL;
+        }
+
+        dict_parser_skip_whitespace(p);
+        if (!dict_parser_consume(p, ':')) {
+            dict_parser_error(p, "Expected ':' after key in object");
+            return NULL;
+        }
+
+        DictValue *value = dict_arena_parse_value(ap);
+        if (!value) return NULL;
+
+        if (ap->pairs_len == ap->pairs_cap &&
+            !dict_arena_grow_stack((void **)&ap->pairs, &ap->pairs_cap, sizeof(DictKeyValuePair))) {
+            dict_parser_error(p, "Failed to insert key-value pair in object");
+            return NULL;
+        }
+        ap->pairs[ap->pairs_len].key = key;
+        ap->pairs[ap->pairs_len].value = value;
+        ap->pairs_len++;
+
+        dict_parser_skip_whitespace(p);
+        if (!dict_parser_peek(p, &c)) {
+            dict_parser_error(p, "Unexpected end of input in object");
+            return NULL;
+        }
+        if (c == ',') {
+            p->pos++;
+            continue;
+        }
+        if (c == '}') {
+            p->pos++;
+            break;
+        }
+        dict_parser_error(p, "Expected ',' or '}' in object");
+        return NULL;
+    }
+
+    return dict_arena_finish_object(ap, obj, mark) ? obj : NULL;
+}
+
+static DictValue *dict_arena_parse_value(DictArenaParser *ap) {
+    DictJsonParser *p = &ap->base;
+    dict_parser_skip_whitespace(p);
+    char c = 0;
+    if (!dict_parser_peek(p, &c)) {
+        dict_parser_error(p, "Unexpected end of input");
+        return NULL;
+    }
+
+    DictValue *val = NULL;
+    if (c == '"') {
+        char *str = dict_arena_parse_string(ap);
+        if (!str) return NULL;
+        if ((val = dict_arena_new_value(ap, DICT_STRING)) != NULL)
+            val->string_value = str;
+    } else if (c == '{') {
+        val = dict_arena_parse_object(ap);
+    } else if (c == '[') {
+        val = dict_arena_parse_array(ap);
+    } else if ((c == '-') || (c >= '0' && c <= '9')) {
+        double num;
+        if (!dict_parse_number(p, &num)) return NULL;
+        if ((val = dict_arena_new_value(ap, DICT_NUMBER)) != NULL)
+            val->number_value = num;
+    } else if (dict_parse_literal(p, "true")) {
+        if ((val = dict_arena_new_value(ap, DICT_BOOL)) != NULL)
+            val->bool_value = 1;
+    } else if (dict_parse_literal(p, "false")) {
+        if ((val = dict_arena_new_value(ap, DICT_BOOL)) != NULL)
+            val->bool_value = 0;
+    } else if (dict_parse_literal(p, "null")) {
+        val = dict_arena_new_value(ap, DICT_NULL);
+    } else {
+        dict_parser_error(p, "Invalid value");
+    }
+    return val;
+}
+
+// Public API function: Parse JSON in place into an arena-owned tree.
+// arena: arena that owns every node (release with dict_arena_release())
+// buffer: writable JSON buffer; it is modified and must outlive the tree
+// content_len: length of JSON content within buffer
+// error_str/error_str_len: optional error message output, as for dict_deserialize_json()
+// Unlike dict_deserialize_json(), empty strings are accepted and duplicate
+// keys are kept as-is (dict_object_get() returns the first one).
+// Returns the root value or NULL on error (partial allocations stay in the
+// arena until it is reset or released).
+static DictValue *dict_deserialize_json_arena(DictArena *arena, char *buffer, size_t content_len, char *error_str, size_t error_str_len) {
+    if (!arena || !buffer || content_len == 0) {
+        if (error_str && error_str_len > 0)
+            snprintf(error_str, error_str_len, "Invalid input buffer or content length");
+        return NULL;
+    }
+
+    DictArenaParser ap;
+    memset(&ap, 0, sizeof(ap));
+    ap.base.buffer = buffer;
+    ap.base.buffer_len = content_len;
+    ap.base.error_str = error_str;
+    ap.base.error_str_len = error_str_len;
+    ap.insitu = buffer;
+    ap.arena = arena;
+
+    // UI descriptions need about 2.6 bytes of nodes per byte of input: get a
+    // big enough first block so typical documents never need a second one
+    if (content_len > SIZE_MAX / 3 || !dict_arena_reserve(arena, content_len * 3)) {
+        dict_parser_error(&ap.base, "Out of memory");
+        return NULL;
+    }
+
+    DictValue *result = dict_arena_parse_value(&ap);
+    free(ap.items);
+    free(ap.pairs);
+    if (!result) return NULL;
+
+    dict_parser_skip_whitespace(&ap.base);
+    if (ap.base.pos != content_len) {
+        if (error_str && error_str_len > 0) {
+            snprintf(error_str, error_str_len, "Extra trailing data after JSON value at pos %zu", ap.base.pos);
+        }
+        return NULL;
+    }
+    return result;
+}
+
+// --- Incremental (push) JSON stream ---
+//
+// dict_deserialize_json*() want the whole document in one buffer and reject
+// anything after the first value. DictJsonStream instead accepts input in
+// arbitrary chunks (e.g. straight from read() on a pipe or socket) and hands
+// back each complete top-level value as soon as its last byte has arrived.
+// Values may be separated by any amount of whitespace, so newline-delimited
+// JSON (one value per line) works as-is.
+//
+// Only the bytes of the value currently being received are buffered. The
+// framing state (nesting depth, inside-string) is kept between calls, so a
+// value split over many chunks is scanned once, and then parsed exactly once
+// in place into the stream's arena.
+//
+// Values returned by dict_json_stream_next() are arena trees (read-only, see
+// above) and stay valid until the next call to dict_json_stream_next(),
+// dict_json_stream_feed() or dict_json_stream_free().
+//
+// Malformed input must not stall the stream. A value longer than max_value
+// bytes is dropped with its buffered bytes, and the stream resumes after the
+// next newline. In NDJSON mode (ndjson set) a newline outside a string ends
+// the current line, so a value with unbalanced brackets is dropped there
+// instead of swallowing the values that follow it.
+
+#define DICT_STREAM_MAX_VALUE  (64u << 20)  // default for DictJsonStream.max_value
+
+typedef enum {
+    DICT_STREAM_VALUE,      // a complete value was returned
+    DICT_STREAM_NEED_MORE,  // all buffered input consumed, feed more
+    DICT_STREAM_ERROR,      // a malformed value was dropped, see s->error
+    DICT_STREAM_END         // dict_json_stream_finish() was called and input is exhausted
+} DictStreamStatus;
+
+typedef struct {
+    char *buf;              // unconsumed input
+    size_t len, cap;
+    size_t start;           // first byte of the value being framed
+    size_t scan;            // framing resumes here
+    size_t depth;           // open arrays/objects in the current value
+    int in_value;           // a value has started but not ended
+    int in_string;          // framing position is inside a string
+    int in_scalar;          // current value is a top-level number/literal
+    int skip_line;          // resynchronizing after garbage: drop up to '\n'
+    int eof;
+    int ndjson;             // one value per line, resynchronize at newlines
+    size_t max_value;       // longest accepted value in bytes, 0 for no limit
+    DictArena arena;        // owns the most recently returned tree
+    size_t values, errors;  // counters for diagnostics
+    char error[128];
+} DictJsonStream;
+
+static void dict_json_stream_init(DictJsonStream *s) {
+    if (!s) return;
+    memset(s, 0, sizeof(*s));
+    s->max_value = DICT_STREAM_MAX_VALUE;
+    dict_arena_init(&s->arena);
+}
+
+static void dict_json_stream_free(DictJsonStream *s) {
+    if (!s) return;
+    free(s->buf);
+    dict_arena_release(&s->arena);
+    memset(s, 0, sizeof(*s));
+}
+
+// Append a chunk of input. Bytes belonging to values that were already
+// returned are discarded first, which invalidates the last returned tree.
+// Returns 1 on success, 0 on allocation failure or after finish().
+static int dict_json_stream_feed(DictJsonStream *s, const char *data, size_t len) {
+    if (!s || s->eof) return 0;
+
+    if (s->start > 0) {
+        s->len -= s->start;
+        if (s->len > 0)
+            memmove(s->buf, s->buf + s->start, s->len);
+        s->scan -= s->start;
+        s->start = 0;
+    }
+    if (len == 0) return 1;
+    if (!data) return 0;
+    if (s->len > SIZE_MAX - len || !dict_grow_buffer(&s->buf, &s->cap, s->len + len))
+        return 0;
+    memcpy(s->buf + s->len, data, len);
+    s->len += len;
+    return 1;
+}
+
+// Signal end of input: a trailing top-level number or literal without a
+// delimiter is completed, and an unterminated array/object/string becomes
+// an error.
+static void dict_json_stream_finish(DictJsonStream *s) {
+    if (s) s->eof = 1;
+}
+
+// Drop the value being framed and report why
+static DictValue *dict_json_stream_fail(DictJsonStream *s, size_t resume, const char *msg, DictStreamStatus *status) {
+    if (msg && msg != s->error)
+        snprintf(s->error, sizeof(s->error), "%s", msg);
+    s->start = s->scan = resume;
+    s->in_value = s->in_string = s->in_scalar = 0;
+    s->depth = 0;
+    s->errors++;
+    *status = DICT_STREAM_ERROR;
+    return NULL;
+}
+
+// Advance the framing state over newly buffered bytes.
+// Returns 1 once the current value is complete (s->scan is one past its end),
+// -1 if a newline cut it short in NDJSON mode (s->scan is past the newline).
+static int dict_json_stream_frame(DictJsonStream *s) {
+    const char *buf = s->buf;
+    size_t pos = s->scan, len = s->len;
+
+    if (s->in_scalar) {
+        while (pos < len) {
+            char c = buf[pos];
+            if (dict_is_space((unsigned char)c) || c == '{' || c == '}' || c == '[' ||
+                c == ']' || c == ',' || c == ':' || c == '"')
+                break;
+            pos++;
+        }
+        s->scan = pos;
+        return pos < len || s->eof;
+    }
+
+    while (pos < len) {
+        if (s->in_string) {
+            pos = dict_scan_string(buf, pos, len);
+            if (pos >= len) break;
+            if (buf[pos] == '\\') {
+                // Resume at the backslash if its escaped byte has not arrived
+                if (pos + 1 >= len) break;
+                pos += 2;
+                continue;
+            }
+            if (buf[pos] == '\n' && s->ndjson) {
+                // A raw newline cannot be inside a string, the line ended early
+                s->in_string = 0;
+                s->scan = pos + 1;
+                return -1;
+            }
+            pos++;
+            if (buf[pos - 1] == '"') {
+                s->in_string = 0;
+                if (s->depth == 0) {
+                    s->scan = pos;
+                    return 1;
+                }
+            }
+            continue;
+        }
+
+        char c = buf[pos++];
+        if (c == '"') {
+            s->in_string = 1;
+        } else if (c == '{' || c == '[') {
+            s->depth++;
+        } else if (c == '}' || c == ']') {
+            if (--s->depth == 0) {
+                s->scan = pos;
+                return 1;
+            }
+        } else if (c == '\n' && s->ndjson) {
+            s->scan = pos;
+            return -1;
+        }
+    }
+    s->scan = pos;
+    return 0;
+}
+
+// Return the next complete top-level value, or NULL with *status set to
+// DICT_STREAM_NEED_MORE, DICT_STREAM_ERROR or DICT_STREAM_END. After an
+// error the offending value (or, for stray bytes between values, the rest of
+// that line) is skipped, so callers can simply keep calling.
+static DictValue *dict_json_stream_next(DictJsonStream *s, DictStreamStatus *status) {
+    DictStreamStatus dummy;
+    if (!status) status = &dummy;
+    if (!s) {
+        *status = DICT_STREAM_ERROR;
+        return NULL;
+    }
+
+    // The previous tree is released here; its input bytes go at the next feed
+    dict_arena_reset(&s->arena);
+
+    if (!s->in_value) {
+        if (s->skip_line) {
+            const char *nl = s->scan < s->len
+                ? (const char *)memchr(s->buf + s->scan, '\n', s->len - s->scan) : NULL;
+            s->start = s->scan = nl ? (size_t)(nl - s->buf) + 1 : s->len;
+            if (!nl) {
+                *status = s->eof ? DICT_STREAM_END : DICT_STREAM_NEED_MORE;
+                return NULL;
+            }
+            s->skip_line = 0;
+        }
+
+        size_t pos = dict_scan_whitespace(s->buf, s->scan, s->len);
+        s->start = s->scan = pos;
+        if (pos >= s->len) {
+            *status = s->eof ? DICT_STREAM_END : DICT_STREAM_NEED_MORE;
+            return NULL;
+        }
+
+        char c = s->buf[pos];
+        if (c == '{' || c == '[' || c == '"') {
+            s->in_value = 1;
+        } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+            s->in_value = 1;
+            s->in_scalar = 1;
+        } else {
+            s->skip_line = 1;
+            snprintf(s->error, sizeof(s->error), "Unexpected character '%c' between values", c);
+            return dict_json_stream_fail(s, pos + 1, s->error, status);
+        }
+    }
+
+    int framed = dict_json_stream_frame(s);
+    if (framed < 0)
+        return dict_json_stream_fail(s, s->scan, "Unterminated value at end of line", status);
+    if (s->max_value && s->scan - s->start > s->max_value) {
+        // Drop what is buffered; the rest of the value goes with its line
+        s->skip_line = !framed;
+        return dict_json_stream_fail(s, framed ? s->scan : s->len, "Value exceeds the maximum size", status);
+    }
+    if (!framed) {
+        if (s->eof)
+            return dict_json_stream_fail(s, s->len, "Unexpected end of stream inside a value", status);
+        *status = DICT_STREAM_NEED_MORE;
+        return NULL;
+    }
+
+    size_t start = s->start, end = s->scan;
+    s->start = end;
+    s->in_value = s->in_scalar = 0;
+
+    DictValue *val = dict_deserialize_json_arena(&s->arena, s->buf + start, end - start,
+                                                 s->error, sizeof(s->error));
+    if (!val)
+        return dict_json_stream_fail(s, end, s->error, status);
+    s->values++;
+    *status = DICT_STREAM_VALUE;
+    return val;
+}
+
 // --- BSON serialization and deserialization with int64 support added ---
 
 /* BSON constants and helpers */
@@ -1369,6 +2358,178 @@ static DictValue *dict_deserialize_bson(const uint8_t *buf, size_t buf_len) {
     return val;
 }
 
+// --- Zero-copy BSON reader ---
+//
+// dict_deserialize_bson() mallocs a copy of every key and string. BSON
+// already stores both NUL-terminated, so the arena reader below points keys
+// and strings straight into the input (e.g. an mmap'd file) and only
+// allocates the DictValue nodes and tables, from an arena. The result is a
+// read-only arena tree (see dict_deserialize_json_arena()); the input must
+// stay mapped for as long as the tree is used.
+
+// Read the document starting at `start`, which must end at or before `limit`
+static DictValue *bson_arena_read_document(DictArenaParser *ap, size_t start, size_t limit, int is_array) {
+    DictJsonParser *p = &ap->base;
+    const uint8_t *buf = (const uint8_t *)p->buffer;
+    p->pos = start;
+
+    if (limit - start < 5) {
+        dict_parser_error(p, "Truncated BSON document");
+        return NULL;
+    }
+    int32_t doc_len = bson_read_int32_le(buf + start);
+    if (doc_len < 5 || (size_t)doc_len > limit - start) {
+        dict_parser_error(p, "Invalid BSON document length");
+        return NULL;
+    }
+    size_t end = start + (size_t)doc_len - 1; // terminator byte
+    if (buf[end] != 0) {
+        dict_parser_error(p, "Missing BSON document terminator");
+        return NULL;
+    }
+
+    DictValue *result = dict_arena_new_value(ap, is_array ? DICT_ARRAY : DICT_OBJECT);
+    if (!result) return NULL;
+    size_t mark = is_array ? ap->items_len : ap->pairs_len;
+
+    size_t pos = start + 4;
+    while (pos < end) {
+        uint8_t type_byte = buf[pos++];
+
+        // Key is a CString; the document terminator bounds the search
+        const uint8_t *key_end = (const uint8_t *)memchr(buf + pos, 0, end + 1 - pos);
+        char *key = (char *)(buf + pos);
+        if (key_end == buf + end) {
+            // The key ran into the terminator, no room is left for a value
+            dict_parser_error(p, "Truncated BSON element");
+            return NULL;
+        }
+        pos = (size_t)(key_end - buf) + 1;
+        p->pos = pos;
+
+        DictValue *val = NULL;
+        size_t val_len = 0;
+        switch (type_byte) {
+            case BSON_TYPE_DOUBLE:
+            case BSON_TYPE_INT64:
+                if (end - pos < 8) {
+                    dict_parser_error(p, "Truncated BSON number");
+                    return NULL;
+                }
+                if (type_byte == BSON_TYPE_DOUBLE) {
+                    if ((val = dict_arena_new_value(ap, DICT_NUMBER)) != NULL)
+                        memcpy(&val->number_value, buf + pos, 8);
+                } else {
+                    if ((val = dict_arena_new_value(ap, DICT_INT64)) != NULL)
+                        val->int64_value = bson_read_int64_le(buf + pos);
+                }
+                val_len = 8;
+                break;
+            case BSON_TYPE_STRING: {
+                if (end - pos < 4) {
+                    dict_parser_error(p, "Truncated BSON string");
+                    return NULL;
+                }
+                int32_t str_len = bson_read_int32_le(buf + pos);
+                if (str_len < 1 || (size_t)str_len > end - pos - 4 ||
+                    buf[pos + 4 + (size_t)str_len - 1] != 0) {
+                    dict_parser_error(p, "Invalid BSON string");
+                    return NULL;
+                }
+                if ((val = dict_arena_new_value(ap, DICT_STRING)) != NULL)
+                    val->string_value = (char *)(buf + pos + 4);
+                val_len = 4 + (size_t)str_len;
+                break;
+            }
+            case BSON_TYPE_BOOL:
+                if (end - pos < 1) {
+                    dict_parser_error(p, "Truncated BSON bool");
+                    return NULL;
+                }
+                if ((val = dict_arena_new_value(ap, DICT_BOOL)) != NULL)
+                    val->bool_value = buf[pos] != 0;
+                val_len = 1;
+                break;
+            case BSON_TYPE_NULL:
+                val = dict_arena_new_value(ap, DICT_NULL);
+                break;
+            case BSON_TYPE_DOCUMENT:
+            case BSON_TYPE_ARRAY:
+                if (pos >= end) {
+                    dict_parser_error(p, "Truncated BSON element");
+                    return NULL;
+                }
+                val = bson_arena_read_document(ap, pos, end, type_byte == BSON_TYPE_ARRAY);
+                if (val) val_len = (size_t)bson_read_int32_le(buf + pos);
+                break;
+            default:
+                dict_parser_error(p, "Unsupported BSON element type");
+                return NULL;
+        }
+        if (!val) return NULL;
+
+        if (is_array) {
+            if (ap->items_len == ap->items_cap &&
+                !dict_arena_grow_stack((void **)&ap->items, &ap->items_cap, sizeof(DictValue *))) {
+                dict_parser_error(p, "Out of memory resizing array");
+                return NULL;
+            }
+            ap->items[ap->items_len++] = val;
+        } else {
+            if (ap->pairs_len == ap->pairs_cap &&
+                !dict_arena_grow_stack((void **)&ap->pairs, &ap->pairs_cap, sizeof(DictKeyValuePair))) {
+                dict_parser_error(p, "Out of memory resizing object");
+                return NULL;
+            }
+            ap->pairs[ap->pairs_len].key = key;
+            ap->pairs[ap->pairs_len].value = val;
+            ap->pairs_len++;
+        }
+        pos += val_len;
+    }
+
+    if (is_array)
+        return dict_arena_finish_array(ap, result, mark) ? result : NULL;
+    return dict_arena_finish_object(ap, result, mark) ? result : NULL;
+}
+
+// Public API: deserialize BSON without copying keys or strings.
+// arena: arena that owns every node (release with dict_arena_release())
+// buf/buf_len: a complete BSON document; it must outlive the tree
+// error_str/error_str_len: optional error message output
+// Returns the root object or NULL on error.
+static DictValue *dict_deserialize_bson_arena(DictArena *arena, const uint8_t *buf, size_t buf_len, char *error_str, size_t error_str_len) {
+    DictArenaParser ap;
+    memset(&ap, 0, sizeof(ap));
+    ap.base.buffer = (const char *)buf;
+    ap.base.buffer_len = buf_len;
+    ap.base.error_str = error_str;
+    ap.base.error_str_len = error_str_len;
+    ap.arena = arena;
+
+    if (!arena || !buf || buf_len < 5 || bson_read_int32_le(buf) != (int64_t)buf_len) {
+        dict_parser_error(&ap.base, "Invalid BSON buffer or length");
+        return NULL;
+    }
+
+    // Nodes only, strings stay in the input: about twice the input size
+    if (buf_len > SIZE_MAX / 2 || !dict_arena_reserve(arena, buf_len * 2)) {
+        dict_parser_error(&ap.base, "Out of memory");
+        return NULL;
+    }
+
+    DictValue *result = bson_arena_read_document(&ap, 0, buf_len, 0);
+    free(ap.items);
+    free(ap.pairs);
+    return result;
+}
+
+// Return 1 if buf looks like a whole BSON document rather than JSON text
+// (its length prefix matches the size and it ends with the terminator)
+static int dict_is_bson(const uint8_t *buf, size_t buf_len) {
+    return buf && buf_len >= 5 && buf_len <= INT32_MAX &&
+           bson_read_int32_le(buf) == (int32_t)buf_len && buf[buf_len - 1] == 0;
+}
 
 #ifdef __cplusplus
 }
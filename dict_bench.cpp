@@ -0,0 +1,474 @@
+// dict_bench -- micro benchmarks for the dict.h JSON/BSON code paths
+//
+// Usage: dict_bench [widget_count] [iterations]
+//
+// Generates a synthetic ngserver-style UI description (nested Views with
+// Buttons and Labels) and compares the malloc-per-node parser against the
+// arena-backed in-place parser. Also measures DictObject insert/lookup cost
+// for objects of 10, 1k and 100k keys against a plain linear scan, and the
+// incremental DictJsonStream on newline-delimited updates fed in small chunks,
+// and JSON vs BSON layout file load time for a 10k-widget tree. Malformed
+// stream input and BSON documents are checked to be rejected without losing
+// the input that follows or reading past the end.
+//
+// Build with -DDICT_NO_SIMD (or -mavx2) to compare the scanner variants.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dict.h"
+#include "dict_file.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Build a UI tree with roughly `widget_count` widgets, 8 leaves per View
+static std::string make_ui_json(int widget_count) {
+    std::string json;
+    json.reserve((size_t)widget_count * 160);
+    json += "{\n  \"id\": \"main_window\",\n  \"type\": \"Window\",\n"
+            "  \"title\": \"Benchmark \\\"window\\\"\",\n  \"width\": 1280,\n"
+            "  \"height\": 720,\n  \"layout\": \"VBoxLayout\",\n  \"children\": [\n";
+    char buf[512];
+    int id = 0;
+    bool first_view = true;
+    while (id < widget_count) {
+        snprintf(buf, sizeof(buf),
+                 "%s    {\n      \"id\": \"view_%d\",\n      \"type\": \"View\",\n"
+                 "      \"layout\": \"HBoxLayout\",\n      \"children\": [\n",
+                 first_view ? "" : ",\n", id++);
+        json += buf;
+        first_view = false;
+        for (int i = 0; i < 8 && id < widget_count; ++i, ++id) {
+            if (i & 1)
+                snprintf(buf, sizeof(buf),
+                         "%s        { \"id\": \"label_%d\", \"type\": \"Label\", "
+                         "\"text\": \"Status line %d\\twith escapes\\n\", \"font_size\": %d }",
+                         i ? ",\n" : "", id, id, 12 + i);
+            else
+                snprintf(buf, sizeof(buf),
+                         "%s        { \"id\": \"button_%d\", \"type\": \"Button\", "
+                         "\"label\": \"Button %d\", \"enabled\": %s, \"weight\": %.3f }",
+                         i ? ",\n" : "", id, id, (id % 3) ? "true" : "false", id * 0.125);
+            json += buf;
+        }
+        json += "\n      ]\n    }";
+    }
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+static size_t count_nodes(const DictValue *val) {
+    if (!val) return 0;
+    size_t n = 1;
+    if (val->type == DICT_ARRAY)
+        for (size_t i = 0; i < val->array_value.length; ++i)
+            n += count_nodes(val->array_value.items[i]);
+    else if (val->type == DICT_OBJECT)
+        for (size_t i = 0; i < val->object_value.count; ++i)
+            n += count_nodes(val->object_value.pairs[i].value);
+    return n;
+}
+
+// Serialize a tree to compact JSON (used to check both parsers agree)
+static std::string to_json(const DictValue *val, size_t capacity) {
+    std::string out(capacity, '\0');
+    if (!dict_serialize_json(val, &out[0], out.size(), 0))
+        return std::string();
+    out.resize(strlen(out.c_str()));
+    return out;
+}
+
+static void bench_json_parse(const std::string &json, int iterations) {
+    char error[256];
+    printf("JSON parse: %.2f MB document, %d iterations\n",
+           json.size() / (1024.0 * 1024.0), iterations);
+
+    // malloc-per-node parser
+    double best_legacy = 1e30;
+    size_t legacy_nodes = 0;
+    std::string legacy_text;
+    for (int it = 0; it < iterations; ++it) {
+        auto start = Clock::now();
+        DictValue *root = dict_deserialize_json(json.data(), json.size(), json.size(),
+                                                error, sizeof(error));
+        if (!root) {
+            printf("  legacy parse failed: %s\n", error);
+            return;
+        }
+        legacy_nodes = count_nodes(root);
+        if (it == 0)
+            legacy_text = to_json(root, json.size() * 2);
+        dict_destroy(root);
+        double ms = elapsed_ms(start);
+        if (ms < best_legacy) best_legacy = ms;
+    }
+
+    // arena parser, including the copy into a writable buffer
+    DictArena arena;
+    dict_arena_init(&arena);
+    std::vector<char> scratch(json.size());
+    double best_arena = 1e30;
+    size_t arena_nodes = 0, arena_bytes = 0;
+    for (int it = 0; it < iterations; ++it) {
+        auto start = Clock::now();
+        memcpy(scratch.data(), json.data(), json.size());
+        DictValue *root = dict_deserialize_json_arena(&arena, scratch.data(), scratch.size(),
+                                                      error, sizeof(error));
+        if (!root) {
+            printf("  arena parse failed: %s\n", error);
+            dict_arena_release(&arena);
+            return;
+        }
+        arena_nodes = count_nodes(root);
+        arena_bytes = arena.bytes_used;
+        if (it == 0 && to_json(root, json.size() * 2) != legacy_text)
+            printf("  WARNING: arena tree differs from legacy tree\n");
+        dict_arena_reset(&arena);
+        double ms = elapsed_ms(start);
+        if (ms < best_arena) best_arena = ms;
+    }
+    dict_arena_release(&arena);
+
+    double mb = json.size() / (1024.0 * 1024.0);
+    printf("  legacy : %8.2f ms  %7.1f MB/s  (%zu nodes, parse + destroy)\n",
+           best_legacy, mb / (best_legacy / 1000.0), legacy_nodes);
+    printf("  arena  : %8.2f ms  %7.1f MB/s  (%zu nodes, copy + parse + reset, %.2f MB arena)\n",
+           best_arena, mb / (best_arena / 1000.0), arena_nodes, arena_bytes / (1024.0 * 1024.0));
+    printf("  speedup: %.2fx\n", best_legacy / best_arena);
+}
+
+// Linear strcmp scan, i.e. what every lookup cost before objects were indexed
+static DictValue *linear_get(const DictValue *obj, const char *key) {
+    for (size_t i = 0; i < obj->object_value.count; ++i)
+        if (strcmp(obj->object_value.pairs[i].key, key) == 0)
+            return obj->object_value.pairs[i].value;
+    return nullptr;
+}
+
+static void bench_object_keys(size_t key_count) {
+    std::vector<std::string> keys(key_count);
+    for (size_t i = 0; i < key_count; ++i)
+        keys[i] = "property_" + std::to_string(i * 2654435761u % 1000003u) + "_" + std::to_string(i);
+
+    std::vector<size_t> order(key_count);
+    for (size_t i = 0; i < key_count; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(1234));
+
+    // Repeat small cases so the timings are measurable
+    int repeats = (int)std::max<size_t>(1, 200000 / key_count);
+
+    auto start = Clock::now();
+    DictValue *obj = nullptr;
+    for (int r = 0; r < repeats; ++r) {
+        if (obj) dict_destroy(obj);
+        obj = dict_create_object();
+        for (size_t i = 0; i < key_count; ++i)
+            dict_object_set(obj, keys[i].c_str(), dict_create_int64((int64_t)i));
+    }
+    double insert_ns = elapsed_ms(start) * 1e6 / ((double)repeats * key_count);
+
+    size_t found = 0;
+    start = Clock::now();
+    for (int r = 0; r < repeats; ++r)
+        for (size_t i : order)
+            found += dict_object_get(obj, keys[i].c_str()) != nullptr;
+    double hashed_ns = elapsed_ms(start) * 1e6 / ((double)repeats * key_count);
+
+    // Linear scans are O(n): sample at most 2000 lookups per repeat
+    size_t samples = std::min<size_t>(key_count, 2000);
+    start = Clock::now();
+    for (int r = 0; r < repeats; ++r)
+        for (size_t s = 0; s < samples; ++s)
+            found += linear_get(obj, keys[order[s]].c_str()) != nullptr;
+    double linear_ns = elapsed_ms(start) * 1e6 / ((double)repeats * samples);
+
+    // Path lookup through a wrapper object ("root/<key>")
+    DictValue *root = dict_create_object();
+    dict_object_set(root, "root", obj);
+    std::string path;
+    start = Clock::now();
+    for (int r = 0; r < repeats; ++r)
+        for (size_t i : order) {
+            path = "root/" + keys[i];
+            found += dict_find_path(root, path.c_str()) != nullptr;
+        }
+    double path_ns = elapsed_ms(start) * 1e6 / ((double)repeats * key_count);
+    dict_destroy(root);
+
+    printf("  %6zu keys: insert %7.1f ns  get %6.1f ns  find_path %6.1f ns  linear get %9.1f ns%s\n",
+           key_count, insert_ns, hashed_ns, path_ns, linear_ns,
+           found == (size_t)repeats * (2 * key_count + samples) ? "" : "  (MISSING KEYS)");
+}
+
+// Newline-delimited stream of small update messages, fed in fixed-size chunks
+// (as they would arrive from a pipe) through DictJsonStream
+static void bench_json_stream(int message_count, int iterations) {
+    std::string ndjson;
+    char buf[256];
+    for (int i = 0; i < message_count; ++i) {
+        snprintf(buf, sizeof(buf),
+                 "{\"op\": \"set\", \"id\": \"label_%d\", \"prop\": \"text\", "
+                 "\"value\": \"Status %d\\tupdated\", \"seq\": %d}\n", i, i, i);
+        ndjson += buf;
+    }
+    printf("JSON stream: %d NDJSON messages (%.2f MB)\n", message_count,
+           ndjson.size() / (1024.0 * 1024.0));
+
+    for (size_t chunk : { (size_t)64, (size_t)4096, (size_t)65536 }) {
+        double best = 1e30;
+        size_t values = 0, errors = 0;
+        for (int it = 0; it < iterations; ++it) {
+            auto start = Clock::now();
+            DictJsonStream stream;
+            dict_json_stream_init(&stream);
+            for (size_t pos = 0; pos < ndjson.size(); pos += chunk) {
+                dict_json_stream_feed(&stream, ndjson.data() + pos,
+                                      std::min(chunk, ndjson.size() - pos));
+                DictStreamStatus status;
+                while (dict_json_stream_next(&stream, &status) || status == DICT_STREAM_ERROR)
+                    ;
+            }
+            dict_json_stream_finish(&stream);
+            DictStreamStatus status;
+            while (dict_json_stream_next(&stream, &status) || status == DICT_STREAM_ERROR)
+                ;
+            values = stream.values;
+            errors = stream.errors;
+            dict_json_stream_free(&stream);
+            double ms = elapsed_ms(start);
+            if (ms < best) best = ms;
+        }
+        printf("  %6zu byte chunks: %8.2f ms  %7.1f MB/s  %6.0f ns/message%s\n",
+               chunk, best, ndjson.size() / (1024.0 * 1024.0) / (best / 1000.0),
+               best * 1e6 / message_count,
+               values == (size_t)message_count && errors == 0 ? "" : "  (LOST MESSAGES)");
+    }
+}
+
+// Feed `input` in small chunks and count the values and errors; `max_buffered`
+// is the most input the stream held at once
+static void stream_chunks(DictJsonStream *stream, const std::string &input,
+                          size_t *values, size_t *errors, size_t *max_buffered) {
+    *max_buffered = 0;
+    for (size_t pos = 0; pos < input.size(); pos += 64) {
+        dict_json_stream_feed(stream, input.data() + pos, std::min<size_t>(64, input.size() - pos));
+        *max_buffered = std::max(*max_buffered, stream->len);
+        DictStreamStatus status;
+        while (dict_json_stream_next(stream, &status) || status == DICT_STREAM_ERROR)
+            ;
+    }
+    dict_json_stream_finish(stream);
+    DictStreamStatus status;
+    while (dict_json_stream_next(stream, &status) || status == DICT_STREAM_ERROR)
+        ;
+    *values = stream->values;
+    *errors = stream->errors;
+}
+
+// A malformed value must cost one error, not the rest of the stream: an
+// NDJSON line with unbalanced brackets or an unterminated string, and an
+// unterminated value that would otherwise be buffered forever
+static void check_json_stream_malformed() {
+    std::string good;
+    for (int i = 0; i < 100; ++i)
+        good += "{\"op\": \"set\", \"id\": \"label_" + std::to_string(i) + "\"}\n";
+
+    size_t values, errors, buffered;
+    DictJsonStream stream;
+    dict_json_stream_init(&stream);
+    stream.ndjson = 1;
+    stream_chunks(&stream, "{\"a\":[}\n" + good, &values, &errors, &buffered);
+    dict_json_stream_free(&stream);
+    printf("  unbalanced NDJSON line: %zu values, %zu errors%s\n", values, errors,
+           values == 100 && errors == 1 ? "" : "  (LOST MESSAGES)");
+
+    dict_json_stream_init(&stream);
+    stream.ndjson = 1;
+    stream_chunks(&stream, "{\"text\": \"no closing quote}\n" + good, &values, &errors, &buffered);
+    dict_json_stream_free(&stream);
+    printf("  unterminated string: %zu values, %zu errors%s\n", values, errors,
+           values == 100 && errors == 1 ? "" : "  (LOST MESSAGES)");
+
+    dict_json_stream_init(&stream);
+    stream.max_value = 4096;
+    stream_chunks(&stream, "{\"a\": [\"" + std::string(1 << 20, 'x') + "\n" + good,
+                  &values, &errors, &buffered);
+    dict_json_stream_free(&stream);
+    printf("  oversized value: %zu values, %zu errors, %zu bytes buffered at most%s\n",
+           values, errors, buffered,
+           values == 100 && errors == 1 && buffered <= 4096 + 64 ? "" : "  (LOST MESSAGES)");
+}
+
+// Time `load` (best of `iterations`), which returns the node count or 0
+template <typename F>
+static double best_of(int iterations, size_t *nodes, F load) {
+    double best = 1e30;
+    for (int it = 0; it < iterations; ++it) {
+        auto start = Clock::now();
+        *nodes = load();
+        double ms = elapsed_ms(start);
+        if (ms < best) best = ms;
+    }
+    return best;
+}
+
+// Load the same UI tree from JSON and BSON files the way ngserver does:
+// map the file, parse it, walk the tree once and tear everything down
+static void bench_layout_load(int widget_count, int iterations) {
+    std::string json = make_ui_json(widget_count);
+    char error[256];
+
+    DictArena arena;
+    dict_arena_init(&arena);
+    std::vector<char> scratch(json.begin(), json.end());
+    DictValue *tree = dict_deserialize_json_arena(&arena, scratch.data(), scratch.size(),
+                                                  error, sizeof(error));
+    std::vector<uint8_t> bson(json.size() * 2);
+    size_t bson_size = tree ? dict_serialize_bson(tree, bson.data(), bson.size()) : 0;
+    dict_arena_release(&arena);
+    if (!bson_size) {
+        printf("Layout load: failed to build BSON document\n");
+        return;
+    }
+
+    std::string json_path = "dict_bench_layout.json", bson_path = "dict_bench_layout.bson";
+    FILE *f = fopen(json_path.c_str(), "wb");
+    bool ok = f && fwrite(json.data(), 1, json.size(), f) == json.size();
+    if (f) fclose(f);
+    f = fopen(bson_path.c_str(), "wb");
+    ok = ok && f && fwrite(bson.data(), 1, bson_size, f) == bson_size;
+    if (f) fclose(f);
+    if (!ok) {
+        printf("Layout load: cannot write temporary files\n");
+        return;
+    }
+
+    printf("Layout load: %d widgets, JSON %.2f MB, BSON %.2f MB\n", widget_count,
+           json.size() / (1024.0 * 1024.0), bson_size / (1024.0 * 1024.0));
+
+    size_t nodes[4] = { 0, 0, 0, 0 };
+    double ms[4];
+    ms[0] = best_of(iterations, &nodes[0], [&]() -> size_t {
+        DictMappedFile file;
+        if (!dict_file_map(&file, json_path.c_str())) return 0;
+        DictValue *root = dict_deserialize_json((const char *)file.data, file.size, file.size,
+                                                error, sizeof(error));
+        size_t n = count_nodes(root);
+        dict_destroy(root);
+        dict_file_unmap(&file);
+        return n;
+    });
+    ms[1] = best_of(iterations, &nodes[1], [&]() -> size_t {
+        DictMappedFile file;
+        if (!dict_file_map(&file, json_path.c_str())) return 0;
+        DictArena a;
+        dict_arena_init(&a);
+        std::vector<char> text((const char *)file.data, (const char *)file.data + file.size);
+        size_t n = count_nodes(dict_deserialize_json_arena(&a, text.data(), text.size(),
+                                                           error, sizeof(error)));
+        dict_arena_release(&a);
+        dict_file_unmap(&file);
+        return n;
+    });
+    ms[2] = best_of(iterations, &nodes[2], [&]() -> size_t {
+        DictMappedFile file;
+        if (!dict_file_map(&file, bson_path.c_str())) return 0;
+        DictValue *root = dict_deserialize_bson(file.data, file.size);
+        size_t n = count_nodes(root);
+        dict_destroy(root);
+        dict_file_unmap(&file);
+        return n;
+    });
+    ms[3] = best_of(iterations, &nodes[3], [&]() -> size_t {
+        DictMappedFile file;
+        if (!dict_file_map(&file, bson_path.c_str())) return 0;
+        DictArena a;
+        dict_arena_init(&a);
+        size_t n = count_nodes(dict_deserialize_bson_arena(&a, file.data, file.size,
+                                                           error, sizeof(error)));
+        dict_arena_release(&a);
+        dict_file_unmap(&file);
+        return n;
+    });
+
+    const char *names[4] = { "JSON legacy", "JSON arena", "BSON legacy", "BSON mmap" };
+    for (int i = 0; i < 4; ++i)
+        printf("  %-11s: %8.2f ms  (%zu nodes)%s\n", names[i], ms[i], nodes[i],
+               nodes[i] == nodes[0] && nodes[i] ? "" : "  (MISMATCH)");
+    printf("  BSON mmap vs JSON arena: %.2fx\n", ms[1] / ms[3]);
+
+    remove(json_path.c_str());
+    remove(bson_path.c_str());
+}
+
+// Malformed BSON the mmap reader must reject without reading past the input:
+// each passes dict_is_bson(), the check ngserver and dictconv make
+static void check_bson_truncated() {
+    static const std::vector<uint8_t> documents[] = {
+        // A bool element whose key runs into the terminator
+        { 0x06, 0x00, 0x00, 0x00, 0x01, 0x00 },
+        // The same document nested in an object
+        { 0x0e, 0x00, 0x00, 0x00, 0x03, 'a', 0x00,
+          0x06, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00 },
+        // A nested document with no bytes left before the terminator
+        { 0x07, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00 },
+    };
+    size_t count = sizeof(documents) / sizeof(documents[0]), accepted = 0;
+    for (const std::vector<uint8_t> &doc : documents) {
+        // An exact-size heap copy, so that an overread shows up under ASan
+        uint8_t *buf = (uint8_t *)malloc(doc.size());
+        memcpy(buf, doc.data(), doc.size());
+        char error[256];
+        DictArena arena;
+        dict_arena_init(&arena);
+        if (!dict_is_bson(buf, doc.size()) ||
+            dict_deserialize_bson_arena(&arena, buf, doc.size(), error, sizeof(error)))
+            accepted++;
+        dict_arena_release(&arena);
+        free(buf);
+    }
+    printf("  truncated BSON: %zu of %zu rejected%s\n", count - accepted, count,
+           accepted ? "  (ACCEPTED MALFORMED INPUT)" : "");
+}
+
+int main(int argc, char **argv) {
+    int widgets = argc > 1 ? atoi(argv[1]) : 50000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 10;
+    if (widgets <= 0 || iterations <= 0) {
+        fprintf(stderr, "usage: %s [widget_count] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+#if defined(DICT_USE_AVX2)
+    printf("JSON scanner: AVX2\n");
+#elif defined(DICT_USE_SSE2)
+    printf("JSON scanner: SSE2\n");
+#else
+    printf("JSON scanner: scalar\n");
+#endif
+
+    std::string json = make_ui_json(widgets);
+    bench_json_parse(json, iterations);
+
+    printf("DictObject keys (per operation):\n");
+    for (size_t n : { (size_t)10, (size_t)1000, (size_t)100000 })
+        bench_object_keys(n);
+
+    bench_json_stream(widgets * 2, iterations);
+    check_json_stream_malformed();
+
+    bench_layout_load(10000, iterations);
+    check_bson_truncated();
+    return 0;
+}
@@ -0,0 +1,146 @@
+#ifndef DICT_FILE_H
+#define DICT_FILE_H
+
+// Read-only file mapping for feeding layout files to the dict.h readers
+// without copying them: dict_deserialize_bson_arena() points keys and
+// strings straight into the mapping. Falls back to reading the file into a
+// malloc'd buffer where mmap is unavailable or fails (e.g. empty files).
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    int mapped;         // 1 if data is a mapping, 0 if it was malloc'd
+#if defined(_WIN32)
+    HANDLE file, mapping;
+#endif
+} DictMappedFile;
+
+// Read the whole file into memory (fallback path). Returns 1 on success.
+static int dict_file_read_all(DictMappedFile *mf, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    uint8_t *data = NULL;
+    size_t size = 0, cap = 0;
+    for (;;) {
+        if (size == cap) {
+            size_t new_cap = cap ? cap * 2 : 64 * 1024;
+            uint8_t *tmp = (uint8_t *)realloc(data, new_cap);
+            if (!tmp) {
+                free(data);
+                fclose(f);
+                return 0;
+            }
+            data = tmp;
+            cap = new_cap;
+        }
+        size_t n = fread(data + size, 1, cap - size, f);
+        size += n;
+        if (n == 0) break;
+    }
+    int ok = !ferror(f);
+    fclose(f);
+    if (!ok) {
+        free(data);
+        return 0;
+    }
+    mf->data = data;
+    mf->size = size;
+    mf->mapped = 0;
+    return 1;
+}
+
+// Map `path` read-only. Returns 1 on success; release with dict_file_unmap().
+static int dict_file_map(DictMappedFile *mf, const char *path) {
+    if (!mf || !path) return 0;
+    memset(mf, 0, sizeof(*mf));
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && (uint64_t)size.QuadPart <= SIZE_MAX) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (view) {
+                mf->data = (const uint8_t *)view;
+                mf->size = (size_t)size.QuadPart;
+                mf->mapped = 1;
+                mf->file = file;
+                mf->mapping = mapping;
+                return 1;
+            }
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+        (uint64_t)st.st_size <= SIZE_MAX) {
+        void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            close(fd);
+#if defined(MADV_SEQUENTIAL)
+            madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+            mf->data = (const uint8_t *)view;
+            mf->size = (size_t)st.st_size;
+            mf->mapped = 1;
+            return 1;
+        }
+    }
+    close(fd);
+#endif
+
+    return dict_file_read_all(mf, path);
+}
+
+static void dict_file_unmap(DictMappedFile *mf) {
+    if (!mf || !mf->data) return;
+    if (mf->mapped) {
+#if defined(_WIN32)
+        UnmapViewOfFile((void *)mf->data);
+        CloseHandle(mf->mapping);
+        CloseHandle(mf->file);
+#else
+        munmap((void *)mf->data, mf->size);
+#endif
+    } else {
+        free((void *)mf->data);
+    }
+    memset(mf, 0, sizeof(*mf));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DICT_FILE_H
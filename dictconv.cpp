@@ -0,0 +1,88 @@
+// dictconv -- convert ngserver layout files between JSON and BSON
+//
+// Usage: dictconv <input> <output> [--pretty]
+//
+// The direction is picked from the input: a BSON document is written out as
+// JSON (pretty-printed with --pretty), anything else is parsed as JSON and
+// written as BSON, which ngserver loads without parsing or copying strings.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "dict.h"
+#include "dict_file.h"
+
+static bool write_file(const char *path, const void *data, size_t size) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, size, f) == size;
+    ok = fclose(f) == 0 && ok;
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 4 || (argc == 4 && strcmp(argv[3], "--pretty") != 0)) {
+        fprintf(stderr, "usage: %s <input> <output> [--pretty]\n", argv[0]);
+        return 1;
+    }
+    bool pretty = argc == 4;
+
+    DictMappedFile in;
+    if (!dict_file_map(&in, argv[1])) {
+        fprintf(stderr, "error: cannot read '%s'\n", argv[1]);
+        return 1;
+    }
+
+    char error[256] = "";
+    DictArena arena;
+    dict_arena_init(&arena);
+    std::vector<char> text;
+    bool to_json = dict_is_bson(in.data, in.size) != 0;
+    DictValue *root = nullptr;
+    if (to_json) {
+        root = dict_deserialize_bson_arena(&arena, in.data, in.size, error, sizeof(error));
+    } else if (in.size > 0) {
+        text.assign((const char *)in.data, (const char *)in.data + in.size);
+        root = dict_deserialize_json_arena(&arena, text.data(), text.size(), error, sizeof(error));
+    } else {
+        snprintf(error, sizeof(error), "Empty file");
+    }
+
+    int status = 1;
+    if (!root) {
+        fprintf(stderr, "error: failed to parse '%s': %s\n", argv[1], error);
+    } else if (!to_json && root->type != DICT_OBJECT) {
+        fprintf(stderr, "error: BSON needs an object at the top level\n");
+    } else {
+        // Neither serializer reports the size it needs: grow until it fits
+        std::vector<uint8_t> out(in.size * 2 + 1024);
+        size_t size = 0;
+        for (;;) {
+            if (to_json) {
+                if (dict_serialize_json(root, (char *)out.data(), out.size(), pretty))
+                    size = strlen((const char *)out.data());
+            } else {
+                size = dict_serialize_bson(root, out.data(), out.size());
+            }
+            if (size || out.size() > ((size_t)1 << 32)) break;
+            out.resize(out.size() * 2);
+        }
+
+        if (!size)
+            fprintf(stderr, "error: failed to serialize '%s'\n", argv[1]);
+        else if (!write_file(argv[2], out.data(), size))
+            fprintf(stderr, "error: cannot write '%s'\n", argv[2]);
+        else {
+            printf("%s -> %s: %zu bytes %s -> %zu bytes %s\n", argv[1], argv[2],
+                   in.size, to_json ? "BSON" : "JSON", size, to_json ? "JSON" : "BSON");
+            status = 0;
+        }
+    }
+
+    dict_arena_release(&arena);
+    dict_file_unmap(&in);
+    return status;
+}
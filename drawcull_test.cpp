@@ -0,0 +1,170 @@
+// drawcull_test -- checks that Widget::draw skips subtrees outside the scissor
+//
+// Usage: drawcull_test [labels]   (run from the repository root, it loads
+//                                  resources/Roboto-Regular.ttf)
+//
+// Lays out a ScrollPanel holding `labels` Labels (100k by default) and draws
+// it at a few scroll positions into a NanoVG context whose back-end only
+// counts what it is asked to render. Only the rows inside the viewport may
+// be drawn, so the number of Label::draw() calls must not exceed what fits
+// in the viewport, and the fill/stroke/triangle submissions at the top must
+// match those of a panel holding just a screenful of labels. No window or GL
+// context is needed. Exits with 1 if culling did not happen.
+
+#include <nanogui/widget.h>
+#include <nanogui/label.h>
+#include <nanogui/layout.h>
+#include <nanogui/scrollpanel.h>
+#include <nanovg.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace nanogui;
+using Clock = std::chrono::steady_clock;
+
+static const Vector2i viewport(400, 300);
+
+struct Counts {
+    int fills = 0, strokes = 0, triangles = 0, labels = 0;
+    double us = 0;
+    int total() const { return fills + strokes + triangles; }
+};
+
+static Counts counts;
+
+class CountingLabel : public Label {
+public:
+    using Label::Label;
+    void draw(NVGcontext* ctx) override {
+        counts.labels++;
+        Label::draw(ctx);
+    }
+};
+
+// Back-end that draws nothing and counts the render calls
+static int count_create(void*) { return 1; }
+static int count_create_texture(void*, int, int, int, int, const unsigned char*) {
+    static int next_image = 1;
+    return next_image++;
+}
+static int count_delete_texture(void*, int) { return 1; }
+static int count_update_texture(void*, int, int, int, int, int, const unsigned char*) { return 1; }
+static int count_texture_size(void*, int, int* w, int* h) { *w = *h = 512; return 1; }
+static void count_viewport(void*, float, float, float) { }
+static void count_cancel(void*) { }
+static void count_flush(void*) { }
+static void count_fill(void*, NVGpaint*, NVGcompositeOperationState, NVGscissor*, float,
+                       const float*, const NVGpath*, int) { counts.fills++; }
+static void count_stroke(void*, NVGpaint*, NVGcompositeOperationState, NVGscissor*, float,
+                         float, const NVGpath*, int) { counts.strokes++; }
+static void count_triangles(void*, NVGpaint*, NVGcompositeOperationState, NVGscissor*,
+                            const NVGvertex*, int, float) { counts.triangles++; }
+static void count_delete(void*) { }
+
+static NVGcontext* create_counting_context() {
+    NVGparams params;
+    memset(&params, 0, sizeof(params));
+    params.edgeAntiAlias = 1;
+    params.renderCreate = count_create;
+    params.renderCreateTexture = count_create_texture;
+    params.renderDeleteTexture = count_delete_texture;
+    params.renderUpdateTexture = count_update_texture;
+    params.renderGetTextureSize = count_texture_size;
+    params.renderViewport = count_viewport;
+    params.renderCancel = count_cancel;
+    params.renderFlush = count_flush;
+    params.renderFill = count_fill;
+    params.renderStroke = count_stroke;
+    params.renderTriangles = count_triangles;
+    params.renderDelete = count_delete;
+    return nvgCreateInternal(&params);
+}
+
+// Lay out a ScrollPanel with `count` equally long labels and count what one
+// frame renders at each of the given scroll positions
+static std::vector<Counts> draw_panel(NVGcontext* ctx, int count,
+                                      std::initializer_list<float> scrolls, int& row_height) {
+    ref<Widget> root = new Widget(nullptr);
+    root->set_size(viewport);
+
+    ScrollPanel* panel = new ScrollPanel(root, ScrollPanel::ScrollTypes::Vertical);
+    panel->set_size(viewport);
+    Widget* content = new Widget(panel);
+    content->set_layout(new BoxLayout(Orientation::Vertical, Alignment::Fill, 0, 0));
+    char caption[32];
+    for (int i = 0; i < count; ++i) {
+        snprintf(caption, sizeof(caption), "Row %06d", i);
+        new CountingLabel(content, caption, "sans", 16);
+    }
+
+    auto start = Clock::now();
+    panel->perform_layout(ctx);
+    double layout_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    row_height = std::max(1, content->children().front()->height());
+    if (count > 1000)
+        printf("%d labels in a %dx%d ScrollPanel, %d px rows (layout %.1f ms)\n",
+               count, viewport.x(), viewport.y(), row_height, layout_ms);
+
+    std::vector<Counts> results;
+    for (float scroll : scrolls) {
+        panel->set_scroll(scroll);
+        const int frames = 20;
+        start = Clock::now();
+        for (int i = 0; i < frames; ++i) {
+            counts = Counts();
+            nvgBeginFrame(ctx, (float) viewport.x(), (float) viewport.y(), 1.f);
+            root->draw(ctx);
+            nvgEndFrame(ctx);
+        }
+        counts.us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / frames;
+        results.push_back(counts);
+    }
+    return results;
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    if (count <= 0) {
+        fprintf(stderr, "usage: %s [labels]\n", argv[0]);
+        return 1;
+    }
+
+    NVGcontext* ctx = create_counting_context();
+    if (!ctx || nvgCreateFont(ctx, "sans", "resources/Roboto-Regular.ttf") == -1) {
+        fprintf(stderr, "could not load resources/Roboto-Regular.ttf (run from the repository root)\n");
+        return 1;
+    }
+
+    int status = 0;
+    try {
+        // Reference: a panel that holds just about one screenful of labels
+        int row_height = 0;
+        Counts reference = draw_panel(ctx, 32, { 0.f }, row_height).front();
+        int max_rows = viewport.y() / row_height + 2;
+
+        std::vector<Counts> results = draw_panel(ctx, count, { 0.f, 0.5f, 1.f }, row_height);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Counts& c = results[i];
+            bool ok = c.labels > 0 && c.labels <= max_rows &&
+                      (i != 0 || c.total() == reference.total());
+            printf("  scroll %.1f: %d labels drawn, %d render calls (%d fills, %d strokes, "
+                   "%d triangles), %.1f us/frame  %s\n", 0.5f * i, c.labels, c.total(),
+                   c.fills, c.strokes, c.triangles, c.us, ok ? "ok" : "FAILED");
+            if (!ok)
+                status = 1;
+        }
+        printf("  reference (32 labels) at the top: %d render calls\n", reference.total());
+    } catch (const std::exception& e) {
+        std::cerr << "Caught a fatal error: " << e.what() << std::endl;
+        status = 1;
+    }
+
+    nvgDeleteInternal(ctx);
+    return status;
+}
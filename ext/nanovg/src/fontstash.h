@@ -54,8 +54,19 @@ enum FONSglyphBitmap {
     FONS_GLYPH_BITMAP_REQUIRED = 2,
 };
 
+// Glyph bitmaps are stored on atlas pages of three formats.
+enum FONSpageFormat {
+    FONS_PAGE_ALPHA = 1,    // 8-bit coverage, grayscale glyphs
+    FONS_PAGE_RGBA = 4,     // 32-bit color, color (emoji) glyphs
+    FONS_PAGE_SDF = 2,      // 8-bit signed distance, glyphs drawn with fonsSetSDF()
+};
+
+#ifndef FONS_MAX_PAGES
+#	define FONS_MAX_PAGES 8
+#endif
+
 enum FONSerrorCode {
-    // Font atlas is full.
+    // Font atlas is full, every page is in use by the current frame and FONS_MAX_PAGES is reached.
     FONS_ATLAS_FULL = 1,
     // Scratch memory used to render glyphs is full, requested size reported in 'val', you may need to bump up FONS_SCRATCH_BUF_SIZE.
     FONS_SCRATCH_FULL = 2,
@@ -95,6 +106,9 @@ struct FONStextIter {
     const char* end;
     unsigned int utf8state;
     int bitmapOption;
+    int isColor;        // current glyph is a color (RGBA) bitmap
+    int page;           // atlas page of the current glyph, -1 if it has no bitmap
+    int glyph;          // index of the current glyph in the font's glyph cache, -1 if none
 };
 typedef struct FONStextIter FONStextIter;
 
@@ -105,13 +119,40 @@ FONScontext* fonsCreateInternal(FONSparams* params);
 void fonsDeleteInternal(FONScontext* s);
 
 void fonsSetErrorCallback(FONScontext* s, void (*callback)(void* uptr, int error, int val), void* uptr);
-// Returns current atlas size.
+// Returns current atlas size, i.e. the size of the first page.
 void fonsGetAtlasSize(FONScontext* s, int* width, int* height);
 // Expands the atlas size.
 int fonsExpandAtlas(FONScontext* s, int width, int height);
 // Resets the whole stash.
 int fonsResetAtlas(FONScontext* stash, int width, int height);
 
+// Advances the clock of the glyph LRU. Only pages that no glyph was drawn from since the
+// last call are re-packed when the atlas runs out of space, so call this once per frame.
+void fonsBeginFrame(FONScontext* s);
+
+// Rasterizes glyph bitmaps on up to FONS_MAX_RASTER_THREADS worker threads instead of in the
+// call that first needs them, 0 threads (the default) rasterizes synchronously. A glyph's
+// metrics and atlas spot are known right away, its bitmap stays blank until a worker has
+// rendered it and fonsBeginFrame() copied it in. 'ready' is called on a worker thread when
+// it runs out of queued glyphs, to schedule the frame that shows them; it may be NULL.
+// Returns the number of threads started.
+int fonsSetRasterThreads(FONScontext* s, int threads, void (*ready)(void* uptr), void* uptr);
+// Returns the number of glyphs queued or being rasterized.
+int fonsPendingGlyphs(FONScontext* s);
+// Adds the glyphs of codepoints first..last that the current font or its fallbacks have, at
+// the current size and blur, to the atlas ahead of their first use. Call between frames; if
+// the range does not fit, the last glyphs of it are kept. Returns the number of glyphs added.
+int fonsPrewarm(FONScontext* s, unsigned int first, unsigned int last);
+
+// Atlas cache. fonsSaveCache() writes the atlas pages and glyph tables to a file, with a hash
+// of each font's data. fonsLoadCache() memory-maps such a file and replaces the atlas and the
+// glyph tables with it, so that its glyphs are drawn without FreeType rendering them again.
+// Load after adding the fonts and fallbacks and before drawing text. Loading fails and leaves
+// the stash as it is if the file was written for different font data, fallbacks or FreeType
+// version. Both return 1 on success.
+int fonsSaveCache(FONScontext* s, const char* path);
+int fonsLoadCache(FONScontext* s, const char* path);
+
 // Add fonts
 int fonsAddFont(FONScontext* s, const char* name, const char* path);
 int fonsAddFontMem(FONScontext* s, const char* name, unsigned char* data, int ndata, int freeData);
@@ -129,6 +170,12 @@ void fonsSetSpacing(FONScontext* s, float spacing);
 void fonsSetBlur(FONScontext* s, float blur);
 void fonsSetAlign(FONScontext* s, int align);
 void fonsSetFont(FONScontext* s, int font);
+// Draws glyphs as signed distance fields: each is rendered once, unhinted at FONS_SDF_SIZE,
+// and scaled to any size, so that text changing size every frame needs no new bitmaps.
+// The page holds the distance to the outline, 128 on it and FONS_SDF_SPREAD pixels (at
+// FONS_SDF_SIZE) per 128 steps, higher inside; the renderer thresholds it and applies the
+// blur. Color and bitmap-only fonts keep their bitmaps.
+void fonsSetSDF(FONScontext* s, int enabled);
 
 // Draw text
 float fonsDrawText(FONScontext* s, float x, float y, const char* string, const char* end);
@@ -142,7 +189,12 @@ void fonsVertMetrics(FONScontext* s, float* ascender, float* descender, float* l
 int fonsTextIterInit(FONScontext* stash, FONStextIter* iter, float x, float y, const char* str, const char* end, int bitmapOption);
 int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, struct FONSquad* quad);
 
-// Pull texture changes
+// Pull texture changes. Glyphs live on up to FONS_MAX_PAGES pages, a page slot without data
+// has been released and its texture can be deleted.
+int fonsGetPageCount(FONScontext* s);
+const unsigned char* fonsGetPageData(FONScontext* s, int page, int* width, int* height, int* format);
+int fonsValidatePage(FONScontext* s, int page, int* dirty);
+// Same for the first page, for renderers that use a single texture.
 const unsigned char* fonsGetTextureData(FONScontext* stash, int* width, int* height);
 int fonsValidateTexture(FONScontext* s, int* dirty);
 
@@ -161,6 +213,52 @@ void fonsDrawDebug(FONScontext* s, float x, float y);
 #include FT_ADVANCES_H
 #include <math.h>
 
+#ifndef FT_LOAD_BITMAP_METRICS_ONLY
+#define FT_LOAD_BITMAP_METRICS_ONLY 0
+#endif
+
+#ifndef FONS_SDF_SIZE
+#	define FONS_SDF_SIZE 48
+#endif
+#ifndef FONS_SDF_SPREAD
+#	define FONS_SDF_SPREAD 8
+#endif
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+typedef HANDLE fons__thread;
+typedef CRITICAL_SECTION fons__mutex;
+typedef CONDITION_VARIABLE fons__cond;
+#define fons__mutexInit(m)      InitializeCriticalSection(m)
+#define fons__mutexDestroy(m)   DeleteCriticalSection(m)
+#define fons__mutexLock(m)      EnterCriticalSection(m)
+#define fons__mutexUnlock(m)    LeaveCriticalSection(m)
+#define fons__condInit(c)       InitializeConditionVariable(c)
+#define fons__condDestroy(c)    ((void)(c))
+#define fons__condWait(c, m)    SleepConditionVariableCS(c, m, INFINITE)
+#define fons__condBroadcast(c)  WakeAllConditionVariable(c)
+#else
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+typedef pthread_t fons__thread;
+typedef pthread_mutex_t fons__mutex;
+typedef pthread_cond_t fons__cond;
+#define fons__mutexInit(m)      pthread_mutex_init(m, NULL)
+#define fons__mutexDestroy(m)   pthread_mutex_destroy(m)
+#define fons__mutexLock(m)      pthread_mutex_lock(m)
+#define fons__mutexUnlock(m)    pthread_mutex_unlock(m)
+#define fons__condInit(c)       pthread_cond_init(c, NULL)
+#define fons__condDestroy(c)    pthread_cond_destroy(c)
+#define fons__condWait(c, m)    pthread_cond_wait(c, m)
+#define fons__condBroadcast(c)  pthread_cond_broadcast(c)
+#endif
+
 struct FONSttFontImpl {
     FT_Face font;
 };
@@ -292,13 +390,10 @@ int fons__tt_getGlyphIndex(FONSttFontImpl *font, int codepoint)
     return FT_Get_Char_Index(font->font, codepoint);
 }
 
-int fons__tt_buildGlyphBitmap(FONSttFontImpl *font, int glyph, float size, float scale,
-                              int *advance, int *lsb, int *x0, int *y0, int *x1, int *y1, int *isColor)
+// Sets the face size glyphs of 'size' are rendered at.
+static int fons__tt_setGlyphSize(FONSttFontImpl *font, float size)
 {
     FT_Error ftError;
-    FT_GlyphSlot ftGlyph;
-    FONS_NOTUSED(scale);
-
     float desired_px = size;  // Approximate point size as pixels
 
     if (!FT_HAS_COLOR(font->font)) {
@@ -343,8 +438,20 @@ int fons__tt_buildGlyphBitmap(FONSttFontImpl *font, int glyph, float size, float
         }
         if (ftError) return 0;
     }
+    return 1;
+}
 
-    ftError = FT_Load_Glyph(font->font, glyph, FT_LOAD_RENDER | FT_LOAD_FORCE_AUTOHINT | FT_LOAD_COLOR);
+// Loads a glyph at the given size, rendering its bitmap if 'flags' has FT_LOAD_RENDER; without
+// it only the metrics and the dimensions of the bitmap it would render to are loaded.
+static int fons__tt_loadGlyph(FONSttFontImpl *font, int glyph, float size, int flags,
+                              int *advance, int *lsb, int *x0, int *y0, int *x1, int *y1, int *isColor)
+{
+    FT_Error ftError;
+    FT_GlyphSlot ftGlyph;
+
+    if (!fons__tt_setGlyphSize(font, size)) return 0;
+
+    ftError = FT_Load_Glyph(font->font, glyph, flags | FT_LOAD_FORCE_AUTOHINT | FT_LOAD_COLOR);
     if (ftError) return 0;
 
     // Reject if bitmap too large
@@ -362,6 +469,48 @@ int fons__tt_buildGlyphBitmap(FONSttFontImpl *font, int glyph, float size, float
     return 1;
 }
 
+int fons__tt_buildGlyphBitmap(FONSttFontImpl *font, int glyph, float size, float scale,
+                              int *advance, int *lsb, int *x0, int *y0, int *x1, int *y1, int *isColor)
+{
+    FONS_NOTUSED(scale);
+    return fons__tt_loadGlyph(font, glyph, size, FT_LOAD_RENDER, advance, lsb, x0, y0, x1, y1, isColor);
+}
+
+// Same as fons__tt_buildGlyphBitmap() without rasterizing: outlines are not rendered and
+// embedded (color) bitmaps are not decoded, the bitmap dimensions are still exact.
+int fons__tt_getGlyphMetrics(FONSttFontImpl *font, int glyph, float size, float scale,
+                             int *advance, int *lsb, int *x0, int *y0, int *x1, int *y1, int *isColor)
+{
+    FONS_NOTUSED(scale);
+    return fons__tt_loadGlyph(font, glyph, size, FT_LOAD_BITMAP_METRICS_ONLY, advance, lsb, x0, y0, x1, y1, isColor);
+}
+
+// Loads a glyph for a distance field, unhinted so that it scales linearly, and with the advance
+// in tenths of a pixel for the same reason. The slot gets the coverage bitmap if 'render' is
+// set; the box returned includes the FONS_SDF_SPREAD margin the field extends into.
+static int fons__tt_loadGlyphSDF(FONSttFontImpl *font, int glyph, float size, int render,
+                                 int *advance, int *x0, int *y0, int *x1, int *y1)
+{
+    FT_GlyphSlot ftGlyph;
+    int flags = FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP | (render ? FT_LOAD_RENDER : FT_LOAD_BITMAP_METRICS_ONLY);
+
+    if (!fons__tt_setGlyphSize(font, size)) return 0;
+    if (FT_Load_Glyph(font->font, glyph, flags) != 0) return 0;
+    ftGlyph = font->font->glyph;
+    if (ftGlyph->bitmap.width > 1024 || ftGlyph->bitmap.rows > 1024) return 0;
+
+    *advance = (int)((ftGlyph->linearHoriAdvance * 10 + 0x8000) >> 16);
+    if (ftGlyph->bitmap.width == 0 || ftGlyph->bitmap.rows == 0) {
+        *x0 = *y0 = *x1 = *y1 = 0; // blank, nothing to draw
+        return 1;
+    }
+    *x0 = ftGlyph->bitmap_left - FONS_SDF_SPREAD;
+    *x1 = ftGlyph->bitmap_left + ftGlyph->bitmap.width + FONS_SDF_SPREAD;
+    *y0 = -ftGlyph->bitmap_top - FONS_SDF_SPREAD;
+    *y1 = -ftGlyph->bitmap_top + ftGlyph->bitmap.rows + FONS_SDF_SPREAD;
+    return 1;
+}
+
 int fons__tt_buildGlyphBitmap__OLD(FONSttFontImpl *font, int glyph, float size, float scale,
                               int *advance, int *lsb, int *x0, int *y0, int *x1, int *y1, int *isColor)
 {
@@ -559,6 +708,15 @@ int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int glyph2)
 #ifndef FONS_MAX_FALLBACKS
 #	define FONS_MAX_FALLBACKS 20
 #endif
+#ifndef FONS_MAX_RASTER_THREADS
+#	define FONS_MAX_RASTER_THREADS 8
+#endif
+#ifndef FONS_PAGES_PER_FORMAT
+#	define FONS_PAGES_PER_FORMAT 3
+#endif
+#ifndef FONS_MAX_PAGE_SIZE
+#	define FONS_MAX_PAGE_SIZE 2048
+#endif
 
 static unsigned int fons__hashint(unsigned int a)
 {
@@ -586,10 +744,13 @@ struct FONSglyph
     unsigned int codepoint;
     int index;
     int next;
-    short size, blur;
+    short size, blur;           // blur -1: distance field, rendered at 'size' for all sizes
     short x0,y0,x1,y1;
     short xadv,xoff,yoff;
     short isColor;
+    short page;                 // atlas page of the bitmap, -1 if it has none
+    unsigned int lastUsed;      // frame the bitmap was last drawn in
+    unsigned int pending;       // raster job filling in the bitmap, 0 if none
 };
 typedef struct FONSglyph FONSglyph;
 
@@ -620,6 +781,7 @@ struct FONSstate
     unsigned int color;
     float blur;
     float spacing;
+    int sdf;
 };
 typedef struct FONSstate FONSstate;
 
@@ -637,14 +799,73 @@ struct FONSatlas
 };
 typedef struct FONSatlas FONSatlas;
 
+struct FONSpage
+{
+    int format;                 // FONSpageFormat, 0 for a free slot
+    int bpp;                    // bytes per pixel
+    int width, height;
+    float itw, ith;
+    unsigned char* data;
+    FONSatlas* atlas;
+    int dirtyRect[4];
+    int nglyphs;                // glyph bitmaps on the page
+    unsigned int lastUsed;      // frame a glyph of the page was last drawn in
+};
+typedef struct FONSpage FONSpage;
+
+// A glyph bitmap to render on a worker thread, into its own buffer
+struct FONSjob
+{
+    unsigned int serial;        // matches FONSglyph::pending while the result is wanted
+    int font, glyph;            // glyph slot the bitmap is for
+    int renderFont, index;      // font and glyph index to render, can be a fallback font
+    const unsigned char* fontData;
+    int fontDataSize;
+    float size, scale;
+    int iblur, pad, isColor;
+    int tw, th, gw, gh;         // color bitmaps are resized to tw x th, gw x gh with padding
+    unsigned char* data;        // gw x gh pixels of the page format, NULL if rendering failed
+    struct FONSjob* next;
+};
+typedef struct FONSjob FONSjob;
+
+struct FONSraster;
+
+// Worker threads have their own FreeType library and faces, FT_Face is not thread-safe
+struct FONSworker
+{
+    struct FONSraster* raster;
+    fons__thread thread;
+    FT_Library library;
+    FT_Face* faces;             // by font index, opened on first use
+    int nfaces;
+};
+typedef struct FONSworker FONSworker;
+
+struct FONSraster
+{
+    fons__mutex mutex;
+    fons__cond cond;
+    FONSjob* queue;
+    FONSjob* queueTail;
+    FONSjob* done;
+    int quit;
+    int pending;                // jobs queued or done but not copied to their page yet
+    unsigned int serial;
+    FONSworker workers[FONS_MAX_RASTER_THREADS];
+    int nworkers;
+    void (*ready)(void* uptr);
+    void* readyUptr;
+};
+typedef struct FONSraster FONSraster;
+
 struct FONScontext
 {
     FONSparams params;
-    float itw,ith;
-    unsigned char* texData;
-    int dirtyRect[4];
+    FONSpage pages[FONS_MAX_PAGES];
+    int npages;
+    unsigned int frame;
     FONSfont** fonts;
-    FONSatlas* atlas;
     int cfonts;
     int nfonts;
     float verts[FONS_VERTEX_COUNT*2];
@@ -657,6 +878,8 @@ struct FONScontext
     int nstates;
     void (*handleError)(void* uptr, int error, int val);
     void* errorUptr;
+    int generation;     // bumped whenever glyph texture coordinates change
+    FONSraster* raster; // glyph raster threads, NULL to rasterize synchronously
 };
 
 // Copyright (c) 2008-2010 Bjoern Hoehrmann <bjoern@hoehrmann.de>
@@ -884,29 +1107,237 @@ static int fons__atlasAddRect(FONSatlas* atlas, int rw, int rh, int* rx, int* ry
     return 1;
 }
 
+static void fons__pageDirty(FONSpage* page, int x0, int y0, int x1, int y1)
+{
+    page->dirtyRect[0] = fons__mini(page->dirtyRect[0], x0);
+    page->dirtyRect[1] = fons__mini(page->dirtyRect[1], y0);
+    page->dirtyRect[2] = fons__maxi(page->dirtyRect[2], x1);
+    page->dirtyRect[3] = fons__maxi(page->dirtyRect[3], y1);
+}
+
 static void fons__addWhiteRect(FONScontext* stash, int w, int h)
 {
-    int x, y, gx, gy;
-    unsigned char* dst;
-    if (fons__atlasAddRect(stash->atlas, w, h, &gx, &gy) == 0)
+    FONSpage* page = &stash->pages[0];
+    int y, gx, gy;
+    if (page->format == 0 || fons__atlasAddRect(page->atlas, w, h, &gx, &gy) == 0)
         return;
 
     // Rasterize
-    dst = &stash->texData[(gx + gy * stash->params.width) * 4];
-    for (y = 0; y < h; y++) {
-        for (x = 0; x < w; x++) {
-            dst[x*4 + 0] = 255;
-            dst[x*4 + 1] = 255;
-            dst[x*4 + 2] = 255;
-            dst[x*4 + 3] = 255;
+    for (y = 0; y < h; y++)
+        memset(&page->data[(gx + (gy + y) * page->width) * page->bpp], 0xff, w * page->bpp);
+
+    fons__pageDirty(page, gx, gy, gx+w, gy+h);
+}
+
+// Atlas pages. Grayscale, color and distance field glyphs go to pages of their own format,
+// each format gets up to FONS_PAGES_PER_FORMAT pages. When those are full, the least recently
+// drawn page that the current frame does not use is re-packed: its most recently drawn glyphs
+// are copied into half of the page, the others lose their bitmap and are rasterized again
+// when next drawn.
+// Pages used by the current frame are never moved, since vertices referencing them may
+// already be queued; more pages are added instead, up to FONS_MAX_PAGES, and
+// fonsBeginFrame() releases them again.
+
+static int fons__allocPage(FONScontext* stash, int format, int minw, int minh)
+{
+    FONSpage* page;
+    int i, idx = -1, n = 0, w, h, bpp;
+
+    for (i = 0; i < stash->npages; i++) {
+        if (stash->pages[i].format == format)
+            n++;
+        else if (stash->pages[i].format == 0 && idx == -1)
+            idx = i;
+    }
+    if (idx == -1) {
+        if (stash->npages >= FONS_MAX_PAGES)
+            return -1;
+        idx = stash->npages;
+    }
+
+    // Later pages of a format are larger, up to FONS_MAX_PAGE_SIZE
+    w = stash->params.width;
+    h = stash->params.height;
+    for (i = 0; i < n; i++) {
+        if (w > h)
+            h = fons__maxi(h, fons__mini(h * 2, FONS_MAX_PAGE_SIZE));
+        else
+            w = fons__maxi(w, fons__mini(w * 2, FONS_MAX_PAGE_SIZE));
+    }
+    w = fons__maxi(w, minw);
+    h = fons__maxi(h, minh);
+    bpp = format == FONS_PAGE_RGBA ? 4 : 1;
+
+    page = &stash->pages[idx];
+    memset(page, 0, sizeof(FONSpage));
+    page->data = (unsigned char*)malloc(w * h * bpp);
+    if (page->data == NULL)
+        return -1;
+    memset(page->data, 0, w * h * bpp);
+    page->atlas = fons__allocAtlas(w, h, FONS_INIT_ATLAS_NODES);
+    if (page->atlas == NULL) {
+        free(page->data);
+        page->data = NULL;
+        return -1;
+    }
+    page->format = format;
+    page->bpp = bpp;
+    page->width = w;
+    page->height = h;
+    page->itw = 1.0f/w;
+    page->ith = 1.0f/h;
+    page->dirtyRect[0] = w;
+    page->dirtyRect[1] = h;
+    page->lastUsed = stash->frame;
+    if (idx == stash->npages)
+        stash->npages++;
+
+    // Add white rect at 0,0 for debug drawing.
+    if (idx == 0)
+        fons__addWhiteRect(stash, 2,2);
+
+    dprintf("fons__allocPage: page=%d format=%d width=%d height=%d\n", idx, format, w, h);
+    return idx;
+}
+
+static void fons__evictGlyph(FONScontext* stash, FONSglyph* glyph)
+{
+    stash->pages[glyph->page].nglyphs--;
+    glyph->x0 = -1;
+    glyph->y0 = 0;
+    glyph->x1 = -1;
+    glyph->y1 = 0;
+    glyph->page = -1;
+    glyph->pending = 0;
+}
+
+static int fons__cmpGlyphUse(const void* a, const void* b)
+{
+    unsigned int ua = (*(FONSglyph* const*)a)->lastUsed;
+    unsigned int ub = (*(FONSglyph* const*)b)->lastUsed;
+    return ua < ub ? 1 : (ua > ub ? -1 : 0);
+}
+
+// Returns the glyphs with a bitmap on the page, most recently drawn first.
+static FONSglyph** fons__pageGlyphs(FONScontext* stash, int idx, int* count)
+{
+    FONSglyph** glyphs;
+    int i, j, n = 0;
+
+    *count = 0;
+    glyphs = (FONSglyph**)malloc(sizeof(FONSglyph*) * (stash->pages[idx].nglyphs + 1));
+    if (glyphs == NULL)
+        return NULL;
+    for (i = 0; i < stash->nfonts; i++) {
+        FONSfont* font = stash->fonts[i];
+        for (j = 0; j < font->nglyphs; j++)
+            if (font->glyphs[j].page == idx && n < stash->pages[idx].nglyphs)
+                glyphs[n++] = &font->glyphs[j];
+    }
+    qsort(glyphs, n, sizeof(FONSglyph*), fons__cmpGlyphUse);
+    *count = n;
+    return glyphs;
+}
+
+static void fons__freePage(FONScontext* stash, int idx)
+{
+    FONSpage* page = &stash->pages[idx];
+    int i, j;
+
+    for (i = 0; i < stash->nfonts && page->nglyphs > 0; i++) {
+        FONSfont* font = stash->fonts[i];
+        for (j = 0; j < font->nglyphs; j++)
+            if (font->glyphs[j].page == idx)
+                fons__evictGlyph(stash, &font->glyphs[j]);
+    }
+    fons__deleteAtlas(page->atlas);
+    free(page->data);
+    memset(page, 0, sizeof(FONSpage));
+    while (stash->npages > 0 && stash->pages[stash->npages-1].format == 0)
+        stash->npages--;
+    stash->generation++;
+}
+
+// Keeps the most recently drawn glyphs of the page, packed into at most half of it.
+static int fons__repackPage(FONScontext* stash, int idx)
+{
+    FONSpage* page = &stash->pages[idx];
+    FONSglyph** glyphs;
+    unsigned char* old;
+    int i, y, n, size = page->width * page->height * page->bpp;
+    int kept = 0, budget = page->width * page->height / 2;
+
+    old = (unsigned char*)malloc(size);
+    if (old == NULL)
+        return 0;
+    glyphs = fons__pageGlyphs(stash, idx, &n);
+    if (glyphs == NULL) {
+        free(old);
+        return 0;
+    }
+    memcpy(old, page->data, size);
+    memset(page->data, 0, size);
+    fons__atlasReset(page->atlas, page->width, page->height);
+    if (idx == 0)
+        fons__addWhiteRect(stash, 2,2);
+
+    for (i = 0; i < n; i++) {
+        FONSglyph* glyph = glyphs[i];
+        int gw = glyph->x1 - glyph->x0, gh = glyph->y1 - glyph->y0, gx, gy;
+        if (kept + gw * gh > budget || fons__atlasAddRect(page->atlas, gw, gh, &gx, &gy) == 0) {
+            fons__evictGlyph(stash, glyph);
+            continue;
         }
-        dst += stash->params.width * 4;
+        for (y = 0; y < gh; y++)
+            memcpy(&page->data[(gx + (gy + y) * page->width) * page->bpp],
+                   &old[(glyph->x0 + (glyph->y0 + y) * page->width) * page->bpp], gw * page->bpp);
+        glyph->x0 = (short)gx;
+        glyph->y0 = (short)gy;
+        glyph->x1 = (short)(gx + gw);
+        glyph->y1 = (short)(gy + gh);
+        kept += gw * gh;
+    }
+    dprintf("fons__repackPage: page=%d kept %d of %d glyphs\n", idx, page->nglyphs, n);
+
+    free(glyphs);
+    free(old);
+    fons__pageDirty(page, 0, 0, page->width, page->height);
+    stash->generation++;
+    return 1;
+}
+
+// Finds room for a w x h bitmap of the given format, returns its page or -1.
+static int fons__allocGlyphRect(FONScontext* stash, int format, int w, int h, int* x, int* y)
+{
+    int i, n = 0, lru = -1;
+
+    for (i = 0; i < stash->npages; i++) {
+        FONSpage* page = &stash->pages[i];
+        if (page->format != format)
+            continue;
+        if (fons__atlasAddRect(page->atlas, w, h, x, y))
+            return i;
+        n++;
+        if (page->lastUsed != stash->frame && page->width >= w && page->height >= h &&
+            (lru == -1 || page->lastUsed < stash->pages[lru].lastUsed))
+            lru = i;
     }
 
-    stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], gx);
-    stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], gy);
-    stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], gx+w);
-    stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], gy+h);
+    // Add pages while the format is within its share, then recycle the least recently
+    // used one; go beyond the share only if all of them are in use by this frame.
+    if (n >= FONS_PAGES_PER_FORMAT && lru != -1 && fons__repackPage(stash, lru) &&
+        fons__atlasAddRect(stash->pages[lru].atlas, w, h, x, y))
+        return lru;
+    i = fons__allocPage(stash, format, w, h);
+    if (i != -1 && fons__atlasAddRect(stash->pages[i].atlas, w, h, x, y))
+        return i;
+    return -1;
+}
+
+static void fons__touchGlyph(FONScontext* stash, FONSglyph* glyph)
+{
+    glyph->lastUsed = stash->frame;
+    stash->pages[glyph->page].lastUsed = stash->frame;
 }
 
 FONScontext* fonsCreateInternal(FONSparams* params)
@@ -932,9 +1363,6 @@ FONScontext* fonsCreateInternal(FONSparams* params)
             goto error;
     }
 
-    stash->atlas = fons__allocAtlas(stash->params.width, stash->params.height, FONS_INIT_ATLAS_NODES);
-    if (stash->atlas == NULL) goto error;
-
     // Allocate space for fonts.
     stash->fonts = (FONSfont**)malloc(sizeof(FONSfont*) * FONS_INIT_FONTS);
     if (stash->fonts == NULL) goto error;
@@ -942,22 +1370,9 @@ FONScontext* fonsCreateInternal(FONSparams* params)
     stash->cfonts = FONS_INIT_FONTS;
     stash->nfonts = 0;
 
-    // Create texture for the cache.
-    stash->itw = 1.0f/stash->params.width;
-    stash->ith = 1.0f/stash->params.height;
-    stash->texData = (unsigned char*)malloc(stash->params.width * stash->params.height * 4);
-    if (stash->texData == NULL) goto error;
-    memset(stash->texData, 0, stash->params.width * stash->params.height * 4);
-	dprintf("fonsCreateInternal: texData=%p width=%d height=%d\n",
-		stash->texData, stash->params.width, stash->params.height);
-
-    stash->dirtyRect[0] = stash->params.width;
-    stash->dirtyRect[1] = stash->params.height;
-    stash->dirtyRect[2] = 0;
-    stash->dirtyRect[3] = 0;
-
-    // Add white rect at 0,0 for debug drawing.
-    fons__addWhiteRect(stash, 2,2);
+    // Create the first page of the cache, it holds the white rect for debug drawing.
+    if (fons__allocPage(stash, FONS_PAGE_ALPHA, 0, 0) == -1) goto error;
+	dprintf("fonsCreateInternal: width=%d height=%d\n", stash->params.width, stash->params.height);
 
     fonsPushState(stash);
     fonsClearState(stash);
@@ -1014,6 +1429,11 @@ void fonsSetFont(FONScontext* stash, int font)
     fons__getState(stash)->font = font;
 }
 
+void fonsSetSDF(FONScontext* stash, int enabled)
+{
+    fons__getState(stash)->sdf = enabled != 0;
+}
+
 void fonsPushState(FONScontext* stash)
 {
     if (stash->nstates >= FONS_MAX_STATES) {
@@ -1044,6 +1464,7 @@ void fonsClearState(FONScontext* stash)
     state->font = 0;
     state->blur = 0;
     state->spacing = 0;
+    state->sdf = 0;
     state->align = FONS_ALIGN_LEFT | FONS_ALIGN_BASELINE;
 }
 
@@ -1246,797 +1667,446 @@ static void fons__blur(FONScontext* stash, unsigned char* dst, int w, int h, int
 //	fons__blurcols(dst, w, h, dstStride, alpha);
 }
 
-static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
-                                 short isize, short iblur, int bitmapOption)
-{
-    int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, x, y;
-    int isColor = 0;
-    float scale;
-    FONSglyph* glyph = NULL;
-    unsigned int h;
-    float size = isize/10.0f;
-    int pad, added;
-    unsigned char* dst;
-    FONSfont* renderFont = font;
+// Signed distance fields are computed from the coverage bitmap with the distance transform of
+// Felzenszwalb and Huttenlocher, run for the pixels outside and those inside the glyph. As in
+// Mapbox's TinySDF, a partly covered pixel places the edge within the pixel.
 
-    if (isize < 2) return NULL;
-    if (iblur > 20) iblur = 20;
-    pad = iblur + 2;
+#define FONS_SDF_INF 1e20f
 
-    // Reset allocator.
-    stash->nscratch = 0;
+// Squared distance transform of the n values 'stride' apart in 'grid', in place. 'f', 'z'
+// and 'v' are scratch arrays of n+1 values.
+static void fons__edt(float* grid, int stride, int n, float* f, float* z, int* v)
+{
+    int q, k = 0, r;
+    float s;
 
-    // Find code point and size.
-    h = fons__hashint(codepoint) & (FONS_HASH_LUT_SIZE-1);
-    i = font->lut[h];
-    while (i != -1) {
-        if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur) {
-            glyph = &font->glyphs[i];
-            if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL || (glyph->x0 >= 0 && glyph->y0 >= 0)) {
-                return glyph;
-            }
-            break;
-        }
-        i = font->glyphs[i].next;
+    v[0] = 0;
+    z[0] = -FONS_SDF_INF;
+    z[1] = FONS_SDF_INF;
+    f[0] = grid[0];
+    for (q = 1; q < n; q++) {
+        f[q] = grid[q * stride];
+        do {
+            r = v[k];
+            s = (f[q] - f[r] + (float)(q * q - r * r)) / (float)(q - r) * 0.5f;
+        } while (s <= z[k] && --k > -1);
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = FONS_SDF_INF;
     }
+    for (q = 0, k = 0; q < n; q++) {
+        while (z[k + 1] < (float)q)
+            k++;
+        r = v[k];
+        grid[q * stride] = f[r] + (float)((q - r) * (q - r));
+    }
+}
 
-    // Create a new glyph or rasterize bitmap data for a cached glyph.
-    g = fons__tt_getGlyphIndex(&font->font, codepoint);
-    if (g == 0) {
-        for (i = 0; i < font->nfallbacks; ++i) {
-            FONSfont* fallbackFont = stash->fonts[font->fallbacks[i]];
-            int fallbackIndex = fons__tt_getGlyphIndex(&fallbackFont->font, codepoint);
-            if (fallbackIndex != 0) {
-                g = fallbackIndex;
-                renderFont = fallbackFont;
-                break;
+// Writes the distance field of the w x h coverage bitmap 'src' to 'dst', a spot of
+// (w + 2*FONS_SDF_SPREAD) x (h + 2*FONS_SDF_SPREAD) pixels with 'stride' bytes per row.
+static void fons__sdfRender(const unsigned char* src, int pitch, int w, int h, unsigned char* dst, int stride)
+{
+    int gw = w + 2 * FONS_SDF_SPREAD, gh = h + 2 * FONS_SDF_SPREAD, n = fons__maxi(gw, gh);
+    int i, x, y;
+    float *outer, *inner, *f, *z;
+    int* v;
+
+    outer = (float*)malloc(sizeof(float) * (2 * gw * gh + 2 * (n + 1)) + sizeof(int) * (n + 1));
+    if (outer == NULL) return;
+    inner = outer + gw * gh;
+    f = inner + gw * gh;
+    z = f + n + 1;
+    v = (int*)(z + n + 1);
+
+    // Squared distances to the outline: 'outer' is 0 inside, 'inner' is 0 outside
+    for (i = 0; i < gw * gh; i++) {
+        outer[i] = FONS_SDF_INF;
+        inner[i] = 0.0f;
+    }
+    for (y = 0; y < h; y++) {
+        for (x = 0; x < w; x++) {
+            int a = src[y * pitch + x], j = (y + FONS_SDF_SPREAD) * gw + x + FONS_SDF_SPREAD;
+            float d = 0.5f - a / 255.0f;
+            if (a == 0)
+                continue;
+            if (a == 255) {
+                outer[j] = 0.0f;
+                inner[j] = FONS_SDF_INF;
+            } else {
+                outer[j] = d > 0.0f ? d * d : 0.0f;
+                inner[j] = d < 0.0f ? d * d : 0.0f;
             }
         }
     }
-    scale = fons__tt_getPixelHeightScale(&renderFont->font, size);
-    // Fix for invalid scale
-    if (!isfinite(scale) || scale <= 0.0f) {
-        scale = 1.0f;
+    for (x = 0; x < gw; x++) {
+        fons__edt(outer + x, gw, gh, f, z, v);
+        fons__edt(inner + x, gw, gh, f, z, v);
     }
-    int ret;
-    if (g == 0) {
-        ret = 0;
-        advance = (int)size;
-        lsb = 0;
-        x0 = 0;
-        y0 = 0;
-        x1 = 0;
-        y1 = 0;
-        isColor = 0;
-    } else {
-        ret = fons__tt_buildGlyphBitmap(&renderFont->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1, &isColor);
-        if (!ret) {
-            advance = (int)size;
-            lsb = 0;
-            x0 = 0;
-            y0 = 0;
-            x1 = 0;
-            y1 = 0;
-            isColor = 0;
-        }
+    for (y = 0; y < gh; y++) {
+        fons__edt(outer + y * gw, 1, gw, f, z, v);
+        fons__edt(inner + y * gw, 1, gw, f, z, v);
     }
-    dprintf("freeType glyph: size=%f scale=%f advance=%d lsb=%d x0=%d y0=%d x1=%d y1=%d isColor=%d\n",
-             size, scale, advance, lsb, x0, y0, x1, y1, isColor);
-
-    // Store original metrics before potential resize
-    int orig_x0 = x0;
-    int orig_y0 = y0;
-    int orig_x1 = x1;
-    int orig_y1 = y1;
-    int orig_advance = advance;
 
-    int orig_w = x1 - x0;
-    int orig_h = y1 - y0;
+    for (y = 0; y < gh; y++) {
+        for (x = 0; x < gw; x++) {
+            float d = sqrtf(outer[y * gw + x]) - sqrtf(inner[y * gw + x]);
+            float value = 128.0f - d * (128.0f / FONS_SDF_SPREAD);
+            dst[y * stride + x] = (unsigned char)(value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value + 0.5f));
+        }
+    }
+    free(outer);
+}
 
-    short calc_xoff, calc_yoff;
-    short calc_xadv;
-    int target_w = 0, target_h = 0;
+// Renders the bitmap FreeType has in the glyph slot of 'font' into 'dst', a cleared gw x gh
+// spot with 'stride' bytes per row, RGBA for color glyphs, the distance field computed from
+// the coverage for distance field glyphs (blur -1) and 8-bit coverage otherwise.
+static void fons__renderGlyph(FONSttFontImpl* font, unsigned char* dst, int stride, int gw, int gh,
+                              int pad, int isColor, int tw, int th, float scale, int g, int iblur)
+{
+    FT_GlyphSlot ftGlyphSlot = font->font->glyph;
+    int y;
 
-    // Handle color vs. grayscale paths
     if (isColor) {
-        // For color glyphs: fallback to grayscale if invalid dimensions
-        if (orig_w <= 0 || orig_h <= 0) {
-            isColor = 0;
-        }
+        // Render color glyph to padded position with aspect-preserving resize
+        fons__tt_renderGlyphBitmap(font, dst + pad * 4 + pad * stride, tw, th, stride, scale, scale, g);
+    } else if (iblur < 0) {
+        if (ftGlyphSlot->bitmap.width > 0 && ftGlyphSlot->bitmap.rows > 0 &&
+            (int)ftGlyphSlot->bitmap.width + 2 * FONS_SDF_SPREAD <= gw - 2 * pad &&
+            (int)ftGlyphSlot->bitmap.rows + 2 * FONS_SDF_SPREAD <= gh - 2 * pad)
+            fons__sdfRender(ftGlyphSlot->bitmap.buffer, ftGlyphSlot->bitmap.pitch, ftGlyphSlot->bitmap.width,
+                            ftGlyphSlot->bitmap.rows, dst + pad + pad * stride, stride);
+    } else if (ftGlyphSlot->bitmap.width > 0 && ftGlyphSlot->bitmap.rows > 0) {
+        // Grayscale glyph, coverage goes straight to the alpha page
+        unsigned char* mdst = dst + pad + pad * stride;
+        int rows = fons__mini((int)ftGlyphSlot->bitmap.rows, gh - pad);
+        int cols = fons__mini((int)ftGlyphSlot->bitmap.width, gw - pad);
+        for (y = 0; y < rows; y++)
+            memcpy(mdst + y * stride, ftGlyphSlot->bitmap.buffer + y * ftGlyphSlot->bitmap.pitch, cols);
+
+        if (iblur > 0)
+            fons__blur(NULL, dst, gw, gh, stride, iblur);
     }
-    if (isColor) {
-        // Color path: Use uniform scale for offsets/advance; resize bitmap to scaled dimensions (aspect-preserving)
-        float scaled_w = (float)orig_w * scale;
-        float scaled_h = (float)orig_h * scale;
-        target_w = fmax(1, (int)(scaled_w + 0.5f));  // Round to nearest int, min 1
-        target_h = fmax(1, (int)(scaled_h + 0.5f));
-        gw = target_w + pad * 2;
-        gh = target_h + pad * 2;
-        calc_xoff = (short)((float)orig_x0 * scale - (float)pad);
-        calc_yoff = (short)((float)orig_y0 * scale - (float)pad);
-        calc_xadv = (short)(orig_advance * scale * 10.0f);  // Scale advance for color
-    } else {
-        // Grayscale path: No resize; direct padding. Rendered at logical size, no scale multiply
-        gw = orig_w + pad * 2;
-        gh = orig_h + pad * 2;
-        calc_xoff = (short)(orig_x0 - pad);
-        calc_yoff = (short)(orig_y0 - iblur - 2);  // Ignore insets for vertical positioning to reduce space above/below
-        calc_xadv = (short)(orig_advance * 10.0f);  // No scale multiply for greyscale
+}
+
+// Glyph raster threads: fons__getGlyph() reserves the atlas spot from the glyph metrics and
+// queues a job, a worker renders the bitmap into the job and fonsBeginFrame() copies it to
+// the page. Jobs of glyphs that were evicted meanwhile are dropped.
+
+static void fons__rasterJob(FONSworker* worker, FONSjob* job)
+{
+    FONSttFontImpl font;
+    int advance, lsb, x0, y0, x1, y1, isColor;
+    int bpp = job->isColor ? 4 : 1;
+
+    if (job->renderFont >= worker->nfaces) {
+        int n = job->renderFont + 8;
+        FT_Face* faces = (FT_Face*)realloc(worker->faces, sizeof(FT_Face) * n);
+        if (faces == NULL) return;
+        memset(&faces[worker->nfaces], 0, sizeof(FT_Face) * (n - worker->nfaces));
+        worker->faces = faces;
+        worker->nfaces = n;
+    }
+    if (worker->faces[job->renderFont] == NULL &&
+        FT_New_Memory_Face(worker->library, job->fontData, job->fontDataSize, 0, &worker->faces[job->renderFont]) != 0) {
+        worker->faces[job->renderFont] = NULL;
+        return;
     }
+    font.font = worker->faces[job->renderFont];
 
-    // Ensure atlas is large enough for the glyph only if needed
-    int needAtlas = ((isColor ? (target_w > 0) : (orig_w > 0 || orig_h > 0)) && (bitmapOption == FONS_GLYPH_BITMAP_REQUIRED));
-    if (needAtlas) {
-        if (gw > stash->params.width || gh > stash->params.height) {
-            int new_w = fons__maxi(stash->params.width, gw + pad * 2);
-            int new_h = fons__maxi(stash->params.height, gh + pad * 2);
-            if (!fonsExpandAtlas(stash, new_w, new_h)) {
-                return NULL;
-            }
-        }
+    if (job->iblur < 0) {
+        if (!fons__tt_loadGlyphSDF(&font, job->index, job->size, 1, &advance, &x0, &y0, &x1, &y1))
+            return;
+    } else if (!fons__tt_buildGlyphBitmap(&font, job->index, job->size, job->scale, &advance, &lsb, &x0, &y0, &x1, &y1, &isColor) ||
+               isColor != job->isColor) {
+        return;
     }
+    job->data = (unsigned char*)calloc(job->gw * job->gh, bpp);
+    if (job->data == NULL) return;
+    fons__renderGlyph(&font, job->data, job->gw * bpp, job->gw, job->gh, job->pad, job->isColor,
+                      job->tw, job->th, job->scale, job->index, job->iblur);
+}
 
-    // Determines the spot to draw glyph in the atlas.
-    gx = -1;
-    gy = -1;
-    if (needAtlas) {
-        added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
-        if (added == 0 && stash->handleError != NULL) {
-            stash->handleError(stash->errorUptr, FONS_ATLAS_FULL, 0);
-            added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
+static void fons__rasterWorker(FONSworker* worker)
+{
+    FONSraster* raster = worker->raster;
+    FONSjob* job;
+    int idle;
+
+    for (;;) {
+        fons__mutexLock(&raster->mutex);
+        while (!raster->quit && raster->queue == NULL)
+            fons__condWait(&raster->cond, &raster->mutex);
+        if (raster->quit) {
+            fons__mutexUnlock(&raster->mutex);
+            break;
         }
-        if (added == 0) return NULL;
-    }
+        job = raster->queue;
+        raster->queue = job->next;
+        if (raster->queue == NULL)
+            raster->queueTail = NULL;
+        fons__mutexUnlock(&raster->mutex);
 
-    // Init glyph.
-    if (glyph == NULL) {
-        glyph = fons__allocGlyph(font);
-        if (glyph == NULL) {
-            return NULL;
-        }
-        glyph->codepoint = codepoint;
-        glyph->size = isize;
-        glyph->blur = iblur;
-        glyph->next = font->lut[h];
-        font->lut[h] = font->nglyphs - 1;
-    }
-    glyph->index = g;
-    if (gx >= 0) {
-        glyph->x0 = (short)gx;
-        glyph->y0 = (short)gy;
-        glyph->x1 = (short)(gx + gw);
-        glyph->y1 = (short)(gy + gh);
-    } else {
-        glyph->x0 = -1;
-        glyph->y0 = 0;
-        glyph->x1 = -1;
-        glyph->y1 = 0;
-    }
-    glyph->xoff = calc_xoff;
-    glyph->yoff = calc_yoff;
-    glyph->xadv = calc_xadv;
-    glyph->isColor = (short)isColor;
+        fons__rasterJob(worker, job);
 
-    if (isColor) {
-        dprintf("Glyph Render Bounds: x0=%d y0=%d x1=%d y1=%d xoff=%d yoff=%d xadv=%d\n",
-               glyph->x0, glyph->y0, glyph->x1, glyph->y1, glyph->xoff, glyph->yoff, glyph->xadv);
-    }
+        fons__mutexLock(&raster->mutex);
+        job->next = raster->done;
+        raster->done = job;
+        idle = raster->queue == NULL;
+        fons__mutexUnlock(&raster->mutex);
 
-    if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL) {
-        return glyph;
-    }
-    // Clear glyph area in texture only if allocated
-    if (gx >= 0) {
-        unsigned char* gdst = &stash->texData[(glyph->x0 + glyph->y0 * stash->params.width) * 4];
-        int atlasStride = stash->params.width * 4;
-        for (y = 0; y < gh; y++) {
-            memset(gdst + y * atlasStride, 0, gw * 4);
-        }
+        // Let the application schedule a frame once a batch of glyphs is done
+        if (idle && raster->ready != NULL)
+            raster->ready(raster->readyUptr);
     }
-
-    FT_GlyphSlot ftGlyphSlot = renderFont->font.font->glyph;
-
-    if (isColor && target_w > 0 && gx >= 0) {
-        // Render color glyph to padded position in atlas with aspect-preserving resize
-        unsigned char* inner_dst = &stash->texData[(glyph->x0 + pad + (glyph->y0 + pad) * stash->params.width) * 4];
-        int atlasStride = stash->params.width * 4;
-        fons__tt_renderGlyphBitmap(&renderFont->font, inner_dst, target_w, target_h, atlasStride, scale, scale, g);
-
-        dprintf("fons__getGlyph: Rendered codepoint %u to scaled color texture (%dx%d)\n", codepoint, target_w, target_h);
-    } else if (!isColor && orig_w > 0 && orig_h > 0 && gx >= 0) {
-        // Grayscale glyph path (unchanged)
-        int monoSize = gw * gh;
-        if (stash->nscratch + monoSize > FONS_SCRATCH_BUF_SIZE) {
-            if (stash->handleError)
-                stash->handleError(stash->errorUptr, FONS_SCRATCH_FULL, stash->nscratch + monoSize);
-            return glyph;
-        }
-        unsigned char* mono = stash->scratch + stash->nscratch;
-        stash->nscratch += monoSize;
-        memset(mono, 0, monoSize);
-
-        unsigned char* mdst = mono + pad + pad * gw;
-        int mstride = gw;
-        for (y = 0; y < ftGlyphSlot->bitmap.rows; y++) {
-            unsigned char* s = ftGlyphSlot->bitmap.buffer + y * ftGlyphSlot->bitmap.pitch;
-            for (x = 0; x < ftGlyphSlot->bitmap.width; x++) {
-                mdst[y * mstride + x] = s[x];
-            }
-        }
-
-        if (iblur > 0) {
-            fons__blur(stash, mono, gw, gh, mstride, iblur);
-        }
-
-        unsigned char* gdst = &stash->texData[(glyph->x0 + glyph->y0 * stash->params.width) * 4];
-        int atlasStride2 = stash->params.width * 4;
-        for (y = 0; y < gh; y++) {
-            unsigned char* row = mono + y * gw;
-            unsigned char* tdst = gdst + y * atlasStride2;
-            for (x = 0; x < gw; x++) {
-                unsigned char val = row[x];
-                tdst[x * 4 + 0] = 255;
-                tdst[x * 4 + 1] = 255;
-                tdst[x * 4 + 2] = 255;
-                tdst[x * 4 + 3] = val;
-            }
-        }
-    } // else missing glyph, no render
-
-    // Update dirty rectangle only if allocated
-    if (gx >= 0) {
-        stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
-        stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
-        stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
-        stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], glyph->y1);
-    }
-
-    return glyph;
 }
 
-static FONSglyph* fons__getGlyph_Ok(FONScontext* stash, FONSfont* font, unsigned int codepoint,
-                                 short isize, short iblur, int bitmapOption)
+#ifdef _WIN32
+static DWORD WINAPI fons__rasterThread(LPVOID arg)
 {
-    int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, x, y;
-    int isColor = 0;
-    float scale;
-    FONSglyph* glyph = NULL;
-    unsigned int h;
-    float size = isize/10.0f;
-    int pad, added;
-    unsigned char* dst;
-    FONSfont* renderFont = font;
-
-    if (isize < 2) return NULL;
-    if (iblur > 20) iblur = 20;
-    pad = iblur + 2;
-
-    // Reset allocator.
-    stash->nscratch = 0;
-
-    // Find code point and size.
-    h = fons__hashint(codepoint) & (FONS_HASH_LUT_SIZE-1);
-    i = font->lut[h];
-    while (i != -1) {
-        if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur) {
-            glyph = &font->glyphs[i];
-            if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL || (glyph->x0 >= 0 && glyph->y0 >= 0)) {
-                return glyph;
-            }
-            break;
-        }
-        i = font->glyphs[i].next;
-    }
-
-    // Create a new glyph or rasterize bitmap data for a cached glyph.
-    g = fons__tt_getGlyphIndex(&font->font, codepoint);
-    if (g == 0) {
-        for (i = 0; i < font->nfallbacks; ++i) {
-            FONSfont* fallbackFont = stash->fonts[font->fallbacks[i]];
-            int fallbackIndex = fons__tt_getGlyphIndex(&fallbackFont->font, codepoint);
-            if (fallbackIndex != 0) {
-                g = fallbackIndex;
-                renderFont = fallbackFont;
-                break;
-            }
-        }
-    }
-    scale = fons__tt_getPixelHeightScale(&renderFont->font, size);
-    // Fix for invalid scale
-    if (!isfinite(scale) || scale <= 0.0f) {
-        scale = 1.0f;
-    }
-    int ret;
-    if (g == 0) {
-        ret = 0;
-        advance = (int)size;
-        lsb = 0;
-        x0 = 0;
-        y0 = 0;
-        x1 = 0;
-        y1 = 0;
-        isColor = 0;
-    } else {
-        ret = fons__tt_buildGlyphBitmap(&renderFont->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1, &isColor);
-        if (!ret) {
-            advance = (int)size;
-            lsb = 0;
-            x0 = 0;
-            y0 = 0;
-            x1 = 0;
-            y1 = 0;
-            isColor = 0;
-        }
-    }
-    dprintf("freeType glyph: size=%f scale=%f advance=%d lsb=%d x0=%d y0=%d x1=%d y1=%d isColor=%d\n",
-             size, scale, advance, lsb, x0, y0, x1, y1, isColor);
-
-    // Store original metrics before potential resize
-    int orig_x0 = x0;
-    int orig_y0 = y0;
-    int orig_x1 = x1;
-    int orig_y1 = y1;
-    int orig_advance = advance;
-
-    int orig_w = x1 - x0;
-    int orig_h = y1 - y0;
-
-    short calc_xoff, calc_yoff;
-    short calc_xadv;
-    int target_w = 0, target_h = 0;
-
-    // Handle color vs. grayscale paths
-    if (isColor) {
-        // For color glyphs: fallback to grayscale if invalid dimensions
-        if (orig_w <= 0 || orig_h <= 0) {
-            isColor = 0;
-        }
-    }
-    if (isColor) {
-        // Color path: Use uniform scale for offsets/advance; resize bitmap to scaled dimensions (aspect-preserving)
-        float scaled_w = (float)orig_w * scale;
-        float scaled_h = (float)orig_h * scale;
-        target_w = fmax(1, (int)(scaled_w + 0.5f));  // Round to nearest int, min 1
-        target_h = fmax(1, (int)(scaled_h + 0.5f));
-        gw = target_w + pad * 2;
-        gh = target_h + pad * 2;
-        calc_xoff = (short)((float)orig_x0 * scale - (float)pad);
-        calc_yoff = (short)((float)orig_y0 * scale - (float)pad);
-        calc_xadv = (short)(orig_advance * scale * 10.0f);  // Scale advance for color
-    } else {
-        // Grayscale path: No resize; direct padding. Rendered at logical size, no scale multiply
-        gw = orig_w + pad * 2;
-        gh = orig_h + pad * 2;
-        calc_xoff = (short)(orig_x0 - pad);
-        calc_yoff = (short)(orig_y0 - pad);
-        calc_xadv = (short)(orig_advance * 10.0f);  // No scale multiply for greyscale
-    }
-
-    // Ensure atlas is large enough for the glyph only if needed
-    int needAtlas = ((isColor ? (target_w > 0) : (orig_w > 0 || orig_h > 0)) && (bitmapOption == FONS_GLYPH_BITMAP_REQUIRED));
-    if (needAtlas) {
-        if (gw > stash->params.width || gh > stash->params.height) {
-            int new_w = fons__maxi(stash->params.width, gw + pad * 2);
-            int new_h = fons__maxi(stash->params.height, gh + pad * 2);
-            if (!fonsExpandAtlas(stash, new_w, new_h)) {
-                return NULL;
-            }
-        }
-    }
-
-    // Determines the spot to draw glyph in the atlas.
-    gx = -1;
-    gy = -1;
-    if (needAtlas) {
-        added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
-        if (added == 0 && stash->handleError != NULL) {
-            stash->handleError(stash->errorUptr, FONS_ATLAS_FULL, 0);
-            added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
-        }
-        if (added == 0) return NULL;
-    }
-
-    // Init glyph.
-    if (glyph == NULL) {
-        glyph = fons__allocGlyph(font);
-        if (glyph == NULL) {
-            return NULL;
-        }
-        glyph->codepoint = codepoint;
-        glyph->size = isize;
-        glyph->blur = iblur;
-        glyph->next = font->lut[h];
-        font->lut[h] = font->nglyphs - 1;
-    }
-    glyph->index = g;
-    if (gx >= 0) {
-        glyph->x0 = (short)gx;
-        glyph->y0 = (short)gy;
-        glyph->x1 = (short)(gx + gw);
-        glyph->y1 = (short)(gy + gh);
-    } else {
-        glyph->x0 = -1;
-        glyph->y0 = 0;
-        glyph->x1 = -1;
-        glyph->y1 = 0;
-    }
-    glyph->xoff = calc_xoff;
-    glyph->yoff = calc_yoff;
-    glyph->xadv = calc_xadv;
-    glyph->isColor = (short)isColor;
-
-    if (isColor) {
-        dprintf("Glyph Render Bounds: x0=%d y0=%d x1=%d y1=%d xoff=%d yoff=%d xadv=%d\n",
-               glyph->x0, glyph->y0, glyph->x1, glyph->y1, glyph->xoff, glyph->yoff, glyph->xadv);
-    }
-
-    if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL) {
-        return glyph;
-    }
-    // Clear glyph area in texture only if allocated
-    if (gx >= 0) {
-        unsigned char* gdst = &stash->texData[(glyph->x0 + glyph->y0 * stash->params.width) * 4];
-        int atlasStride = stash->params.width * 4;
-        for (y = 0; y < gh; y++) {
-            memset(gdst + y * atlasStride, 0, gw * 4);
-        }
-    }
-
-    FT_GlyphSlot ftGlyphSlot = renderFont->font.font->glyph;
-
-    if (isColor && target_w > 0 && gx >= 0) {
-        // Render color glyph to padded position in atlas with aspect-preserving resize
-        unsigned char* inner_dst = &stash->texData[(glyph->x0 + pad + (glyph->y0 + pad) * stash->params.width) * 4];
-        int atlasStride = stash->params.width * 4;
-        fons__tt_renderGlyphBitmap(&renderFont->font, inner_dst, target_w, target_h, atlasStride, scale, scale, g);
-
-        dprintf("fons__getGlyph: Rendered codepoint %u to scaled color texture (%dx%d)\n", codepoint, target_w, target_h);
-    } else if (!isColor && orig_w > 0 && orig_h > 0 && gx >= 0) {
-        // Grayscale glyph path (unchanged)
-        int monoSize = gw * gh;
-        if (stash->nscratch + monoSize > FONS_SCRATCH_BUF_SIZE) {
-            if (stash->handleError)
-                stash->handleError(stash->errorUptr, FONS_SCRATCH_FULL, stash->nscratch + monoSize);
-            return glyph;
-        }
-        unsigned char* mono = stash->scratch + stash->nscratch;
-        stash->nscratch += monoSize;
-        memset(mono, 0, monoSize);
-
-        unsigned char* mdst = mono + pad + pad * gw;
-        int mstride = gw;
-        for (y = 0; y < ftGlyphSlot->bitmap.rows; y++) {
-            unsigned char* s = ftGlyphSlot->bitmap.buffer + y * ftGlyphSlot->bitmap.pitch;
-            for (x = 0; x < ftGlyphSlot->bitmap.width; x++) {
-                mdst[y * mstride + x] = s[x];
-            }
-        }
-
-        if (iblur > 0) {
-            fons__blur(stash, mono, gw, gh, mstride, iblur);
-        }
-
-        unsigned char* gdst = &stash->texData[(glyph->x0 + glyph->y0 * stash->params.width) * 4];
-        int atlasStride2 = stash->params.width * 4;
-        for (y = 0; y < gh; y++) {
-            unsigned char* row = mono + y * gw;
-            unsigned char* tdst = gdst + y * atlasStride2;
-            for (x = 0; x < gw; x++) {
-                unsigned char val = row[x];
-                tdst[x * 4 + 0] = 255;
-                tdst[x * 4 + 1] = 255;
-                tdst[x * 4 + 2] = 255;
-                tdst[x * 4 + 3] = val;
-            }
-        }
-    } // else missing glyph, no render
-
-    // Update dirty rectangle only if allocated
-    if (gx >= 0) {
-        stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
-        stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
-        stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
-        stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], glyph->y1);
-    }
-
-    return glyph;
+    fons__rasterWorker((FONSworker*)arg);
+    return 0;
 }
 
-static FONSglyph* fons__getGlyph_Old(FONScontext* stash, FONSfont* font, unsigned int codepoint,
-                                 short isize, short iblur, int bitmapOption)
+static int fons__threadStart(fons__thread* thread, FONSworker* worker)
 {
-    int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, x, y;
-    int isColor = 0;
-    float scale;
-    FONSglyph* glyph = NULL;
-    unsigned int h;
-    float size = isize/10.0f;
-    int pad, added;
-    unsigned char* dst;
-    FONSfont* renderFont = font;
-
-    if (isize < 2) return NULL;
-    if (iblur > 20) iblur = 20;
-    pad = iblur + 2;
-
-    // Reset allocator.
-    stash->nscratch = 0;
-
-    // Find code point and size.
-    h = fons__hashint(codepoint) & (FONS_HASH_LUT_SIZE-1);
-    i = font->lut[h];
-    while (i != -1) {
-        if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur) {
-            glyph = &font->glyphs[i];
-            if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL || (glyph->x0 >= 0 && glyph->y0 >= 0)) {
-                return glyph;
-            }
-            break;
-        }
-        i = font->glyphs[i].next;
-    }
-
-    // Create a new glyph or rasterize bitmap data for a cached glyph.
-    g = fons__tt_getGlyphIndex(&font->font, codepoint);
-    if (g == 0) {
-        for (i = 0; i < font->nfallbacks; ++i) {
-            FONSfont* fallbackFont = stash->fonts[font->fallbacks[i]];
-            int fallbackIndex = fons__tt_getGlyphIndex(&fallbackFont->font, codepoint);
-            if (fallbackIndex != 0) {
-                g = fallbackIndex;
-                renderFont = fallbackFont;
-                break;
-            }
-        }
-    }
-    scale = fons__tt_getPixelHeightScale(&renderFont->font, size);
-    // Fix for invalid scale
-    if (!isfinite(scale) || scale <= 0.0f) {
-        scale = 1.0f;
-    }
-    int ret;
-    if (g == 0) {
-        ret = 0;
-        advance = (int)size;
-        lsb = 0;
-        x0 = 0;
-        y0 = 0;
-        x1 = 0;
-        y1 = 0;
-        isColor = 0;
-    } else {
-        ret = fons__tt_buildGlyphBitmap(&renderFont->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1, &isColor);
-        if (!ret) {
-            advance = (int)size;
-            lsb = 0;
-            x0 = 0;
-            y0 = 0;
-            x1 = 0;
-            y1 = 0;
-            isColor = 0;
-        }
-    }
-    dprintf("freeType glyph: size=%f scale=%f advance=%d lsb=%d x0=%d y0=%d x1=%d y1=%d isColor=%d\n",
-             size, scale, advance, lsb, x0, y0, x1, y1, isColor);
-
-    // Store original metrics before potential resize
-    int orig_x0 = x0;
-    int orig_y0 = y0;
-    int orig_x1 = x1;
-    int orig_y1 = y1;
-    int orig_advance = advance;
-
-    int orig_w = x1 - x0;
-    int orig_h = y1 - y0;
-
-    short calc_xoff, calc_yoff;
-    short calc_xadv;
-    int target_w = 0, target_h = 0;
-
-    // Handle color vs. grayscale paths with uniform scaling to prevent NaN and inconsistencies
-    if (isColor) {
-        // For color glyphs: fallback to grayscale if invalid dimensions (prevents div-by-zero in scaling)
-        if (orig_w <= 0 || orig_h <= 0) {
-            isColor = 0;
-        }
-    }
-    if (isColor) {
-        // Color path: Use uniform scale for offsets/advance (based on strike height); resize bitmap to scaled dimensions (aspect-preserving)
-        float scaled_w = (float)orig_w * scale;
-        float scaled_h = (float)orig_h * scale;
-        target_w = fmax(1, (int)(scaled_w + 0.5f));  // Round to nearest int, min 1
-        target_h = fmax(1, (int)(scaled_h + 0.5f));
-        gw = target_w + pad * 2;
-        gh = target_h + pad * 2;
-        calc_xoff = (short)((float)orig_x0 * scale - (float)pad);
-        calc_yoff = (short)((float)orig_y0 * scale - (float)pad);
-        calc_xadv = (short)(scale * (float)orig_advance * 10.0f);  // Uniform scale for advance (no per-glyph resize factor)
-    } else {
-        // Grayscale path: No resize; direct padding. Scale now ~1.0 due to consistent setup.
-        gw = orig_w + pad * 2;
-        gh = orig_h + pad * 2;
-        calc_xoff = (short)(orig_x0 - pad);
-        calc_yoff = (short)(orig_y0 - pad);
-        calc_xadv = (short)(scale * (float)orig_advance * 10.0f);
-    }
-
-    // Ensure atlas is large enough for the glyph only if needed
-    int needAtlas = ((isColor ? (target_w > 0) : (orig_w > 0 || orig_h > 0)) && (bitmapOption == FONS_GLYPH_BITMAP_REQUIRED));
-    if (needAtlas) {
-        if (gw > stash->params.width || gh > stash->params.height) {
-            int new_w = fons__maxi(stash->params.width, gw + pad * 2);
-            int new_h = fons__maxi(stash->params.height, gh + pad * 2);
-            if (!fonsExpandAtlas(stash, new_w, new_h)) {
-                return NULL;
-            }
-        }
-    }
-
-    // Determines the spot to draw glyph in the atlas.
-    gx = -1;
-    gy = -1;
-    if (needAtlas) {
-        added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
-        if (added == 0 && stash->handleError != NULL) {
-            stash->handleError(stash->errorUptr, FONS_ATLAS_FULL, 0);
-            added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
-        }
-        if (added == 0) return NULL;
-    }
+    *thread = CreateThread(NULL, 0, fons__rasterThread, worker, 0, NULL);
+    return *thread != NULL;
+}
 
-    // Init glyph.
-    if (glyph == NULL) {
-        glyph = fons__allocGlyph(font);
-        if (glyph == NULL) {
-            return NULL;
-        }
-        glyph->codepoint = codepoint;
-        glyph->size = isize;
-        glyph->blur = iblur;
-        glyph->next = font->lut[h];
-        font->lut[h] = font->nglyphs - 1;
-    }
-    glyph->index = g;
-    if (gx >= 0) {
-        glyph->x0 = (short)gx;
-        glyph->y0 = (short)gy;
-        glyph->x1 = (short)(gx + gw);
-        glyph->y1 = (short)(gy + gh);
-    } else {
-        glyph->x0 = -1;
-        glyph->y0 = 0;
-        glyph->x1 = -1;
-        glyph->y1 = 0;
-    }
-    glyph->xoff = calc_xoff;
-    glyph->yoff = calc_yoff;
-    glyph->xadv = calc_xadv;
-    glyph->isColor = (short)isColor;
+static void fons__threadJoin(fons__thread thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+static void* fons__rasterThread(void* arg)
+{
+    fons__rasterWorker((FONSworker*)arg);
+    return NULL;
+}
 
-    if (isColor) {
-        dprintf("Glyph Render Bounds: x0=%d y0=%d x1=%d y1=%d xoff=%d yoff=%d xadv=%d\n",
-               glyph->x0, glyph->y0, glyph->x1, glyph->y1, glyph->xoff, glyph->yoff, glyph->xadv);
-    }
+static int fons__threadStart(fons__thread* thread, FONSworker* worker)
+{
+    return pthread_create(thread, NULL, fons__rasterThread, worker) == 0;
+}
 
-    if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL) {
-        return glyph;
-    }
-    // Clear glyph area in texture only if allocated
-    if (gx >= 0) {
-        unsigned char* gdst = &stash->texData[(glyph->x0 + glyph->y0 * stash->params.width) * 4];
-        int atlasStride = stash->params.width * 4;
-        for (y = 0; y < gh; y++) {
-            memset(gdst + y * atlasStride, 0, gw * 4);
-        }
-    }
+static void fons__threadJoin(fons__thread thread)
+{
+    pthread_join(thread, NULL);
+}
+#endif
 
-    FT_GlyphSlot ftGlyphSlot = renderFont->font.font->glyph;
+// Queues rendering the bitmap of a glyph that has its atlas spot, returns 0 on failure.
+static int fons__rasterQueue(FONScontext* stash, FONSfont* font, FONSglyph* glyph, FONSfont* renderFont,
+                             float size, float scale, int iblur, int pad, int tw, int th)
+{
+    FONSraster* raster = stash->raster;
+    FONSjob* job;
+    int i;
 
-    if (isColor && target_w > 0 && gx >= 0) {
-        // Render color glyph to padded position in atlas with aspect-preserving resize
-        unsigned char* inner_dst = &stash->texData[(glyph->x0 + pad + (glyph->y0 + pad) * stash->params.width) * 4];
-        int atlasStride = stash->params.width * 4;
-        fons__tt_renderGlyphBitmap(&renderFont->font, inner_dst, target_w, target_h, atlasStride, scale, scale, g);
+    job = (FONSjob*)calloc(1, sizeof(FONSjob));
+    if (job == NULL) return 0;
+    for (i = 0; i < stash->nfonts; i++) {
+        if (stash->fonts[i] == font)
+            job->font = i;
+        if (stash->fonts[i] == renderFont)
+            job->renderFont = i;
+    }
+    job->glyph = (int)(glyph - font->glyphs);
+    job->index = glyph->index;
+    job->fontData = renderFont->data;
+    job->fontDataSize = renderFont->dataSize;
+    job->size = size;
+    job->scale = scale;
+    job->iblur = iblur;
+    job->pad = pad;
+    job->isColor = glyph->isColor;
+    job->tw = tw;
+    job->th = th;
+    job->gw = glyph->x1 - glyph->x0;
+    job->gh = glyph->y1 - glyph->y0;
+    if (++raster->serial == 0)
+        raster->serial = 1;
+    job->serial = raster->serial;
+    glyph->pending = job->serial;
+    raster->pending++;
+
+    fons__mutexLock(&raster->mutex);
+    if (raster->queueTail != NULL)
+        raster->queueTail->next = job;
+    else
+        raster->queue = job;
+    raster->queueTail = job;
+    fons__condBroadcast(&raster->cond);
+    fons__mutexUnlock(&raster->mutex);
+    return 1;
+}
 
-        dprintf("fons__getGlyph: Rendered codepoint %u to scaled color texture (%dx%d)\n", codepoint, target_w, target_h);
-    } else if (!isColor && orig_w > 0 && orig_h > 0 && gx >= 0) {
-        // Grayscale glyph path (unchanged)
-        int monoSize = gw * gh;
-        if (stash->nscratch + monoSize > FONS_SCRATCH_BUF_SIZE) {
-            if (stash->handleError)
-                stash->handleError(stash->errorUptr, FONS_SCRATCH_FULL, stash->nscratch + monoSize);
-            return glyph;
-        }
-        unsigned char* mono = stash->scratch + stash->nscratch;
-        stash->nscratch += monoSize;
-        memset(mono, 0, monoSize);
-
-        unsigned char* mdst = mono + pad + pad * gw;
-        int mstride = gw;
-        for (y = 0; y < ftGlyphSlot->bitmap.rows; y++) {
-            unsigned char* s = ftGlyphSlot->bitmap.buffer + y * ftGlyphSlot->bitmap.pitch;
-            for (x = 0; x < ftGlyphSlot->bitmap.width; x++) {
-                mdst[y * mstride + x] = s[x];
+// Copies the bitmaps the workers finished to the spots of their glyphs.
+static void fons__rasterCollect(FONScontext* stash)
+{
+    FONSraster* raster = stash->raster;
+    FONSjob* job;
+    FONSjob* next;
+    int y;
+
+    if (raster == NULL) return;
+    fons__mutexLock(&raster->mutex);
+    job = raster->done;
+    raster->done = NULL;
+    fons__mutexUnlock(&raster->mutex);
+
+    for (; job != NULL; job = next) {
+        FONSglyph* glyph = NULL;
+        next = job->next;
+        if (job->font < stash->nfonts && job->glyph < stash->fonts[job->font]->nglyphs)
+            glyph = &stash->fonts[job->font]->glyphs[job->glyph];
+        if (glyph != NULL && glyph->pending == job->serial) {
+            glyph->pending = 0;
+            if (job->data != NULL && glyph->page >= 0 &&
+                glyph->x1 - glyph->x0 == job->gw && glyph->y1 - glyph->y0 == job->gh) {
+                FONSpage* page = &stash->pages[glyph->page];
+                int row = job->gw * page->bpp;
+                if (page->format == (job->iblur < 0 ? FONS_PAGE_SDF : (job->isColor ? FONS_PAGE_RGBA : FONS_PAGE_ALPHA))) {
+                    for (y = 0; y < job->gh; y++)
+                        memcpy(&page->data[(glyph->x0 + (glyph->y0 + y) * page->width) * page->bpp],
+                               &job->data[y * row], row);
+                    fons__pageDirty(page, glyph->x0, glyph->y0, glyph->x1, glyph->y1);
+                }
             }
         }
+        raster->pending--;
+        free(job->data);
+        free(job);
+    }
+}
 
-        if (iblur > 0) {
-            fons__blur(stash, mono, gw, gh, mstride, iblur);
-        }
+// Joins the raster threads. Finished bitmaps are copied in, glyphs still queued lose their
+// spot and get rasterized again when next drawn.
+static void fons__rasterStop(FONScontext* stash)
+{
+    FONSraster* raster = stash->raster;
+    FONSjob* job;
+    FONSjob* next;
+    int i, j, evicted = 0;
+
+    if (raster == NULL) return;
+    fons__mutexLock(&raster->mutex);
+    raster->quit = 1;
+    fons__condBroadcast(&raster->cond);
+    fons__mutexUnlock(&raster->mutex);
+    for (i = 0; i < raster->nworkers; i++) {
+        FONSworker* worker = &raster->workers[i];
+        fons__threadJoin(worker->thread);
+        for (j = 0; j < worker->nfaces; j++)
+            if (worker->faces[j] != NULL)
+                FT_Done_Face(worker->faces[j]);
+        free(worker->faces);
+        FT_Done_FreeType(worker->library);
+    }
 
-        unsigned char* gdst = &stash->texData[(glyph->x0 + glyph->y0 * stash->params.width) * 4];
-        int atlasStride2 = stash->params.width * 4;  // Renamed to avoid conflict
-        for (y = 0; y < gh; y++) {
-            unsigned char* row = mono + y * gw;
-            unsigned char* tdst = gdst + y * atlasStride2;
-            for (x = 0; x < gw; x++) {
-                unsigned char val = row[x];
-                tdst[x * 4 + 0] = 255;
-                tdst[x * 4 + 1] = 255;
-                tdst[x * 4 + 2] = 255;
-                tdst[x * 4 + 3] = val;
+    fons__rasterCollect(stash);
+    for (job = raster->queue; job != NULL; job = next) {
+        next = job->next;
+        free(job);
+    }
+    for (i = 0; i < stash->nfonts; i++) {
+        FONSfont* font = stash->fonts[i];
+        for (j = 0; j < font->nglyphs; j++) {
+            if (font->glyphs[j].pending != 0 && font->glyphs[j].page >= 0) {
+                fons__evictGlyph(stash, &font->glyphs[j]);
+                evicted = 1;
             }
+            font->glyphs[j].pending = 0;
         }
-    } // else missing glyph, no render
+    }
+    if (evicted)
+        stash->generation++;
 
-    // Update dirty rectangle only if allocated
-    if (gx >= 0) {
-        stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
-        stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
-        stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
-        stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], glyph->y1);
+    fons__condDestroy(&raster->cond);
+    fons__mutexDestroy(&raster->mutex);
+    free(raster);
+    stash->raster = NULL;
+}
+
+// Returns the font that has the glyph of the codepoint, 'font' or one of its fallbacks, and
+// the glyph index in it; 0 and 'font' if none has it.
+static FONSfont* fons__findRenderFont(FONScontext* stash, FONSfont* font, unsigned int codepoint, int* g)
+{
+    int i;
+    *g = fons__tt_getGlyphIndex(&font->font, codepoint);
+    for (i = 0; *g == 0 && i < font->nfallbacks; ++i) {
+        FONSfont* fallbackFont = stash->fonts[font->fallbacks[i]];
+        *g = fons__tt_getGlyphIndex(&fallbackFont->font, codepoint);
+        if (*g != 0)
+            return fallbackFont;
     }
+    return font;
+}
 
-    return glyph;
+static int fons__findGlyph(FONSfont* font, unsigned int h, unsigned int codepoint, short isize, short iblur)
+{
+    int i = font->lut[h];
+    while (i != -1) {
+        if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur)
+            return i;
+        i = font->glyphs[i].next;
+    }
+    return -1;
 }
 
-static FONSglyph* fons__getGlyph_Old2(FONScontext* stash, FONSfont* font, unsigned int codepoint,
+static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
                                  short isize, short iblur, int bitmapOption)
 {
-    int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, x, y;
-    int isColor = 0;
+    int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, y;
+    int isColor = 0, page = -1, queued, sdf = 0;
     float scale;
     FONSglyph* glyph = NULL;
     unsigned int h;
-    float size = isize/10.0f;
-    int pad, added;
-    unsigned char* dst;
+    float size;
+    int pad;
     FONSfont* renderFont = font;
 
     if (isize < 2) return NULL;
     if (iblur > 20) iblur = 20;
-    pad = iblur + 2;
 
     // Reset allocator.
     stash->nscratch = 0;
 
-    // Find code point and size.
+    // A distance field serves all sizes and blurs, it is keyed by the codepoint only. Glyphs
+    // that can not be one (color or bitmap fonts) are looked up at their size as usual.
     h = fons__hashint(codepoint) & (FONS_HASH_LUT_SIZE-1);
-    i = font->lut[h];
-    while (i != -1) {
-        if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur) {
-            glyph = &font->glyphs[i];
-            if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL || (glyph->x0 >= 0 && glyph->y0 >= 0)) {
-                return glyph;
-            }
-            break;
+    if (fons__getState(stash)->sdf) {
+        i = fons__findGlyph(font, h, codepoint, FONS_SDF_SIZE*10, -1);
+        if (i == -1) {
+            FT_Face face = fons__findRenderFont(stash, font, codepoint, &g)->font.font;
+            sdf = g != 0 && FT_IS_SCALABLE(face) && !FT_HAS_COLOR(face);
+        } else {
+            sdf = 1;
+        }
+        if (sdf) {
+            isize = FONS_SDF_SIZE*10;
+            iblur = -1;
         }
-        i = font->glyphs[i].next;
     }
+    size = isize/10.0f;
+    pad = sdf ? 1 : iblur + 2;
 
-    // Create a new glyph or rasterize bitmap data for a cached glyph.
-    g = fons__tt_getGlyphIndex(&font->font, codepoint);
-    if (g == 0) {
-        for (i = 0; i < font->nfallbacks; ++i) {
-            FONSfont* fallbackFont = stash->fonts[font->fallbacks[i]];
-            int fallbackIndex = fons__tt_getGlyphIndex(&fallbackFont->font, codepoint);
-            if (fallbackIndex != 0) {
-                g = fallbackIndex;
-                renderFont = fallbackFont;
-                break;
-            }
+    // Find code point and size.
+    i = fons__findGlyph(font, h, codepoint, isize, iblur);
+    if (i != -1) {
+        glyph = &font->glyphs[i];
+        if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL)
+            return glyph;
+        if (glyph->x0 >= 0 && glyph->y0 >= 0) {
+            fons__touchGlyph(stash, glyph);
+            return glyph;
         }
     }
+
+    // Create a new glyph or rasterize bitmap data for a cached glyph.
+    renderFont = fons__findRenderFont(stash, font, codepoint, &g);
     scale = fons__tt_getPixelHeightScale(&renderFont->font, size);
     // Fix for invalid scale
     if (!isfinite(scale) || scale <= 0.0f) {
@@ -2052,8 +2122,25 @@ static FONSglyph* fons__getGlyph_Old2(FONScontext* stash, FONSfont* font, unsign
         x1 = 0;
         y1 = 0;
         isColor = 0;
+    } else if (sdf) {
+        // The distance field is computed from the coverage, which needs rendering likewise
+        ret = fons__tt_loadGlyphSDF(&renderFont->font, g, size,
+                                    bitmapOption == FONS_GLYPH_BITMAP_REQUIRED && stash->raster == NULL,
+                                    &advance, &x0, &y0, &x1, &y1);
+        if (!ret) {
+            advance = (int)size * 10;
+            x0 = 0;
+            y0 = 0;
+            x1 = 0;
+            y1 = 0;
+        }
+        lsb = 0;
     } else {
-        ret = fons__tt_buildGlyphBitmap(&renderFont->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1, &isColor);
+        // Measuring needs only the metrics, and so does a glyph that a worker will render
+        if (bitmapOption == FONS_GLYPH_BITMAP_REQUIRED && stash->raster == NULL)
+            ret = fons__tt_buildGlyphBitmap(&renderFont->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1, &isColor);
+        else
+            ret = fons__tt_getGlyphMetrics(&renderFont->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1, &isColor);
         if (!ret) {
             advance = (int)size;
             lsb = 0;
@@ -2064,7 +2151,7 @@ static FONSglyph* fons__getGlyph_Old2(FONScontext* stash, FONSfont* font, unsign
             isColor = 0;
         }
     }
-	dprintf("freeType glyph: size=%f scale=%f advance=%d lsb=%d x0=%d y0=%d x1=%d y1=%d isColor=%d\n",
+    dprintf("freeType glyph: size=%f scale=%f advance=%d lsb=%d x0=%d y0=%d x1=%d y1=%d isColor=%d\n",
              size, scale, advance, lsb, x0, y0, x1, y1, isColor);
 
     // Store original metrics before potential resize
@@ -2077,54 +2164,58 @@ static FONSglyph* fons__getGlyph_Old2(FONScontext* stash, FONSfont* font, unsign
     int orig_w = x1 - x0;
     int orig_h = y1 - y0;
 
-    float resize_scale_x = 1.0f;
-    float resize_scale_y = 1.0f;
-    int target_size = 0;
-
     short calc_xoff, calc_yoff;
     short calc_xadv;
+    int target_w = 0, target_h = 0;
 
+    // Handle color vs. grayscale paths
     if (isColor) {
-        // Resize target size for color glyphs
-        target_size = (int)size; // Adjust as needed (e.g., fixed 64)
-        resize_scale_x = (float)target_size / (float)orig_w;
-        resize_scale_y = (float)target_size / (float)orig_h;
-        gw = target_size + pad * 2;
-        gh = target_size + pad * 2;
-        calc_xoff = (short)(orig_x0 * resize_scale_x - pad);
-        calc_yoff = (short)(orig_y0 * resize_scale_y - pad);
-        calc_xadv = (short)(scale * orig_advance * 10.0f * resize_scale_x);
-    } else {
-        // Grayscale glyph path
+        // For color glyphs: fallback to grayscale if invalid dimensions
+        if (orig_w <= 0 || orig_h <= 0) {
+            isColor = 0;
+        }
+    }
+    if (sdf) {
+        // Distance field: the field has its own margin, the border only keeps glyphs apart.
+        // The advance is in tenths of a pixel already.
         gw = orig_w + pad * 2;
         gh = orig_h + pad * 2;
         calc_xoff = (short)(orig_x0 - pad);
         calc_yoff = (short)(orig_y0 - pad);
-        calc_xadv = (short)(scale * orig_advance * 10.0f);
+        calc_xadv = (short)orig_advance;
+    } else if (isColor) {
+        // Color path: Use uniform scale for offsets/advance; resize bitmap to scaled dimensions (aspect-preserving)
+        float scaled_w = (float)orig_w * scale;
+        float scaled_h = (float)orig_h * scale;
+        target_w = fmax(1, (int)(scaled_w + 0.5f));  // Round to nearest int, min 1
+        target_h = fmax(1, (int)(scaled_h + 0.5f));
+        gw = target_w + pad * 2;
+        gh = target_h + pad * 2;
+        calc_xoff = (short)((float)orig_x0 * scale - (float)pad);
+        calc_yoff = (short)((float)orig_y0 * scale - (float)pad);
+        calc_xadv = (short)(orig_advance * scale * 10.0f);  // Scale advance for color
+    } else {
+        // Grayscale path: No resize; direct padding. Rendered at logical size, no scale multiply
+        gw = orig_w + pad * 2;
+        gh = orig_h + pad * 2;
+        calc_xoff = (short)(orig_x0 - pad);
+        calc_yoff = (short)(orig_y0 - iblur - 2);  // Ignore insets for vertical positioning to reduce space above/below
+        calc_xadv = (short)(orig_advance * 10.0f);  // No scale multiply for greyscale
     }
 
-    // Ensure atlas is large enough for the glyph only if needed
-    int needAtlas = (orig_w > 0 || orig_h > 0) && (bitmapOption == FONS_GLYPH_BITMAP_REQUIRED);
-    if (needAtlas) {
-        if (gw > stash->params.width || gh > stash->params.height) {
-            int new_w = fons__maxi(stash->params.width, gw + pad * 2);
-            int new_h = fons__maxi(stash->params.height, gh + pad * 2);
-            if (!fonsExpandAtlas(stash, new_w, new_h)) {
-                return NULL;
-            }
-        }
-    }
+    int needAtlas = ((isColor ? (target_w > 0) : (orig_w > 0 || orig_h > 0)) && (bitmapOption == FONS_GLYPH_BITMAP_REQUIRED));
 
-    // Determines the spot to draw glyph in the atlas.
+    // Determines the page and spot to draw glyph in the atlas.
     gx = -1;
     gy = -1;
     if (needAtlas) {
-        added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
-        if (added == 0 && stash->handleError != NULL) {
+        int format = sdf ? FONS_PAGE_SDF : (isColor ? FONS_PAGE_RGBA : FONS_PAGE_ALPHA);
+        page = fons__allocGlyphRect(stash, format, gw, gh, &gx, &gy);
+        if (page == -1 && stash->handleError != NULL) {
             stash->handleError(stash->errorUptr, FONS_ATLAS_FULL, 0);
-            added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
+            page = fons__allocGlyphRect(stash, format, gw, gh, &gx, &gy);
         }
-        if (added == 0) return NULL;
+        if (page == -1) return NULL;
     }
 
     // Init glyph.
@@ -2140,7 +2231,11 @@ static FONSglyph* fons__getGlyph_Old2(FONScontext* stash, FONSfont* font, unsign
         font->lut[h] = font->nglyphs - 1;
     }
     glyph->index = g;
+    glyph->page = (short)page;
+    glyph->pending = 0;
     if (gx >= 0) {
+        stash->pages[page].nglyphs++;
+        fons__touchGlyph(stash, glyph);
         glyph->x0 = (short)gx;
         glyph->y0 = (short)gy;
         glyph->x1 = (short)(gx + gw);
@@ -2164,80 +2259,38 @@ static FONSglyph* fons__getGlyph_Old2(FONScontext* stash, FONSfont* font, unsign
     if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL) {
         return glyph;
     }
-    // Clear glyph area in texture only if allocated
-    if (gx >= 0) {
-        unsigned char* gdst = &stash->texData[(glyph->x0 + glyph->y0 * stash->params.width) * 4];
-        int atlasStride = stash->params.width * 4;
-        for (y = 0; y < gh; y++) {
-            memset(gdst + y * atlasStride, 0, gw * 4);
-        }
-    }
+    if (gx < 0)
+        return glyph; // missing or blank glyph, no render
 
-    FT_GlyphSlot ftGlyphSlot = renderFont->font.font->glyph;
-
-    if (isColor && target_size > 0 && orig_w > 0 && orig_h > 0 && gx >= 0) {
-        // Render color glyph directly to padded position in atlas with resize
-        unsigned char* inner_dst = &stash->texData[(glyph->x0 + pad + (glyph->y0 + pad) * stash->params.width) * 4];
-        int atlasStride = stash->params.width * 4;
-        fons__tt_renderGlyphBitmap(&renderFont->font, inner_dst, target_size, target_size, atlasStride, scale, scale, g);
-
-        dprintf("fons__getGlyph: Rendered codepoint %d to resized color texture (%dx%d)\n", codepoint, target_size, target_size);
-    } else if (!isColor && orig_w > 0 && orig_h > 0 && gx >= 0) {
-        // Grayscale glyph path
-        int monoSize = gw * gh;
-        if (stash->nscratch + monoSize > FONS_SCRATCH_BUF_SIZE) {
-            if (stash->handleError)
-                stash->handleError(stash->errorUptr, FONS_SCRATCH_FULL, stash->nscratch + monoSize);
-            return glyph;
-        }
-        unsigned char* mono = stash->scratch + stash->nscratch;
-        stash->nscratch += monoSize;
-        memset(mono, 0, monoSize);
-
-        unsigned char* mdst = mono + pad + pad * gw;
-        int mstride = gw;
-        for (y = 0; y < ftGlyphSlot->bitmap.rows; y++) {
-            unsigned char* s = ftGlyphSlot->bitmap.buffer + y * ftGlyphSlot->bitmap.pitch;
-            for (x = 0; x < ftGlyphSlot->bitmap.width; x++) {
-                mdst[y * mstride + x] = s[x];
-            }
-        }
+    FONSpage* dstPage = &stash->pages[page];
+    int atlasStride = dstPage->width * dstPage->bpp;
+    unsigned char* gdst = &dstPage->data[(glyph->x0 + glyph->y0 * dstPage->width) * dstPage->bpp];
 
-        if (iblur > 0) {
-            fons__blur(stash, mono, gw, gh, mstride, iblur);
-        }
+    // Clear glyph area in texture
+    for (y = 0; y < gh; y++)
+        memset(gdst + y * atlasStride, 0, gw * dstPage->bpp);
 
-        unsigned char* gdst = &stash->texData[(glyph->x0 + glyph->y0 * stash->params.width) * 4];
-        int atlasStride = stash->params.width * 4;
-        for (y = 0; y < gh; y++) {
-            unsigned char* row = mono + y * gw;
-            unsigned char* tdst = gdst + y * atlasStride;
-            for (x = 0; x < gw; x++) {
-                unsigned char val = row[x];
-                tdst[x * 4 + 0] = 255;
-                tdst[x * 4 + 1] = 255;
-                tdst[x * 4 + 2] = 255;
-                tdst[x * 4 + 3] = val;
-            }
-        }
-    } // else missing glyph, no render
+    // With raster threads the glyph slot holds just the metrics, render it here only if queueing fails
+    queued = stash->raster != NULL &&
+             fons__rasterQueue(stash, font, glyph, renderFont, size, scale, iblur, pad, target_w, target_h);
+    if (!queued && (stash->raster == NULL ||
+                    (sdf ? fons__tt_loadGlyphSDF(&renderFont->font, g, size, 1, &advance, &x0, &y0, &x1, &y1)
+                         : fons__tt_buildGlyphBitmap(&renderFont->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1, &isColor))))
+        fons__renderGlyph(&renderFont->font, gdst, atlasStride, gw, gh, pad, isColor, target_w, target_h, scale, g, iblur);
 
-    // Update dirty rectangle only if allocated
-    if (gx >= 0) {
-        stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
-        stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
-        stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
-        stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], glyph->y1);
-    }
+    fons__pageDirty(dstPage, glyph->x0, glyph->y0, glyph->x1, glyph->y1);
 
     return glyph;
 }
 
 static void fons__getQuad(FONScontext* stash, FONSfont* font,
-                           int prevGlyphIndex, FONSglyph* glyph,
+                           int prevGlyphIndex, FONSglyph* glyph, short isize,
                            float scale, float spacing, float* x, float* y, FONSquad* q)
 {
-    float rx,ry,xoff,yoff,x0,y0,x1,y1;
+    float rx,ry,xoff,yoff,x0,y0,x1,y1,qw,qh,xadv;
+    int snap = 1;
+    float itw = glyph->page >= 0 ? stash->pages[glyph->page].itw : 0.0f;
+    float ith = glyph->page >= 0 ? stash->pages[glyph->page].ith : 0.0f;
 
     if (prevGlyphIndex != -1) {
         float adv = fons__tt_getGlyphKernAdvance(&font->font, prevGlyphIndex, glyph->index) * scale;
@@ -2253,36 +2306,51 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
     y0 = (float)(glyph->y0+1);
     x1 = (float)(glyph->x1-1);
     y1 = (float)(glyph->y1-1);
+    qw = x1 - x0;
+    qh = y1 - y0;
+    xadv = glyph->xadv / 10.0f;
+
+    // Distance fields are scaled from their size and placed without snapping to whole pixels,
+    // so that text changing size moves smoothly
+    if (glyph->blur < 0) {
+        float k = (float)isize / (float)glyph->size;
+        xoff *= k;
+        yoff *= k;
+        qw *= k;
+        qh *= k;
+        xadv *= k;
+        snap = 0;
+    }
 
     if (stash->params.flags & FONS_ZERO_TOPLEFT) {
-        rx = (float)(int)(*x + xoff);
-        ry = (float)(int)(*y + yoff);
+        rx = snap ? (float)(int)(*x + xoff) : *x + xoff;
+        ry = snap ? (float)(int)(*y + yoff) : *y + yoff;
 
         q->x0 = rx;
         q->y0 = ry;
-        q->x1 = rx + x1 - x0;
-        q->y1 = ry + y1 - y0;
+        q->x1 = rx + qw;
+        q->y1 = ry + qh;
 
-        q->s0 = x0 * stash->itw;
-        q->t0 = y0 * stash->ith;
-        q->s1 = x1 * stash->itw;
-        q->t1 = y1 * stash->ith;
+        q->s0 = x0 * itw;
+        q->t0 = y0 * ith;
+        q->s1 = x1 * itw;
+        q->t1 = y1 * ith;
     } else {
-        rx = (float)(int)(*x + xoff);
-        ry = (float)(int)(*y - yoff);
+        rx = snap ? (float)(int)(*x + xoff) : *x + xoff;
+        ry = snap ? (float)(int)(*y - yoff) : *y - yoff;
 
         q->x0 = rx;
         q->y0 = ry;
-        q->x1 = rx + x1 - x0;
-        q->y1 = ry - y1 + y0;
+        q->x1 = rx + qw;
+        q->y1 = ry - qh;
 
-        q->s0 = x0 * stash->itw;
-        q->t0 = y0 * stash->ith;
-        q->s1 = x1 * stash->itw;
-        q->t1 = y1 * stash->ith;
+        q->s0 = x0 * itw;
+        q->t0 = y0 * ith;
+        q->s1 = x1 * itw;
+        q->t1 = y1 * ith;
     }
 
-    *x += (int)(glyph->xadv / 10.0f + 0.5f);
+    *x += snap ? (float)(int)(xadv + 0.5f) : xadv;
 	dprintf("fons__getQuads: scale=%f spacing=%f *x=%f *y=%f, q={%f,%f,%f,%f,%f,%f,%f,%f}\n",
 		scale, spacing, *x, *y,
         q->x0, q->y0, q->x1, q->y1, q->s0, q->t0, q->s1, q->t1);
@@ -2291,15 +2359,11 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 
 static void fons__flush(FONScontext* stash)
 {
-    // Flush texture
-    if (stash->dirtyRect[0] < stash->dirtyRect[2] && stash->dirtyRect[1] < stash->dirtyRect[3]) {
+    // Flush texture, the render callbacks only know of the first page
+    int dirty[4];
+    if (fonsValidatePage(stash, 0, dirty)) {
         if (stash->params.renderUpdate != NULL)
-            stash->params.renderUpdate(stash->params.userPtr, stash->dirtyRect, stash->texData);
-        // Reset dirty rect
-        stash->dirtyRect[0] = stash->params.width;
-        stash->dirtyRect[1] = stash->params.height;
-        stash->dirtyRect[2] = 0;
-        stash->dirtyRect[3] = 0;
+            stash->params.renderUpdate(stash->params.userPtr, dirty, stash->pages[0].data);
     }
 
     // Flush triangles
@@ -2391,7 +2455,7 @@ float fonsDrawText(FONScontext* stash,
             continue;
         glyph = fons__getGlyph(stash, font, codepoint, isize, iblur, FONS_GLYPH_BITMAP_REQUIRED);
         if (glyph != NULL) {
-            fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+            fons__getQuad(stash, font, prevGlyphIndex, glyph, isize, scale, state->spacing, &x, &y, &q);
             if (glyph->x0 >= 0) {
                 if (stash->nverts+6 > FONS_VERTEX_COUNT)
                     fons__flush(stash);
@@ -2478,7 +2542,7 @@ int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, FONSquad* quad)
         iter->y = iter->nexty;
         glyph = fons__getGlyph(stash, iter->font, iter->codepoint, iter->isize, iter->iblur, iter->bitmapOption);
         if (glyph != NULL) {
-            fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
+            fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->isize, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
             if (glyph->x0 < 0) {
                 // Invalid quad for missing glyph
                 quad->x0 = quad->x1 = iter->nextx;
@@ -2494,6 +2558,9 @@ int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, FONSquad* quad)
             quad->s0 = quad->t0 = quad->s1 = quad->t1 = 0.0f;
         }
         iter->prevGlyphIndex = glyph != NULL ? glyph->index : -1;
+        iter->isColor = glyph != NULL ? glyph->isColor : 0;
+        iter->page = glyph != NULL ? glyph->page : -1;
+        iter->glyph = glyph != NULL ? (int)(glyph - iter->font->glyphs) : -1;
         break;
     }
     iter->next = str;
@@ -2531,8 +2598,8 @@ void fonsDrawDebug(FONScontext* stash, float x, float y)
     fons__vertex(stash, x+w, y+h, 1, 1, 0xffffffff);
 
     // Drawbug draw atlas
-    for (i = 0; i < stash->atlas->nnodes; i++) {
-        FONSatlasNode* n = &stash->atlas->nodes[i];
+    for (i = 0; i < stash->pages[0].atlas->nnodes; i++) {
+        FONSatlasNode* n = &stash->pages[0].atlas->nodes[i];
 
         if (stash->nverts+6 > FONS_VERTEX_COUNT)
             fons__flush(stash);
@@ -2589,7 +2656,7 @@ float fonsTextBounds(FONScontext* stash,
             continue;
         glyph = fons__getGlyph(stash, font, codepoint, isize, iblur, FONS_GLYPH_BITMAP_OPTIONAL);
         if (glyph != NULL) {
-            fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+            fons__getQuad(stash, font, prevGlyphIndex, glyph, isize, scale, state->spacing, &x, &y, &q);
             if (q.x0 < minx) minx = q.x0;
             if (q.x1 > maxx) maxx = q.x1;
             if (stash->params.flags & FONS_ZERO_TOPLEFT) {
@@ -2672,46 +2739,175 @@ void fonsLineBounds(FONScontext* stash, float y, float* miny, float* maxy)
     }
 }
 
-const unsigned char* fonsGetTextureData(FONScontext* stash, int* width, int* height)
+int fonsGetPageCount(FONScontext* stash)
+{
+    return stash->npages;
+}
+
+const unsigned char* fonsGetPageData(FONScontext* stash, int page, int* width, int* height, int* format)
 {
+    FONSpage* p;
+    if (page < 0 || page >= stash->npages || stash->pages[page].format == 0)
+        return NULL;
+    p = &stash->pages[page];
     if (width != NULL)
-        *width = stash->params.width;
+        *width = p->width;
     if (height != NULL)
-        *height = stash->params.height;
-    return stash->texData;
+        *height = p->height;
+    if (format != NULL)
+        *format = p->format;
+    return p->data;
 }
 
-int fonsValidateTexture(FONScontext* stash, int* dirty)
+int fonsValidatePage(FONScontext* stash, int page, int* dirty)
 {
-    if (stash->dirtyRect[0] < stash->dirtyRect[2] && stash->dirtyRect[1] < stash->dirtyRect[3]) {
-        dirty[0] = stash->dirtyRect[0];
-        dirty[1] = stash->dirtyRect[1];
-        dirty[2] = stash->dirtyRect[2];
-        dirty[3] = stash->dirtyRect[3];
+    FONSpage* p;
+    if (page < 0 || page >= stash->npages)
+        return 0;
+    p = &stash->pages[page];
+    if (p->dirtyRect[0] < p->dirtyRect[2] && p->dirtyRect[1] < p->dirtyRect[3]) {
+        dirty[0] = p->dirtyRect[0];
+        dirty[1] = p->dirtyRect[1];
+        dirty[2] = p->dirtyRect[2];
+        dirty[3] = p->dirtyRect[3];
         // Reset dirty rect
-        stash->dirtyRect[0] = stash->params.width;
-        stash->dirtyRect[1] = stash->params.height;
-        stash->dirtyRect[2] = 0;
-        stash->dirtyRect[3] = 0;
+        p->dirtyRect[0] = p->width;
+        p->dirtyRect[1] = p->height;
+        p->dirtyRect[2] = 0;
+        p->dirtyRect[3] = 0;
         return 1;
     }
     return 0;
 }
 
+const unsigned char* fonsGetTextureData(FONScontext* stash, int* width, int* height)
+{
+    return fonsGetPageData(stash, 0, width, height, NULL);
+}
+
+int fonsValidateTexture(FONScontext* stash, int* dirty)
+{
+    return fonsValidatePage(stash, 0, dirty);
+}
+
+void fonsBeginFrame(FONScontext* stash)
+{
+    static const int formats[3] = { FONS_PAGE_ALPHA, FONS_PAGE_RGBA, FONS_PAGE_SDF };
+    int i, f, format, n, lru;
+    if (stash == NULL) return;
+    stash->frame++;
+
+    fons__rasterCollect(stash);
+
+    // Release the least recently used page of a format that went over its share
+    for (f = 0; f < 3; f++) {
+        format = formats[f];
+        n = 0;
+        lru = -1;
+        for (i = 1; i < stash->npages; i++) {
+            if (stash->pages[i].format != format)
+                continue;
+            n++;
+            if (lru == -1 || stash->pages[i].lastUsed < stash->pages[lru].lastUsed)
+                lru = i;
+        }
+        if (stash->pages[0].format == format)
+            n++;
+        if (n > FONS_PAGES_PER_FORMAT && lru != -1)
+            fons__freePage(stash, lru);
+    }
+}
+
+int fonsSetRasterThreads(FONScontext* stash, int threads, void (*ready)(void* uptr), void* uptr)
+{
+    FONSraster* raster;
+    int i, n;
+    if (stash == NULL) return 0;
+
+    fons__rasterStop(stash);
+    threads = fons__mini(threads, FONS_MAX_RASTER_THREADS);
+    if (threads <= 0) return 0;
+
+    raster = (FONSraster*)malloc(sizeof(FONSraster));
+    if (raster == NULL) return 0;
+    memset(raster, 0, sizeof(FONSraster));
+    fons__mutexInit(&raster->mutex);
+    fons__condInit(&raster->cond);
+    raster->ready = ready;
+    raster->readyUptr = uptr;
+    stash->raster = raster;
+
+    for (i = 0; i < threads; i++) {
+        FONSworker* worker = &raster->workers[raster->nworkers];
+        worker->raster = raster;
+        if (FT_Init_FreeType(&worker->library) != 0)
+            break;
+        if (!fons__threadStart(&worker->thread, worker)) {
+            FT_Done_FreeType(worker->library);
+            break;
+        }
+        raster->nworkers++;
+    }
+    n = raster->nworkers;
+    if (n == 0)
+        fons__rasterStop(stash);
+    return n;
+}
+
+int fonsPendingGlyphs(FONScontext* stash)
+{
+    if (stash == NULL || stash->raster == NULL) return 0;
+    return stash->raster->pending;
+}
+
+int fonsPrewarm(FONScontext* stash, unsigned int first, unsigned int last)
+{
+    FONSstate* state;
+    FONSfont* font;
+    unsigned int c;
+    short isize, iblur;
+    int g, n = 0;
+
+    if (stash == NULL) return 0;
+    state = fons__getState(stash);
+    if (state->font < 0 || state->font >= stash->nfonts) return 0;
+    font = stash->fonts[state->font];
+    isize = (short)(state->size*10.0f);
+    iblur = (short)state->blur;
+
+    for (c = first; c <= last; c++) {
+        fons__findRenderFont(stash, font, c, &g);
+        if (g != 0) {
+            // A tick of the LRU clock per glyph, so that a range larger than the atlas
+            // re-packs pages rather than growing it, keeping the glyphs added last
+            stash->frame++;
+            if (fons__getGlyph(stash, font, c, isize, iblur, FONS_GLYPH_BITMAP_REQUIRED) != NULL)
+                n++;
+        }
+        if (c == last)
+            break;
+    }
+    return n;
+}
+
 void fonsDeleteInternal(FONScontext* stash)
 {
     int i;
     if (stash == NULL) return;
 
+    fons__rasterStop(stash);
+
     if (stash->params.renderDelete)
         stash->params.renderDelete(stash->params.userPtr);
 
     for (i = 0; i < stash->nfonts; ++i)
         fons__freeFont(stash->fonts[i]);
 
-    if (stash->atlas) fons__deleteAtlas(stash->atlas);
+    for (i = 0; i < stash->npages; ++i) {
+        fons__deleteAtlas(stash->pages[i].atlas);
+        free(stash->pages[i].data);
+    }
     if (stash->fonts) free(stash->fonts);
-    if (stash->texData) free(stash->texData);
     if (stash->scratch) free(stash->scratch);
     free(stash);
     fons__tt_done(stash);
@@ -2734,8 +2930,7 @@ void fonsGetAtlasSize(FONScontext* stash, int* width, int* height)
 
 int fonsExpandAtlas(FONScontext* stash, int width, int height)
 {
-    int i, maxy = 0;
-    unsigned char* data = NULL;
+    int i, j, maxy;
     if (stash == NULL) return 0;
 
     width = fons__maxi(width, stash->params.width);
@@ -2752,41 +2947,46 @@ int fonsExpandAtlas(FONScontext* stash, int width, int height)
         if (stash->params.renderResize(stash->params.userPtr, width, height) == 0)
             return 0;
     }
-    // Copy old texture data over.
-    data = (unsigned char*)malloc(width * height * 4);
-    if (data == NULL)
-        return 0;
-    for (i = 0; i < stash->params.height; i++) {
-        unsigned char* dst = &data[i*width*4];
-        unsigned char* src = &stash->texData[i*stash->params.width*4];
-        memcpy(dst, src, stash->params.width*4);
-        if (width > stash->params.width)
-            memset(dst+stash->params.width*4, 0, (width - stash->params.width)*4);
-    }
-    if (height > stash->params.height)
-        memset(&data[stash->params.height * width * 4], 0, (height - stash->params.height) * width * 4);
-
-    free(stash->texData);
-    stash->texData = data;
-
-    // Increase atlas size
-    fons__atlasExpand(stash->atlas, width, height);
-
-    // Add existing data as dirty.
-    for (i = 0; i < stash->atlas->nnodes; i++)
-        maxy = fons__maxi(maxy, stash->atlas->nodes[i].y);
-    stash->dirtyRect[0] = 0;
-    stash->dirtyRect[1] = 0;
-    stash->dirtyRect[2] = stash->params.width;
-    stash->dirtyRect[3] = maxy;
+
+    // Grow the pages that are smaller, copying the old texture data over.
+    for (i = 0; i < stash->npages; i++) {
+        FONSpage* page = &stash->pages[i];
+        int w = fons__maxi(width, page->width), h = fons__maxi(height, page->height);
+        unsigned char* data;
+        if (page->format == 0 || (w == page->width && h == page->height))
+            continue;
+        data = (unsigned char*)malloc(w * h * page->bpp);
+        if (data == NULL)
+            return 0;
+        memset(data, 0, w * h * page->bpp);
+        for (j = 0; j < page->height; j++)
+            memcpy(&data[j*w*page->bpp], &page->data[j*page->width*page->bpp], page->width*page->bpp);
+        free(page->data);
+        page->data = data;
+
+        // Increase atlas size
+        fons__atlasExpand(page->atlas, w, h);
+
+        // Add existing data as dirty.
+        maxy = 0;
+        for (j = 0; j < page->atlas->nnodes; j++)
+            maxy = fons__maxi(maxy, page->atlas->nodes[j].y);
+        page->dirtyRect[0] = 0;
+        page->dirtyRect[1] = 0;
+        page->dirtyRect[2] = page->width;
+        page->dirtyRect[3] = maxy;
+
+        page->width = w;
+        page->height = h;
+        page->itw = 1.0f/w;
+        page->ith = 1.0f/h;
+    }
 
     stash->params.width = width;
     stash->params.height = height;
-    stash->itw = 1.0f/stash->params.width;
-    stash->ith = 1.0f/stash->params.height;
+    stash->generation++;
 
-	dprintf("fonsExpandAtlas: texData=%p width=%d height=%d\n",
-		stash->texData, stash->params.width, stash->params.height);
+	dprintf("fonsExpandAtlas: width=%d height=%d\n", stash->params.width, stash->params.height);
 
     return 1;
 }
@@ -2805,19 +3005,13 @@ int fonsResetAtlas(FONScontext* stash, int width, int height)
             return 0;
     }
 
-    // Reset atlas
-    fons__atlasReset(stash->atlas, width, height);
-
-    // Clear texture data.
-    stash->texData = (unsigned char*)realloc(stash->texData, width * height * 4);
-    if (stash->texData == NULL) return 0;
-    memset(stash->texData, 0, width * height * 4);
-
-    // Reset dirty rect
-    stash->dirtyRect[0] = width;
-    stash->dirtyRect[1] = height;
-    stash->dirtyRect[2] = 0;
-    stash->dirtyRect[3] = 0;
+    // Release all pages
+    for (i = 0; i < stash->npages; i++) {
+        fons__deleteAtlas(stash->pages[i].atlas);
+        free(stash->pages[i].data);
+        memset(&stash->pages[i], 0, sizeof(FONSpage));
+    }
+    stash->npages = 0;
 
     // Reset cached glyphs
     for (i = 0; i < stash->nfonts; i++) {
@@ -2829,13 +3023,428 @@ int fonsResetAtlas(FONScontext* stash, int width, int height)
 
     stash->params.width = width;
     stash->params.height = height;
-    stash->itw = 1.0f/stash->params.width;
-    stash->ith = 1.0f/stash->params.height;
+    stash->generation++;
 
-    // Add white rect at 0,0 for debug drawing.
-    fons__addWhiteRect(stash, 2,2);
+    // Create the first page, with the white rect at 0,0 for debug drawing.
+    return fons__allocPage(stash, FONS_PAGE_ALPHA, 0, 0) != -1;
+}
 
-    return 1;
+
+// Atlas cache file: a header, each font's identity and glyph table, then each page's skyline
+// and pixels. It is in native byte order and only valid for the build that wrote it.
+
+#define FONS_CACHE_MAGIC 0x43534e46u    // "FNSC"
+#define FONS_CACHE_VERSION 1
+
+struct FONScacheHeader
+{
+    unsigned int magic, version;
+    int glyphSize;              // sizeof(FONSglyph)
+    int freetype;               // FreeType version that rendered the bitmaps
+    int sdfSize, sdfSpread;
+    int nfonts, npages;
+    unsigned int frame;
+};
+typedef struct FONScacheHeader FONScacheHeader;
+
+struct FONScacheFont
+{
+    char name[64];
+    uint64_t hash;              // of the font data
+    int dataSize;
+    int nfallbacks;
+    int fallbacks[FONS_MAX_FALLBACKS];
+    int nglyphs;
+};
+typedef struct FONScacheFont FONScacheFont;
+
+struct FONScachePage
+{
+    int format;                 // 0 for a free slot, which has no nodes and pixels
+    int width, height;
+    int nnodes;
+    unsigned int lastUsed;
+};
+typedef struct FONScachePage FONScachePage;
+
+struct FONScacheReader
+{
+    const unsigned char* p;
+    const unsigned char* end;
+};
+typedef struct FONScacheReader FONScacheReader;
+
+// MurmurHash64A
+static uint64_t fons__hashData(const unsigned char* data, size_t n)
+{
+    const uint64_t m = 0xc6a4a7935bd1e995ull;
+    uint64_t h = 0x8445d61a4e774912ull ^ ((uint64_t)n * m), k;
+    size_t i, j;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        memcpy(&k, data + i, 8);
+        k *= m;
+        k ^= k >> 47;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    if (i < n) {
+        for (k = 0, j = n; j > i; j--)
+            k = (k << 8) | data[j-1];
+        h ^= k;
+        h *= m;
+    }
+    h ^= h >> 47;
+    h *= m;
+    h ^= h >> 47;
+    return h;
+}
+
+#ifdef _WIN32
+static const unsigned char* fons__mapFile(const char* path, size_t* size)
+{
+    const unsigned char* data = NULL;
+    LARGE_INTEGER n;
+    HANDLE file, mapping;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+    if (GetFileSizeEx(file, &n) && n.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL) {
+            data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        *size = (size_t)n.QuadPart;
+    }
+    CloseHandle(file);
+    return data;
+}
+
+static void fons__unmapFile(const unsigned char* data, size_t size)
+{
+    FONS_NOTUSED(size);
+    UnmapViewOfFile(data);
+}
+#else
+static const unsigned char* fons__mapFile(const char* path, size_t* size)
+{
+    void* data = NULL;
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if (fd == -1)
+        return NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+            data = NULL;
+        *size = (size_t)st.st_size;
+    }
+    close(fd);
+    return (const unsigned char*)data;
+}
+
+static void fons__unmapFile(const unsigned char* data, size_t size)
+{
+    munmap((void*)data, size);
+}
+#endif
+
+// Returns the next n bytes of the file and copies them to dst if it is not NULL, NULL if the
+// file is too short.
+static const unsigned char* fons__cacheRead(FONScacheReader* r, void* dst, size_t n)
+{
+    const unsigned char* p = r->p;
+    if ((size_t)(r->end - r->p) < n)
+        return NULL;
+    if (dst != NULL)
+        memcpy(dst, p, n);
+    r->p += n;
+    return p;
+}
+
+static void fons__cacheHeader(FONScontext* stash, FONScacheHeader* header)
+{
+    memset(header, 0, sizeof(FONScacheHeader));
+    header->magic = FONS_CACHE_MAGIC;
+    header->version = FONS_CACHE_VERSION;
+    header->glyphSize = (int)sizeof(FONSglyph);
+    header->freetype = FREETYPE_MAJOR * 10000 + FREETYPE_MINOR * 100 + FREETYPE_PATCH;
+    header->sdfSize = FONS_SDF_SIZE;
+    header->sdfSpread = FONS_SDF_SPREAD;
+    header->nfonts = stash->nfonts;
+    header->npages = stash->npages;
+    header->frame = stash->frame;
+}
+
+int fonsSaveCache(FONScontext* stash, const char* path)
+{
+    FONScacheHeader header;
+    FILE* fp;
+    char* tmp;
+    int i, j, ok;
+
+    if (stash == NULL) return 0;
+    tmp = (char*)malloc(strlen(path) + 5);
+    if (tmp == NULL) return 0;
+    strcpy(tmp, path);
+    strcat(tmp, ".tmp");
+    fp = fopen(tmp, "wb");
+    if (fp == NULL) {
+        free(tmp);
+        return 0;
+    }
+
+    fons__cacheHeader(stash, &header);
+    fwrite(&header, sizeof(header), 1, fp);
+    for (i = 0; i < stash->nfonts; i++) {
+        FONSfont* font = stash->fonts[i];
+        FONScacheFont cfont;
+        memset(&cfont, 0, sizeof(cfont));
+        memcpy(cfont.name, font->name, sizeof(cfont.name));
+        cfont.hash = fons__hashData(font->data, (size_t)font->dataSize);
+        cfont.dataSize = font->dataSize;
+        cfont.nfallbacks = font->nfallbacks;
+        memcpy(cfont.fallbacks, font->fallbacks, sizeof(cfont.fallbacks));
+        cfont.nglyphs = font->nglyphs;
+        fwrite(&cfont, sizeof(cfont), 1, fp);
+        for (j = 0; j < font->nglyphs; j++) {
+            // A bitmap the raster threads have not delivered yet is saved as evicted
+            FONSglyph glyph = font->glyphs[j];
+            if (glyph.pending != 0 && glyph.page >= 0) {
+                glyph.x0 = -1;
+                glyph.y0 = 0;
+                glyph.x1 = -1;
+                glyph.y1 = 0;
+                glyph.page = -1;
+            }
+            glyph.pending = 0;
+            fwrite(&glyph, sizeof(glyph), 1, fp);
+        }
+    }
+    for (i = 0; i < stash->npages; i++) {
+        FONSpage* page = &stash->pages[i];
+        FONScachePage cpage;
+        memset(&cpage, 0, sizeof(cpage));
+        cpage.format = page->format;
+        if (page->format != 0) {
+            cpage.width = page->width;
+            cpage.height = page->height;
+            cpage.nnodes = page->atlas->nnodes;
+            cpage.lastUsed = page->lastUsed;
+        }
+        fwrite(&cpage, sizeof(cpage), 1, fp);
+        if (page->format == 0)
+            continue;
+        fwrite(page->atlas->nodes, sizeof(FONSatlasNode), page->atlas->nnodes, fp);
+        fwrite(page->data, (size_t)page->width * page->bpp, page->height, fp);
+    }
+
+    ok = !ferror(fp);
+    ok = fclose(fp) == 0 && ok;
+#ifdef _WIN32
+    if (ok)
+        remove(path);
+#endif
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok)
+        remove(tmp);
+    free(tmp);
+    return ok;
+}
+
+int fonsLoadCache(FONScontext* stash, const char* path)
+{
+    FONScacheHeader header, expected;
+    FONScachePage cpages[FONS_MAX_PAGES];
+    FONSpage pages[FONS_MAX_PAGES];
+    const unsigned char* nodes[FONS_MAX_PAGES];
+    const unsigned char* pixels[FONS_MAX_PAGES];
+    FONScacheFont* cfonts = NULL;
+    const unsigned char** glyphs = NULL;
+    int* map = NULL;            // stash font of each font in the file
+    FONScacheReader r;
+    FONSglyph glyph;
+    const unsigned char* data;
+    size_t size = 0;
+    int i, j, k, ok = 0;
+
+    if (stash == NULL || fonsPendingGlyphs(stash) > 0) return 0;
+    data = fons__mapFile(path, &size);
+    if (data == NULL) return 0;
+    r.p = data;
+    r.end = data + size;
+    memset(pages, 0, sizeof(pages));
+
+    fons__cacheHeader(stash, &expected);
+    if (fons__cacheRead(&r, &header, sizeof(header)) == NULL ||
+        header.magic != expected.magic || header.version != expected.version ||
+        header.glyphSize != expected.glyphSize || header.freetype != expected.freetype ||
+        header.sdfSize != expected.sdfSize || header.sdfSpread != expected.sdfSpread ||
+        header.nfonts < 0 || (size_t)header.nfonts > size / sizeof(FONScacheFont) ||
+        header.npages < 1 || header.npages > FONS_MAX_PAGES)
+        goto done;
+
+    // Each font of the file must be in the stash with the same data and fallbacks
+    cfonts = (FONScacheFont*)malloc(sizeof(FONScacheFont) * (header.nfonts + 1));
+    glyphs = (const unsigned char**)malloc(sizeof(const unsigned char*) * (header.nfonts + 1));
+    map = (int*)malloc(sizeof(int) * (header.nfonts + 1));
+    if (cfonts == NULL || glyphs == NULL || map == NULL)
+        goto done;
+    for (i = 0; i < header.nfonts; i++) {
+        FONSfont* font;
+        if (fons__cacheRead(&r, &cfonts[i], sizeof(FONScacheFont)) == NULL)
+            goto done;
+        cfonts[i].name[sizeof(cfonts[i].name)-1] = '\0';
+        map[i] = fonsGetFontByName(stash, cfonts[i].name);
+        if (map[i] == FONS_INVALID)
+            goto done;
+        for (j = 0; j < i; j++)
+            if (map[j] == map[i])
+                goto done;
+        font = stash->fonts[map[i]];
+        if (font->dataSize != cfonts[i].dataSize || cfonts[i].nglyphs < 0 ||
+            fons__hashData(font->data, (size_t)font->dataSize) != cfonts[i].hash)
+            goto done;
+        glyphs[i] = fons__cacheRead(&r, NULL, sizeof(FONSglyph) * (size_t)cfonts[i].nglyphs);
+        if (glyphs[i] == NULL)
+            goto done;
+    }
+    for (i = 0; i < header.nfonts; i++) {
+        FONSfont* font = stash->fonts[map[i]];
+        if (cfonts[i].nfallbacks != font->nfallbacks)
+            goto done;
+        for (j = 0; j < font->nfallbacks; j++) {
+            k = cfonts[i].fallbacks[j];
+            if (k < 0 || k >= header.nfonts || map[k] != font->fallbacks[j])
+                goto done;
+        }
+    }
+
+    for (i = 0; i < header.npages; i++) {
+        FONScachePage* cpage = &cpages[i];
+        int bpp;
+        if (fons__cacheRead(&r, cpage, sizeof(FONScachePage)) == NULL)
+            goto done;
+        if (cpage->format == 0)
+            continue;
+        if ((cpage->format != FONS_PAGE_ALPHA && cpage->format != FONS_PAGE_RGBA && cpage->format != FONS_PAGE_SDF) ||
+            cpage->width <= 0 || cpage->width > 32767 || cpage->height <= 0 || cpage->height > 32767 ||
+            cpage->nnodes < 1 || cpage->nnodes > cpage->width)
+            goto done;
+        bpp = cpage->format == FONS_PAGE_RGBA ? 4 : 1;
+        nodes[i] = fons__cacheRead(&r, NULL, sizeof(FONSatlasNode) * (size_t)cpage->nnodes);
+        pixels[i] = fons__cacheRead(&r, NULL, (size_t)cpage->width * cpage->height * bpp);
+        if (nodes[i] == NULL || pixels[i] == NULL)
+            goto done;
+        // The skyline must span the page from left to right without gaps
+        for (j = 0, k = 0; j < cpage->nnodes; j++) {
+            FONSatlasNode node;
+            memcpy(&node, nodes[i] + sizeof(FONSatlasNode) * j, sizeof(FONSatlasNode));
+            if (node.x != k || node.width <= 0 || node.y < 0 || node.y > cpage->height)
+                goto done;
+            k += node.width;
+        }
+        if (k != cpage->width)
+            goto done;
+    }
+    if (r.p != r.end)
+        goto done;
+
+    // Glyph bitmaps must lie on a page
+    for (i = 0; i < header.nfonts; i++) {
+        for (j = 0; j < cfonts[i].nglyphs; j++) {
+            memcpy(&glyph, glyphs[i] + sizeof(FONSglyph) * j, sizeof(FONSglyph));
+            if (glyph.page < 0)
+                continue;
+            if (glyph.page >= header.npages || cpages[glyph.page].format == 0 ||
+                glyph.x0 < 0 || glyph.y0 < 0 || glyph.x1 < glyph.x0 || glyph.y1 < glyph.y0 ||
+                glyph.x1 > cpages[glyph.page].width || glyph.y1 > cpages[glyph.page].height)
+                goto done;
+        }
+    }
+
+    // Everything that can fail is allocated before the stash is changed
+    for (i = 0; i < header.nfonts; i++) {
+        FONSfont* font = stash->fonts[map[i]];
+        if (cfonts[i].nglyphs > font->cglyphs) {
+            FONSglyph* g = (FONSglyph*)realloc(font->glyphs, sizeof(FONSglyph) * cfonts[i].nglyphs);
+            if (g == NULL)
+                goto done;
+            font->glyphs = g;
+            font->cglyphs = cfonts[i].nglyphs;
+        }
+    }
+    for (i = 0; i < header.npages; i++) {
+        FONScachePage* cpage = &cpages[i];
+        FONSpage* page = &pages[i];
+        if (cpage->format == 0)
+            continue;
+        page->format = cpage->format;
+        page->bpp = cpage->format == FONS_PAGE_RGBA ? 4 : 1;
+        page->width = cpage->width;
+        page->height = cpage->height;
+        page->itw = 1.0f/cpage->width;
+        page->ith = 1.0f/cpage->height;
+        page->lastUsed = cpage->lastUsed;
+        page->data = (unsigned char*)malloc((size_t)page->width * page->height * page->bpp);
+        page->atlas = fons__allocAtlas(page->width, page->height, fons__maxi(cpage->nnodes, FONS_INIT_ATLAS_NODES));
+        if (page->data == NULL || page->atlas == NULL)
+            goto done;
+        memcpy(page->data, pixels[i], (size_t)page->width * page->height * page->bpp);
+        memcpy(page->atlas->nodes, nodes[i], sizeof(FONSatlasNode) * cpage->nnodes);
+        page->atlas->nnodes = cpage->nnodes;
+        page->dirtyRect[2] = page->width;
+        page->dirtyRect[3] = page->height;
+    }
+
+    // Replace the pages and the glyph tables
+    fons__flush(stash);
+    for (i = 0; i < stash->npages; i++) {
+        fons__deleteAtlas(stash->pages[i].atlas);
+        free(stash->pages[i].data);
+    }
+    memcpy(stash->pages, pages, sizeof(pages));
+    memset(pages, 0, sizeof(pages));
+    stash->npages = header.npages;
+    for (i = 0; i < stash->nfonts; i++) {
+        FONSfont* font = stash->fonts[i];
+        font->nglyphs = 0;
+        for (j = 0; j < FONS_HASH_LUT_SIZE; j++)
+            font->lut[j] = -1;
+    }
+    for (i = 0; i < header.nfonts; i++) {
+        FONSfont* font = stash->fonts[map[i]];
+        memcpy(font->glyphs, glyphs[i], sizeof(FONSglyph) * cfonts[i].nglyphs);
+        font->nglyphs = cfonts[i].nglyphs;
+        for (j = 0; j < font->nglyphs; j++) {
+            FONSglyph* g = &font->glyphs[j];
+            unsigned int h = fons__hashint(g->codepoint) & (FONS_HASH_LUT_SIZE-1);
+            g->next = font->lut[h];
+            font->lut[h] = j;
+            g->pending = 0;
+            if (g->page >= 0)
+                stash->pages[g->page].nglyphs++;
+        }
+    }
+    stash->frame = header.frame;
+    stash->generation++;
+    ok = 1;
+    dprintf("fonsLoadCache: %d fonts, %d pages from %s\n", header.nfonts, header.npages, path);
+
+done:
+    for (i = 0; i < FONS_MAX_PAGES; i++) {
+        fons__deleteAtlas(pages[i].atlas);
+        free(pages[i].data);
+    }
+    free(cfonts);
+    free(glyphs);
+    free(map);
+    fons__unmapFile(data, size);
+    return ok;
 }
 
 
@@ -19,10 +19,9 @@
 #ifndef IMAGESTASH_H
 #define IMAGESTASH_H
 
-#define IMGS_INVALID -1
+#include <stdint.h>
 
-// Define maximum name length for images
-#define IMGS_MAX_NAME_LEN 64
+#define IMGS_INVALID -1
 
 // Padding around images in atlas to prevent bleeding (1 pixel)
 #define IMGS_PAD 1
@@ -77,21 +76,58 @@ int imgsExpandAtlas(IMGcontext* s, int width, int height);
 // Resets the whole stash.
 int imgsResetAtlas(IMGcontext* stash, int width, int height);
 
-// Add images
+// Add images. Return a handle for the image, 0 on failure. Adding a name again replaces the
+// image. A file already in the atlas under the name (e.g. from the cache) with the same
+// contents and size limits is not decoded again.
 int imgsAddFile(IMGcontext* s, const char* name, const char* path, int maxWidth, int maxHeight);
 int imgsAddPixels(IMGcontext* s, const char* name, unsigned char* data, int width, int height, int freeData);
+// Returns the handle of the image with the name, 0 if there is none.
+int imgsFindImage(IMGcontext* s, const char* name);
+// Removes an image; its space in the atlas is reused. The handle becomes invalid.
+int imgsRemoveImage(IMGcontext* s, int image);
+
+// Mipmaps. Images added while this is on keep their pixels outside the atlas, with a pyramid of
+// halved sizes resized from them (stb_image_resize2) when first drawn. imgsDraw() draws the
+// level closest to the size drawn, so downscaled images do not alias, and only levels that are
+// drawn take space in the atlas. Mipmapped images are not saved in the cache.
+void imgsSetMipmaps(IMGcontext* s, int mipmaps);
+// Ends a frame: flushes the quads drawn and takes mip levels not drawn for IMGS_MIP_FRAMES
+// frames out of the atlas. Levels not drawn in the current frame also make room for new
+// images before the atlas grows, once frames are ended.
+void imgsEndFrame(IMGcontext* s);
+
+// Decodes and downsizes the files of imgsAddFileAsync() on up to IMGS_MAX_LOAD_THREADS worker
+// threads, 0 stops them. 'ready' is called on a worker thread after each image it finished,
+// to schedule a frame that calls imgsCollect(); it may be NULL. Returns the number started.
+int imgsSetLoadThreads(IMGcontext* s, int threads, void (*ready)(void* uptr), void* uptr);
+// Like imgsAddFile(), but the file is read, decoded and resized on a load thread; the image
+// is in the atlas once imgsCollect() reported it. Without load threads it is added right
+// away. Returns 0 if the image could not be queued.
+int imgsAddFileAsync(IMGcontext* s, const char* name, const char* path, int maxWidth, int maxHeight);
+// Adds the images the load threads finished to the atlas, on the thread that draws (e.g. once
+// per frame). 'added' is called for each with the handle of the image, 0 if it could not be
+// loaded; it may be NULL. Returns the number of images added.
+int imgsCollect(IMGcontext* s, void (*added)(void* uptr, const char* name, int image), void* uptr);
+// Returns the number of images queued with imgsAddFileAsync() and not collected yet.
+int imgsPendingImages(IMGcontext* s);
 
 // Retrieve image copy for manipulation
 IMGimage* imgsGet(IMGcontext* s, const char* name);
+IMGimage* imgsGetImage(IMGcontext* s, int image);
 void imgsDeleteImage(IMGimage* img);
 
-// Filters (modify IMGimage in place)
+// Filters (modify IMGimage in place). Blurs cost the same per pixel for any radius; images
+// of 256x256 pixels and more are split across the filter threads.
 void imgsFilterGreyscale(IMGimage* img);
-void imgsFilterBlur(IMGimage* img, float radius); // Approximate box blur
+void imgsFilterBlur(IMGimage* img, float radius); // Box blur over 2*radius+1 pixels
+void imgsFilterGaussian(IMGimage* img, float sigma); // Three box blurs approximating a Gaussian
+// Sets the number of threads a filter may use, 0 for one per CPU (the default).
+void imgsSetFilterThreads(IMGcontext* s, int threads);
 void imgsFilterResize(IMGimage* img, int newWidth, int newHeight);
 
 // Draw (adds quads to buffer and flushes if needed)
 void imgsDraw(IMGcontext* s, const char* name, float x, float y, float w, float h);
+void imgsDrawImage(IMGcontext* s, int image, float x, float y, float w, float h);
 void imgsDrawFiltered(IMGimage* img, float x, float y); // Draws at natural size
 
 // Pull texture changes
@@ -101,25 +137,99 @@ int imgsValidateTexture(IMGcontext* s, int* dirty);
 // Draws the stash texture for debugging
 void imgsDrawDebug(IMGcontext* s, float x, float y);
 
+// Atlas cache. imgsSaveCache() writes the atlas and the image table to a file, with a hash of
+// the file each image was loaded from (mipmapped images are left out). imgsLoadCache() memory-maps such a file and replaces
+// the atlas with it; call it right after imgsCreateInternal(), handles from before are invalid.
+// The images are then in the atlas (see imgsFindImage()), and imgsAddFile() only decodes those
+// whose file changed. Both return 1 on success.
+int imgsSaveCache(IMGcontext* s, const char* path);
+int imgsLoadCache(IMGcontext* s, const char* path);
+
 #endif // IMAGESTASH_H
 
 #ifdef IMAGESTASH_IMPLEMENTATION
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <limits.h>
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+typedef HANDLE imgs__thread;
+typedef CRITICAL_SECTION imgs__mutex;
+typedef CONDITION_VARIABLE imgs__cond;
+#define imgs__mutexInit(m)      InitializeCriticalSection(m)
+#define imgs__mutexDestroy(m)   DeleteCriticalSection(m)
+#define imgs__mutexLock(m)      EnterCriticalSection(m)
+#define imgs__mutexUnlock(m)    LeaveCriticalSection(m)
+#define imgs__condInit(c)       InitializeConditionVariable(c)
+#define imgs__condDestroy(c)    ((void)(c))
+#define imgs__condWait(c, m)    SleepConditionVariableCS(c, m, INFINITE)
+#define imgs__condBroadcast(c)  WakeAllConditionVariable(c)
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+typedef pthread_t imgs__thread;
+typedef pthread_mutex_t imgs__mutex;
+typedef pthread_cond_t imgs__cond;
+#define imgs__mutexInit(m)      pthread_mutex_init(m, NULL)
+#define imgs__mutexDestroy(m)   pthread_mutex_destroy(m)
+#define imgs__mutexLock(m)      pthread_mutex_lock(m)
+#define imgs__mutexUnlock(m)    pthread_mutex_unlock(m)
+#define imgs__condInit(c)       pthread_cond_init(c, NULL)
+#define imgs__condDestroy(c)    pthread_cond_destroy(c)
+#define imgs__condWait(c, m)    pthread_cond_wait(c, m)
+#define imgs__condBroadcast(c)  pthread_cond_broadcast(c)
+#endif
+
 //#define STB_IMAGE_IMPLEMENTATION
 //#include "stb_image.h"
 //#define STB_IMAGE_RESIZE_IMPLEMENTATION
 //#include "stb_image_resize2.h"
 
 #define IMGS_NOTUSED(v)  (void)sizeof(v)
-#define IMGS_HASH_LUT_SIZE 256
+#define IMGS_INITIAL_TABLE 64      // Name table slots, a power of two
+#define IMGS_HANDLE_BITS 20         // Image slot bits of a handle, the rest is the generation
 #define IMGS_INITIAL_NODES 256
 #define IMGS_VERTEX_COUNT 1024 * 6  // Enough for many quads
 #define IMGS_SCRATCH_BUF_SIZE 64000
+#ifndef IMGS_MAX_LOAD_THREADS
+#define IMGS_MAX_LOAD_THREADS 8
+#endif
+#ifndef IMGS_MAX_FILTER_THREADS
+#define IMGS_MAX_FILTER_THREADS 16
+#endif
+#define IMGS_FILTER_THREAD_PIXELS (256 * 256)  // Smaller images are filtered on the calling thread
+#define IMGS_MAX_BLUR_RADIUS 1024
+#define IMGS_MAX_LEVELS 16         // Mip levels, enough for 32768 pixels
+#ifndef IMGS_MIP_FRAMES
+#define IMGS_MIP_FRAMES 60         // Frames a mip level stays in the atlas undrawn
+#endif
+
+// The filters use SSE2 (and AVX2 where the compiler targets it) or NEON, chosen at compile
+// time. Define IMGS_NO_SIMD for the scalar code, which gives the same results.
+#if !defined(IMGS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define IMGS_USE_SSE2
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define IMGS_USE_AVX2
+#include <immintrin.h>
+#endif
+#elif !defined(IMGS_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define IMGS_USE_NEON
+#include <arm_neon.h>
+#endif
+
+static int imgs__mini(int a, int b) { return a < b ? a : b; }
+static int imgs__maxi(int a, int b) { return a > b ? a : b; }
 
 // Simple FNV-1a hash for strings
 static unsigned int imgs__hashstr(const char* str) {
@@ -131,12 +241,72 @@ static unsigned int imgs__hashstr(const char* str) {
     return hash;
 }
 
-// Internal image struct for stash storage
+// MurmurHash64A, for file contents
+static uint64_t imgs__hashData(const unsigned char* data, size_t n, uint64_t seed) {
+    const uint64_t m = 0xc6a4a7935bd1e995ull;
+    uint64_t h = seed ^ ((uint64_t)n * m), k;
+    size_t i, j;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        memcpy(&k, data + i, 8);
+        k *= m;
+        k ^= k >> 47;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    if (i < n) {
+        for (k = 0, j = n; j > i; j--)
+            k = (k << 8) | data[j - 1];
+        h ^= k;
+        h *= m;
+    }
+    h ^= h >> 47;
+    h *= m;
+    h ^= h >> 47;
+    return h;
+}
+
+static unsigned char* imgs__readFile(const char* path, size_t* size) {
+    unsigned char* data = NULL;
+    long n;
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) return NULL;
+    if (fseek(fp, 0, SEEK_END) == 0 && (n = ftell(fp)) > 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        data = (unsigned char*)malloc((size_t)n);
+        if (data != NULL && fread(data, 1, (size_t)n, fp) != (size_t)n) {
+            free(data);
+            data = NULL;
+        }
+        *size = (size_t)n;
+    }
+    fclose(fp);
+    return data;
+}
+
+// Internal image struct for stash storage. A handle is (generation << IMGS_HANDLE_BITS) | (slot + 1).
 struct IMGSimageImpl {
-    char name[IMGS_MAX_NAME_LEN];
+    char* name;  // NULL if the slot is free
+    unsigned int hash;
+    short x, y;
+    short width, height;
+    int generation;  // Bumped when the slot is freed, so old handles do not match
+    int nextFree;
+    uint64_t source;  // Hash of the file and size limits it was loaded with, 0 for pixels
+    struct IMGSmipmaps* mips;  // NULL if the image itself is in the atlas (x, y)
+};
+
+// A level of a mipmapped image, in the atlas when x is not -1
+struct IMGSmipLevel {
     short x, y;
     short width, height;
-    int next;  // For hash chain
+    unsigned char* pixels;  // Resized when first drawn; level 0 holds the image
+    unsigned int used;      // Frame it was last drawn in
+};
+
+struct IMGSmipmaps {
+    int nlevels;
+    struct IMGSmipLevel levels[IMGS_MAX_LEVELS];
 };
 
 struct IMGSatlasNode {
@@ -145,11 +315,48 @@ struct IMGSatlasNode {
     short width;
 };
 
+// Space of removed images below the skyline
+struct IMGSatlasRect {
+    short x, y;
+    short width, height;
+};
+
 struct IMGSatlas {
     int width, height;
     int nnodes;
     int cnodes;
     struct IMGSatlasNode* nodes;
+    int nfree;
+    int cfree;
+    struct IMGSatlasRect* free;
+};
+
+// An image file to load on a worker thread
+struct IMGSjob {
+    char* name;
+    char* path;
+    int maxWidth, maxHeight;
+    int mipmaps;
+    uint64_t known;          // source of the atlas image of the name when queued, 0 if none
+    uint64_t source;         // source of the file, 0 if it could not be read
+    unsigned char* pixels;   // RGBA, NULL if loading failed or the file is 'known'
+    int width, height;
+    struct IMGSjob* next;
+};
+
+struct IMGSloader {
+    imgs__mutex mutex;
+    imgs__cond cond;
+    struct IMGSjob* queue;
+    struct IMGSjob* queueTail;
+    struct IMGSjob* done;
+    struct IMGSjob* doneTail;
+    int quit;
+    int pending;             // jobs queued or done but not collected yet
+    imgs__thread threads[IMGS_MAX_LOAD_THREADS];
+    int nthreads;
+    void (*ready)(void* uptr);
+    void* readyUptr;
 };
 
 struct IMGcontext {
@@ -159,19 +366,31 @@ struct IMGcontext {
     int dirtyRect[4];
     struct IMGSatlas* atlas;
     struct IMGSimageImpl* images;
-    int nimages;
+    int nimages;    // Slots in use or freed
     int cimages;
-    int lut[IMGS_HASH_LUT_SIZE];
+    int freeImage;  // First free slot, -1 if none
+    int nlive;
+    // Open addressing name table of image slots, -1 if empty
+    int* table;
+    int ctable;
     // Vertex buffer for drawing
     float* verts;
     float* tcoords;
     unsigned int* colors;
     int nverts;
-    // Scratch
+    // Scratch, grown by the filters
     unsigned char* scratch;
+    size_t nscratch;
+    int filterThreads;  // 0 for one per CPU
     // Error handling
     void (*handleError)(void* uptr, int error, int val);
     void* errorUptr;
+    // Load threads, NULL to load synchronously
+    struct IMGSloader* loader;
+    // Mipmapped images
+    int mipmaps;         // Images added get mip levels
+    unsigned int frame;  // Counted by imgsEndFrame()
+    int nresident;       // Mip levels in the atlas
 };
 
 // Atlas functions (adapted from fontstash, with fixes for packing and dynamic sizing)
@@ -199,6 +418,7 @@ static struct IMGSatlas* imgs__allocAtlas(int w, int h, int cnodes) {
 static void imgs__deleteAtlas(struct IMGSatlas* atlas) {
     if (atlas != NULL) {
         if (atlas->nodes != NULL) free(atlas->nodes);
+        if (atlas->free != NULL) free(atlas->free);
         free(atlas);
     }
 }
@@ -211,6 +431,7 @@ static void imgs__atlasReset(struct IMGSatlas* atlas, int w, int h) {
     atlas->nodes[0].y = 0;
     atlas->nodes[0].width = (short)w;
     atlas->nnodes++;
+    atlas->nfree = 0;
 }
 
 static void imgs__atlasExpand(struct IMGSatlas* atlas, int w, int h) {
@@ -218,8 +439,135 @@ static void imgs__atlasExpand(struct IMGSatlas* atlas, int w, int h) {
     atlas->height = h;
 }
 
+static int imgs__atlasInsertNode(struct IMGSatlas* atlas, int idx, int x, int y, int w) {
+    int i;
+    if (atlas->nnodes + 1 > atlas->cnodes) {
+        struct IMGSatlasNode* nodes = (struct IMGSatlasNode*)realloc(atlas->nodes, sizeof(struct IMGSatlasNode) * atlas->cnodes * 2);
+        if (nodes == NULL) return 0;
+        atlas->nodes = nodes;
+        atlas->cnodes *= 2;
+    }
+    for (i = atlas->nnodes; i > idx; i--)
+        atlas->nodes[i] = atlas->nodes[i-1];
+    atlas->nodes[idx].x = (short)x;
+    atlas->nodes[idx].y = (short)y;
+    atlas->nodes[idx].width = (short)w;
+    atlas->nnodes++;
+    return 1;
+}
+
+static void imgs__atlasRemoveFree(struct IMGSatlas* atlas, int idx) {
+    atlas->free[idx] = atlas->free[--atlas->nfree];
+}
+
+static void imgs__atlasRemoveNode(struct IMGSatlas* atlas, int idx) {
+    int i;
+    for (i = idx; i < atlas->nnodes - 1; i++)
+        atlas->nodes[i] = atlas->nodes[i+1];
+    atlas->nnodes--;
+}
+
+// Merges neighbouring skyline segments of the same height
+static void imgs__atlasMergeNodes(struct IMGSatlas* atlas) {
+    int i;
+    for (i = 0; i < atlas->nnodes - 1; i++) {
+        if (atlas->nodes[i].y == atlas->nodes[i+1].y) {
+            atlas->nodes[i].width += atlas->nodes[i+1].width;
+            imgs__atlasRemoveNode(atlas, i + 1);
+            i--;
+        }
+    }
+}
+
+// Adds a free rect, joined with free neighbours that share a whole edge with it. Returns its
+// index, -1 if out of memory (the space is lost until the next reset).
+static int imgs__atlasAddFree(struct IMGSatlas* atlas, struct IMGSatlasRect r) {
+    int i;
+    for (i = 0; i < atlas->nfree; i++) {
+        struct IMGSatlasRect* f = &atlas->free[i];
+        if (f->x == r.x && f->width == r.width && (f->y + f->height == r.y || r.y + r.height == f->y)) {
+            r.y = f->y < r.y ? f->y : r.y;
+            r.height = (short)(r.height + f->height);
+        } else if (f->y == r.y && f->height == r.height && (f->x + f->width == r.x || r.x + r.width == f->x)) {
+            r.x = f->x < r.x ? f->x : r.x;
+            r.width = (short)(r.width + f->width);
+        } else {
+            continue;
+        }
+        imgs__atlasRemoveFree(atlas, i);
+        i = -1;
+    }
+    if (atlas->nfree + 1 > atlas->cfree) {
+        int cfree = atlas->cfree ? atlas->cfree * 2 : 16;
+        struct IMGSatlasRect* rects = (struct IMGSatlasRect*)realloc(atlas->free, sizeof(struct IMGSatlasRect) * cfree);
+        if (rects == NULL) return -1;
+        atlas->free = rects;
+        atlas->cfree = cfree;
+    }
+    atlas->free[atlas->nfree] = r;
+    return atlas->nfree++;
+}
+
+// Best area fit among the free rects; the rest of the rect stays free, split along its
+// shorter leftover side.
+static int imgs__atlasAddFreeRect(struct IMGSatlas* atlas, int rw, int rh, int* rx, int* ry) {
+    int i, besti = -1, besta = INT_MAX;
+    struct IMGSatlasRect r, right, below;
+
+    for (i = 0; i < atlas->nfree; i++) {
+        struct IMGSatlasRect* f = &atlas->free[i];
+        if (f->width >= rw && f->height >= rh && f->width * f->height < besta) {
+            besti = i;
+            besta = f->width * f->height;
+        }
+    }
+    if (besti == -1) return 0;
+
+    r = atlas->free[besti];
+    *rx = r.x;
+    *ry = r.y;
+    right.x = (short)(r.x + rw);
+    right.y = r.y;
+    right.width = (short)(r.width - rw);
+    below.x = r.x;
+    below.y = (short)(r.y + rh);
+    below.height = (short)(r.height - rh);
+    if (r.width - rw > r.height - rh) {
+        right.height = r.height;
+        below.width = (short)rw;
+    } else {
+        right.height = (short)rh;
+        below.width = r.width;
+    }
+
+    imgs__atlasRemoveFree(atlas, besti);
+    if (right.width > 0 && right.height > 0)
+        imgs__atlasAddFree(atlas, right);
+    if (below.width > 0 && below.height > 0)
+        imgs__atlasAddFree(atlas, below);
+    return 1;
+}
+
+// Checks if there is enough space at skyline segment 'i' and returns the height the rect
+// would rest at, on the highest segment under it, or -1 if it does not fit.
+static int imgs__atlasRectFits(struct IMGSatlas* atlas, int i, int w, int h) {
+    int x = atlas->nodes[i].x;
+    int y = atlas->nodes[i].y;
+    int spaceLeft = w;
+    if (x + w > atlas->width)
+        return -1;
+    while (spaceLeft > 0) {
+        if (i == atlas->nnodes) return -1;
+        if (atlas->nodes[i].y > y) y = atlas->nodes[i].y;
+        if (y + h > atlas->height) return -1;
+        spaceLeft -= atlas->nodes[i].width;
+        ++i;
+    }
+    return y;
+}
+
 static int imgs__atlasAddRect(struct IMGSatlas* atlas, int rw, int rh, int* rx, int* ry) {
-    int besth = INT_MAX, bestw = INT_MAX, besti = -1;
+    int besth = INT_MAX, bestw = INT_MAX, besti = -1, bestx = -1, besty = -1;
     int i;
 
     // Validate input dimensions
@@ -228,53 +576,122 @@ static int imgs__atlasAddRect(struct IMGSatlas* atlas, int rw, int rh, int* rx,
         return 0;
     }
 
-    // Find best shelf: minimize new max height (y + rh), then tightest width fit
+    // Reuse the space of removed images first
+    if (imgs__atlasAddFreeRect(atlas, rw, rh, rx, ry))
+        return 1;
+
+    // Bottom left fit: minimize new max height (y + rh), then tightest width fit
     for (i = 0; i < atlas->nnodes; ++i) {
-        int y = atlas->nodes[i].y;
-        if (atlas->nodes[i].width >= rw && y + rh <= atlas->height) {
-            int thisw = atlas->nodes[i].width;
-            int thish = y + rh;
-            if (thish < besth || (thish == besth && thisw < bestw)) {
-                besti = i;
-                bestw = thisw;
-                besth = thish;
-            }
+        int y = imgs__atlasRectFits(atlas, i, rw, rh);
+        if (y != -1 && (y + rh < besth || (y + rh == besth && atlas->nodes[i].width < bestw))) {
+            besti = i;
+            bestw = atlas->nodes[i].width;
+            besth = y + rh;
+            bestx = atlas->nodes[i].x;
+            besty = y;
         }
     }
 
     if (besti == -1) return 0;
 
-    *rx = atlas->nodes[besti].x;
-    *ry = atlas->nodes[besti].y;
-
-    // Split node if remainder > 0
-    int old_width = atlas->nodes[besti].width;
-    if (old_width - rw > 0) {
-        // Realloc if needed
-        if (atlas->nnodes + 1 > atlas->cnodes) {
-            int old_c = atlas->cnodes;
-            atlas->cnodes = atlas->cnodes * 2;
-            atlas->nodes = (struct IMGSatlasNode*)realloc(atlas->nodes, sizeof(struct IMGSatlasNode) * atlas->cnodes);
-            if (atlas->nodes == NULL) return 0;
-            // Zero new memory
-            memset(atlas->nodes + old_c, 0, sizeof(struct IMGSatlasNode) * (atlas->cnodes - old_c));
+    // Insert the new segment; the space between lower segments under it and the rect stays
+    // free, then the segments are cut
+    if (!imgs__atlasInsertNode(atlas, besti, bestx, besty + rh, rw))
+        return 0;
+    for (i = besti + 1; i < atlas->nnodes && atlas->nodes[i].x < bestx + rw; i++) {
+        struct IMGSatlasNode* n = &atlas->nodes[i];
+        if (n->y < besty) {
+            struct IMGSatlasRect gap;
+            gap.x = n->x;
+            gap.y = n->y;
+            gap.width = (short)((n->x + n->width < bestx + rw ? n->x + n->width : bestx + rw) - n->x);
+            gap.height = (short)(besty - n->y);
+            imgs__atlasAddFree(atlas, gap);
         }
+    }
+    for (i = besti + 1; i < atlas->nnodes; i++) {
+        int shrink = atlas->nodes[i-1].x + atlas->nodes[i-1].width - atlas->nodes[i].x;
+        if (shrink <= 0)
+            break;
+        atlas->nodes[i].x += (short)shrink;
+        atlas->nodes[i].width -= (short)shrink;
+        if (atlas->nodes[i].width > 0)
+            break;
+        imgs__atlasRemoveNode(atlas, i);
+        i--;
+    }
+    imgs__atlasMergeNodes(atlas);
 
-        for (i = atlas->nnodes; i > besti; --i)
-            atlas->nodes[i] = atlas->nodes[i-1];
+    *rx = bestx;
+    *ry = besty;
+    return 1;
+}
 
-        atlas->nodes[besti+1].x = atlas->nodes[besti].x + rw;
-        atlas->nodes[besti+1].y = atlas->nodes[besti].y;
-        atlas->nodes[besti+1].width = old_width - rw;
-        atlas->nnodes++;
-    }
+// Lowers the skyline over a removed rect if nothing was placed above it. Returns 0 if
+// something was.
+static int imgs__atlasLowerSkyline(struct IMGSatlas* atlas, struct IMGSatlasRect r) {
+    int i, x1 = r.x + r.width, top = r.y + r.height;
 
-    atlas->nodes[besti].width = rw;
-    atlas->nodes[besti].y += rh;
+    for (i = 0; i < atlas->nnodes; i++) {
+        struct IMGSatlasNode* n = &atlas->nodes[i];
+        if (n->x < x1 && n->x + n->width > r.x && n->y != top)
+            return 0;
+    }
 
+    // Split the nodes at the edges of the rect and lower the ones in between
+    for (i = 0; i < atlas->nnodes; i++) {
+        struct IMGSatlasNode* n = &atlas->nodes[i];
+        if (n->x < r.x && n->x + n->width > r.x) {
+            if (!imgs__atlasInsertNode(atlas, i + 1, r.x, n->y, n->x + n->width - r.x))
+                return 0;
+            atlas->nodes[i].width = (short)(r.x - atlas->nodes[i].x);
+        } else if (n->x < x1 && n->x + n->width > x1) {
+            if (!imgs__atlasInsertNode(atlas, i + 1, x1, n->y, n->x + n->width - x1))
+                return 0;
+            atlas->nodes[i].width = (short)(x1 - atlas->nodes[i].x);
+        }
+    }
+    for (i = 0; i < atlas->nnodes; i++) {
+        struct IMGSatlasNode* n = &atlas->nodes[i];
+        if (n->x >= r.x && n->x + n->width <= x1)
+            n->y = r.y;
+    }
+    imgs__atlasMergeNodes(atlas);
     return 1;
 }
 
+// Returns the space of a removed image to the atlas. It lowers the skyline if it is at the
+// top of its columns, otherwise it is kept as a free rect.
+static void imgs__atlasRemoveRect(struct IMGSatlas* atlas, int x, int y, int w, int h) {
+    struct IMGSatlasRect r;
+    int i, lowered;
+
+    r.x = (short)x;
+    r.y = (short)y;
+    r.width = (short)w;
+    r.height = (short)h;
+    lowered = imgs__atlasLowerSkyline(atlas, r);
+    if (!lowered) {
+        i = imgs__atlasAddFree(atlas, r);
+        if (i != -1 && imgs__atlasLowerSkyline(atlas, atlas->free[i])) {
+            imgs__atlasRemoveFree(atlas, i);
+            lowered = 1;
+        }
+    }
+
+    // A lower skyline may reach free rects that were below other images
+    while (lowered) {
+        lowered = 0;
+        for (i = 0; i < atlas->nfree; i++) {
+            if (imgs__atlasLowerSkyline(atlas, atlas->free[i])) {
+                imgs__atlasRemoveFree(atlas, i);
+                lowered = 1;
+                break;
+            }
+        }
+    }
+}
+
 static void imgs__addWhiteRect(IMGcontext* stash, int w, int h) {
     int x, y, gx, gy;
     unsigned char* dst;
@@ -326,98 +743,191 @@ static void imgs__vertex(IMGcontext* stash, float x, float y, float u, float v,
     stash->nverts++;
 }
 
-static int imgs__getImageIndex(IMGcontext* stash, const char* name) {
-    unsigned int hash = imgs__hashstr(name) % IMGS_HASH_LUT_SIZE;
-    int i = stash->lut[hash];
-    while (i != -1) {
-        if (strcmp(stash->images[i].name, name) == 0)
+// Name table, linear probing over image slots
+
+static int imgs__findSlot(IMGcontext* stash, const char* name, unsigned int hash) {
+    int mask = stash->ctable - 1, i = (int)(hash & (unsigned int)mask);
+    while (stash->table[i] != -1) {
+        struct IMGSimageImpl* img = &stash->images[stash->table[i]];
+        if (img->hash == hash && strcmp(img->name, name) == 0)
             return i;
-        i = stash->images[i].next;
+        i = (i + 1) & mask;
     }
-    return -1;
+    return i;
+}
+
+static int imgs__getImageIndex(IMGcontext* stash, const char* name) {
+    return stash->table[imgs__findSlot(stash, name, imgs__hashstr(name))];
+}
+
+static int imgs__resizeTable(IMGcontext* stash, int ctable) {
+    int i, j, mask = ctable - 1;
+    int* table = (int*)malloc(sizeof(int) * ctable);
+    if (table == NULL) {
+        if (stash->handleError)
+            stash->handleError(stash->errorUptr, IMGS_SCRATCH_FULL, 0);
+        return 0;
+    }
+    memset(table, -1, sizeof(int) * ctable);
+    for (i = 0; i < stash->nimages; i++) {
+        if (stash->images[i].name == NULL) continue;
+        j = (int)(stash->images[i].hash & (unsigned int)mask);
+        while (table[j] != -1)
+            j = (j + 1) & mask;
+        table[j] = i;
+    }
+    free(stash->table);
+    stash->table = table;
+    stash->ctable = ctable;
+    return 1;
+}
+
+static void imgs__tableRemove(IMGcontext* stash, int idx) {
+    int mask = stash->ctable - 1;
+    int i = imgs__findSlot(stash, stash->images[idx].name, stash->images[idx].hash), j = i, k;
+
+    // Move later entries of the probe sequence back into the hole
+    stash->table[i] = -1;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (stash->table[j] == -1)
+            break;
+        k = (int)(stash->images[stash->table[j]].hash & (unsigned int)mask);
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+            stash->table[i] = stash->table[j];
+            stash->table[j] = -1;
+            i = j;
+        }
+    }
+}
+
+static int imgs__handle(IMGcontext* stash, int idx) {
+    return (stash->images[idx].generation << IMGS_HANDLE_BITS) | (idx + 1);
+}
+
+// Returns the slot of a handle, -1 if it is not valid (anymore)
+static int imgs__handleIndex(IMGcontext* stash, int image) {
+    int idx = (image & ((1 << IMGS_HANDLE_BITS) - 1)) - 1;
+    if (image <= 0 || idx < 0 || idx >= stash->nimages || stash->images[idx].name == NULL ||
+        stash->images[idx].generation != image >> IMGS_HANDLE_BITS)
+        return -1;
+    return idx;
 }
 
 static int imgs__allocImage(IMGcontext* stash) {
+    int idx;
+    if (stash->freeImage != -1) {
+        idx = stash->freeImage;
+        stash->freeImage = stash->images[idx].nextFree;
+        return idx;
+    }
+    if (stash->nimages >= (1 << IMGS_HANDLE_BITS) - 1) {
+        if (stash->handleError)
+            stash->handleError(stash->errorUptr, IMGS_SCRATCH_FULL, 0);
+        return -1;
+    }
     if (stash->nimages + 1 > stash->cimages) {
-        stash->cimages = stash->cimages ? stash->cimages * 2 : 8;
-        stash->images = (struct IMGSimageImpl*)realloc(stash->images, sizeof(struct IMGSimageImpl) * stash->cimages);
-        if (stash->images == NULL) {
+        int cimages = stash->cimages ? stash->cimages * 2 : 8;
+        struct IMGSimageImpl* images = (struct IMGSimageImpl*)realloc(stash->images, sizeof(struct IMGSimageImpl) * cimages);
+        if (images == NULL) {
             if (stash->handleError)
                 stash->handleError(stash->errorUptr, IMGS_SCRATCH_FULL, 0);
             return -1;
         }
+        stash->images = images;
+        stash->cimages = cimages;
     }
+    stash->images[stash->nimages].generation = 0;
     return stash->nimages++;
 }
 
-static int imgs__addImage(IMGcontext* stash, const char* name, int width, int height, unsigned char* data, int freeData) {
-    int idx = imgs__allocImage(stash);
-    if (idx == -1) {
-        if (freeData) free(data);
-        return 0;
-    }
+static void imgs__deleteMipmaps(struct IMGSmipmaps* mips) {
+    int i;
+    if (mips == NULL) return;
+    for (i = 0; i < mips->nlevels; i++)
+        free(mips->levels[i].pixels);
+    free(mips);
+}
 
+static void imgs__freeImage(IMGcontext* stash, int idx) {
     struct IMGSimageImpl* img = &stash->images[idx];
-    strncpy(img->name, name, IMGS_MAX_NAME_LEN);
-    img->name[IMGS_MAX_NAME_LEN - 1] = '\0';
-    img->width = (short)width;
-    img->height = (short)height;
-    img->next = -1;
+    free(img->name);
+    img->name = NULL;
+    imgs__deleteMipmaps(img->mips);
+    img->mips = NULL;
+    img->generation = (img->generation + 1) & ((1 << (31 - IMGS_HANDLE_BITS)) - 1);
+    img->nextFree = stash->freeImage;
+    stash->freeImage = idx;
+}
 
-    // Insert to hash
-    unsigned int hash = imgs__hashstr(name) % IMGS_HASH_LUT_SIZE;
-    img->next = stash->lut[hash];
-    stash->lut[hash] = idx;
+// Mipmaps
 
-    // Find space in atlas
-    int gw = width + 2 * IMGS_PAD;
-    int gh = height + 2 * IMGS_PAD;
-    int gx = 0, gy = 0;
-    while (imgs__atlasAddRect(stash->atlas, gw, gh, &gx, &gy) == 0) {
-        // Expand atlas
+static void imgs__evictLevel(IMGcontext* stash, struct IMGSmipLevel* level) {
+    imgs__atlasRemoveRect(stash->atlas, level->x, level->y, level->width + 2 * IMGS_PAD, level->height + 2 * IMGS_PAD);
+    level->x = level->y = -1;
+    stash->nresident--;
+}
+
+// Takes the mip levels not drawn for 'frames' frames out of the atlas. Returns the number.
+static int imgs__evictLevels(IMGcontext* stash, unsigned int frames) {
+    struct IMGSmipmaps* mips;
+    int i, j, n = 0;
+    for (i = 0; i < stash->nimages && stash->nresident > 0; i++) {
+        if (stash->images[i].name == NULL || (mips = stash->images[i].mips) == NULL) continue;
+        for (j = 0; j < mips->nlevels; j++) {
+            if (mips->levels[j].x < 0 || stash->frame - mips->levels[j].used < frames) continue;
+            if (n++ == 0) imgs__flush(stash);
+            imgs__evictLevel(stash, &mips->levels[j]);
+        }
+    }
+    return n;
+}
+
+// Atlas space for a w x h rect, padding included. Mip levels not drawn in this frame make room
+// before the atlas grows, up to 4096x4096. Returns 0 if it does not fit.
+static int imgs__placeRect(IMGcontext* stash, int w, int h, int* x, int* y) {
+    while (imgs__atlasAddRect(stash->atlas, w, h, x, y) == 0) {
         int nw = stash->params.width * 2;
         int nh = stash->params.height * 2;
+        if (imgs__evictLevels(stash, 1) > 0) continue;
         if (nw > 4096) nw = 4096;  // Cap
         if (nh > 4096) nh = 4096;
-        if (nw == stash->params.width && nh == stash->params.height) {
-            if (freeData) free(data);
-            if (stash->handleError)
-                stash->handleError(stash->errorUptr, IMGS_ATLAS_FULL, 0);
-            return 0;
-        }
-        if (!imgsExpandAtlas(stash, nw, nh)) {
-            if (freeData) free(data);
+        if ((nw == stash->params.width && nh == stash->params.height) || !imgsExpandAtlas(stash, nw, nh)) {
             if (stash->handleError)
                 stash->handleError(stash->errorUptr, IMGS_ATLAS_FULL, 0);
             return 0;
         }
     }
-    img->x = (short)gx;
-    img->y = (short)gy;
+    return 1;
+}
 
-    // Copy to atlas with clamp borders
-    unsigned char* dst = stash->texData + (gy + IMGS_PAD) * stash->params.width * 4 + (gx + IMGS_PAD) * 4;
-    unsigned char* src = data;
+// Copies pixels into the atlas rect at gx, gy, with borders repeating the edge pixels
+static void imgs__blitImage(IMGcontext* stash, int gx, int gy, const unsigned char* data, int width, int height) {
+    int gw = width + 2 * IMGS_PAD;
+    int gh = height + 2 * IMGS_PAD;
+    int stride = stash->params.width * 4;
+    unsigned char* dst = stash->texData + (gy + IMGS_PAD) * stride + (gx + IMGS_PAD) * 4;
+    const unsigned char* src = data;
     int x, y;
 
     // Inner pixels
     for (y = 0; y < height; ++y) {
         memcpy(dst, src, width * 4);
-        dst += stash->params.width * 4;
+        dst += stride;
         src += width * 4;
     }
 
     // Horizontal borders
-    dst = stash->texData + gy * stash->params.width * 4 + gx * 4;
+    dst = stash->texData + gy * stride + gx * 4;
     for (x = 0; x < gw; ++x) {
-        memcpy(dst + x * 4, data, 4);  // Top border: first row
-        memcpy(dst + (gh - 1) * stash->params.width * 4 + x * 4, data + (height - 1) * width * 4, 4);  // Bottom
+        memcpy(dst + x * 4, data + imgs__mini(imgs__maxi(x - IMGS_PAD, 0), width - 1) * 4, 4);  // Top border: first row
+        memcpy(dst + (gh - 1) * stride + x * 4, data + ((height - 1) * width + imgs__mini(imgs__maxi(x - IMGS_PAD, 0), width - 1)) * 4, 4);  // Bottom
     }
 
     // Vertical borders
     for (y = 0; y < gh; ++y) {
-        memcpy(dst + y * stash->params.width * 4, dst + y * stash->params.width * 4 + IMGS_PAD * 4, 4);  // Left
-        memcpy(dst + y * stash->params.width * 4 + (gw - 1) * 4, dst + y * stash->params.width * 4 + (IMGS_PAD + width - 1) * 4, 4);  // Right
+        memcpy(dst + y * stride, dst + y * stride + IMGS_PAD * 4, 4);  // Left
+        memcpy(dst + y * stride + (gw - 1) * 4, dst + y * stride + (IMGS_PAD + width - 1) * 4, 4);  // Right
     }
 
     // Update texture if renderUpdate is available
@@ -430,56 +940,466 @@ static int imgs__addImage(IMGcontext* stash, const char* name, int width, int he
     stash->dirtyRect[1] = (int)fminf(stash->dirtyRect[1], (float)gy);
     stash->dirtyRect[2] = (int)fmaxf(stash->dirtyRect[2], (float)gx + gw);
     stash->dirtyRect[3] = (int)fmaxf(stash->dirtyRect[3], (float)gy + gh);
+}
+
+// Takes over or copies the pixels as level 0 and sizes the levels down to 1x1
+static struct IMGSmipmaps* imgs__allocMipmaps(unsigned char* data, int width, int height, int freeData) {
+    struct IMGSmipmaps* mips = (struct IMGSmipmaps*)calloc(1, sizeof(struct IMGSmipmaps));
+    struct IMGSmipLevel* level;
+    int i;
+    if (mips == NULL) return NULL;
+    if (freeData) {
+        mips->levels[0].pixels = data;
+    } else {
+        mips->levels[0].pixels = (unsigned char*)malloc((size_t)width * height * 4);
+        if (mips->levels[0].pixels == NULL) {
+            free(mips);
+            return NULL;
+        }
+        memcpy(mips->levels[0].pixels, data, (size_t)width * height * 4);
+    }
+    for (i = 0; i < IMGS_MAX_LEVELS; i++) {
+        level = &mips->levels[i];
+        level->x = level->y = -1;
+        level->width = (short)imgs__maxi(width >> i, 1);
+        level->height = (short)imgs__maxi(height >> i, 1);
+        mips->nlevels = i + 1;
+        if (level->width == 1 && level->height == 1) break;
+    }
+    return mips;
+}
 
-    if (freeData) free(data);
+// Puts a mip level in the atlas, resized from the image when first needed. Returns 0 if it
+// does not fit.
+static int imgs__placeLevel(IMGcontext* stash, struct IMGSmipmaps* mips, int i) {
+    struct IMGSmipLevel* level = &mips->levels[i];
+    struct IMGSmipLevel* image = &mips->levels[0];
+    int gx, gy;
+
+    if (level->x >= 0) return 1;
+    if (level->pixels == NULL) {
+        level->pixels = (unsigned char*)malloc((size_t)level->width * level->height * 4);
+        if (level->pixels == NULL ||
+            !stbir_resize_uint8_linear(image->pixels, image->width, image->height, 0,
+                                       level->pixels, level->width, level->height, 0, STBIR_RGBA)) {
+            free(level->pixels);
+            level->pixels = NULL;
+            if (stash->handleError)
+                stash->handleError(stash->errorUptr, IMGS_SCRATCH_FULL, 0);
+            return 0;
+        }
+    }
+    if (!imgs__placeRect(stash, level->width + 2 * IMGS_PAD, level->height + 2 * IMGS_PAD, &gx, &gy))
+        return 0;
+    imgs__blitImage(stash, gx, gy, level->pixels, level->width, level->height);
+    level->x = (short)gx;
+    level->y = (short)gy;
+    level->used = stash->frame;
+    stash->nresident++;
     return 1;
 }
 
-int imgsAddFile(IMGcontext* s, const char* name, const char* path, int maxWidth, int maxHeight) {
-    int w, h, n;
-    unsigned char* data = stbi_load(path, &w, &h, &n, 4);  // Force RGBA
-    if (!data) {
-        if (s->handleError)
-            s->handleError(s->errorUptr, IMGS_SCRATCH_FULL, 0);
+void imgsSetMipmaps(IMGcontext* s, int mipmaps) {
+    if (s == NULL) return;
+    s->mipmaps = mipmaps != 0;
+}
+
+void imgsEndFrame(IMGcontext* s) {
+    if (s == NULL) return;
+    imgs__flush(s);
+    imgs__evictLevels(s, IMGS_MIP_FRAMES);
+    s->frame++;
+}
+
+int imgsRemoveImage(IMGcontext* s, int image) {
+    int idx = s != NULL ? imgs__handleIndex(s, image) : -1;
+    struct IMGSimageImpl* img;
+    int i;
+    if (idx == -1) return 0;
+
+    img = &s->images[idx];
+    imgs__flush(s);
+    if (img->mips != NULL) {
+        for (i = 0; i < img->mips->nlevels; i++)
+            if (img->mips->levels[i].x >= 0)
+                imgs__evictLevel(s, &img->mips->levels[i]);
+    } else {
+        imgs__atlasRemoveRect(s->atlas, img->x, img->y, img->width + 2 * IMGS_PAD, img->height + 2 * IMGS_PAD);
+    }
+    imgs__tableRemove(s, idx);
+    imgs__freeImage(s, idx);
+    s->nlive--;
+    return 1;
+}
+
+int imgsFindImage(IMGcontext* s, const char* name) {
+    int idx = imgs__getImageIndex(s, name);
+    return idx != -1 ? imgs__handle(s, idx) : 0;
+}
+
+static int imgs__addImage(IMGcontext* stash, const char* name, int width, int height, unsigned char* data, int freeData,
+                          uint64_t source, int mipmaps) {
+    struct IMGSimageImpl* img;
+    struct IMGSmipmaps* mips = NULL;
+    unsigned int hash = imgs__hashstr(name);
+    int idx = imgs__getImageIndex(stash, name);
+    int slot;
+    char* copy;
+
+    // Replace an image of the same name
+    if (idx != -1)
+        imgsRemoveImage(stash, imgs__handle(stash, idx));
+
+    // Find space in atlas, mip levels get it when drawn
+    int gw = width + 2 * IMGS_PAD;
+    int gh = height + 2 * IMGS_PAD;
+    int gx = -1, gy = -1;
+    if (mipmaps) {
+        mips = imgs__allocMipmaps(data, width, height, freeData);
+        if (mips == NULL) {
+            if (freeData) free(data);
+            if (stash->handleError)
+                stash->handleError(stash->errorUptr, IMGS_SCRATCH_FULL, 0);
+            return 0;
+        }
+    } else if (!imgs__placeRect(stash, gw, gh, &gx, &gy)) {
+        if (freeData) free(data);
         return 0;
     }
-    int bytes_per_pixel = 4; // RGBA
+
+    copy = (char*)malloc(strlen(name) + 1);
+    if (copy == NULL || ((stash->nlive + 1) * 4 > stash->ctable * 3 && !imgs__resizeTable(stash, stash->ctable * 2)) ||
+        (idx = imgs__allocImage(stash)) == -1) {
+        if (copy == NULL && stash->handleError)
+            stash->handleError(stash->errorUptr, IMGS_SCRATCH_FULL, 0);
+        free(copy);
+        if (mips != NULL) {
+            imgs__deleteMipmaps(mips);
+            return 0;
+        }
+        imgs__atlasRemoveRect(stash->atlas, gx, gy, gw, gh);
+        if (freeData) free(data);
+        return 0;
+    }
+    strcpy(copy, name);
+    img = &stash->images[idx];
+    img->name = copy;
+    img->hash = hash;
+    img->width = (short)width;
+    img->height = (short)height;
+    img->x = (short)gx;
+    img->y = (short)gy;
+    img->source = source;
+    img->mips = mips;
+    slot = imgs__findSlot(stash, name, hash);
+    stash->table[slot] = idx;
+    stash->nlive++;
+
+    if (mips == NULL) {
+        imgs__blitImage(stash, gx, gy, data, width, height);
+        if (freeData) free(data);
+    }
+    return imgs__handle(stash, idx);
+}
+
+// Reads an image file, decodes it to RGBA and downsizes it to fit maxWidth x maxHeight. Sets
+// *source to the hash of the file, the limits and whether it gets mipmaps; if that is 'known'
+// (the image is in the atlas already) the file is not decoded. Returns NULL then or if loading
+// fails. Thread-safe.
+static unsigned char* imgs__loadFile(const char* path, int maxWidth, int maxHeight, int mipmaps, uint64_t known,
+                                     int* width, int* height, uint64_t* source) {
+    int w, h, n;
+    size_t size = 0;
+    unsigned char* data;
+    unsigned char* file = imgs__readFile(path, &size);
+    *source = 0;
+    if (!file) return NULL;
+
+    *source = imgs__hashData(file, size, (((uint64_t)(unsigned int)maxWidth << 32) | (unsigned int)maxHeight) ^
+                                         (mipmaps ? 0x9e3779b97f4a7c15ull : 0));
+    if (*source == 0) *source = 1;  // 0 marks images added as pixels
+    if (*source == known) {
+        free(file);
+        return NULL;
+    }
+
+    data = stbi_load_from_memory(file, (int)size, &w, &h, &n, 4);  // Force RGBA
+    free(file);
+    if (!data) return NULL;
 
     // Resize if needed
     if (w > maxWidth || h > maxHeight) {
         float scale = fminf((float)maxWidth / w, (float)maxHeight / h);
         int nw = (int)(w * scale);
         int nh = (int)(h * scale);
-        unsigned char* resized = (unsigned char*)malloc(nw * nh * 4);
-        if (!resized) {
-            stbi_image_free(data);
-            if (s->handleError)
-                s->handleError(s->errorUptr, IMGS_SCRATCH_FULL, 0);
-            return 0;
-        }
-        if (!stbir_resize_uint8_linear(data, w, h, 0, resized, nw, nh, 0, bytes_per_pixel)) {
+        unsigned char* resized;
+        if (nw < 1) nw = 1;
+        if (nh < 1) nh = 1;
+        resized = (unsigned char*)malloc(nw * nh * 4);
+        if (!resized || !stbir_resize_uint8_linear(data, w, h, 0, resized, nw, nh, 0, STBIR_RGBA)) {
             free(resized);
             stbi_image_free(data);
-            if (s->handleError)
-                s->handleError(s->errorUptr, IMGS_SCRATCH_FULL, 0);
-            return 0;
+            return NULL;
         }
         stbi_image_free(data);
         data = resized;
         w = nw;
         h = nh;
     }
-	printf("imgsAddFile: added %s\n", name);
+    *width = w;
+    *height = h;
+    return data;
+}
 
-    return imgs__addImage(s, name, w, h, data, 1);
+int imgsAddFile(IMGcontext* s, const char* name, const char* path, int maxWidth, int maxHeight) {
+    int w, h, idx = imgs__getImageIndex(s, name);
+    uint64_t known = idx != -1 ? s->images[idx].source : 0, source;
+    unsigned char* data = imgs__loadFile(path, maxWidth, maxHeight, s->mipmaps, known, &w, &h, &source);
+    if (!data) {
+        // Already in the atlas, loaded from the same file with the same limits
+        if (source != 0 && source == known)
+            return imgs__handle(s, idx);
+        if (s->handleError)
+            s->handleError(s->errorUptr, IMGS_SCRATCH_FULL, 0);
+        return 0;
+    }
+    return imgs__addImage(s, name, w, h, data, 1, source, s->mipmaps);
 }
 
 int imgsAddPixels(IMGcontext* s, const char* name, unsigned char* data, int width, int height, int freeData) {
-    return imgs__addImage(s, name, width, height, data, freeData);
+    return imgs__addImage(s, name, width, height, data, freeData, 0, s->mipmaps);
+}
+
+// Threads, for loading and filtering
+
+struct IMGSthreadStart {
+    void (*run)(void* arg);
+    void* arg;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI imgs__threadMain(LPVOID p) {
+    struct IMGSthreadStart start = *(struct IMGSthreadStart*)p;
+    free(p);
+    start.run(start.arg);
+    return 0;
+}
+#else
+static void* imgs__threadMain(void* p) {
+    struct IMGSthreadStart start = *(struct IMGSthreadStart*)p;
+    free(p);
+    start.run(start.arg);
+    return NULL;
+}
+#endif
+
+static int imgs__threadStart(imgs__thread* thread, void (*run)(void* arg), void* arg) {
+    struct IMGSthreadStart* start = (struct IMGSthreadStart*)malloc(sizeof(struct IMGSthreadStart));
+    if (start == NULL) return 0;
+    start->run = run;
+    start->arg = arg;
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, imgs__threadMain, start, 0, NULL);
+    if (*thread != NULL) return 1;
+#else
+    if (pthread_create(thread, NULL, imgs__threadMain, start) == 0) return 1;
+#endif
+    free(start);
+    return 0;
+}
+
+static void imgs__threadJoin(imgs__thread thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+// Load threads. Workers take jobs off the queue, load them and append them to the done list,
+// imgsCollect() adds the done ones to the atlas on the drawing thread.
+
+static void imgs__freeJob(struct IMGSjob* job) {
+    free(job->pixels);
+    free(job->name);  // and the path after it
+    free(job);
+}
+
+static void imgs__loadWorker(void* arg) {
+    struct IMGSloader* loader = (struct IMGSloader*)arg;
+    struct IMGSjob* job;
+    for (;;) {
+        imgs__mutexLock(&loader->mutex);
+        while (loader->queue == NULL && !loader->quit)
+            imgs__condWait(&loader->cond, &loader->mutex);
+        if (loader->quit) {
+            imgs__mutexUnlock(&loader->mutex);
+            return;
+        }
+        job = loader->queue;
+        loader->queue = job->next;
+        if (loader->queue == NULL)
+            loader->queueTail = NULL;
+        imgs__mutexUnlock(&loader->mutex);
+
+        job->pixels = imgs__loadFile(job->path, job->maxWidth, job->maxHeight, job->mipmaps, job->known,
+                                     &job->width, &job->height, &job->source);
+
+        imgs__mutexLock(&loader->mutex);
+        job->next = NULL;
+        if (loader->doneTail != NULL)
+            loader->doneTail->next = job;
+        else
+            loader->done = job;
+        loader->doneTail = job;
+        imgs__mutexUnlock(&loader->mutex);
+        if (loader->ready)
+            loader->ready(loader->readyUptr);
+    }
+}
+
+// Stops the load threads, images not loaded or not collected yet are dropped
+static void imgs__loadStop(IMGcontext* s) {
+    struct IMGSloader* loader = s->loader;
+    struct IMGSjob* job;
+    struct IMGSjob* next;
+    int i;
+
+    if (loader == NULL) return;
+    imgs__mutexLock(&loader->mutex);
+    loader->quit = 1;
+    imgs__condBroadcast(&loader->cond);
+    imgs__mutexUnlock(&loader->mutex);
+    for (i = 0; i < loader->nthreads; i++)
+        imgs__threadJoin(loader->threads[i]);
+
+    for (job = loader->queue; job != NULL; job = next) {
+        next = job->next;
+        imgs__freeJob(job);
+    }
+    for (job = loader->done; job != NULL; job = next) {
+        next = job->next;
+        imgs__freeJob(job);
+    }
+    imgs__condDestroy(&loader->cond);
+    imgs__mutexDestroy(&loader->mutex);
+    free(loader);
+    s->loader = NULL;
+}
+
+int imgsSetLoadThreads(IMGcontext* s, int threads, void (*ready)(void* uptr), void* uptr) {
+    struct IMGSloader* loader;
+    if (s == NULL) return 0;
+
+    imgs__loadStop(s);
+    if (threads > IMGS_MAX_LOAD_THREADS) threads = IMGS_MAX_LOAD_THREADS;
+    if (threads <= 0) return 0;
+
+    loader = (struct IMGSloader*)malloc(sizeof(struct IMGSloader));
+    if (loader == NULL) return 0;
+    memset(loader, 0, sizeof(struct IMGSloader));
+    imgs__mutexInit(&loader->mutex);
+    imgs__condInit(&loader->cond);
+    loader->ready = ready;
+    loader->readyUptr = uptr;
+    s->loader = loader;
+
+    while (loader->nthreads < threads && imgs__threadStart(&loader->threads[loader->nthreads], imgs__loadWorker, loader))
+        loader->nthreads++;
+    if (loader->nthreads == 0)
+        imgs__loadStop(s);
+    return s->loader != NULL ? loader->nthreads : 0;
+}
+
+int imgsAddFileAsync(IMGcontext* s, const char* name, const char* path, int maxWidth, int maxHeight) {
+    struct IMGSloader* loader = s->loader;
+    struct IMGSjob* job;
+    int idx;
+
+    if (loader == NULL)
+        return imgsAddFile(s, name, path, maxWidth, maxHeight);
+
+    job = (struct IMGSjob*)malloc(sizeof(struct IMGSjob));
+    if (job == NULL) return 0;
+    memset(job, 0, sizeof(struct IMGSjob));
+    job->name = (char*)malloc(strlen(name) + strlen(path) + 2);
+    if (job->name == NULL) {
+        free(job);
+        return 0;
+    }
+    strcpy(job->name, name);
+    job->path = job->name + strlen(name) + 1;
+    strcpy(job->path, path);
+    job->maxWidth = maxWidth;
+    job->maxHeight = maxHeight;
+    job->mipmaps = s->mipmaps;
+    idx = imgs__getImageIndex(s, name);
+    job->known = idx != -1 ? s->images[idx].source : 0;
+
+    imgs__mutexLock(&loader->mutex);
+    if (loader->queueTail != NULL)
+        loader->queueTail->next = job;
+    else
+        loader->queue = job;
+    loader->queueTail = job;
+    loader->pending++;
+    imgs__condBroadcast(&loader->cond);
+    imgs__mutexUnlock(&loader->mutex);
+    return 1;
+}
+
+int imgsCollect(IMGcontext* s, void (*added)(void* uptr, const char* name, int image), void* uptr) {
+    struct IMGSloader* loader = s->loader;
+    struct IMGSjob* job;
+    struct IMGSjob* next;
+    int n = 0, image, idx;
+
+    if (loader == NULL) return 0;
+    imgs__mutexLock(&loader->mutex);
+    job = loader->done;
+    loader->done = loader->doneTail = NULL;
+    imgs__mutexUnlock(&loader->mutex);
+
+    for (; job != NULL; job = next) {
+        next = job->next;
+        if (job->pixels != NULL) {
+            image = imgs__addImage(s, job->name, job->width, job->height, job->pixels, 1, job->source, job->mipmaps);
+            job->pixels = NULL;
+        } else {
+            // Unchanged, unless the image was replaced or removed in the meantime
+            idx = imgs__getImageIndex(s, job->name);
+            image = job->source != 0 && idx != -1 && s->images[idx].source == job->source ? imgs__handle(s, idx) : 0;
+            if (!image && s->handleError)
+                s->handleError(s->errorUptr, IMGS_SCRATCH_FULL, 0);
+        }
+        if (added)
+            added(uptr, job->name, image);
+        n += image != 0;
+        imgs__freeJob(job);
+
+        imgs__mutexLock(&loader->mutex);
+        loader->pending--;
+        imgs__mutexUnlock(&loader->mutex);
+    }
+    return n;
+}
+
+int imgsPendingImages(IMGcontext* s) {
+    int n;
+    if (s == NULL || s->loader == NULL) return 0;
+    imgs__mutexLock(&s->loader->mutex);
+    n = s->loader->pending;
+    imgs__mutexUnlock(&s->loader->mutex);
+    return n;
 }
 
 IMGimage* imgsGet(IMGcontext* s, const char* name) {
-    int idx = imgs__getImageIndex(s, name);
+    return imgsGetImage(s, imgsFindImage(s, name));
+}
+
+IMGimage* imgsGetImage(IMGcontext* s, int image) {
+    int idx = imgs__handleIndex(s, image);
     if (idx == -1) return NULL;
 
     struct IMGSimageImpl* impl = &s->images[idx];
@@ -499,6 +1419,21 @@ IMGimage* imgsGet(IMGcontext* s, const char* name) {
     img->ownedPixels = 0;
     img->dirty = 0;
 
+    // A mipmapped image is not in the atlas, copy its pixels
+    if (impl->mips != NULL) {
+        size_t size = (size_t)impl->width * impl->height * 4;
+        img->pixels = (unsigned char*)malloc(size);
+        if (!img->pixels) {
+            if (s->handleError)
+                s->handleError(s->errorUptr, IMGS_SCRATCH_FULL, 0);
+            free(img);
+            return NULL;
+        }
+        memcpy(img->pixels, impl->mips->levels[0].pixels, size);
+        img->ownedPixels = 1;
+        img->dirty = 1;
+    }
+
     return img;
 }
 
@@ -531,16 +1466,351 @@ static void imgs__ensurePixels(IMGimage* img) {
     img->dirty = 1;  // Mark dirty since we intend to modify
 }
 
+// Filters. Blurs are separable running sums, O(1) per pixel for any radius: each box pass runs
+// along the rows into the scratch buffer, then down the columns back into the image, a whole
+// row at a time. A sum is divided by multiplying with the reciprocal of the box width, made a
+// little larger so whole quotients come out exact; the SIMD and scalar code do the same float
+// operations and give the same results.
+
+struct IMGSfilterJob {
+    unsigned char* pixels;
+    unsigned char* temp;  // The rows pass, in the scratch buffer
+    int* sums;            // Running sum of each byte column, after it
+    int width, height;
+    int radius;
+    float scale;
+    int nthreads;
+};
+
+struct IMGSfilterPart {
+    struct IMGSfilterJob* job;
+    int index;
+};
+
+static int imgs__cpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+static int imgs__ensureScratch(IMGcontext* s, size_t size) {
+    unsigned char* scratch;
+    if (size <= s->nscratch) return 1;
+    scratch = (unsigned char*)malloc(size);
+    if (scratch == NULL) {
+        if (s->handleError)
+            s->handleError(s->errorUptr, IMGS_SCRATCH_FULL, 0);
+        return 0;
+    }
+    free(s->scratch);
+    s->scratch = scratch;
+    s->nscratch = size;
+    return 1;
+}
+
+#ifdef IMGS_USE_SSE2
+static __m128i imgs__loadPixel(const unsigned char* p) {
+    __m128i zero = _mm_setzero_si128();
+    int v;
+    memcpy(&v, p, 4);
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero);
+}
+#endif
+
+#ifdef IMGS_USE_NEON
+static uint32x4_t imgs__loadPixel(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(v)))));
+}
+#endif
+
+// Box sums along one row, edge pixels repeated. The four channels of a pixel are summed in
+// one vector; a row depends on its previous sum, so there is no wider parallelism here.
+static void imgs__boxRow(const unsigned char* src, unsigned char* dst, int w, int r, float scale) {
+    int x, i, last = w - 1;
+#if defined(IMGS_USE_SSE2)
+    __m128 vscale = _mm_set1_ps(scale);
+    __m128i sum = _mm_set1_epi32(r), q;  // Half the box width, to round
+    int v;
+    for (i = -r; i <= r; i++)
+        sum = _mm_add_epi32(sum, imgs__loadPixel(src + imgs__maxi(imgs__mini(i, last), 0) * 4));
+    for (x = 0; x < w; x++) {
+        q = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(sum), vscale));
+        q = _mm_packs_epi32(q, q);
+        v = _mm_cvtsi128_si32(_mm_packus_epi16(q, q));
+        memcpy(dst + x * 4, &v, 4);
+        sum = _mm_add_epi32(sum, imgs__loadPixel(src + imgs__mini(x + r + 1, last) * 4));
+        sum = _mm_sub_epi32(sum, imgs__loadPixel(src + imgs__maxi(x - r, 0) * 4));
+    }
+#elif defined(IMGS_USE_NEON)
+    float32x4_t vscale = vdupq_n_f32(scale);
+    uint32x4_t sum = vdupq_n_u32((uint32_t)r);
+    uint16x4_t q;
+    for (i = -r; i <= r; i++)
+        sum = vaddq_u32(sum, imgs__loadPixel(src + imgs__maxi(imgs__mini(i, last), 0) * 4));
+    for (x = 0; x < w; x++) {
+        q = vmovn_u32(vcvtq_u32_f32(vmulq_f32(vcvtq_f32_u32(sum), vscale)));
+        vst1_lane_u32((uint32_t*)(dst + x * 4), vreinterpret_u32_u8(vmovn_u16(vcombine_u16(q, q))), 0);
+        sum = vaddq_u32(sum, imgs__loadPixel(src + imgs__mini(x + r + 1, last) * 4));
+        sum = vsubq_u32(sum, imgs__loadPixel(src + imgs__maxi(x - r, 0) * 4));
+    }
+#else
+    int sum[4] = { r, r, r, r }, c;
+    const unsigned char *add, *sub;
+    for (i = -r; i <= r; i++)
+        for (c = 0; c < 4; c++)
+            sum[c] += src[imgs__maxi(imgs__mini(i, last), 0) * 4 + c];
+    for (x = 0; x < w; x++) {
+        add = src + imgs__mini(x + r + 1, last) * 4;
+        sub = src + imgs__maxi(x - r, 0) * 4;
+        for (c = 0; c < 4; c++) {
+            dst[x * 4 + c] = (unsigned char)(int)((float)sum[c] * scale);
+            sum[c] += add[c] - sub[c];
+        }
+    }
+#endif
+}
+
+// One output row of the columns pass over bytes [c0, c1): writes the sums divided, then moves
+// the box down a row.
+static void imgs__boxColumnStep(int* sums, const unsigned char* add, const unsigned char* sub,
+                                unsigned char* out, int c0, int c1, float scale) {
+    int c = c0, j;
+#if defined(IMGS_USE_AVX2)
+    __m256 vscale8 = _mm256_set1_ps(scale);
+    __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7), s8, q8[4];
+    for (; c + 32 <= c1; c += 32) {
+        for (j = 0; j < 4; j++) {
+            s8 = _mm256_loadu_si256((const __m256i*)(sums + c + j * 8));
+            q8[j] = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(s8), vscale8));
+            s8 = _mm256_add_epi32(s8, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(add + c + j * 8))));
+            s8 = _mm256_sub_epi32(s8, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(sub + c + j * 8))));
+            _mm256_storeu_si256((__m256i*)(sums + c + j * 8), s8);
+        }
+        // The packs work within 128-bit lanes, the permute puts the 4-byte groups in order
+        q8[0] = _mm256_packus_epi16(_mm256_packs_epi32(q8[0], q8[1]), _mm256_packs_epi32(q8[2], q8[3]));
+        _mm256_storeu_si256((__m256i*)(out + c), _mm256_permutevar8x32_epi32(q8[0], order));
+    }
+#endif
+#if defined(IMGS_USE_SSE2)
+    {
+        __m128 vscale = _mm_set1_ps(scale);
+        __m128i zero = _mm_setzero_si128(), a, b, s, q[4];
+        for (; c + 16 <= c1; c += 16) {
+            a = _mm_loadu_si128((const __m128i*)(add + c));
+            b = _mm_loadu_si128((const __m128i*)(sub + c));
+            for (j = 0; j < 4; j++) {
+                __m128i a16 = j < 2 ? _mm_unpacklo_epi8(a, zero) : _mm_unpackhi_epi8(a, zero);
+                __m128i b16 = j < 2 ? _mm_unpacklo_epi8(b, zero) : _mm_unpackhi_epi8(b, zero);
+                s = _mm_loadu_si128((const __m128i*)(sums + c + j * 4));
+                q[j] = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(s), vscale));
+                s = _mm_add_epi32(s, (j & 1) ? _mm_unpackhi_epi16(a16, zero) : _mm_unpacklo_epi16(a16, zero));
+                s = _mm_sub_epi32(s, (j & 1) ? _mm_unpackhi_epi16(b16, zero) : _mm_unpacklo_epi16(b16, zero));
+                _mm_storeu_si128((__m128i*)(sums + c + j * 4), s);
+            }
+            _mm_storeu_si128((__m128i*)(out + c), _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3])));
+        }
+    }
+#elif defined(IMGS_USE_NEON)
+    {
+        float32x4_t vscale = vdupq_n_f32(scale);
+        uint8x16_t a, b;
+        uint16x8_t a16, b16;
+        uint32x4_t s;
+        uint16x4_t q[4];
+        for (; c + 16 <= c1; c += 16) {
+            a = vld1q_u8(add + c);
+            b = vld1q_u8(sub + c);
+            for (j = 0; j < 4; j++) {
+                a16 = vmovl_u8(j < 2 ? vget_low_u8(a) : vget_high_u8(a));
+                b16 = vmovl_u8(j < 2 ? vget_low_u8(b) : vget_high_u8(b));
+                s = vld1q_u32((const uint32_t*)(sums + c + j * 4));
+                q[j] = vmovn_u32(vcvtq_u32_f32(vmulq_f32(vcvtq_f32_u32(s), vscale)));
+                s = vaddw_u16(s, (j & 1) ? vget_high_u16(a16) : vget_low_u16(a16));
+                s = vsubw_u16(s, (j & 1) ? vget_high_u16(b16) : vget_low_u16(b16));
+                vst1q_u32((uint32_t*)(sums + c + j * 4), s);
+            }
+            vst1q_u8(out + c, vcombine_u8(vmovn_u16(vcombine_u16(q[0], q[1])), vmovn_u16(vcombine_u16(q[2], q[3]))));
+        }
+    }
+#endif
+    IMGS_NOTUSED(j);
+    for (; c < c1; c++) {
+        out[c] = (unsigned char)(int)((float)sums[c] * scale);
+        sums[c] += add[c] - sub[c];
+    }
+}
+
+// Box sums down the byte columns [c0, c1), edge rows repeated
+static void imgs__boxColumns(const unsigned char* src, unsigned char* dst, int* sums, int stride, int h,
+                             int c0, int c1, int r, float scale) {
+    const unsigned char* row;
+    int y, i, c;
+    for (c = c0; c < c1; c++)
+        sums[c] = r;
+    for (i = -r; i <= r; i++) {
+        row = src + (size_t)imgs__maxi(imgs__mini(i, h - 1), 0) * stride;
+        for (c = c0; c < c1; c++)
+            sums[c] += row[c];
+    }
+    for (y = 0; y < h; y++)
+        imgs__boxColumnStep(sums, src + (size_t)imgs__mini(y + r + 1, h - 1) * stride,
+                            src + (size_t)imgs__maxi(y - r, 0) * stride, dst + (size_t)y * stride, c0, c1, scale);
+}
+
+// A part of a pass is a band of rows, or a strip of columns a multiple of 16 bytes wide
+static void imgs__boxRowsPart(void* arg) {
+    struct IMGSfilterPart* part = (struct IMGSfilterPart*)arg;
+    struct IMGSfilterJob* job = part->job;
+    size_t stride = (size_t)job->width * 4;
+    int y0 = (int)((long long)job->height * part->index / job->nthreads);
+    int y1 = (int)((long long)job->height * (part->index + 1) / job->nthreads), y;
+    for (y = y0; y < y1; y++)
+        imgs__boxRow(job->pixels + y * stride, job->temp + y * stride, job->width, job->radius, job->scale);
+}
+
+static void imgs__boxColumnsPart(void* arg) {
+    struct IMGSfilterPart* part = (struct IMGSfilterPart*)arg;
+    struct IMGSfilterJob* job = part->job;
+    int stride = job->width * 4, units = (stride + 15) / 16;
+    int c0 = units * part->index / job->nthreads * 16;
+    int c1 = imgs__mini(units * (part->index + 1) / job->nthreads * 16, stride);
+    imgs__boxColumns(job->temp, job->pixels, job->sums, stride, job->height, c0, c1, job->radius, job->scale);
+}
+
+// Runs the parts of a pass on the filter threads and the calling thread. A part whose thread
+// could not be started runs on the calling thread.
+static void imgs__filterRun(struct IMGSfilterJob* job, void (*run)(void* arg)) {
+    struct IMGSfilterPart parts[IMGS_MAX_FILTER_THREADS];
+    imgs__thread threads[IMGS_MAX_FILTER_THREADS];
+    int started[IMGS_MAX_FILTER_THREADS], i;
+    for (i = 0; i < job->nthreads; i++) {
+        parts[i].job = job;
+        parts[i].index = i;
+        started[i] = i > 0 && imgs__threadStart(&threads[i], run, &parts[i]);
+    }
+    for (i = 0; i < job->nthreads; i++)
+        if (!started[i]) run(&parts[i]);
+    for (i = 1; i < job->nthreads; i++)
+        if (started[i]) imgs__threadJoin(threads[i]);
+}
+
+// Applies box blurs of the given radii one after another
+static void imgs__filterBoxes(IMGimage* img, const int* radii, int npasses) {
+    IMGcontext* s = img->ctx;
+    struct IMGSfilterJob job;
+    size_t stride = (size_t)img->width * 4, tempSize = (stride * img->height + 15) & ~(size_t)15;
+    int i;
+
+    if (img->width <= 0 || img->height <= 0) return;
+    if (!imgs__ensureScratch(s, tempSize + stride * sizeof(int))) return;
+    job.pixels = img->pixels;
+    job.temp = s->scratch;
+    job.sums = (int*)(s->scratch + tempSize);
+    job.width = img->width;
+    job.height = img->height;
+    job.nthreads = s->filterThreads > 0 ? s->filterThreads : imgs__cpuCount();
+    if (job.nthreads > IMGS_MAX_FILTER_THREADS) job.nthreads = IMGS_MAX_FILTER_THREADS;
+    if ((long long)img->width * img->height < IMGS_FILTER_THREAD_PIXELS) job.nthreads = 1;
+
+    for (i = 0; i < npasses; i++) {
+        if (radii[i] <= 0) continue;
+        job.radius = imgs__mini(radii[i], IMGS_MAX_BLUR_RADIUS);
+        job.scale = (1.0f + 1.0f / (1 << 20)) / (float)(2 * job.radius + 1);
+        imgs__filterRun(&job, imgs__boxRowsPart);
+        imgs__filterRun(&job, imgs__boxColumnsPart);
+    }
+    img->dirty = 1;
+}
+
+void imgsSetFilterThreads(IMGcontext* s, int threads) {
+    if (s == NULL) return;
+    s->filterThreads = imgs__maxi(0, imgs__mini(threads, IMGS_MAX_FILTER_THREADS));
+}
+
+// Greyscale weights 0.3, 0.59 and 0.11 in 15-bit fixed point
+#define IMGS_GREY_R 9830
+#define IMGS_GREY_G 19333
+#define IMGS_GREY_B 3605
+
 void imgsFilterGreyscale(IMGimage* img) {
     if (!img) return;
     imgs__ensurePixels(img);
     if (!img->pixels) return;
 
     unsigned char* p = img->pixels;
-    for (int i = 0; i < img->width * img->height; ++i) {
-        unsigned char grey = (unsigned char)(0.3f * p[0] + 0.59f * p[1] + 0.11f * p[2]);
-        p[0] = p[1] = p[2] = grey;
-        p += 4;
+    int n = img->width * img->height, i = 0;
+#if defined(IMGS_USE_AVX2)
+    {
+        __m256i zero = _mm256_setzero_si256(), v, lo, hi, grey;
+        __m256i weights = _mm256_setr_epi16(IMGS_GREY_R, IMGS_GREY_G, IMGS_GREY_B, 0, IMGS_GREY_R, IMGS_GREY_G, IMGS_GREY_B, 0,
+                                            IMGS_GREY_R, IMGS_GREY_G, IMGS_GREY_B, 0, IMGS_GREY_R, IMGS_GREY_G, IMGS_GREY_B, 0);
+        __m256i half = _mm256_set1_epi32(1 << 14), alpha = _mm256_set1_epi32((int)0xff000000);
+        for (; i + 8 <= n; i += 8) {
+            v = _mm256_loadu_si256((const __m256i*)(p + i * 4));
+            lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(v, zero), weights);
+            hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(v, zero), weights);
+            lo = _mm256_shuffle_epi32(_mm256_add_epi32(lo, _mm256_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+            hi = _mm256_shuffle_epi32(_mm256_add_epi32(hi, _mm256_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+            grey = _mm256_srli_epi32(_mm256_add_epi32(_mm256_unpacklo_epi64(lo, hi), half), 15);
+            grey = _mm256_or_si256(grey, _mm256_or_si256(_mm256_slli_epi32(grey, 8), _mm256_slli_epi32(grey, 16)));
+            _mm256_storeu_si256((__m256i*)(p + i * 4), _mm256_or_si256(grey, _mm256_and_si256(v, alpha)));
+        }
+    }
+#endif
+#if defined(IMGS_USE_SSE2)
+    {
+        // Four pixels: the weighted r+g and b+0 of each pair of channels, added, then moved
+        // to one 32-bit lane per pixel
+        __m128i zero = _mm_setzero_si128(), v, lo, hi, grey;
+        __m128i weights = _mm_setr_epi16(IMGS_GREY_R, IMGS_GREY_G, IMGS_GREY_B, 0, IMGS_GREY_R, IMGS_GREY_G, IMGS_GREY_B, 0);
+        __m128i half = _mm_set1_epi32(1 << 14), alpha = _mm_set1_epi32((int)0xff000000);
+        for (; i + 4 <= n; i += 4) {
+            v = _mm_loadu_si128((const __m128i*)(p + i * 4));
+            lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weights);
+            hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weights);
+            lo = _mm_shuffle_epi32(_mm_add_epi32(lo, _mm_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+            hi = _mm_shuffle_epi32(_mm_add_epi32(hi, _mm_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+            grey = _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi64(lo, hi), half), 15);
+            grey = _mm_or_si128(grey, _mm_or_si128(_mm_slli_epi32(grey, 8), _mm_slli_epi32(grey, 16)));
+            _mm_storeu_si128((__m128i*)(p + i * 4), _mm_or_si128(grey, _mm_and_si128(v, alpha)));
+        }
+    }
+#elif defined(IMGS_USE_NEON)
+    {
+        uint8x16x4_t v;
+        uint16x8_t r, g, b;
+        uint32x4_t sum;
+        uint16x4_t grey[4];
+        int j, k;
+        for (; i + 16 <= n; i += 16) {
+            v = vld4q_u8(p + i * 4);
+            for (j = 0; j < 2; j++) {
+                r = vmovl_u8(j ? vget_high_u8(v.val[0]) : vget_low_u8(v.val[0]));
+                g = vmovl_u8(j ? vget_high_u8(v.val[1]) : vget_low_u8(v.val[1]));
+                b = vmovl_u8(j ? vget_high_u8(v.val[2]) : vget_low_u8(v.val[2]));
+                for (k = 0; k < 2; k++) {
+                    sum = vmull_n_u16(k ? vget_high_u16(r) : vget_low_u16(r), IMGS_GREY_R);
+                    sum = vmlal_n_u16(sum, k ? vget_high_u16(g) : vget_low_u16(g), IMGS_GREY_G);
+                    sum = vmlal_n_u16(sum, k ? vget_high_u16(b) : vget_low_u16(b), IMGS_GREY_B);
+                    grey[j * 2 + k] = vshrn_n_u32(vaddq_u32(sum, vdupq_n_u32(1 << 14)), 15);
+                }
+            }
+            v.val[0] = vcombine_u8(vmovn_u16(vcombine_u16(grey[0], grey[1])), vmovn_u16(vcombine_u16(grey[2], grey[3])));
+            v.val[1] = v.val[2] = v.val[0];
+            vst4q_u8(p + i * 4, v);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        unsigned char* q = p + i * 4;
+        q[0] = q[1] = q[2] = (unsigned char)((IMGS_GREY_R * q[0] + IMGS_GREY_G * q[1] + IMGS_GREY_B * q[2] + (1 << 14)) >> 15);
     }
     img->dirty = 1;
 }
@@ -552,58 +1822,24 @@ void imgsFilterBlur(IMGimage* img, float radius) {
 
     int kernelSize = (int)(2 * radius) + 1;
     if (kernelSize < 3) kernelSize = 3;  // Min box
+    int r = kernelSize / 2;
+    imgs__filterBoxes(img, &r, 1);
+}
 
-    unsigned char* temp = (unsigned char*)malloc(img->width * img->height * 4);
-    if (!temp) {
-        if (img->ctx->handleError)
-            img->ctx->handleError(img->ctx->errorUptr, IMGS_SCRATCH_FULL, 0);
-        return;
-    }
-
-    // Horizontal pass
-    for (int y = 0; y < img->height; ++y) {
-        for (int x = 0; x < img->width; ++x) {
-            int r = 0, g = 0, b = 0, a = 0;
-            int count = 0;
-            for (int k = -kernelSize / 2; k <= kernelSize / 2; ++k) {
-                int nx = x + k;
-                if (nx < 0) nx = 0;
-                if (nx >= img->width) nx = img->width - 1;
-                unsigned char* p = img->pixels + (y * img->width + nx) * 4;
-                r += p[0]; g += p[1]; b += p[2]; a += p[3];
-                ++count;
-            }
-            unsigned char* dst = temp + (y * img->width + x) * 4;
-            dst[0] = (unsigned char)(r / count);
-            dst[1] = (unsigned char)(g / count);
-            dst[2] = (unsigned char)(b / count);
-            dst[3] = (unsigned char)(a / count);
-        }
-    }
-
-    // Vertical pass
-    for (int x = 0; x < img->width; ++x) {
-        for (int y = 0; y < img->height; ++y) {
-            int r = 0, g = 0, b = 0, a = 0;
-            int count = 0;
-            for (int k = -kernelSize / 2; k <= kernelSize / 2; ++k) {
-                int ny = y + k;
-                if (ny < 0) ny = 0;
-                if (ny >= img->height) ny = img->height - 1;
-                unsigned char* p = temp + (ny * img->width + x) * 4;
-                r += p[0]; g += p[1]; b += p[2]; a += p[3];
-                ++count;
-            }
-            unsigned char* dst = img->pixels + (y * img->width + x) * 4;
-            dst[0] = (unsigned char)(r / count);
-            dst[1] = (unsigned char)(g / count);
-            dst[2] = (unsigned char)(b / count);
-            dst[3] = (unsigned char)(a / count);
-        }
-    }
+void imgsFilterGaussian(IMGimage* img, float sigma) {
+    if (!img || sigma <= 0) return;
+    imgs__ensurePixels(img);
+    if (!img->pixels) return;
 
-    free(temp);
-    img->dirty = 1;
+    // Widths of three boxes whose variances add up to sigma^2 (Kovesi, "Fast almost-Gaussian
+    // filtering"): the odd width below the ideal one for the first m, two more for the rest
+    float variance = 12.0f * sigma * sigma;
+    int lower = (int)sqrtf(variance / 3 + 1), m, i, radii[3];
+    if (lower % 2 == 0) lower--;
+    m = (int)floorf((variance - 3 * lower * lower - 12 * lower - 9) / (-4.0f * lower - 4) + 0.5f);
+    for (i = 0; i < 3; i++)
+        radii[i] = (i < m ? lower : lower + 2) / 2;
+    imgs__filterBoxes(img, radii, 3);
 }
 
 void imgsFilterResize(IMGimage* img, int newWidth, int newHeight) {
@@ -639,64 +1875,18 @@ static void imgs__uploadToAtlas(IMGimage* img) {
     if (!img->dirty || !img->pixels) return;
 
     int gx, gy;
-    int gw = img->width + 2 * IMGS_PAD;
-    int gh = img->height + 2 * IMGS_PAD;
     IMGcontext* s = img->ctx;
 
     if (img->atlasX < 0) {
         // Allocate new space
-        while (imgs__atlasAddRect(s->atlas, gw, gh, &gx, &gy) == 0) {
-            int nw = s->params.width * 2;
-            int nh = s->params.height * 2;
-            if (nw > 4096) nw = 4096;
-            if (nh > 4096) nh = 4096;
-            if (!imgsExpandAtlas(s, nw, nh)) {
-                if (s->handleError)
-                    s->handleError(s->errorUptr, IMGS_ATLAS_FULL, 0);
-                return;
-            }
-        }
+        if (!imgs__placeRect(s, img->width + 2 * IMGS_PAD, img->height + 2 * IMGS_PAD, &gx, &gy))
+            return;
         img->atlasX = gx;
         img->atlasY = gy;
-    } else {
-        // Update in place (assume size unchanged)
-        gx = img->atlasX;
-        gy = img->atlasY;
-    }
-
-    // Copy with borders (clamp)
-    unsigned char* dst = s->texData + (gy + IMGS_PAD) * s->params.width * 4 + (gx + IMGS_PAD) * 4;
-    unsigned char* src = img->pixels;
-    int x, y;
-
-    for (y = 0; y < img->height; ++y) {
-        memcpy(dst, src, img->width * 4);
-        dst += s->params.width * 4;
-        src += img->width * 4;
-    }
-
-    dst = s->texData + gy * s->params.width * 4 + gx * 4;
-    for (x = 0; x < gw; ++x) {
-        memcpy(dst + x * 4, img->pixels, 4);  // Top
-        memcpy(dst + (gh - 1) * s->params.width * 4 + x * 4, img->pixels + (img->height - 1) * img->width * 4, 4);  // Bottom
-    }
-
-    for (y = 0; y < gh; ++y) {
-        memcpy(dst + y * s->params.width * 4, dst + y * s->params.width * 4 + IMGS_PAD * 4, 4);  // Left
-        memcpy(dst + y * s->params.width * 4 + (gw - 1) * 4, dst + y * s->params.width * 4 + (IMGS_PAD + img->width - 1) * 4, 4);  // Right
-    }
-
-    s->dirtyRect[0] = (int)fminf(s->dirtyRect[0], (float)gx);
-    s->dirtyRect[1] = (int)fminf(s->dirtyRect[1], (float)gy);
-    s->dirtyRect[2] = (int)fmaxf(s->dirtyRect[2], (float)gx + gw);
-    s->dirtyRect[3] = (int)fmaxf(s->dirtyRect[3], (float)gy + gh);
-
-    // Update texture if renderUpdate is available
-    if (s->params.renderUpdate) {
-        int rect[4] = {gx, gy, gx + gw, gy + gh};
-        s->params.renderUpdate(s->params.userPtr, rect, s->texData);
     }
+    // else update in place (assume size unchanged)
 
+    imgs__blitImage(s, img->atlasX, img->atlasY, img->pixels, img->width, img->height);
     img->dirty = 0;
 }
 
@@ -715,10 +1905,48 @@ static void imgs__drawQuad(IMGcontext* s, float dx, float dy, float dw, float dh
 }
 
 void imgsDraw(IMGcontext* s, const char* name, float x, float y, float w, float h) {
-    int idx = imgs__getImageIndex(s, name);
+    imgsDrawImage(s, imgsFindImage(s, name), x, y, w, h);
+}
+
+// Draws the mip level closest to the size drawn, or if that does not fit in the atlas the
+// closest one in it
+static void imgs__drawMipmapped(IMGcontext* s, struct IMGSimageImpl* impl, float x, float y, float w, float h) {
+    struct IMGSmipmaps* mips = impl->mips;
+    struct IMGSmipLevel* level = NULL;
+    float area = fabsf(w * h);
+    int want = 0, d;
+
+    if (area > 0)
+        want = (int)floorf(0.5f * log2f((float)impl->width * impl->height / area) + 0.5f);
+    want = imgs__maxi(0, imgs__mini(want, mips->nlevels - 1));
+    if (imgs__placeLevel(s, mips, want))
+        level = &mips->levels[want];
+    for (d = 1; level == NULL && d < mips->nlevels; d++) {
+        if (want - d >= 0 && mips->levels[want - d].x >= 0)
+            level = &mips->levels[want - d];
+        else if (want + d < mips->nlevels && mips->levels[want + d].x >= 0)
+            level = &mips->levels[want + d];
+    }
+    if (level == NULL) return;
+    level->used = s->frame;
+
+    float u0 = (level->x + IMGS_PAD) * s->itw;
+    float v0 = (level->y + IMGS_PAD) * s->ith;
+    float u1 = (level->x + IMGS_PAD + level->width) * s->itw;
+    float v1 = (level->y + IMGS_PAD + level->height) * s->ith;
+
+    imgs__drawQuad(s, x, y, w, h, u0, v0, u1, v1);
+}
+
+void imgsDrawImage(IMGcontext* s, int image, float x, float y, float w, float h) {
+    int idx = imgs__handleIndex(s, image);
     if (idx == -1) return;
 
     struct IMGSimageImpl* impl = &s->images[idx];
+    if (impl->mips != NULL) {
+        imgs__drawMipmapped(s, impl, x, y, w, h);
+        return;
+    }
     float u0 = (impl->x + IMGS_PAD) * s->itw;
     float v0 = (impl->y + IMGS_PAD) * s->ith;
     float u1 = (impl->x + IMGS_PAD + impl->width) * s->itw;
@@ -774,7 +2002,9 @@ IMGcontext* imgsCreateInternal(IMGSparams* params) {
     stash->images = NULL;
     stash->nimages = 0;
     stash->cimages = 0;
-    memset(stash->lut, -1, sizeof(stash->lut));
+    stash->freeImage = -1;
+    if (!imgs__resizeTable(stash, IMGS_INITIAL_TABLE))
+        goto error;
 
     stash->verts = (float*)malloc(sizeof(float) * IMGS_VERTEX_COUNT * 2);
     stash->tcoords = (float*)malloc(sizeof(float) * IMGS_VERTEX_COUNT * 2);
@@ -792,6 +2022,7 @@ IMGcontext* imgsCreateInternal(IMGSparams* params) {
             stash->handleError(stash->errorUptr, IMGS_SCRATCH_FULL, 0);
         goto error;
     }
+    stash->nscratch = IMGS_SCRATCH_BUF_SIZE;
 
     // Only call renderCreate if provided
     if (stash->params.renderCreate) {
@@ -815,11 +2046,21 @@ error:
 void imgsDeleteInternal(IMGcontext* stash) {
     if (stash == NULL) return;
 
+    imgs__loadStop(stash);
+
     if (stash->params.renderDelete)
         stash->params.renderDelete(stash->params.userPtr);
 
     if (stash->atlas) imgs__deleteAtlas(stash->atlas);
-    if (stash->images) free(stash->images);
+    if (stash->images) {
+        int i;
+        for (i = 0; i < stash->nimages; i++) {
+            if (stash->images[i].name != NULL) imgs__deleteMipmaps(stash->images[i].mips);
+            free(stash->images[i].name);
+        }
+        free(stash->images);
+    }
+    if (stash->table) free(stash->table);
     if (stash->texData) free(stash->texData);
     if (stash->verts) free(stash->verts);
     if (stash->tcoords) free(stash->tcoords);
@@ -924,6 +2165,7 @@ int imgsExpandAtlas(IMGcontext* stash, int width, int height) {
 }
 
 int imgsResetAtlas(IMGcontext* stash, int width, int height) {
+    int i;
     if (stash == NULL) return 0;
 
     imgs__flush(stash);
@@ -951,8 +2193,13 @@ int imgsResetAtlas(IMGcontext* stash, int width, int height) {
     stash->dirtyRect[2] = 0;
     stash->dirtyRect[3] = 0;
 
-    stash->nimages = 0;
-    memset(stash->lut, -1, sizeof(stash->lut));
+    // Free all slots, so handles from before do not match
+    for (i = stash->nimages - 1; i >= 0; i--)
+        if (stash->images[i].name != NULL)
+            imgs__freeImage(stash, i);
+    stash->nlive = 0;
+    stash->nresident = 0;
+    memset(stash->table, -1, sizeof(int) * stash->ctable);
 
     stash->params.width = width;
     stash->params.height = height;
@@ -1033,4 +2280,293 @@ void imgsDrawDebug(IMGcontext* s, float x, float y) {
 
     imgs__flush(s);
 }
+
+// Atlas cache file: a header, the images, the skyline, the free rects, the image names and the
+// pixels, in native byte order
+
+#define IMGS_CACHE_MAGIC 0x43534d49u  // "IMSC"
+#define IMGS_CACHE_VERSION 2
+
+struct IMGScacheHeader {
+    unsigned int magic, version;
+    int imageSize;  // sizeof(struct IMGScacheImage)
+    int width, height;
+    int nimages, nnodes, nfree;
+    int namesSize;
+};
+
+struct IMGScacheImage {
+    short x, y;
+    short width, height;
+    int nameLength;  // Without the terminating zero
+    uint64_t source;
+};
+
+#ifdef _WIN32
+static const unsigned char* imgs__mapFile(const char* path, size_t* size) {
+    const unsigned char* data = NULL;
+    LARGE_INTEGER n;
+    HANDLE file, mapping;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    if (GetFileSizeEx(file, &n) && n.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL) {
+            data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        *size = (size_t)n.QuadPart;
+    }
+    CloseHandle(file);
+    return data;
+}
+
+static void imgs__unmapFile(const unsigned char* data, size_t size) {
+    IMGS_NOTUSED(size);
+    UnmapViewOfFile(data);
+}
+#else
+static const unsigned char* imgs__mapFile(const char* path, size_t* size) {
+    void* data = NULL;
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if (fd == -1) return NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) data = NULL;
+        *size = (size_t)st.st_size;
+    }
+    close(fd);
+    return (const unsigned char*)data;
+}
+
+static void imgs__unmapFile(const unsigned char* data, size_t size) {
+    munmap((void*)data, size);
+}
+#endif
+
+int imgsSaveCache(IMGcontext* s, const char* path) {
+    struct IMGScacheHeader header;
+    struct IMGScacheImage image;
+    FILE* fp;
+    char* tmp;
+    int i, ok;
+
+    if (s == NULL) return 0;
+    tmp = (char*)malloc(strlen(path) + 5);
+    if (tmp == NULL) return 0;
+    strcpy(tmp, path);
+    strcat(tmp, ".tmp");
+    fp = fopen(tmp, "wb");
+    if (fp == NULL) {
+        free(tmp);
+        return 0;
+    }
+
+    // Mipmapped images are not saved, their levels leave the atlas (they come back when drawn)
+    imgs__evictLevels(s, 0);
+
+    memset(&header, 0, sizeof(header));
+    header.magic = IMGS_CACHE_MAGIC;
+    header.version = IMGS_CACHE_VERSION;
+    header.imageSize = (int)sizeof(struct IMGScacheImage);
+    header.width = s->params.width;
+    header.height = s->params.height;
+    header.nnodes = s->atlas->nnodes;
+    header.nfree = s->atlas->nfree;
+    for (i = 0; i < s->nimages; i++) {
+        if (s->images[i].name != NULL && s->images[i].mips == NULL) {
+            header.nimages++;
+            header.namesSize += (int)strlen(s->images[i].name) + 1;
+        }
+    }
+    fwrite(&header, sizeof(header), 1, fp);
+    for (i = 0; i < s->nimages; i++) {
+        struct IMGSimageImpl* img = &s->images[i];
+        if (img->name == NULL || img->mips != NULL) continue;
+        memset(&image, 0, sizeof(image));
+        image.x = img->x;
+        image.y = img->y;
+        image.width = img->width;
+        image.height = img->height;
+        image.nameLength = (int)strlen(img->name);
+        image.source = img->source;
+        fwrite(&image, sizeof(image), 1, fp);
+    }
+    fwrite(s->atlas->nodes, sizeof(struct IMGSatlasNode), s->atlas->nnodes, fp);
+    fwrite(s->atlas->free, sizeof(struct IMGSatlasRect), s->atlas->nfree, fp);
+    for (i = 0; i < s->nimages; i++)
+        if (s->images[i].name != NULL && s->images[i].mips == NULL)
+            fwrite(s->images[i].name, strlen(s->images[i].name) + 1, 1, fp);
+    fwrite(s->texData, (size_t)s->params.width * 4, s->params.height, fp);
+
+    ok = !ferror(fp);
+    ok = fclose(fp) == 0 && ok;
+#ifdef _WIN32
+    if (ok) remove(path);
+#endif
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok) remove(tmp);
+    free(tmp);
+    return ok;
+}
+
+int imgsLoadCache(IMGcontext* s, const char* path) {
+    struct IMGScacheHeader header;
+    struct IMGScacheImage image;
+    struct IMGSimageImpl* images = NULL;
+    struct IMGSatlasNode* nodes = NULL;
+    struct IMGSatlasRect* rects = NULL;
+    unsigned char* texData = NULL;
+    int* table = NULL;
+    const unsigned char* data;
+    const unsigned char* p;
+    const char* names;
+    size_t size = 0, imagesSize, nodesSize, freeSize, texSize;
+    int i, j, cnodes, ctable, nameOffset, x, ok = 0;
+
+    if (s == NULL) return 0;
+    data = imgs__mapFile(path, &size);
+    if (data == NULL) return 0;
+
+    if (size < sizeof(header)) goto done;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != IMGS_CACHE_MAGIC || header.version != IMGS_CACHE_VERSION ||
+        header.imageSize != (int)sizeof(struct IMGScacheImage) ||
+        header.width <= 0 || header.width > 4096 || header.height <= 0 || header.height > 4096 ||
+        header.nimages < 0 || header.nimages >= (1 << IMGS_HANDLE_BITS) - 1 ||
+        header.nnodes < 1 || header.nnodes > header.width || header.nfree < 0 || header.namesSize < 0)
+        goto done;
+    imagesSize = sizeof(struct IMGScacheImage) * (size_t)header.nimages;
+    nodesSize = sizeof(struct IMGSatlasNode) * (size_t)header.nnodes;
+    freeSize = sizeof(struct IMGSatlasRect) * (size_t)header.nfree;
+    texSize = (size_t)header.width * header.height * 4;
+    if (header.nfree > (int)(size / sizeof(struct IMGSatlasRect)) ||
+        size != sizeof(header) + imagesSize + nodesSize + freeSize + (size_t)header.namesSize + texSize)
+        goto done;
+
+    // Copy everything out of the file before the stash is changed
+    for (ctable = IMGS_INITIAL_TABLE; ctable * 3 < header.nimages * 4; ctable *= 2)
+        ;
+    cnodes = header.nnodes > IMGS_INITIAL_NODES ? header.nnodes : IMGS_INITIAL_NODES;
+    images = (struct IMGSimageImpl*)calloc((size_t)header.nimages + 1, sizeof(struct IMGSimageImpl));
+    nodes = (struct IMGSatlasNode*)malloc(sizeof(struct IMGSatlasNode) * cnodes);
+    rects = (struct IMGSatlasRect*)malloc(freeSize + sizeof(struct IMGSatlasRect));
+    table = (int*)malloc(sizeof(int) * ctable);
+    texData = (unsigned char*)malloc(texSize);
+    if (images == NULL || nodes == NULL || rects == NULL || table == NULL || texData == NULL) goto done;
+    p = data + sizeof(header);
+    names = (const char*)(p + imagesSize + nodesSize + freeSize);
+    memcpy(nodes, p + imagesSize, nodesSize);
+    memcpy(rects, p + imagesSize + nodesSize, freeSize);
+    memcpy(texData, p + imagesSize + nodesSize + freeSize + header.namesSize, texSize);
+    memset(table, -1, sizeof(int) * ctable);
+    for (i = 0, nameOffset = 0; i < header.nimages; i++) {
+        struct IMGSimageImpl* img = &images[i];
+        memcpy(&image, p + sizeof(struct IMGScacheImage) * i, sizeof(image));
+        if (image.x < 0 || image.y < 0 || image.width <= 0 || image.height <= 0 ||
+            image.x + image.width + 2 * IMGS_PAD > header.width || image.y + image.height + 2 * IMGS_PAD > header.height ||
+            image.nameLength < 0 || image.nameLength >= header.namesSize - nameOffset ||
+            names[nameOffset + image.nameLength] != '\0')
+            goto done;
+        img->name = (char*)malloc((size_t)image.nameLength + 1);
+        if (img->name == NULL) goto done;
+        memcpy(img->name, names + nameOffset, (size_t)image.nameLength + 1);
+        nameOffset += image.nameLength + 1;
+        img->hash = imgs__hashstr(img->name);
+        img->x = image.x;
+        img->y = image.y;
+        img->width = image.width;
+        img->height = image.height;
+        img->source = image.source;
+        for (j = (int)(img->hash & (unsigned int)(ctable - 1)); table[j] != -1; j = (j + 1) & (ctable - 1))
+            if (strcmp(images[table[j]].name, img->name) == 0)
+                goto done;  // Duplicate name
+        table[j] = i;
+    }
+    for (i = 0, x = 0; i < header.nnodes; i++) {
+        if (nodes[i].x != x || nodes[i].width <= 0 || nodes[i].y < 0 || nodes[i].y > header.height)
+            goto done;
+        x += nodes[i].width;
+    }
+    for (i = 0; i < header.nfree; i++) {
+        if (rects[i].x < 0 || rects[i].y < 0 || rects[i].width <= 0 || rects[i].height <= 0 ||
+            rects[i].x + rects[i].width > header.width || rects[i].y + rects[i].height > header.height)
+            goto done;
+    }
+    if (x != header.width || nameOffset != header.namesSize)
+        goto done;
+
+    if ((header.width != s->params.width || header.height != s->params.height) && s->params.renderResize) {
+        if (s->params.renderResize(s->params.userPtr, header.width, header.height) == 0) {
+            if (s->handleError)
+                s->handleError(s->errorUptr, IMGS_RENDER_CREATE_FAILED, 0);
+            goto done;
+        }
+    }
+    imgs__flush(s);
+
+    for (i = 0; i < s->nimages; i++) {
+        if (s->images[i].name != NULL) imgs__deleteMipmaps(s->images[i].mips);
+        free(s->images[i].name);
+    }
+    free(s->images);
+    s->images = images;
+    s->nresident = 0;
+    s->nimages = s->nlive = header.nimages;
+    s->cimages = header.nimages + 1;
+    s->freeImage = -1;
+    images = NULL;
+    free(s->table);
+    s->table = table;
+    s->ctable = ctable;
+    table = NULL;
+
+    free(s->atlas->nodes);
+    s->atlas->nodes = nodes;
+    s->atlas->cnodes = cnodes;
+    s->atlas->nnodes = header.nnodes;
+    free(s->atlas->free);
+    s->atlas->free = rects;
+    s->atlas->cfree = header.nfree + 1;
+    s->atlas->nfree = header.nfree;
+    s->atlas->width = header.width;
+    s->atlas->height = header.height;
+    nodes = NULL;
+    rects = NULL;
+
+    free(s->texData);
+    s->texData = texData;
+    texData = NULL;
+    s->params.width = header.width;
+    s->params.height = header.height;
+    s->itw = 1.0f / s->params.width;
+    s->ith = 1.0f / s->params.height;
+    s->dirtyRect[0] = 0;
+    s->dirtyRect[1] = 0;
+    s->dirtyRect[2] = s->params.width;
+    s->dirtyRect[3] = s->params.height;
+
+    // Update texture if renderUpdate is available
+    if (s->params.renderUpdate) {
+        int rect[4] = {0, 0, s->params.width, s->params.height};
+        s->params.renderUpdate(s->params.userPtr, rect, s->texData);
+    }
+    ok = 1;
+
+done:
+    if (images != NULL) {
+        for (i = 0; i < header.nimages; i++)
+            free(images[i].name);
+        free(images);
+    }
+    free(nodes);
+    free(rects);
+    free(table);
+    free(texData);
+    imgs__unmapFile(data, size);
+    return ok;
+}
 #endif // IMAGESTASH_IMPLEMENTATION
@@ -47,8 +47,7 @@
 #endif
 
 #define NVG_INIT_FONTIMAGE_SIZE  512
-#define NVG_MAX_FONTIMAGE_SIZE   2048
-#define NVG_MAX_FONTIMAGES       4
+#define NVG_MAX_FONTIMAGES       FONS_MAX_PAGES
 
 #define NVG_INIT_COMMANDS_SIZE 256
 #define NVG_INIT_POINTS_SIZE 128
@@ -95,6 +94,7 @@ struct NVGstate {
 	float fontBlur;
 	int textAlign;
 	int fontId;
+	int textSDF;
 };
 typedef struct NVGstate NVGstate;
 
@@ -121,6 +121,77 @@ struct NVGpathCache {
 };
 typedef struct NVGpathCache NVGpathCache;
 
+// Laid out text, memoized per font, size, blur, letter spacing and string:
+// glyph runs for nvgText(), nvgTextBounds() and nvgTextGlyphPositions(), row
+// breaks for nvgTextBreakLines(). Entries live in a hash table and an LRU
+// list bounded by a byte budget.
+enum NVGtextCacheKind {
+	NVG_TEXT_CACHE_RUN,
+	NVG_TEXT_CACHE_ROWS,
+};
+
+struct NVGcachedGlyph {
+	int str;				// byte offset of the glyph in the string
+	float x, nextx;			// pen position before and after the glyph
+	float qx, qy;			// top-left quad corner, before pixel snapping
+	float qw, qh;			// quad size
+	float s0, t0, s1, t1;
+	int empty;				// blank glyph, zero sized quad at the pen position
+	short isColor;
+	short sdf;				// distance field, placed without pixel snapping
+	short page;				// atlas page of the bitmap
+	int glyph;				// index in the font's glyph cache, to mark it used on replay
+};
+typedef struct NVGcachedGlyph NVGcachedGlyph;
+
+struct NVGcachedRow {
+	int start, end, next;	// byte offsets in the string
+	float width, minx, maxx;
+};
+typedef struct NVGcachedRow NVGcachedRow;
+
+typedef struct NVGtextCacheEntry NVGtextCacheEntry;
+struct NVGtextCacheEntry {
+	NVGtextCacheEntry* hashNext;
+	NVGtextCacheEntry* lruPrev;
+	NVGtextCacheEntry* lruNext;
+	unsigned int hash;
+	int kind;
+	int font;
+	short isize, iblur;
+	int sdf;
+	float spacing;
+	int align;				// rows: text align of the call
+	float scale;			// rows: font scale of the call
+	float breakWidth;		// rows: break width of the call
+	int maxRows;			// rows: row limit of the call
+	int generation;			// runs: atlas generation of the texture coordinates
+	float advance;			// runs: pen advance of the whole run
+	int count;				// glyphs or rows
+	int len;
+	int bytes;
+	void* items;			// NVGcachedGlyph or NVGcachedRow array
+	char* str;				// copy of the string, follows the items
+};
+
+#define NVG_TEXT_CACHE_BUCKETS 1024
+#define NVG_TEXT_CACHE_SIZE (4*1024*1024)
+
+struct NVGtextCache {
+	NVGtextCacheEntry* buckets[NVG_TEXT_CACHE_BUCKETS];
+	NVGtextCacheEntry* head;	// most recently used
+	NVGtextCacheEntry* tail;
+	int entries;
+	int bytes;
+	int capacity;
+	unsigned int hits, misses, evictions;
+	NVGcachedGlyph* scratch;	// glyphs of the run being laid out
+	int cscratch;
+};
+typedef struct NVGtextCache NVGtextCache;
+
+static void nvg__textCacheClear(NVGtextCache* cache);
+
 struct NVGcontext {
 	NVGparams params;
 	float* commands;
@@ -135,12 +206,13 @@ struct NVGcontext {
 	float fringeWidth;
 	float devicePxRatio;
 	struct FONScontext* fs;
-	int fontImages[NVG_MAX_FONTIMAGES];
-	int fontImageIdx;
+	int fontImages[NVG_MAX_FONTIMAGES];		// one texture per fontstash atlas page
+	int fontImageFormats[NVG_MAX_FONTIMAGES];
 	int drawCallCount;
 	int fillTriCount;
 	int strokeTriCount;
 	int textTriCount;
+	NVGtextCache textCache;
 };
 
 static float nvg__sqrtf(float a) { return sqrtf(a); }
@@ -335,11 +407,12 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 	ctx->fs = fonsCreateInternal(&fontParams);
 	if (ctx->fs == NULL) goto error;
 
-	// Create font texture
-	//ctx->fontImages[0] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, fontParams.width, fontParams.height, 0, NULL);
-	ctx->fontImages[0] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_RGBA, fontParams.width, fontParams.height, 0, NULL);
+	// Create font texture of the first page, textures of further pages are created as glyphs fill them
+	ctx->fontImages[0] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, fontParams.width, fontParams.height, 0, NULL);
 	if (ctx->fontImages[0] == 0) goto error;
-	ctx->fontImageIdx = 0;
+	ctx->fontImageFormats[0] = FONS_PAGE_ALPHA;
+
+	ctx->textCache.capacity = NVG_TEXT_CACHE_SIZE;
 
 	return ctx;
 
@@ -360,6 +433,9 @@ void nvgDeleteInternal(NVGcontext* ctx)
 	if (ctx->commands != NULL) free(ctx->commands);
 	if (ctx->cache != NULL) nvg__deletePathCache(ctx->cache);
 
+	nvg__textCacheClear(&ctx->textCache);
+	free(ctx->textCache.scratch);
+
 	if (ctx->fs)
 		fonsDeleteInternal(ctx->fs);
 
@@ -390,6 +466,8 @@ void nvgBeginFrame(NVGcontext* ctx, float windowWidth, float windowHeight, float
 
 	ctx->params.renderViewport(ctx->params.userPtr, windowWidth, windowHeight, devicePixelRatio);
 
+	fonsBeginFrame(ctx->fs);
+
 	ctx->drawCallCount = 0;
 	ctx->fillTriCount = 0;
 	ctx->strokeTriCount = 0;
@@ -404,31 +482,6 @@ void nvgCancelFrame(NVGcontext* ctx)
 void nvgEndFrame(NVGcontext* ctx)
 {
 	ctx->params.renderFlush(ctx->params.userPtr);
-	if (ctx->fontImageIdx != 0) {
-		int fontImage = ctx->fontImages[ctx->fontImageIdx];
-		int i, j, iw, ih;
-		// delete images that smaller than current one
-		if (fontImage == 0)
-			return;
-		nvgImageSize(ctx, fontImage, &iw, &ih);
-		for (i = j = 0; i < ctx->fontImageIdx; i++) {
-			if (ctx->fontImages[i] != 0) {
-				int nw, nh;
-				nvgImageSize(ctx, ctx->fontImages[i], &nw, &nh);
-				if (nw < iw || nh < ih)
-					nvgDeleteImage(ctx, ctx->fontImages[i]);
-				else
-					ctx->fontImages[j++] = ctx->fontImages[i];
-			}
-		}
-		// make current font image to first
-		ctx->fontImages[j++] = ctx->fontImages[0];
-		ctx->fontImages[0] = fontImage;
-		ctx->fontImageIdx = 0;
-		// clear all images after j
-		for (i = j; i < NVG_MAX_FONTIMAGES; i++)
-			ctx->fontImages[i] = 0;
-	}
 }
 
 NVGcolor nvgRGB(unsigned char r, unsigned char g, unsigned char b)
@@ -676,6 +729,7 @@ void nvgReset(NVGcontext* ctx)
 	state->fontBlur = 0.0f;
 	state->textAlign = NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE;
 	state->fontId = 0;
+	state->textSDF = 0;
 }
 
 // State setting
@@ -1034,6 +1088,24 @@ void nvgResetScissor(NVGcontext* ctx)
 	state->scissor.extent[1] = -1.0f;
 }
 
+int nvgCurrentScissor(NVGcontext* ctx, float* bounds)
+{
+	NVGstate* state = nvg__getState(ctx);
+	const float* xf = state->scissor.xform;
+	float ex = state->scissor.extent[0];
+	float ey = state->scissor.extent[1];
+	float tex, tey;
+
+	if (ex < 0) return 0;
+	tex = ex*nvg__absf(xf[0]) + ey*nvg__absf(xf[2]);
+	tey = ex*nvg__absf(xf[1]) + ey*nvg__absf(xf[3]);
+	bounds[0] = xf[4] - tex;
+	bounds[1] = xf[5] - tey;
+	bounds[2] = xf[4] + tex;
+	bounds[3] = xf[5] + tey;
+	return 1;
+}
+
 // Global composite operation.
 void nvgGlobalCompositeOperation(NVGcontext* ctx, int op)
 {
@@ -2341,6 +2413,13 @@ void nvgFontBlur(NVGcontext* ctx, float blur)
 	state->fontBlur = blur;
 }
 
+int nvgTextSDF(NVGcontext* ctx, int enabled)
+{
+	NVGstate* state = nvg__getState(ctx);
+	state->textSDF = enabled != 0 && ctx->params.imageSDF;
+	return enabled == 0 || state->textSDF;
+}
+
 void nvgTextLetterSpacing(NVGcontext* ctx, float spacing)
 {
 	NVGstate* state = nvg__getState(ctx);
@@ -2381,56 +2460,387 @@ static float nvg__getFontScale(NVGstate* state)
 	return nvg__minf(nvg__quantize(nvg__getAverageScale(state->xform), 0.01f), 4.0f);
 }
 
+// Mirrors the fontstash atlas pages in textures: creates textures for new pages, replaces
+// those whose page changed size or format, deletes those of released pages and uploads
+// the dirty part of the others.
 static void nvg__flushTextTexture(NVGcontext* ctx)
 {
-	int dirty[4];
+	int i, dirty[4];
 
-	if (fonsValidateTexture(ctx->fs, dirty)) {
-		int fontImage = ctx->fontImages[ctx->fontImageIdx];
-		// Update texture
-		if (fontImage != 0) {
-			int iw, ih;
-			const unsigned char* data = fonsGetTextureData(ctx->fs, &iw, &ih);
+	for (i = 0; i < NVG_MAX_FONTIMAGES; i++) {
+		int iw = 0, ih = 0, pw, ph, format;
+		const unsigned char* data = fonsGetPageData(ctx->fs, i, &pw, &ph, &format);
+		if (ctx->fontImages[i] != 0) {
+			if (data != NULL && ctx->fontImageFormats[i] == format)
+				nvgImageSize(ctx, ctx->fontImages[i], &iw, &ih);
+			if (iw != pw || ih != ph) {
+				nvgDeleteImage(ctx, ctx->fontImages[i]);
+				ctx->fontImages[i] = 0;
+			}
+		}
+		if (data == NULL)
+			continue;
+		if (ctx->fontImages[i] == 0) {
+			int type = format == FONS_PAGE_RGBA ? NVG_TEXTURE_RGBA : NVG_TEXTURE_ALPHA;
+			int flags = format == FONS_PAGE_SDF ? NVG_IMAGE_SDF : 0;
+			fonsValidatePage(ctx->fs, i, dirty);
+			ctx->fontImages[i] = ctx->params.renderCreateTexture(ctx->params.userPtr, type, pw, ph, flags, data);
+			ctx->fontImageFormats[i] = format;
+		} else if (fonsValidatePage(ctx->fs, i, dirty)) {
 			int x = dirty[0];
 			int y = dirty[1];
 			int w = dirty[2] - dirty[0];
 			int h = dirty[3] - dirty[1];
-			ctx->params.renderUpdateTexture(ctx->params.userPtr, fontImage, x,y, w,h, data);
+			ctx->params.renderUpdateTexture(ctx->params.userPtr, ctx->fontImages[i], x,y, w,h, data);
 		}
 	}
 }
 
+//
+// Text layout cache
+//
+
+struct NVGtextKey {
+	int kind;
+	int font;
+	short isize, iblur;
+	int sdf;
+	float spacing;
+	int align;
+	float scale;
+	float breakWidth;
+	int maxRows;
+	const char* str;
+	int len;
+	unsigned int hash;
+};
+typedef struct NVGtextKey NVGtextKey;
 
-static int nvg__allocTextAtlas(NVGcontext* ctx)
+static unsigned int nvg__hashText(const char* str, int len, unsigned int seed)
 {
-    int iw, ih;
-    nvg__flushTextTexture(ctx);
-    if (ctx->fontImageIdx >= NVG_MAX_FONTIMAGES-1)
-        return 0;
-    // if next fontImage already have a texture
-    if (ctx->fontImages[ctx->fontImageIdx+1] != 0)
-        nvgImageSize(ctx, ctx->fontImages[ctx->fontImageIdx+1], &iw, &ih);
-    else { // calculate the new font image size and create it.
-        nvgImageSize(ctx, ctx->fontImages[ctx->fontImageIdx], &iw, &ih);
-        if (iw > ih)
-            ih *= 2;
-        else
-            iw *= 2;
-        if (iw > NVG_MAX_FONTIMAGE_SIZE || ih > NVG_MAX_FONTIMAGE_SIZE)
-            iw = ih = NVG_MAX_FONTIMAGE_SIZE;
-        ctx->fontImages[ctx->fontImageIdx+1] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_RGBA, iw, ih, 0, NULL);
-    }
-    ++ctx->fontImageIdx;
-    fonsResetAtlas(ctx->fs, iw, ih);
-    return 1;
+	// FNV-1a
+	unsigned int h = 2166136261u ^ seed;
+	int i;
+	for (i = 0; i < len; i++) {
+		h ^= (unsigned char)str[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+// Builds the cache key from the current fontstash state, call after fonsSetFont() & co.
+static void nvg__textKey(NVGcontext* ctx, NVGtextKey* key, int kind, const char* string, const char* end)
+{
+	FONSstate* fstate = fons__getState(ctx->fs);
+	memset(key, 0, sizeof(*key));
+	key->kind = kind;
+	key->font = fstate->font;
+	key->isize = (short)(fstate->size*10.0f);
+	key->iblur = (short)fstate->blur;
+	key->sdf = fstate->sdf;
+	key->spacing = fstate->spacing;
+	key->str = string;
+	key->len = (int)(end - string);
+}
+
+static void nvg__textKeyHash(NVGtextKey* key)
+{
+	unsigned int seed = (unsigned int)key->kind * 0x9e3779b9u;
+	seed ^= (unsigned int)key->font * 0x85ebca6bu;
+	seed ^= ((unsigned int)(unsigned short)key->isize << 16) | (unsigned short)key->iblur;
+	seed ^= (unsigned int)key->sdf * 0x27d4eb2fu;
+	seed ^= (unsigned int)key->maxRows * 0xc2b2ae35u;
+	key->hash = nvg__hashText(key->str, key->len, seed);
+}
+
+static void nvg__textCacheUnlink(NVGtextCache* cache, NVGtextCacheEntry* e)
+{
+	if (e->lruPrev != NULL) e->lruPrev->lruNext = e->lruNext;
+	else cache->head = e->lruNext;
+	if (e->lruNext != NULL) e->lruNext->lruPrev = e->lruPrev;
+	else cache->tail = e->lruPrev;
+	e->lruPrev = e->lruNext = NULL;
+}
+
+static void nvg__textCachePushFront(NVGtextCache* cache, NVGtextCacheEntry* e)
+{
+	e->lruPrev = NULL;
+	e->lruNext = cache->head;
+	if (cache->head != NULL) cache->head->lruPrev = e;
+	else cache->tail = e;
+	cache->head = e;
+}
+
+static void nvg__textCacheRemove(NVGtextCache* cache, NVGtextCacheEntry* e)
+{
+	NVGtextCacheEntry** link = &cache->buckets[e->hash & (NVG_TEXT_CACHE_BUCKETS-1)];
+	while (*link != e)
+		link = &(*link)->hashNext;
+	*link = e->hashNext;
+	nvg__textCacheUnlink(cache, e);
+	cache->entries--;
+	cache->bytes -= e->bytes;
+	free(e);
+}
+
+static void nvg__textCacheEvict(NVGtextCache* cache, int bytes)
+{
+	while (cache->tail != NULL && cache->bytes + bytes > cache->capacity) {
+		nvg__textCacheRemove(cache, cache->tail);
+		cache->evictions++;
+	}
+}
+
+static NVGtextCacheEntry* nvg__textCacheFind(NVGtextCache* cache, const NVGtextKey* key)
+{
+	NVGtextCacheEntry* e;
+	for (e = cache->buckets[key->hash & (NVG_TEXT_CACHE_BUCKETS-1)]; e != NULL; e = e->hashNext) {
+		if (e->hash == key->hash && e->kind == key->kind && e->font == key->font &&
+			e->isize == key->isize && e->iblur == key->iblur && e->sdf == key->sdf && e->spacing == key->spacing &&
+			e->align == key->align && e->scale == key->scale && e->breakWidth == key->breakWidth &&
+			e->maxRows == key->maxRows && e->len == key->len &&
+			memcmp(e->str, key->str, key->len) == 0) {
+			nvg__textCacheUnlink(cache, e);
+			nvg__textCachePushFront(cache, e);
+			cache->hits++;
+			return e;
+		}
+	}
+	cache->misses++;
+	return NULL;
+}
+
+// Allocates an entry for `count` items of `itemSize` bytes, evicting the least recently
+// used entries to stay within budget. Returns NULL if the entry is too large to be cached.
+static NVGtextCacheEntry* nvg__textCacheAdd(NVGtextCache* cache, const NVGtextKey* key, int count, int itemSize)
+{
+	NVGtextCacheEntry* e;
+	NVGtextCacheEntry** bucket;
+	int bytes = (int)sizeof(NVGtextCacheEntry) + count*itemSize + key->len;
+
+	if (bytes > cache->capacity / 8) return NULL;
+	nvg__textCacheEvict(cache, bytes);
+
+	e = (NVGtextCacheEntry*)malloc(bytes);
+	if (e == NULL) return NULL;
+	memset(e, 0, sizeof(NVGtextCacheEntry));
+	e->hash = key->hash;
+	e->kind = key->kind;
+	e->font = key->font;
+	e->isize = key->isize;
+	e->iblur = key->iblur;
+	e->sdf = key->sdf;
+	e->spacing = key->spacing;
+	e->align = key->align;
+	e->scale = key->scale;
+	e->breakWidth = key->breakWidth;
+	e->maxRows = key->maxRows;
+	e->count = count;
+	e->len = key->len;
+	e->bytes = bytes;
+	e->items = e + 1;
+	e->str = (char*)e->items + count*itemSize;
+	memcpy(e->str, key->str, key->len);
+
+	bucket = &cache->buckets[e->hash & (NVG_TEXT_CACHE_BUCKETS-1)];
+	e->hashNext = *bucket;
+	*bucket = e;
+	nvg__textCachePushFront(cache, e);
+	cache->entries++;
+	cache->bytes += bytes;
+	return e;
+}
+
+static void nvg__textCacheClear(NVGtextCache* cache)
+{
+	while (cache->head != NULL)
+		nvg__textCacheRemove(cache, cache->head);
+}
+
+// Returns the glyph run of the string for the current font state, laying it out (with
+// glyph bitmaps in the atlas) on a miss. The run is stored left/baseline aligned at the
+// origin; replays redo fontstash's alignment and pixel snapping at the actual position.
+// Returns NULL if the run can not be cached, callers then lay the text out directly.
+static NVGtextCacheEntry* nvg__textRun(NVGcontext* ctx, const char* string, const char* end)
+{
+	NVGtextCache* cache = &ctx->textCache;
+	FONSstate* fstate = fons__getState(ctx->fs);
+	int align = fstate->align, generation = ctx->fs->generation;
+	NVGtextKey key;
+	NVGtextCacheEntry* e;
+	FONStextIter iter;
+	FONSquad q;
+	int n = 0;
+
+	if (cache->capacity <= 0 || string == end) return NULL;
+
+	nvg__textKey(ctx, &key, NVG_TEXT_CACHE_RUN, string, end);
+	nvg__textKeyHash(&key);
+	e = nvg__textCacheFind(cache, &key);
+	if (e != NULL) {
+		if (e->generation == generation)
+			return e;
+		nvg__textCacheRemove(cache, e); // the atlas was reset or resized
+	}
+
+	if (cache->cscratch < key.len) {
+		NVGcachedGlyph* scratch = (NVGcachedGlyph*)realloc(cache->scratch, sizeof(NVGcachedGlyph)*key.len);
+		if (scratch == NULL) return NULL;
+		cache->scratch = scratch;
+		cache->cscratch = key.len;
+	}
+
+	fonsSetAlign(ctx->fs, FONS_ALIGN_LEFT | FONS_ALIGN_BASELINE);
+	fonsTextIterInit(ctx->fs, &iter, 0, 0, string, end, FONS_GLYPH_BITMAP_REQUIRED);
+	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
+		NVGcachedGlyph* g = &cache->scratch[n];
+		if (iter.prevGlyphIndex == -1)
+			break; // atlas full
+		g->str = (int)(iter.str - string);
+		g->x = iter.x;
+		g->nextx = iter.nextx;
+		g->qx = q.x0;
+		g->qy = q.y0;
+		g->qw = q.x1 - q.x0;
+		g->qh = q.y1 - q.y0;
+		g->s0 = q.s0;
+		g->t0 = q.t0;
+		g->s1 = q.s1;
+		g->t1 = q.t1;
+		g->empty = q.x0 == q.x1 || q.y0 == q.y1;
+		g->isColor = (short)iter.isColor;
+		g->sdf = (short)(iter.glyph >= 0 && iter.font->glyphs[iter.glyph].blur < 0);
+		g->page = (short)iter.page;
+		g->glyph = iter.glyph;
+		n++;
+	}
+	fonsSetAlign(ctx->fs, align);
+	if (iter.prevGlyphIndex == -1 || ctx->fs->generation != generation)
+		return NULL;
+
+	e = nvg__textCacheAdd(cache, &key, n, (int)sizeof(NVGcachedGlyph));
+	if (e == NULL) return NULL;
+	memcpy(e->items, cache->scratch, sizeof(NVGcachedGlyph)*n);
+	e->generation = generation;
+	e->advance = iter.nextx;
+	return e;
+}
+
+// Start of a cached run drawn at (x,y) with the given alignment, as fonsTextIterInit() computes it.
+static void nvg__textRunOrigin(NVGcontext* ctx, const NVGtextCacheEntry* e, int align, float* x, float* y)
+{
+	if (align & FONS_ALIGN_LEFT) {
+		// empty
+	} else if (align & FONS_ALIGN_RIGHT) {
+		*x -= e->advance;
+	} else if (align & FONS_ALIGN_CENTER) {
+		*x -= e->advance * 0.5f;
+	}
+	*y += fons__getVertAlign(ctx->fs, ctx->fs->fonts[e->font], align, e->isize);
+}
+
+// Quad of a cached glyph in a run starting at (x,y), snapped like fons__getQuad() does.
+static void nvg__textRunQuad(const NVGcachedGlyph* g, float x, float y, FONSquad* q)
+{
+	if (g->empty) {
+		q->x0 = q->x1 = x + g->nextx;
+		q->y0 = q->y1 = y;
+		q->s0 = q->t0 = q->s1 = q->t1 = 0.0f;
+		return;
+	}
+	q->x0 = g->sdf ? x + g->qx : (float)(int)(x + g->qx);
+	q->y0 = g->sdf ? y + g->qy : (float)(int)(y + g->qy);
+	q->x1 = q->x0 + g->qw;
+	q->y1 = q->y0 + g->qh;
+	q->s0 = g->s0;
+	q->t0 = g->t0;
+	q->s1 = g->s1;
+	q->t1 = g->t1;
+}
+
+void nvgTextCacheSize(NVGcontext* ctx, int bytes)
+{
+	NVGtextCache* cache = &ctx->textCache;
+	cache->capacity = nvg__maxi(bytes, 0);
+	nvg__textCacheEvict(cache, 0);
+	if (cache->capacity == 0) {
+		free(cache->scratch);
+		cache->scratch = NULL;
+		cache->cscratch = 0;
+	}
 }
 
-static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts, NVGpaint paint)
+void nvgTextCacheStats(NVGcontext* ctx, NVGtextCacheStats* stats)
+{
+	NVGtextCache* cache = &ctx->textCache;
+	stats->entries = cache->entries;
+	stats->bytes = cache->bytes;
+	stats->capacity = cache->capacity;
+	stats->hits = cache->hits;
+	stats->misses = cache->misses;
+	stats->evictions = cache->evictions;
+}
+
+int nvgTextRasterThreads(NVGcontext* ctx, int threads, void (*ready)(void* uptr), void* uptr)
+{
+	return fonsSetRasterThreads(ctx->fs, threads, ready, uptr);
+}
+
+int nvgTextPendingGlyphs(NVGcontext* ctx)
+{
+	return fonsPendingGlyphs(ctx->fs);
+}
+
+int nvgTextPrewarm(NVGcontext* ctx, unsigned int first, unsigned int last)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	int n;
+
+	if (state->fontId == FONS_INVALID) return 0;
+
+	fonsSetSize(ctx->fs, state->fontSize*scale);
+	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	fonsSetSDF(ctx->fs, state->textSDF);
+	fonsSetFont(ctx->fs, state->fontId);
+
+	n = fonsPrewarm(ctx->fs, first, last);
+	nvg__flushTextTexture(ctx);
+	return n;
+}
+
+int nvgSaveFontAtlas(NVGcontext* ctx, const char* path)
+{
+	return fonsSaveCache(ctx->fs, path);
+}
+
+int nvgLoadFontAtlas(NVGcontext* ctx, const char* path)
+{
+	if (!fonsLoadCache(ctx->fs, path))
+		return 0;
+	nvg__flushTextTexture(ctx);
+	return 1;
+}
+
+static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts, NVGpaint paint, int page)
 {
     NVGstate* state = nvg__getState(ctx);
 
-    // Set the paint image to the current font texture
-    paint.image = ctx->fontImages[ctx->fontImageIdx];
+    // Upload the dirty atlas pages and draw with the texture of the glyphs' page
+    if (page < 0 || page >= NVG_MAX_FONTIMAGES)
+        return;
+    nvg__flushTextTexture(ctx);
+    if (ctx->fontImages[page] == 0)
+        return;
+    paint.image = ctx->fontImages[page];
+
+    // Distance field pages: the half width of the edge ramp in distance units, one pixel
+    // wide for anti-aliasing, widened by the blur
+    if (ctx->fontImageFormats[page] == FONS_PAGE_SDF) {
+        FONSstate* fstate = fons__getState(ctx->fs);
+        float perPixel = 2.0f * FONS_SDF_SPREAD * fstate->size / FONS_SDF_SIZE;
+        paint.feather = nvg__minf((0.5f + fstate->blur) / perPixel, 0.5f);
+    }
 
     // Apply global alpha to the paint (already set in nvgText for color/non-color cases)
     ctx->params.renderTriangles(ctx->params.userPtr, &paint, state->compositeOperation, &state->scissor, verts, nverts, ctx->fringeWidth);
@@ -2443,17 +2853,18 @@ const char *nvgFontTexture( NVGcontext* ctx, int *width, int *height ) {
 	return fonsGetTextureData(ctx->fs, width, height);
 }
 
-float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char* end)
+// Lays the text out glyph by glyph, for runs that can not be cached
+static float nvg__textDirect(NVGcontext* ctx, float x, float y, const char* string, const char* end)
 {
     NVGstate* state = nvg__getState(ctx);
-    FONStextIter iter, prevIter;
+    FONStextIter iter;
     FONSquad q;
     NVGvertex* verts;
     float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
     float invscale = 1.0f / scale;
     int cverts = 0;
     int nverts = 0;
-    int currentIsColor = -1;
+    int currentPage = -1;
     NVGpaint currentPaint = state->fill;
     if (end == NULL)
         end = string + strlen(string);
@@ -2463,6 +2874,7 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
     fonsSetSize(ctx->fs, state->fontSize*scale);
     fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
     fonsSetBlur(ctx->fs, state->fontBlur*scale);
+    fonsSetSDF(ctx->fs, state->textSDF);
     fonsSetAlign(ctx->fs, state->textAlign);
     fonsSetFont(ctx->fs, state->fontId);
 
@@ -2471,33 +2883,20 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
     if (verts == NULL) return x;
 
     fonsTextIterInit(ctx->fs, &iter, x*scale, y*scale, string, end, FONS_GLYPH_BITMAP_REQUIRED);
-    prevIter = iter;
     while (fonsTextIterNext(ctx->fs, &iter, &q)) {
         float c[4*2];
-        if (iter.prevGlyphIndex == -1) { // can not retrieve glyph?
+        if (q.x0 == q.x1 || q.y0 == q.y1)
+            continue; // blank (space) or no room in the atlas, nothing to draw
+
+        // Batch glyphs into runs of the same kind: a run ends only where the
+        // atlas page changes, and with it the texture and color or grayscale paint
+        if (iter.page != currentPage) {
             if (nverts != 0) {
-                nvg__renderText(ctx, verts, nverts, currentPaint);
+                nvg__renderText(ctx, verts, nverts, currentPaint, currentPage);
                 nverts = 0;
             }
-            if (!nvg__allocTextAtlas(ctx))
-                break; // no memory :(
-            iter = prevIter;
-            fonsTextIterNext(ctx->fs, &iter, &q); // try again
-            if (iter.prevGlyphIndex == -1) // still can not find glyph?
-                break;
-        }
-        prevIter = iter;
-
-        FONSglyph* glyph = fons__getGlyph(ctx->fs, iter.font, iter.codepoint, iter.isize, iter.iblur, FONS_GLYPH_BITMAP_OPTIONAL);
-        int isColor = glyph ? glyph->isColor : 0;
-
-		if (nverts != 0) {
-			nvg__renderText(ctx, verts, nverts, currentPaint);
-			nverts = 0;
-		}
-        if (isColor != currentIsColor) {
             currentPaint = state->fill;
-            if (isColor) {
+            if (iter.isColor) {
                 // For color glyphs, use white to preserve texture colors
                 currentPaint.innerColor = nvgRGBAf(1.0f, 1.0f, 1.0f, 1.0f);
                 currentPaint.outerColor = nvgRGBAf(1.0f, 1.0f, 1.0f, 1.0f);
@@ -2506,7 +2905,7 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
                 currentPaint.innerColor.a *= state->alpha;
                 currentPaint.outerColor.a *= state->alpha;
             }
-            currentIsColor = isColor;
+            currentPage = iter.page;
         }
 
         // Transform corners.
@@ -2530,12 +2929,100 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
 
     // Render any remaining vertices
     if (nverts != 0) {
-        nvg__renderText(ctx, verts, nverts, currentPaint);
+        nvg__renderText(ctx, verts, nverts, currentPaint, currentPage);
     }
 
     return iter.nextx / scale;
 }
 
+float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char* end)
+{
+    NVGstate* state = nvg__getState(ctx);
+    NVGtextCacheEntry* run;
+    const NVGcachedGlyph* glyphs;
+    FONSquad q;
+    NVGvertex* verts;
+    float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+    float invscale = 1.0f / scale;
+    int cverts = 0;
+    int nverts = 0;
+    int currentPage = -1;
+    NVGpaint currentPaint = state->fill;
+    FONSglyph* fontGlyphs;
+    int i;
+    if (end == NULL)
+        end = string + strlen(string);
+
+    if (state->fontId == FONS_INVALID) return x;
+
+    fonsSetSize(ctx->fs, state->fontSize*scale);
+    fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
+    fonsSetBlur(ctx->fs, state->fontBlur*scale);
+    fonsSetSDF(ctx->fs, state->textSDF);
+    fonsSetAlign(ctx->fs, state->textAlign);
+    fonsSetFont(ctx->fs, state->fontId);
+
+    run = nvg__textRun(ctx, string, end);
+    if (run == NULL)
+        return nvg__textDirect(ctx, x, y, string, end);
+    glyphs = (const NVGcachedGlyph*)run->items;
+    fontGlyphs = ctx->fs->fonts[run->font]->glyphs;
+
+    cverts = nvg__maxi(2, run->count) * 6;
+    verts = nvg__allocTempVerts(ctx, cverts);
+    if (verts == NULL) return x;
+
+    x *= scale;
+    y *= scale;
+    nvg__textRunOrigin(ctx, run, state->textAlign, &x, &y);
+    for (i = 0; i < run->count; i++) {
+        const NVGcachedGlyph* g = &glyphs[i];
+        float c[4*2];
+        if (g->empty)
+            continue;
+        fons__touchGlyph(ctx->fs, &fontGlyphs[g->glyph]); // keeps its page from being re-packed
+
+        // Same batching as nvg__textDirect(): one call per run of glyphs on the same atlas page
+        if (g->page != currentPage) {
+            if (nverts != 0) {
+                nvg__renderText(ctx, verts, nverts, currentPaint, currentPage);
+                nverts = 0;
+            }
+            currentPaint = state->fill;
+            if (g->isColor) {
+                currentPaint.innerColor = nvgRGBAf(1.0f, 1.0f, 1.0f, 1.0f);
+                currentPaint.outerColor = nvgRGBAf(1.0f, 1.0f, 1.0f, 1.0f);
+            } else {
+                currentPaint.innerColor.a *= state->alpha;
+                currentPaint.outerColor.a *= state->alpha;
+            }
+            currentPage = g->page;
+        }
+
+        nvg__textRunQuad(g, x, y, &q);
+        nvgTransformPoint(&c[0],&c[1], state->xform, q.x0*invscale, q.y0*invscale);
+        nvgTransformPoint(&c[2],&c[3], state->xform, q.x1*invscale, q.y0*invscale);
+        nvgTransformPoint(&c[4],&c[5], state->xform, q.x1*invscale, q.y1*invscale);
+        nvgTransformPoint(&c[6],&c[7], state->xform, q.x0*invscale, q.y1*invscale);
+        if (nverts+6 <= cverts) {
+            nvg__vset(&verts[nverts], c[0], c[1], q.s0, q.t0); nverts++;
+            nvg__vset(&verts[nverts], c[4], c[5], q.s1, q.t1); nverts++;
+            nvg__vset(&verts[nverts], c[2], c[3], q.s1, q.t0); nverts++;
+            nvg__vset(&verts[nverts], c[0], c[1], q.s0, q.t0); nverts++;
+            nvg__vset(&verts[nverts], c[6], c[7], q.s0, q.t1); nverts++;
+            nvg__vset(&verts[nverts], c[4], c[5], q.s1, q.t1); nverts++;
+        }
+    }
+
+    // Flush texture changes
+    nvg__flushTextTexture(ctx);
+
+    if (nverts != 0)
+        nvg__renderText(ctx, verts, nverts, currentPaint, currentPage);
+
+    return (x + run->advance) / scale;
+}
+
 void nvgTextBox(NVGcontext* ctx, float x, float y, float breakRowWidth, const char* string, const char* end)
 {
 	NVGstate* state = nvg__getState(ctx);
@@ -2574,8 +3061,9 @@ int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y, const char* string,
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
-	FONStextIter iter, prevIter;
+	FONStextIter iter;
 	FONSquad q;
+	NVGtextCacheEntry* run;
 	int npos = 0;
 
 	if (state->fontId == FONS_INVALID) return 0;
@@ -2589,17 +3077,30 @@ int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y, const char* string,
 	fonsSetSize(ctx->fs, state->fontSize*scale);
 	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
 	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	fonsSetSDF(ctx->fs, state->textSDF);
 	fonsSetAlign(ctx->fs, state->textAlign);
 	fonsSetFont(ctx->fs, state->fontId);
 
+	run = nvg__textRun(ctx, string, end);
+	if (run != NULL) {
+		const NVGcachedGlyph* glyphs = (const NVGcachedGlyph*)run->items;
+		int i;
+		x *= scale;
+		y *= scale;
+		nvg__textRunOrigin(ctx, run, state->textAlign, &x, &y);
+		for (i = 0; i < run->count && npos < maxPositions; i++) {
+			nvg__textRunQuad(&glyphs[i], x, y, &q);
+			positions[npos].str = string + glyphs[i].str;
+			positions[npos].x = (x + glyphs[i].x) * invscale;
+			positions[npos].minx = nvg__minf(x + glyphs[i].x, q.x0) * invscale;
+			positions[npos].maxx = nvg__maxf(x + glyphs[i].nextx, q.x1) * invscale;
+			npos++;
+		}
+		return npos;
+	}
+
 	fonsTextIterInit(ctx->fs, &iter, x*scale, y*scale, string, end, FONS_GLYPH_BITMAP_OPTIONAL);
-	prevIter = iter;
 	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
-		if (iter.prevGlyphIndex < 0 && nvg__allocTextAtlas(ctx)) { // can not retrieve glyph?
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-		}
-		prevIter = iter;
 		positions[npos].str = iter.str;
 		positions[npos].x = iter.x * invscale;
 		positions[npos].minx = nvg__minf(iter.x, q.x0) * invscale;
@@ -2619,12 +3120,12 @@ enum NVGcodepointType {
 	NVG_CJK_CHAR,
 };
 
-int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows)
+static int nvg__textBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows)
 {
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
-	FONStextIter iter, prevIter;
+	FONStextIter iter;
 	FONSquad q;
 	int nrows = 0;
 	float rowStartX = 0;
@@ -2653,19 +3154,14 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 	fonsSetSize(ctx->fs, state->fontSize*scale);
 	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
 	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	fonsSetSDF(ctx->fs, state->textSDF);
 	fonsSetAlign(ctx->fs, state->textAlign);
 	fonsSetFont(ctx->fs, state->fontId);
 
 	breakRowWidth *= scale;
 
 	fonsTextIterInit(ctx->fs, &iter, 0, 0, string, end, FONS_GLYPH_BITMAP_OPTIONAL);
-	prevIter = iter;
 	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
-		if (iter.prevGlyphIndex < 0 && nvg__allocTextAtlas(ctx)) { // can not retrieve glyph?
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-		}
-		prevIter = iter;
 		switch (iter.codepoint) {
 			case 9:			// \t
 			case 11:		// \v
@@ -2825,11 +3321,74 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 	return nrows;
 }
 
+int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGtextCache* cache = &ctx->textCache;
+	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	NVGtextKey key;
+	NVGtextCacheEntry* e;
+	NVGcachedRow* cached;
+	int nrows, i;
+
+	if (maxRows <= 0) return 0;
+	if (state->fontId == FONS_INVALID) return 0;
+	if (end == NULL)
+		end = string + strlen(string);
+	if (string == end) return 0;
+	if (cache->capacity <= 0)
+		return nvg__textBreakLines(ctx, string, end, breakRowWidth, rows, maxRows);
+
+	fonsSetSize(ctx->fs, state->fontSize*scale);
+	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
+	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	fonsSetSDF(ctx->fs, state->textSDF);
+	fonsSetAlign(ctx->fs, state->textAlign);
+	fonsSetFont(ctx->fs, state->fontId);
+
+	nvg__textKey(ctx, &key, NVG_TEXT_CACHE_ROWS, string, end);
+	key.align = state->textAlign;
+	key.scale = scale;
+	key.breakWidth = breakRowWidth;
+	key.maxRows = maxRows;
+	nvg__textKeyHash(&key);
+
+	e = nvg__textCacheFind(cache, &key);
+	if (e != NULL) {
+		cached = (NVGcachedRow*)e->items;
+		for (i = 0; i < e->count; i++) {
+			rows[i].start = string + cached[i].start;
+			rows[i].end = string + cached[i].end;
+			rows[i].next = string + cached[i].next;
+			rows[i].width = cached[i].width;
+			rows[i].minx = cached[i].minx;
+			rows[i].maxx = cached[i].maxx;
+		}
+		return e->count;
+	}
+
+	nrows = nvg__textBreakLines(ctx, string, end, breakRowWidth, rows, maxRows);
+	e = nvg__textCacheAdd(cache, &key, nrows, (int)sizeof(NVGcachedRow));
+	if (e != NULL) {
+		cached = (NVGcachedRow*)e->items;
+		for (i = 0; i < nrows; i++) {
+			cached[i].start = (int)(rows[i].start - string);
+			cached[i].end = (int)(rows[i].end - string);
+			cached[i].next = (int)(rows[i].next - string);
+			cached[i].width = rows[i].width;
+			cached[i].minx = rows[i].minx;
+			cached[i].maxx = rows[i].maxx;
+		}
+	}
+	return nrows;
+}
+
 float nvgTextBounds(NVGcontext* ctx, float x, float y, const char* string, const char* end, float* bounds)
 {
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
+	NVGtextCacheEntry* run;
 	float width;
 
 	if (state->fontId == FONS_INVALID) return 0;
@@ -2837,10 +3396,43 @@ float nvgTextBounds(NVGcontext* ctx, float x, float y, const char* string, const
 	fonsSetSize(ctx->fs, state->fontSize*scale);
 	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
 	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	fonsSetSDF(ctx->fs, state->textSDF);
 	fonsSetAlign(ctx->fs, state->textAlign);
 	fonsSetFont(ctx->fs, state->fontId);
 
-	width = fonsTextBounds(ctx->fs, x*scale, y*scale, string, end, bounds);
+	if (end == NULL)
+		end = string + strlen(string);
+	run = nvg__textRun(ctx, string, end);
+	if (run != NULL) {
+		// Same as fonsTextBounds(), from the cached quads
+		const NVGcachedGlyph* glyphs = (const NVGcachedGlyph*)run->items;
+		float minx = x*scale, maxx = x*scale;
+		FONSquad q;
+		int i;
+		for (i = 0; i < run->count; i++) {
+			if (glyphs[i].empty)
+				continue;
+			nvg__textRunQuad(&glyphs[i], x*scale, y*scale, &q);
+			minx = nvg__minf(minx, q.x0);
+			maxx = nvg__maxf(maxx, q.x1);
+		}
+		width = run->advance;
+		if (state->textAlign & NVG_ALIGN_LEFT) {
+			// empty
+		} else if (state->textAlign & NVG_ALIGN_RIGHT) {
+			minx -= width;
+			maxx -= width;
+		} else if (state->textAlign & NVG_ALIGN_CENTER) {
+			minx -= width * 0.5f;
+			maxx -= width * 0.5f;
+		}
+		if (bounds != NULL) {
+			bounds[0] = minx;
+			bounds[2] = maxx;
+		}
+	} else {
+		width = fonsTextBounds(ctx->fs, x*scale, y*scale, string, end, bounds);
+	}
 	if (bounds != NULL) {
 		// Use line bounds for height.
 		fonsLineBounds(ctx->fs, y*scale, &bounds[1], &bounds[3]);
@@ -2881,6 +3473,7 @@ void nvgTextBoxBounds(NVGcontext* ctx, float x, float y, float breakRowWidth, co
 	fonsSetSize(ctx->fs, state->fontSize*scale);
 	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
 	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	fonsSetSDF(ctx->fs, state->textSDF);
 	fonsSetAlign(ctx->fs, state->textAlign);
 	fonsSetFont(ctx->fs, state->fontId);
 	fonsLineBounds(ctx->fs, 0, &rminy, &rmaxy);
@@ -2932,6 +3525,7 @@ void nvgTextMetrics(NVGcontext* ctx, float* ascender, float* descender, float* l
 	fonsSetSize(ctx->fs, state->fontSize*scale);
 	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
 	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	fonsSetSDF(ctx->fs, state->textSDF);
 	fonsSetAlign(ctx->fs, state->textAlign);
 	fonsSetFont(ctx->fs, state->fontId);
 
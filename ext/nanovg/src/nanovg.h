@@ -151,6 +151,16 @@ struct NVGtextRow {
 };
 typedef struct NVGtextRow NVGtextRow;
 
+struct NVGtextCacheStats {
+	int entries;		// cached glyph runs and line breaks
+	int bytes;			// memory held by the cache
+	int capacity;		// memory budget, see nvgTextCacheSize()
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int evictions;
+};
+typedef struct NVGtextCacheStats NVGtextCacheStats;
+
 enum NVGimageFlags {
     NVG_IMAGE_GENERATE_MIPMAPS	= 1<<0,     // Generate mipmaps during creation of the image.
 	NVG_IMAGE_REPEATX			= 1<<1,		// Repeat image in X direction.
@@ -158,6 +168,7 @@ enum NVGimageFlags {
 	NVG_IMAGE_FLIPY				= 1<<3,		// Flips (inverses) image in Y direction when rendered.
 	NVG_IMAGE_PREMULTIPLIED		= 1<<4,		// Image data has premultiplied alpha.
 	NVG_IMAGE_NEAREST			= 1<<5,		// Image interpolation is Nearest instead Linear
+	NVG_IMAGE_SDF				= 1<<6,		// Alpha image is a signed distance field, 0.5 on the edge, ramped over +-paint feather.
 };
 
 // Begin drawing a new frame
@@ -457,6 +468,11 @@ extern NVG_EXPORT void nvgIntersectScissor(NVGcontext* ctx, float x, float y, fl
 // Reset and disables scissoring.
 extern NVG_EXPORT void nvgResetScissor(NVGcontext* ctx);
 
+// Gets the axis-aligned bounds of the current scissor rectangle in screen
+// space as [xmin, ymin, xmax, ymax]. Returns 0 (leaving bounds untouched) if
+// scissoring is disabled.
+extern NVG_EXPORT int nvgCurrentScissor(NVGcontext* ctx, float* bounds);
+
 //
 // Paths
 //
@@ -581,6 +597,13 @@ extern NVG_EXPORT void nvgFontSize(NVGcontext* ctx, float size);
 // Sets the blur of current text style.
 extern NVG_EXPORT void nvgFontBlur(NVGcontext* ctx, float blur);
 
+// Draws the text of current text style from signed distance fields, rendered once per glyph
+// and scaled by the GPU, rather than from bitmaps rendered for each size and blur. Use it for
+// text that changes scale every frame (animations, zooming); it is unhinted, so static text
+// looks sharper with bitmaps. Color glyphs keep their bitmaps. Returns 0 when enabling fails
+// because the back-end can not draw distance fields (see NVGparams::imageSDF).
+extern NVG_EXPORT int nvgTextSDF(NVGcontext* ctx, int enabled);
+
 // Sets the letter spacing of current text style.
 extern NVG_EXPORT void nvgTextLetterSpacing(NVGcontext* ctx, float spacing);
 
@@ -630,6 +653,38 @@ extern NVG_EXPORT void nvgTextMetrics(NVGcontext* ctx, float* ascender, float* d
 // Words longer than the max width are slit at nearest character (i.e. no hyphenation).
 extern NVG_EXPORT int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows);
 
+// Laid out text is cached per font, size, blur, letter spacing, SDF mode and string, so that
+// drawing or measuring the same string again skips decoding, glyph lookups and kerning.
+// Sets the memory budget of the cache in bytes (default 4MB), 0 disables it.
+extern NVG_EXPORT void nvgTextCacheSize(NVGcontext* ctx, int bytes);
+
+// Returns the text layout cache statistics.
+extern NVG_EXPORT void nvgTextCacheStats(NVGcontext* ctx, NVGtextCacheStats* stats);
+
+// Renders glyph bitmaps on 'threads' worker threads, so that text showing many new glyphs does
+// not stall the frame; 0 (the default) renders them in the text call that first needs them.
+// Text is laid out right away, a glyph stays invisible until its bitmap is copied in at the
+// next nvgBeginFrame(). 'ready' is called on a worker thread when it has no glyphs left to
+// render and should schedule a frame; it may be NULL. Returns the number of threads started.
+extern NVG_EXPORT int nvgTextRasterThreads(NVGcontext* ctx, int threads, void (*ready)(void* uptr), void* uptr);
+
+// Returns the number of glyphs whose bitmaps the raster threads have not delivered yet.
+extern NVG_EXPORT int nvgTextPendingGlyphs(NVGcontext* ctx);
+
+// Adds the glyphs of the codepoints first..last to the atlas in the current font face, size
+// and blur, e.g. at startup for a script the UI will show. With raster threads this returns
+// right away. Call outside of nvgBeginFrame()/nvgEndFrame(). Returns the number of glyphs.
+extern NVG_EXPORT int nvgTextPrewarm(NVGcontext* ctx, unsigned int first, unsigned int last);
+
+// Saves the glyph atlas (pages and glyph metrics) to a file, e.g. when the application exits.
+// Returns 1 on success.
+extern NVG_EXPORT int nvgSaveFontAtlas(NVGcontext* ctx, const char* path);
+
+// Loads a glyph atlas saved by nvgSaveFontAtlas(), so that the glyphs in it are drawn without
+// being rasterized again. Call after creating the fonts and fallbacks, before drawing text.
+// The file holds a hash of each font's data; it is rejected (and 0 returned) if a font changed.
+extern NVG_EXPORT int nvgLoadFontAtlas(NVGcontext* ctx, const char* path);
+
 //
 // Internal Render API
 //
@@ -668,6 +723,7 @@ typedef struct NVGpath NVGpath;
 struct NVGparams {
 	void* userPtr;
 	int edgeAntiAlias;
+	int imageSDF;			// Back-end draws NVG_IMAGE_SDF images, enables nvgTextSDF().
 	int (*renderCreate)(void* uptr);
 	int (*renderCreateTexture)(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data);
 	int (*renderDeleteTexture)(void* uptr, int image);
@@ -94,6 +94,11 @@ GLuint nvglImageHandleGLES3(NVGcontext* ctx, int image);
 
 #endif
 
+// Restricts everything rendered from now on (until changed) to a rectangle
+// of the framebuffer, in GL window coordinates (origin at the bottom left).
+// Used to repaint only part of a retained frame; pass w < 0 to lift it.
+void nvglSetFrameClip(NVGcontext* ctx, int x, int y, int w, int h);
+
 // These are additional flags on top of NVGimageFlags.
 enum NVGimageFlagsGL {
 	NVG_IMAGE_NODELETE			= 1<<16,	// Do not delete GL texture handle.
@@ -272,6 +277,10 @@ struct GLNVGcontext {
 	#endif
 
 	int dummyTex;
+
+	// Hardware scissor applied to whole frames (nvglSetFrameClip)
+	int frameClip[4];
+	int hasFrameClip;
 };
 typedef struct GLNVGcontext GLNVGcontext;
 
@@ -665,6 +674,7 @@ static int glnvg__renderCreate(void* uptr)
 		"#endif\n"
 		"		if (texType == 1) color = vec4(color.xyz*color.w,color.w);"
 		"		if (texType == 2) color = vec4(color.x);"
+		"		if (texType == 3) color = vec4(smoothstep(0.5 - feather, 0.5 + feather, color.x));\n"
 		"		// Apply color tint and alpha.\n"
 		"		color *= innerCol;\n"
 		"		// Combine alpha\n"
@@ -680,6 +690,7 @@ static int glnvg__renderCreate(void* uptr)
 		"#endif\n"
 		"		if (texType == 1) color = vec4(color.xyz*color.w,color.w);"
 		"		if (texType == 2) color = vec4(color.x);"
+		"		if (texType == 3) color = vec4(smoothstep(0.5 - feather, 0.5 + feather, color.x));\n"
 		"		color *= scissor;\n"
 		"		result = color * innerCol;\n"
 		"	}\n"
@@ -970,13 +981,15 @@ static int glnvg__convertPaint(GLNVGcontext* gl, GLNVGfragUniforms* frag, NVGpai
 		if (tex->type == NVG_TEXTURE_RGBA)
 			frag->texType = (tex->flags & NVG_IMAGE_PREMULTIPLIED) ? 0 : 1;
 		else
-			frag->texType = 2;
+			frag->texType = (tex->flags & NVG_IMAGE_SDF) ? 3 : 2;
 		#else
 		if (tex->type == NVG_TEXTURE_RGBA)
 			frag->texType = (tex->flags & NVG_IMAGE_PREMULTIPLIED) ? 0.0f : 1.0f;
 		else
-			frag->texType = 2.0f;
+			frag->texType = (tex->flags & NVG_IMAGE_SDF) ? 3.0f : 2.0f;
 		#endif
+		// Distance fields: half width of the edge ramp
+		frag->feather = paint->feather;
 //		printf("frag->texType = %d\n", frag->texType);
 	} else {
 		frag->type = NSVG_SHADER_FILLGRAD;
@@ -1204,7 +1217,12 @@ static void glnvg__renderFlush(void* uptr)
 		glFrontFace(GL_CCW);
 		glEnable(GL_BLEND);
 		glDisable(GL_DEPTH_TEST);
-		glDisable(GL_SCISSOR_TEST);
+		if (gl->hasFrameClip) {
+			glEnable(GL_SCISSOR_TEST);
+			glScissor(gl->frameClip[0], gl->frameClip[1], gl->frameClip[2], gl->frameClip[3]);
+		} else {
+			glDisable(GL_SCISSOR_TEST);
+		}
 		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 		glStencilMask(0xffffffff);
 		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
@@ -1267,6 +1285,7 @@ static void glnvg__renderFlush(void* uptr)
 		glBindVertexArray(0);
 #endif
 		glDisable(GL_CULL_FACE);
+		glDisable(GL_SCISSOR_TEST);
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glUseProgram(0);
 		glnvg__bindTexture(gl, 0);
@@ -1604,6 +1623,7 @@ NVGcontext* nvgCreateGLES3(int flags)
 	params.renderDelete = glnvg__renderDelete;
 	params.userPtr = gl;
 	params.edgeAntiAlias = flags & NVG_ANTIALIAS ? 1 : 0;
+	params.imageSDF = 1;
 
 	gl->flags = flags;
 
@@ -1670,5 +1690,15 @@ GLuint nvglImageHandleGLES3(NVGcontext* ctx, int image)
 	return tex->tex;
 }
 
+void nvglSetFrameClip(NVGcontext* ctx, int x, int y, int w, int h)
+{
+	GLNVGcontext* gl = (GLNVGcontext*)nvgInternalParams(ctx)->userPtr;
+	gl->hasFrameClip = w >= 0 && h >= 0;
+	gl->frameClip[0] = x;
+	gl->frameClip[1] = y;
+	gl->frameClip[2] = w;
+	gl->frameClip[3] = h;
+}
+
 #endif /* NANOVG_GL_IMPLEMENTATION */
 
@@ -0,0 +1,178 @@
+// filter_bench -- speed of the imagestash filters on a 4K image
+//
+// Usage: filter_bench [radius] [threads]
+//
+// Blurs a 3840x2160 image with imgsFilterBlur() (radius 20 by default) and
+// compares it with the box blur imagestash had before, which summed the whole
+// box for every pixel and walked the columns in its vertical pass. Its code is
+// copied below. The new blur runs on one filter thread and on one per CPU (or
+// the count given), and must give the same pixels on both. The old blur
+// truncated each pass where the new one rounds, so they may differ by one per
+// pass. Then imgsFilterGaussian() is timed, and imgsFilterGreyscale() against
+// the old float greyscale. Exits with 1 if a check failed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "stb_image_resize2.h"
+#include "imagestash.h"
+}
+
+using Clock = std::chrono::steady_clock;
+using Pixels = std::vector<unsigned char>;
+
+static const int width = 3840, height = 2160;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Something like a photo: gradients, edges and noise
+static Pixels make_image() {
+    Pixels pixels((size_t) width * height * 4);
+    unsigned int seed = 1;
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x) {
+            unsigned char* p = &pixels[((size_t) y * width + x) * 4];
+            seed = seed * 1664525u + 1013904223u;
+            int noise = (int) (seed >> 28) - 8;
+            p[0] = (unsigned char) std::clamp(x * 255 / width + noise, 0, 255);
+            p[1] = (unsigned char) std::clamp(y * 255 / height + noise, 0, 255);
+            p[2] = ((x / 120 + y / 120) & 1) ? 220 : 30;
+            p[3] = (unsigned char) (255 - (x + y) % 64);
+        }
+    return pixels;
+}
+
+// The blur and greyscale imagestash had before
+static void old_blur(unsigned char* pixels, int w, int h, float radius) {
+    int kernelSize = (int) (2 * radius) + 1;
+    if (kernelSize < 3) kernelSize = 3;
+    Pixels temp((size_t) w * h * 4);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            int r = 0, g = 0, b = 0, a = 0, count = 0;
+            for (int k = -kernelSize / 2; k <= kernelSize / 2; ++k) {
+                int nx = std::clamp(x + k, 0, w - 1);
+                unsigned char* p = pixels + ((size_t) y * w + nx) * 4;
+                r += p[0]; g += p[1]; b += p[2]; a += p[3];
+                ++count;
+            }
+            unsigned char* dst = &temp[((size_t) y * w + x) * 4];
+            dst[0] = (unsigned char) (r / count);
+            dst[1] = (unsigned char) (g / count);
+            dst[2] = (unsigned char) (b / count);
+            dst[3] = (unsigned char) (a / count);
+        }
+    for (int x = 0; x < w; ++x)
+        for (int y = 0; y < h; ++y) {
+            int r = 0, g = 0, b = 0, a = 0, count = 0;
+            for (int k = -kernelSize / 2; k <= kernelSize / 2; ++k) {
+                int ny = std::clamp(y + k, 0, h - 1);
+                unsigned char* p = &temp[((size_t) ny * w + x) * 4];
+                r += p[0]; g += p[1]; b += p[2]; a += p[3];
+                ++count;
+            }
+            unsigned char* dst = pixels + ((size_t) y * w + x) * 4;
+            dst[0] = (unsigned char) (r / count);
+            dst[1] = (unsigned char) (g / count);
+            dst[2] = (unsigned char) (b / count);
+            dst[3] = (unsigned char) (a / count);
+        }
+}
+
+static void old_greyscale(unsigned char* p, int w, int h) {
+    for (int i = 0; i < w * h; ++i, p += 4)
+        p[0] = p[1] = p[2] = (unsigned char) (0.3f * p[0] + 0.59f * p[1] + 0.11f * p[2]);
+}
+
+static int max_difference(const Pixels& a, const Pixels& b) {
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        diff = std::max(diff, std::abs(a[i] - b[i]));
+    return diff;
+}
+
+// Times a filter on a copy of the source, the best of a few runs
+template <typename Filter>
+static double time_filter(const Pixels& source, Pixels& result, int runs, Filter filter) {
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        result = source;
+        auto start = Clock::now();
+        filter(result.data());
+        best = std::min(best, ms_since(start));
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    float radius = argc > 1 ? (float) atof(argv[1]) : 20.0f;
+    int threads = argc > 2 ? atoi(argv[2]) : (int) std::thread::hardware_concurrency();
+    if (radius <= 0 || threads < 0) {
+        fprintf(stderr, "usage: %s [radius] [threads]\n", argv[0]);
+        return 1;
+    }
+    threads = std::max(threads, 1);
+
+    IMGSparams params;
+    memset(&params, 0, sizeof(params));
+    params.width = params.height = 256;
+    IMGcontext* stash = imgsCreateInternal(&params);
+    if (!stash) {
+        fprintf(stderr, "could not create the image stash\n");
+        return 1;
+    }
+    auto filter = [&](unsigned char* pixels, auto apply) {
+        IMGimage img = { stash, -1, -1, width, height, pixels, 0, 0 };
+        apply(&img);
+    };
+
+    Pixels source = make_image(), old_result, result, threaded;
+    int failures = 0;
+    printf("%dx%d pixels, box blur radius %g, %d threads\n", width, height, radius, threads);
+
+    double old_ms = time_filter(source, old_result, 1, [&](unsigned char* p) { old_blur(p, width, height, radius); });
+    imgsSetFilterThreads(stash, 1);
+    double one_ms = time_filter(source, result, 3, [&](unsigned char* p) {
+        filter(p, [&](IMGimage* img) { imgsFilterBlur(img, radius); });
+    });
+    imgsSetFilterThreads(stash, threads);
+    double many_ms = time_filter(source, threaded, 3, [&](unsigned char* p) {
+        filter(p, [&](IMGimage* img) { imgsFilterBlur(img, radius); });
+    });
+    int diff = max_difference(old_result, result);
+    printf("  blur:      old %8.1f ms, 1 thread %6.1f ms (%.0fx), %d threads %6.1f ms (%.0fx), differs by %d\n",
+           old_ms, one_ms, old_ms / one_ms, threads, many_ms, old_ms / many_ms, diff);
+    if (diff > 2 || threaded != result) {
+        fprintf(stderr, "  FAILED: %s\n", diff > 2 ? "blur differs from the old one" : "threads changed the result");
+        failures++;
+    }
+
+    double gauss_ms = time_filter(source, result, 3, [&](unsigned char* p) {
+        filter(p, [&](IMGimage* img) { imgsFilterGaussian(img, radius / 2); });
+    });
+    printf("  gaussian:  sigma %g, %d threads %6.1f ms\n", radius / 2, threads, gauss_ms);
+
+    old_ms = time_filter(source, old_result, 3, [&](unsigned char* p) { old_greyscale(p, width, height); });
+    double grey_ms = time_filter(source, result, 3, [&](unsigned char* p) {
+        filter(p, [&](IMGimage* img) { imgsFilterGreyscale(img); });
+    });
+    diff = max_difference(old_result, result);
+    printf("  greyscale: old %8.1f ms, new %6.1f ms (%.0fx), differs by %d\n",
+           old_ms, grey_ms, old_ms / grey_ms, diff);
+    if (diff > 1) {
+        fprintf(stderr, "  FAILED: greyscale differs from the old one\n");
+        failures++;
+    }
+
+    imgsDeleteInternal(stash);
+    printf("  %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
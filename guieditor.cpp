@@ -1321,6 +1321,7 @@ void GUIEditor::addBoxLayoutControls(BoxLayout* layout) {
     orientation_combo->set_selected_index(layout->orientation() == Orientation::Horizontal ? 0 : 1);
     orientation_combo->set_callback([this, layout](int index) {
         layout->set_orientation(index == 0 ? Orientation::Horizontal : Orientation::Vertical);
+        selected_widget->mark_layout_dirty();
         selected_widget->perform_layout(m_nvg_context);
         if (Widget* parent = selected_widget->parent()) {
             parent->perform_layout(m_nvg_context);
@@ -1336,6 +1337,7 @@ void GUIEditor::addBoxLayoutControls(BoxLayout* layout) {
     align_combo->set_selected_index((int)layout->alignment());
     align_combo->set_callback([this, layout](int index) {
         layout->set_alignment((Alignment)index);
+        selected_widget->mark_layout_dirty();
         selected_widget->perform_layout(m_nvg_context);
         if (Widget* parent = selected_widget->parent()) {
             parent->perform_layout(m_nvg_context);
@@ -1351,6 +1353,7 @@ void GUIEditor::addBoxLayoutControls(BoxLayout* layout) {
     margin_box->set_value(layout->margin());
     margin_box->set_callback([this, layout](int v) {
         layout->set_margin(v);
+        selected_widget->mark_layout_dirty();
         selected_widget->perform_layout(m_nvg_context);
         if (Widget* parent = selected_widget->parent()) {
             parent->perform_layout(m_nvg_context);
@@ -1367,6 +1370,7 @@ void GUIEditor::addBoxLayoutControls(BoxLayout* layout) {
     spacing_box->set_value(layout->spacing());
     spacing_box->set_callback([this, layout](int v) {
         layout->set_spacing(v);
+        selected_widget->mark_layout_dirty();
         selected_widget->perform_layout(m_nvg_context);
         if (Widget* parent = selected_widget->parent()) {
             parent->perform_layout(m_nvg_context);
@@ -1385,6 +1389,7 @@ void GUIEditor::addGridLayoutControls(GridLayout* layout) {
     resolution_box->set_value(layout->resolution());
     resolution_box->set_callback([this, layout](int v) {
         layout->set_resolution(std::max(1, v));
+        selected_widget->mark_layout_dirty();
         selected_widget->perform_layout(m_nvg_context);
         if (Widget* parent = selected_widget->parent()) {
             parent->perform_layout(m_nvg_context);
@@ -1401,6 +1406,7 @@ void GUIEditor::addGridLayoutControls(GridLayout* layout) {
     orientation_combo->set_selected_index(layout->orientation() == Orientation::Horizontal ? 0 : 1);
     orientation_combo->set_callback([this, layout](int index) {
         layout->set_orientation(index == 0 ? Orientation::Horizontal : Orientation::Vertical);
+        selected_widget->mark_layout_dirty();
         selected_widget->perform_layout(m_nvg_context);
         if (Widget* parent = selected_widget->parent()) {
             parent->perform_layout(m_nvg_context);
@@ -1433,6 +1439,7 @@ void GUIEditor::addGridLayoutControls(GridLayout* layout) {
 				layout->disable_draw_table();
 		}
 
+        selected_widget->mark_layout_dirty();
         perform_layout();
         redraw();
     });
@@ -1448,6 +1455,7 @@ void GUIEditor::addFlexLayoutControls(FlexLayout* layout) {
     direction_combo->set_selected_index((int)layout->direction());
     direction_combo->set_callback([this, layout](int index) {
         layout->set_direction((FlexDirection)index);
+        selected_widget->mark_layout_dirty();
         selected_widget->perform_layout(m_nvg_context);
         if (Widget* parent = selected_widget->parent()) {
             parent->perform_layout(m_nvg_context);
@@ -1465,6 +1473,7 @@ void GUIEditor::addFlexLayoutControls(FlexLayout* layout) {
     justify_combo->set_selected_index((int)layout->justify_content());
     justify_combo->set_callback([this, layout](int index) {
         layout->set_justify_content((JustifyContent)index);
+        selected_widget->mark_layout_dirty();
         selected_widget->perform_layout(m_nvg_context);
         if (Widget* parent = selected_widget->parent()) {
             parent->perform_layout(m_nvg_context);
@@ -1482,6 +1491,7 @@ void GUIEditor::addFlexLayoutControls(FlexLayout* layout) {
     align_combo->set_selected_index((int)layout->align_items());
     align_combo->set_callback([this, layout](int index) {
         layout->set_align_items((AlignItems)index);
+        selected_widget->mark_layout_dirty();
         selected_widget->perform_layout(m_nvg_context);
         if (Widget* parent = selected_widget->parent()) {
             parent->perform_layout(m_nvg_context);
@@ -1490,6 +1500,42 @@ void GUIEditor::addFlexLayoutControls(FlexLayout* layout) {
         redraw();
     });
     align_combo->set_fixed_height(20);
+
+    // Wrap
+    new Label(properties_pane, "Wrap:", "sans-bold");
+    ComboBox *wrap_combo = new ComboBox(properties_pane, {
+        "No Wrap", "Wrap", "Wrap Reverse"
+    });
+    wrap_combo->set_selected_index((int)layout->flex_wrap());
+    wrap_combo->set_callback([this, layout](int index) {
+        layout->set_flex_wrap((FlexWrap)index);
+        selected_widget->mark_layout_dirty();
+        selected_widget->perform_layout(m_nvg_context);
+        if (Widget* parent = selected_widget->parent()) {
+            parent->perform_layout(m_nvg_context);
+        }
+        perform_layout();
+        redraw();
+    });
+    wrap_combo->set_fixed_height(20);
+
+    // Align Content
+    new Label(properties_pane, "Align Content:", "sans-bold");
+    ComboBox *content_combo = new ComboBox(properties_pane, {
+        "Flex Start", "Flex End", "Center", "Space Between", "Space Around", "Space Evenly", "Stretch"
+    });
+    content_combo->set_selected_index((int)layout->align_content());
+    content_combo->set_callback([this, layout](int index) {
+        layout->set_align_content((AlignContent)index);
+        selected_widget->mark_layout_dirty();
+        selected_widget->perform_layout(m_nvg_context);
+        if (Widget* parent = selected_widget->parent()) {
+            parent->perform_layout(m_nvg_context);
+        }
+        perform_layout();
+        redraw();
+    });
+    content_combo->set_fixed_height(20);
 }
 
 void GUIEditor::addGroupLayoutControls(GroupLayout* layout) {
@@ -1499,6 +1545,7 @@ void GUIEditor::addGroupLayoutControls(GroupLayout* layout) {
     margin_box->set_value(layout->margin());
     margin_box->set_callback([this, layout](int v) {
         layout->set_margin(v);
+        selected_widget->mark_layout_dirty();
         selected_widget->perform_layout(m_nvg_context);
         if (Widget* parent = selected_widget->parent()) {
             parent->perform_layout(m_nvg_context);
@@ -1515,6 +1562,7 @@ void GUIEditor::addGroupLayoutControls(GroupLayout* layout) {
     spacing_box->set_value(layout->spacing());
     spacing_box->set_callback([this, layout](int v) {
         layout->set_spacing(v);
+        selected_widget->mark_layout_dirty();
         selected_widget->perform_layout(m_nvg_context);
         if (Widget* parent = selected_widget->parent()) {
             parent->perform_layout(m_nvg_context);
@@ -0,0 +1,142 @@
+// hittest_bench -- cost of hit tests over a container with many children
+//
+// Usage: hittest_bench [moves]
+//
+// Builds a grid of 20k tiles (200 x 100) in one container out of plain
+// widgets, no window or GL context is needed. Three mouse-move traces are
+// replayed over it, `moves` positions each:
+//   sweep:  horizontal passes over the grid, a few pixels per move
+//   wander: a random walk, as a hand on a mouse makes
+//   jumps:  uniformly random positions, nothing to gain from locality
+// Every move does what Screen does on a cursor event: find_widget() for the
+// cursor and mouse_motion_event() through the root for enter/leave and
+// motion events. Each trace is replayed with the container's hit index off
+// (a linear scan of the children) and on, and the widgets found and the
+// events delivered must be the same. Exits with 1 if they are not. Finally
+// the cost of rebuilding the index after one tile moved is timed.
+
+#include <nanogui/widget.h>
+#include <nanogui/layout.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace nanogui;
+using Clock = std::chrono::steady_clock;
+
+static long enters = 0, motions = 0;
+
+class Tile : public Widget {
+public:
+    Tile(Widget* parent) : Widget(parent) { }
+
+    virtual Vector2i preferred_size(NVGcontext*) const override {
+        return Vector2i(12, 16);
+    }
+
+    virtual bool mouse_enter_event(const Vector2i& p, bool enter) override {
+        enters++;
+        return Widget::mouse_enter_event(p, enter);
+    }
+
+    virtual bool mouse_motion_event(const Vector2i&, const Vector2i&, int, int) override {
+        motions++;
+        return false;
+    }
+};
+
+struct Result {
+    double ms;
+    uint64_t found;
+    long enters, motions;
+};
+
+static Result replay(Widget* root, const std::vector<Vector2i>& trace) {
+    enters = motions = 0;
+    uint64_t found = 0;
+    Vector2i last = trace[0];
+    auto start = Clock::now();
+    for (const Vector2i& p : trace) {
+        const Widget* widget = root->find_widget(p);
+        found = found * 31 + (uint64_t) (uintptr_t) widget;
+        root->mouse_motion_event(p, p - last, 0, 0);
+        last = p;
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return Result { ms, found, enters, motions };
+}
+
+int main(int argc, char** argv) {
+    int moves = argc > 1 ? atoi(argv[1]) : 100000;
+    if (moves <= 0) {
+        fprintf(stderr, "usage: %s [moves]\n", argv[0]);
+        return 1;
+    }
+
+    // The root stands in for the screen
+    Widget* root = new Widget(nullptr);
+    root->inc_ref();
+    root->set_size(Vector2i(3000, 2000));
+    Widget* grid = new Widget(root);
+    grid->set_position(Vector2i(20, 20));
+    grid->set_size(Vector2i(2900, 1900));
+    grid->set_layout(new GridLayout(Orientation::Horizontal, 200, Alignment::Fill, 4, 2));
+    std::vector<Tile*> tiles;
+    for (int i = 0; i < 200 * 100; ++i)
+        tiles.push_back(new Tile(grid));
+    root->update_layout(nullptr);
+    printf("grid: %zu tiles\n", tiles.size());
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> step(-6, 6), x(0, 2999), y(0, 1999);
+    std::vector<Vector2i> sweep, wander, jumps;
+    for (int i = 0; sweep.size() < (size_t) moves; ++i) {
+        int row = 25 + (i * 7) % 1900;
+        for (int px = 0; px < 2950 && sweep.size() < (size_t) moves; px += 3)
+            sweep.push_back(Vector2i(px, row));
+    }
+    Vector2i p(1500, 1000);
+    for (int i = 0; i < moves; ++i) {
+        p = min(max(p + Vector2i(step(rng), step(rng)), Vector2i(0)), Vector2i(2999, 1999));
+        wander.push_back(p);
+        jumps.push_back(Vector2i(x(rng), y(rng)));
+    }
+
+    int failures = 0;
+    struct { const char* name; const std::vector<Vector2i>& trace; } traces[] = {
+        { "sweep", sweep }, { "wander", wander }, { "jumps", jumps }
+    };
+    for (auto& t : traces) {
+        grid->set_hit_index(false);
+        Result linear = replay(root, t.trace);
+        grid->set_hit_index(true);
+        Result indexed = replay(root, t.trace);
+        printf("  %-7s linear %8.3f us/move, indexed %6.3f us/move, %6.1fx, %ld enters\n",
+               t.name, linear.ms * 1000.0 / moves, indexed.ms * 1000.0 / moves,
+               linear.ms / indexed.ms, indexed.enters);
+        if (linear.found != indexed.found || linear.enters != indexed.enters ||
+            linear.motions != indexed.motions) {
+            fprintf(stderr, "  FAILED: the indexed hit tests differ from a linear scan\n");
+            failures++;
+        }
+    }
+
+    // Moving a tile invalidates the index, the next hit test rebuilds it
+    double best = 1e30;
+    Tile* tile = tiles[tiles.size() / 2];
+    for (int i = 0; i < 20; ++i) {
+        tile->set_position(tile->position() + Vector2i(i % 2 ? -1 : 1, 0));
+        auto start = Clock::now();
+        root->find_widget(Vector2i(1500, 1000));
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    printf("  rebuild %8.3f ms\n", best);
+
+    root->dec_ref();
+    printf("  %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
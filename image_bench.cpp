@@ -0,0 +1,337 @@
+// image_bench -- throughput of imagestash image loading
+//
+// Usage: image_bench [images] [threads ...]   (run from the repository root, it
+//                                             copies the JPEGs from
+//                                             ext/nanovg/example/images)
+//
+// Writes `images` files (1000 by default) into a temporary directory, half of
+// them PNGs generated here and half JPEGs copied from the NanoVG examples
+// (stb_image_write has no JPEG encoder in this tree), and loads them into an
+// image stash as thumbnails of at most 64x64 pixels.
+//
+// They are loaded once with imgsAddFile() on the calling thread, then with
+// imgsAddFileAsync() on 1, 2 and 4 load threads (or the counts given on the
+// command line). In the asynchronous runs the calling thread acts as a
+// render thread that calls imgsCollect() once per 4 ms "frame"; the time it
+// spends there is what the decoding no longer costs a frame. Reports images
+// per second, the render-thread time and its longest frame, and checks that
+// every thumbnail has the same pixels as in the synchronous run.
+//
+// Then an image browser is simulated: a window of 200 thumbnails slides over
+// all of them five times, removing the oldest with imgsRemoveImage() for each
+// one added, so the atlas has to reuse freed space instead of growing. The
+// thumbnails in the window must keep their pixels (nothing was packed over
+// them). Then drawing every thumbnail by name (imgsDraw) is compared with
+// drawing it by handle (imgsDrawImage).
+//
+// Last, the PNGs are added at full size (256x192) and drawn as a grid of 32x24
+// pixel cells, once as plain images and once with mipmaps. Reports how many
+// fit in the atlas and how many texels a drawn pixel covers at most (1 means
+// no aliasing, 8 here without mipmaps). With mipmaps they must all fit and
+// the drawn level be at most 2 texels per pixel. Exits with 1 if a check
+// failed.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+extern "C" {
+#include "stb_image_resize2.h"
+#include "imagestash.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+}
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Smooth gradients with a few stripes, something between a photo and an icon
+static void write_png(const std::string& path, int seed) {
+    const int w = 256, h = 192;
+    std::vector<unsigned char> pixels(w * h * 4);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            unsigned char* p = &pixels[(y * w + x) * 4];
+            p[0] = (unsigned char) (x + seed * 37);
+            p[1] = (unsigned char) (y + seed * 11);
+            p[2] = ((x / 16 + y / 16 + seed) & 1) ? 200 : 40;
+            p[3] = 255;
+        }
+    stbi_write_png(path.c_str(), w, h, 4, pixels.data(), w * 4);
+}
+
+static bool copy_file(const std::string& from, const std::string& to) {
+    std::ifstream in(from, std::ios::binary);
+    std::ofstream out(to, std::ios::binary);
+    out << in.rdbuf();
+    return in && out;
+}
+
+struct Run {
+    int loaded = 0;
+    double wall_ms = 0, render_ms = 0, longest_ms = 0;
+};
+
+static void count_added(void* uptr, const char*, int image) {
+    ((Run*) uptr)->loaded += image != 0;
+}
+
+// The most texels drawn quads cover per pixel
+struct Minification {
+    IMGcontext* stash = nullptr;
+    float worst = 0;
+};
+
+static void measure_quads(void* uptr, const float* verts, const float* tcoords, const unsigned int*, int nverts) {
+    Minification* m = (Minification*) uptr;
+    int w, h;
+    imgsGetAtlasSize(m->stash, &w, &h);
+    for (int i = 0; i + 6 <= nverts; i += 6) {
+        float texels = std::fabs(tcoords[i * 2 + 2] - tcoords[i * 2]) * w;
+        float pixels = std::fabs(verts[i * 2 + 2] - verts[i * 2]);
+        if (pixels > 0)
+            m->worst = std::max(m->worst, texels / pixels);
+    }
+}
+
+static IMGcontext* create_stash(Minification* minification = nullptr) {
+    IMGSparams params;
+    memset(&params, 0, sizeof(params));
+    params.width = params.height = 1024;
+    if (minification) {
+        params.userPtr = minification;
+        params.renderDraw = measure_quads;
+    }
+    IMGcontext* stash = imgsCreateInternal(&params);
+    if (minification)
+        minification->stash = stash;
+    return stash;
+}
+
+static Run load(IMGcontext* stash, const std::vector<std::string>& files, int threads) {
+    Run run;
+    auto start = Clock::now();
+    if (threads == 0) {
+        for (const std::string& path : files)
+            run.loaded += imgsAddFile(stash, path.c_str(), path.c_str(), 64, 64) != 0;
+        run.wall_ms = run.render_ms = run.longest_ms = ms_since(start);
+        return run;
+    }
+
+    imgsSetLoadThreads(stash, threads, nullptr, nullptr);
+    auto frame = Clock::now();
+    for (const std::string& path : files)
+        imgsAddFileAsync(stash, path.c_str(), path.c_str(), 64, 64);
+    run.render_ms = run.longest_ms = ms_since(frame);
+    while (imgsPendingImages(stash) > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(4));
+        frame = Clock::now();
+        imgsCollect(stash, count_added, &run);
+        double ms = ms_since(frame);
+        run.render_ms += ms;
+        run.longest_ms = std::max(run.longest_ms, ms);
+    }
+    run.wall_ms = ms_since(start);
+    imgsSetLoadThreads(stash, 0, nullptr, nullptr);
+    return run;
+}
+
+// The thumbnail's pixels, as packed into the atlas
+static std::vector<unsigned char> pixels_of(IMGcontext* stash, const std::string& name, int& w, int& h) {
+    std::vector<unsigned char> pixels;
+    IMGimage* img = imgsGet(stash, name.c_str());
+    w = h = 0;
+    if (img) {
+        int atlas_w, atlas_h;
+        const unsigned char* atlas = imgsGetTextureData(stash, &atlas_w, &atlas_h);
+        w = img->width;
+        h = img->height;
+        for (int y = 0; y < h; ++y) {
+            const unsigned char* row = atlas + ((img->atlasY + IMGS_PAD + y) * atlas_w + img->atlasX + IMGS_PAD) * 4;
+            pixels.insert(pixels.end(), row, row + w * 4);
+        }
+        imgsDeleteImage(img);
+    }
+    return pixels;
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000;
+    if (count <= 0) {
+        fprintf(stderr, "usage: %s [images] [threads ...]\n", argv[0]);
+        return 1;
+    }
+    std::vector<int> thread_counts;
+    for (int i = 2; i < argc; ++i)
+        thread_counts.push_back(atoi(argv[i]));
+    if (thread_counts.empty())
+        thread_counts = { 1, 2, 4 };
+
+    char dir[] = "/tmp/image_bench_XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::vector<std::string> files;
+    size_t bytes = 0;
+    for (int i = 0; i < count; ++i) {
+        std::string path = std::string(dir) + "/" + std::to_string(i);
+        if (i % 2 == 0) {
+            path += ".png";
+            write_png(path, i);
+        } else {
+            path += ".jpg";
+            std::string jpeg = "ext/nanovg/example/images/image" + std::to_string(i / 2 % 12 + 1) + ".jpg";
+            if (!copy_file(jpeg, path)) {
+                fprintf(stderr, "could not copy %s (run from the repository root)\n", jpeg.c_str());
+                return 1;
+            }
+        }
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        bytes += (size_t) in.tellg();
+        files.push_back(path);
+    }
+    printf("%d images (%d PNG, %d JPEG, %.1f MB) loaded as thumbnails of at most 64x64\n",
+           count, (count + 1) / 2, count / 2, bytes / 1048576.0);
+
+    int failures = 0;
+    IMGcontext* reference = create_stash();
+    std::vector<int> runs = thread_counts;
+    runs.insert(runs.begin(), 0);
+    for (int threads : runs) {
+        IMGcontext* stash = threads == 0 ? reference : create_stash();
+        Run run = load(stash, files, threads);
+
+        int mismatched = 0;
+        if (threads != 0) {
+            for (const std::string& path : files) {
+                int w0, h0, w1, h1;
+                if (pixels_of(reference, path, w0, h0) != pixels_of(stash, path, w1, h1) || w0 != w1 || h0 != h1)
+                    mismatched++;
+            }
+            imgsDeleteInternal(stash);
+        }
+        if (run.loaded != count || mismatched) {
+            fprintf(stderr, "  FAILED: %d of %d images loaded, %d differ from the synchronous run\n",
+                    run.loaded, count, mismatched);
+            failures++;
+        }
+
+        if (threads == 0)
+            printf("  imgsAddFile:          %7.0f images/s, render thread %7.1f ms\n",
+                   count * 1000.0 / run.wall_ms, run.render_ms);
+        else
+            printf("  imgsAddFileAsync (%d): %7.0f images/s, render thread %7.1f ms, longest frame %.2f ms\n",
+                   threads, count * 1000.0 / run.wall_ms, run.render_ms, run.longest_ms);
+    }
+
+    // Browse: keep a window of thumbnails, drop the oldest for each new one
+    std::vector<std::vector<unsigned char>> thumbnails(files.size());
+    std::vector<int> widths(files.size()), heights(files.size());
+    for (size_t i = 0; i < files.size(); ++i)
+        thumbnails[i] = pixels_of(reference, files[i], widths[i], heights[i]);
+    IMGcontext* browser = create_stash();
+    const int window = std::min(200, count), passes = 5;
+    std::vector<int> handles(files.size(), 0);
+    int max_w = 0, max_h = 0, lost = 0;
+    auto start = Clock::now();
+    for (int step = 0; step < count * passes; ++step) {
+        size_t i = step % files.size();
+        if (step >= window) {
+            size_t oldest = (step - window) % files.size();
+            lost += !imgsRemoveImage(browser, handles[oldest]);
+        }
+        handles[i] = imgsAddPixels(browser, files[i].c_str(), thumbnails[i].data(), widths[i], heights[i], 0);
+        lost += handles[i] == 0;
+        int w, h;
+        imgsGetAtlasSize(browser, &w, &h);
+        max_w = std::max(max_w, w);
+        max_h = std::max(max_h, h);
+    }
+    double browse_ms = ms_since(start);
+    int damaged = 0;
+    for (int step = count * passes - window; step < count * passes; ++step) {
+        size_t i = step % files.size();
+        int w, h;
+        if (imgsFindImage(browser, files[i].c_str()) != handles[i] ||
+            pixels_of(browser, files[i], w, h) != thumbnails[i])
+            damaged++;
+    }
+    if (lost || damaged) {
+        fprintf(stderr, "  FAILED: %d adds or removes failed, %d thumbnails damaged\n", lost, damaged);
+        failures++;
+    }
+    printf("  browsing %d thumbnails, %d at a time: %.2f us per image, atlas at most %dx%d\n",
+           count * passes, window, browse_ms * 1000.0 / (count * passes), max_w, max_h);
+    imgsDeleteInternal(browser);
+
+    // Lookups: by name hashes and compares the name, a handle is an index
+    const int rounds = 100;
+    std::vector<int> all(files.size());
+    for (size_t i = 0; i < files.size(); ++i)
+        all[i] = imgsFindImage(reference, files[i].c_str());
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (size_t i = 0; i < files.size(); ++i)
+            imgsDraw(reference, files[i].c_str(), 0, 0, 64, 64);
+    double by_name = ms_since(start);
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (size_t i = 0; i < files.size(); ++i)
+            imgsDrawImage(reference, all[i], 0, 0, 64, 64);
+    double by_handle = ms_since(start);
+    printf("  drawing: %.1f ns per image by name, %.1f ns by handle\n",
+           by_name * 1e6 / (rounds * files.size()), by_handle * 1e6 / (rounds * files.size()));
+    imgsDeleteInternal(reference);
+
+    // Mipmaps: the PNGs at full size drawn as a grid of small cells
+    std::vector<std::string> pngs;
+    for (size_t i = 0; i < files.size(); i += 2)
+        pngs.push_back(files[i]);
+    for (int mipmaps = 0; mipmaps <= 1; ++mipmaps) {
+        Minification minification;
+        IMGcontext* stash = create_stash(&minification);
+        imgsSetMipmaps(stash, mipmaps);
+        std::vector<int> grid;
+        for (const std::string& path : pngs)
+            if (int image = imgsAddFile(stash, path.c_str(), path.c_str(), 256, 256))
+                grid.push_back(image);
+        double first_ms = 0, frame_ms = 0;
+        const int frames = 10;
+        for (int frame = 0; frame < frames; ++frame) {
+            start = Clock::now();
+            for (size_t i = 0; i < grid.size(); ++i)
+                imgsDrawImage(stash, grid[i], (i % 40) * 32.0f, (i / 40) * 24.0f, 32, 24);
+            imgsEndFrame(stash);
+            (frame == 0 ? first_ms : frame_ms) += ms_since(start);
+        }
+        int w, h;
+        imgsGetAtlasSize(stash, &w, &h);
+        printf("  %s: %zu of %zu 256x192 images fit, atlas %dx%d, grid at 32x24: %.1f texels per pixel, "
+               "first frame %.2f ms, then %.2f ms\n", mipmaps ? "mipmapped" : "plain    ", grid.size(), pngs.size(),
+               w, h, minification.worst, first_ms, frame_ms / (frames - 1));
+        if (mipmaps && (grid.size() != pngs.size() || minification.worst > 2)) {
+            fprintf(stderr, "  FAILED: mipmapped images missing or drawn from a level too large\n");
+            failures++;
+        }
+        imgsDeleteInternal(stash);
+    }
+
+    for (const std::string& path : files)
+        unlink(path.c_str());
+    rmdir(dir);
+
+    printf("  %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -49,9 +49,17 @@ public:
         // Initialize mutex
         pthread_mutex_init(&m_highResMutex, nullptr);
 
-        // Start thread to load images progressively
-        pthread_create(&m_loadThread, nullptr, loadImages, this);
-        m_threadRunning = true;
+        // Decode and downsize the thumbnails on load threads, draw() adds them to the atlas
+        Screen* scr = screen();
+        imgsSetLoadThreads(m_stash, 4, [](void* uptr) {
+            Screen* scr = (Screen*) uptr;
+            async([scr] { scr->redraw(); });
+            glfwPostEmptyEvent();
+        }, scr);
+        for (const auto& path : m_imagePaths) {
+            std::string name = path.substr(path.find_last_of("/\\") + 1);
+            imgsAddFileAsync(m_stash, name.c_str(), path.c_str(), 128, 128);
+        }
 
         // Request redraw
         //set_needs_redraw();
@@ -60,20 +68,8 @@ public:
     }
 
     ~ImageStashWidget() {
-        // Cancel and join any running thread
-        if (m_threadRunning) {
-            pthread_cancel(m_loadThread);
-            pthread_join(m_loadThread, nullptr);
-            m_threadRunning = false;
-        }
-
-        // Clean up pending images
+        // Clean up pending images (the thumbnail load threads stop in imgsDeleteInternal)
         pthread_mutex_lock(&m_highResMutex);
-        for (auto& pending : m_pendingImages) {
-            if (pending.pixels) {
-                stbi_image_free(pending.pixels);
-            }
-        }
         if (m_pendingHighResPixels) {
             stbi_image_free(m_pendingHighResPixels);
         }
@@ -148,86 +144,11 @@ public:
         //set_needs_redraw();
     } */
 
-    struct PendingImage {
-        std::string name;
-        std::string path;
-        unsigned char* pixels = nullptr;
-        int width = 0;
-        int height = 0;
-    };
-
     struct LoadThreadData {
         ImageStashWidget* widget;
         std::string path;
     };
 
-    static void* loadImages(void* arg) {
-        ImageStashWidget* widget = (ImageStashWidget*)arg;
-        printf("loadImages start\n");
-
-        // Enable cancellation
-        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, nullptr);
-        pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, nullptr);
-
-        const int maxWidth = 128;
-        const int maxHeight = 128;
-
-        for (const auto& path : widget->m_imagePaths) {
-            std::string name = path.substr(path.find_last_of("/\\") + 1);
-            int w, h, n;
-            unsigned char* pixels = stbi_load(path.c_str(), &w, &h, &n, 4); // Force RGBA
-            pthread_testcancel(); // Cancellation point
-            if (!pixels) {
-                std::cerr << "Failed to load image: " << path << std::endl;
-                continue;
-            }
-
-            // Resize if needed
-            unsigned char* data = pixels;
-            if (w > maxWidth || h > maxHeight) {
-                float scale = fminf((float)maxWidth / w, (float)maxHeight / h);
-                int nw = (int)(w * scale);
-                int nh = (int)(h * scale);
-                unsigned char* resized = (unsigned char*)malloc(nw * nh * 4);
-                if (!resized) {
-                    stbi_image_free(data);
-                    std::cerr << "Failed to allocate memory for resized image: " << name << std::endl;
-                    continue;
-                }
-
-                if (!stbir_resize_uint8_linear(data, w, h, 0, resized, nw, nh, 0, STBIR_RGBA)) {
-                    free(resized);
-                    stbi_image_free(data);
-                    std::cerr << "Failed to resize image: " << name << std::endl;
-                    continue;
-                }
-                stbi_image_free(data);
-                data = resized;
-                w = nw;
-                h = nh;
-            }
-
-            //printf("loadImages loaded: %s, %dx%d\n", name.c_str(), w, h);
-
-            pthread_mutex_lock(&widget->m_highResMutex);
-            if (widget->m_threadRunning) {
-                widget->m_pendingImages.push_back({name, path, data, w, h});
-                widget->m_redraw = true;
-                glfwPostEmptyEvent();
-				printf("loadImages: added image\n");
-            } else {
-                free(data);
-            }
-            pthread_mutex_unlock(&widget->m_highResMutex);
-        }
-
-        pthread_mutex_lock(&widget->m_highResMutex);
-        widget->m_threadRunning = false;
-        pthread_mutex_unlock(&widget->m_highResMutex);
-        printf("loadImages completed\n");
-        return nullptr;
-    }
-
     static void* loadHighResImage(void* arg) {
         LoadThreadData* data = (LoadThreadData*)arg;
         ImageStashWidget* widget = data->widget;
@@ -566,38 +487,16 @@ public:
         }
 		*/
 
-		// Process pending images
-        pthread_mutex_lock(&m_highResMutex);
-        for (auto& pending : m_pendingImages) {
-			m_redraw = true;
-            if (imgsAddPixels(m_stash, pending.name.c_str(), pending.pixels, pending.width, pending.height, 0)) {
-                TestImage img;
-                img.name = pending.name;
-                img.path = pending.path;
-                IMGimage* tmp = imgsGet(m_stash, pending.name.c_str());
-                if (tmp) {
-                    img.w = tmp->width;
-                    img.h = tmp->height;
-                    img.atlasX = tmp->atlasX;
-                    img.atlasY = tmp->atlasY;
-                    imgsDeleteImage(tmp);
-                } else {
-                    img.w = pending.width;
-                    img.h = pending.height;
-                    img.atlasX = -1;
-                    img.atlasY = -1;
-                }
-                m_images.push_back(img);
-                glfwPostEmptyEvent();
-				// **MUST** run this async, as perform_layout in a draw will result in recursive loop 
-				async([this] { screen()->perform_layout(); });
-            } else {
-                std::cerr << "Failed to add image to stash: " << pending.name << std::endl;
-            }
-            stbi_image_free(pending.pixels);
+        // Add the thumbnails loaded since the last frame
+        if (imgsCollect(m_stash, [](void* uptr, const char* name, int image) {
+                ((ImageStashWidget*) uptr)->image_loaded(name, image);
+            }, this) > 0) {
+            m_redraw = true;
+            // **MUST** run this async, as perform_layout in a draw will result in recursive loop
+            async([this] { screen()->perform_layout(); });
         }
-        m_pendingImages.clear();
 
+        pthread_mutex_lock(&m_highResMutex);
         // Check for pending high-res image and create texture
         if (m_pendingHighResPixels) {
             if (m_fullscreenHighResImg) {
@@ -676,6 +575,30 @@ public:
     } // draw()
 
 private:
+    void image_loaded(const char* name, int image) {
+        if (!image) {
+            std::cerr << "Failed to load image: " << name << std::endl;
+            return;
+        }
+        TestImage img;
+        img.name = name;
+        for (const auto& path : m_imagePaths)
+            if (path.substr(path.find_last_of("/\\") + 1) == img.name)
+                img.path = path;
+        IMGimage* tmp = imgsGetImage(m_stash, image);
+        if (tmp) {
+            img.w = tmp->width;
+            img.h = tmp->height;
+            img.atlasX = tmp->atlasX;
+            img.atlasY = tmp->atlasY;
+            imgsDeleteImage(tmp);
+        } else {
+            img.w = img.h = 0;
+            img.atlasX = img.atlasY = -1;
+        }
+        m_images.push_back(img);
+    }
+
     struct TestImage {
         std::string name;
         std::string path;
@@ -686,7 +609,6 @@ private:
     NVGcontext* m_nvg_context = nullptr;
     std::vector<TestImage> m_images;
     std::vector<std::string> m_imagePaths;
-    std::vector<PendingImage> m_pendingImages;
     IMGcontext* m_stash = nullptr;
     IMGimage* m_filteredImg = nullptr;
     IMGimage* m_fullscreenHighResImg = nullptr;
@@ -703,9 +625,7 @@ private:
     bool m_isEnteringFullscreen = false;
     bool m_redraw = true;
     float m_backgroundOpacity = 0.0f;
-    pthread_t m_loadThread;
     pthread_t m_loadHighResThread;
-    bool m_threadRunning = false;
     bool m_threadRunningHighRes = false;
     pthread_mutex_t m_highResMutex;
 
@@ -59,7 +59,7 @@ NAMESPACE_BEGIN(nanogui)
         const std::string& caption() const { return m_caption; }
 
         /// Sets the caption of this Button.
-        void set_caption(const std::string& caption) { m_caption = caption; }
+        void set_caption(const std::string& caption) { m_caption = caption; mark_layout_dirty(); }
 
         /// Returns the background color of this Button.
         const Color& background_color() const { return m_background_color; }
@@ -79,7 +79,7 @@ NAMESPACE_BEGIN(nanogui)
         /// Returns the icon of this Button.  See \ref nanogui::Button::m_icon.
         int icon() const { return m_icon; }
         /// Sets the icon of this Button.  See \ref nanogui::Button::m_icon.
-        void set_icon(int icon) { m_icon = icon; }
+        void set_icon(int icon) { m_icon = icon; mark_layout_dirty(); }
 
         /// The current flags of this Button (see \ref nanogui::Button::Flags for options).
         int flags() const { return m_flags; }
@@ -114,6 +114,8 @@ NAMESPACE_BEGIN(nanogui)
 
         /// The preferred size of this Button.
         virtual Vector2i preferred_size(NVGcontext* ctx) const override;
+        /// The baseline of the caption (see \ref Widget::baseline).
+        virtual int baseline(NVGcontext* ctx, int height) const override;
         /// The callback that is called when any type of mouse or keyboard event is issued to this Button.
         virtual bool mouse_enter_event(const Vector2i& p, bool enter) override;
         virtual bool mouse_button_event(const Vector2i& p, int button, bool down, int modifiers) override;
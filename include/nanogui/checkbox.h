@@ -52,7 +52,7 @@ public:
    const std::string &caption() const { return m_caption; }
 
     /// Sets the caption of this CheckBox.
-    void set_caption(const std::string &caption) { m_caption = caption; }
+    void set_caption(const std::string &caption) { m_caption = caption; mark_layout_dirty(); }
 
     /// Whether or not this CheckBox is currently checked.
     const bool &checked() const { return m_checked; }
@@ -96,6 +96,9 @@ public:
  /// Compute the preferred size needed to display the label.
  virtual Vector2i preferred_size(NVGcontext *ctx) const override;
 
+ /// The baseline of the first line of text (see \ref Widget::baseline).
+ virtual int baseline(NVGcontext *ctx, int height) const override;
+
  /// Draw the label with the current text and settings.
  virtual void draw(NVGcontext *ctx) override;
 
@@ -17,7 +17,6 @@
 
 #include <nanogui/object.h>
 #include <nanogui/vector.h>
-#include <unordered_map>
 #include <vector>
 
 NAMESPACE_BEGIN(nanogui)
@@ -40,6 +39,11 @@ enum class Orientation {
  * \class Layout layout.h nanogui/layout.h
  *
  * \brief Basic interface of a layout engine.
+ *
+ * The setters of a layout do not know the widget it is attached to. After
+ * changing the parameters of a layout in use (orientation, margin, spacing,
+ * ...), call \ref Widget::mark_layout_dirty() or \ref Widget::request_layout()
+ * on that widget, or its cached preferred size and layout are kept.
  */
 
 struct TableTheme {
@@ -480,16 +484,11 @@ public:
     /// Set the stretch factor of a given column
     void set_col_stretch(int index, float stretch) { m_col_stretch.at(index) = stretch; }
 
-    /// Specify the anchor data structure for a given widget
-    void set_anchor(const Widget *widget, const Anchor &anchor) { m_anchor[widget] = anchor; }
+    /// Specify the anchor data structure for a given widget (see \ref Widget::set_grid_anchor())
+    void set_anchor(Widget *widget, const Anchor &anchor);
 
     /// Retrieve the anchor data structure for a given widget
-    Anchor anchor(const Widget *widget) const {
-        auto it = m_anchor.find(widget);
-        if (it == m_anchor.end())
-            throw std::runtime_error("Widget was not registered with the grid layout!");
-        return it->second;
-    }
+    Anchor anchor(const Widget *widget) const;
 
     /* Implementation of the layout interface */
 
@@ -520,9 +519,6 @@ protected:
     /// The stretch for each row of this AdvancedGridLayout.
     std::vector<float> m_row_stretch;
 
-    /// The mapping of widgets to their specified anchor points.
-    std::unordered_map<const Widget *, Anchor> m_anchor;
-
     /// The margin around this AdvancedGridLayout.
     int m_margin;
 };
@@ -551,7 +547,19 @@ enum class AlignItems {
     FlexEnd,        ///< Items aligned at end of cross axis
     Center,         ///< Items centered along cross axis
     Stretch,        ///< Items stretched to fill cross axis
-    Baseline        ///< Items aligned along their baseline
+    Baseline,       ///< Items aligned along their baseline (rows only, see \ref Widget::baseline)
+    Auto            ///< Use the container's align_items (only for FlexItem::align_self)
+};
+
+/// Cross axis alignment of the lines of a wrapping FlexLayout (equivalent to CSS align-content)
+enum class AlignContent {
+    FlexStart = 0,  ///< Lines packed at start of cross axis
+    FlexEnd,        ///< Lines packed at end of cross axis
+    Center,         ///< Lines centered along cross axis
+    SpaceBetween,   ///< Lines evenly distributed, first/last at edges
+    SpaceAround,    ///< Lines evenly distributed with equal space around
+    SpaceEvenly,    ///< Lines evenly distributed with equal space between
+    Stretch         ///< Free space shared among the lines
 };
 
 /// Flex wrap behavior (equivalent to CSS flex-wrap)
@@ -568,7 +576,16 @@ enum class FlexWrap {
  *
  * This layout implements the CSS Flexbox model for one-dimensional layout.
  * Items can be arranged along a main axis with flexible sizing and various
- * alignment options along both main and cross axes.
+ * alignment options along both main and cross axes. With wrapping enabled,
+ * items that do not fit go to further lines, which are placed according to
+ * \ref align_content(), and the preferred size of the container is the one
+ * of the lines at its current width (or height, for columns).
+ *
+ * The hypothetical size of an item is its flex basis, or else its preferred
+ * size, clamped to its minimum and maximum size; the free space of a line is
+ * shared according to the grow and shrink factors as in CSS, freezing the
+ * items that reach their minimum or maximum size. The gap applies both
+ * between items and between lines.
  */
 class NANOGUI_EXPORT FlexLayout : public Layout {
 public:
@@ -581,7 +598,7 @@ public:
         float flex_grow = 0.0f;     ///< How much the item should grow (CSS flex-grow)
         float flex_shrink = 1.0f;   ///< How much the item should shrink (CSS flex-shrink)  
         int flex_basis = -1;        ///< Initial main size before free space distribution (CSS flex-basis)
-        AlignItems align_self = AlignItems::FlexStart;  ///< Override container align_items for this item
+        AlignItems align_self = AlignItems::Auto;  ///< Override container align_items for this item
         
         FlexItem() = default;
         FlexItem(float grow, float shrink = 1.0f, int basis = -1) 
@@ -622,6 +639,11 @@ public:
     /// Set the flex wrap setting
     void set_flex_wrap(FlexWrap wrap) { m_flex_wrap = wrap; }
 
+    /// Get the alignment of the lines when wrapping
+    AlignContent align_content() const { return m_align_content; }
+    /// Set the alignment of the lines when wrapping
+    void set_align_content(AlignContent align) { m_align_content = align; }
+
     /// Get the margin
     int margin() const { return m_margin; }
     /// Set the margin
@@ -632,14 +654,11 @@ public:
     /// Set the gap between items  
     void set_gap(int gap) { m_gap = gap; }
 
-    /// Set flex properties for a specific widget
-    void set_flex_item(const Widget *widget, const FlexItem &item) { m_flex_items[widget] = item; }
+    /// Set flex properties for a specific widget (see \ref Widget::set_flex_item())
+    void set_flex_item(Widget *widget, const FlexItem &item);
 
     /// Get flex properties for a widget (returns default if not set)
-    FlexItem get_flex_item(const Widget *widget) const {
-        auto it = m_flex_items.find(widget);
-        return it != m_flex_items.end() ? it->second : FlexItem();
-    }
+    const FlexItem &get_flex_item(const Widget *widget) const;
 
     /* Implementation of the layout interface */
     virtual Vector2i preferred_size(NVGcontext *ctx, const Widget *widget) const override;
@@ -658,14 +677,48 @@ protected:
     /// Get cross axis index  
     int cross_axis() const { return is_row_direction() ? 1 : 0; }
 
+    /// A visible child during a layout pass (sizes along the main/cross axis)
+    struct Item {
+        Widget *widget;
+        float grow, shrink;
+        AlignItems align;
+        bool frozen;
+        int base, main, min_main, max_main;
+        int cross, min_cross, max_cross;
+        int baseline, pos;
+    };
+
+    /// The items [begin, end) placed on one line
+    struct Line {
+        size_t begin, end;
+        int main;   ///< Hypothetical sizes and gaps
+        int cross;  ///< Largest hypothetical cross size (or baseline extent)
+        int above;  ///< Largest baseline of the baseline-aligned items
+        int pos;
+    };
+
+    /// Collect the visible children of \c widget and break them into lines
+    void compute_lines(NVGcontext *ctx, const Widget *widget, const Vector2i &available,
+                       std::vector<Item> &items, std::vector<Line> &lines) const;
+
+    /// Resolve the main sizes of the items of a line (CSS "resolve flexible lengths")
+    void resolve_lengths(std::vector<Item> &items, const Line &line, int available) const;
+
 protected:
     FlexDirection m_direction;
     JustifyContent m_justify_content;
     AlignItems m_align_items;
     FlexWrap m_flex_wrap;
+    AlignContent m_align_content;
     int m_margin;
     int m_gap;
-    std::unordered_map<const Widget*, FlexItem> m_flex_items;
+
+    /* Buffers of the layout passes, kept to avoid allocating in each one. A
+       pass that starts while they are in use (a descendant sharing this
+       layout) uses its own */
+    mutable std::vector<Item> m_items;
+    mutable std::vector<Line> m_lines;
+    mutable bool m_scratch_busy = false;
 };
 
 
@@ -114,10 +114,42 @@ public:
     /// Send an event that will cause the screen to be redrawn at the next event loop iteration
     void redraw();
 
+    /**
+     * \brief Mark a rectangle (in screen coordinates) as needing a repaint at
+     * the next event loop iteration
+     *
+     * Unlike \ref redraw(), which repaints everything, only the union of the
+     * rectangles marked since the last frame is cleared and redrawn (widgets
+     * outside of it are skipped); the rest of the framebuffer is kept from a
+     * retained copy of the previous frame. Falls back to a full redraw when no
+     * such copy is available.
+     */
+    void mark_dirty(const Vector2i& pos, const Vector2i& size);
+
+    /// Return whether \ref mark_dirty() repaints only the marked area (OpenGL only)
+    bool partial_redraw() const { return m_partial_redraw; }
+    /// Enable or disable partial repaints (when disabled, \ref mark_dirty() redraws everything)
+    void set_partial_redraw(bool partial_redraw) {
+        m_partial_redraw = partial_redraw;
+        m_retained_valid = false;
+    }
+
+    /**
+     * \brief Keep the glyph atlas in the file \c path across runs
+     *
+     * Loads the atlas that the previous run saved there, so that the first
+     * frames draw their text without rasterizing the glyphs again, and saves
+     * it back when the screen is destroyed. A file saved for other fonts (or
+     * other versions of them) is ignored and overwritten. Call after setting
+     * the theme and before drawing. Returns whether the file was loaded.
+     */
+    bool set_atlas_cache(const std::string &path);
+
     /**
      * \brief Redraw the screen if the redraw flag is set
      *
-     * This function does everything -- it calls \ref draw_setup(), \ref
+     * This function does everything -- it runs the queued layouts (\ref
+     * perform_scheduled_layouts()), calls \ref draw_setup(), \ref
      * draw_contents() (which also clears the screen by default), \ref draw(),
      * and finally \ref draw_teardown().
      *
@@ -231,11 +263,29 @@ public:
 
     using Widget::perform_layout;
 
-    /// Compute the layout of all widgets
+    /// Compute the layout of all windows whose layout is dirty (see \ref Widget::mark_layout_dirty())
     void perform_layout() {
+        m_layout_dirty = false;
         this->perform_layout(m_nvg_context);
     }
 
+    /// Lay out \c root before the next frame (see \ref Widget::request_layout())
+    void schedule_layout(Widget* root);
+
+    /**
+     * \brief Run the layouts queued by \ref schedule_layout()
+     *
+     * Called by \ref draw_all() before drawing. Each queued root is laid out
+     * once, however often it was queued, and a root inside another one is
+     * left to the layout of the outer root.
+     */
+    void perform_scheduled_layouts();
+
+    /// Return how many layouts were queued through \ref schedule_layout()
+    size_t layouts_requested() const { return m_layouts_requested; }
+    /// Return how many of the queued layouts were run (the rest were coalesced)
+    size_t layouts_performed() const { return m_layouts_performed; }
+
 	void notify_widget_destroyed(Widget* widget) {
 		// Clear drag widget if it's being destroyed
 		if (m_drag_widget == widget) {
@@ -283,8 +333,11 @@ public:
     void update_focus(Widget* widget);
     void dispose_window(Window* window);
     void center_window(Window* window);
+    void cancel_layouts(const Widget* widget);
     void move_window_to_front(Window* window);
     void draw_widgets();
+    bool restore_frame();
+    void retain_frame(const Vector2i& pos, const Vector2i& size);
     void set_popup_visible(PopupButton* iButton) { m_popup_visible.push_back(iButton); }
     void remove_popup_visible(PopupButton* iButton) { m_close_popups = true; m_popup_visible.remove(iButton); }
     std::vector<Widget*> m_focus_path;
@@ -312,6 +365,21 @@ protected:
     bool m_stencil_buffer;
     bool m_float_buffer;
     bool m_redraw;
+    bool m_partial_redraw = true;
+    std::string m_atlas_cache;
+    /* Union of the mark_dirty() rectangles since the last frame (empty if
+       min >= max), and the area of the partial repaint in progress in
+       framebuffer pixels, GL orientation (size < 0 during full redraws) */
+    Vector2i m_dirty_min = Vector2i(0), m_dirty_max = Vector2i(0);
+    Vector2i m_clip_pos = Vector2i(0), m_clip_size = Vector2i(-1);
+    /* Copy of the last frame that partial repaints start from */
+    uint32_t m_retained_fbo = 0, m_retained_rbo = 0;
+    Vector2i m_retained_size = Vector2i(0);
+    bool m_retained_valid = false;
+    /* Roots queued by schedule_layout(), all of them in this screen's tree
+       (removing a widget drops it and its descendants from the queue) */
+    std::vector<Widget*> m_layout_queue;
+    size_t m_layouts_requested = 0, m_layouts_performed = 0;
     std::function<void(Vector2i)> m_resize_callback;
 #if defined(NANOGUI_USE_METAL)
     void* m_metal_texture = nullptr;
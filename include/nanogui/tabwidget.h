@@ -62,7 +62,7 @@ public:
     /// Return the caption of the tab with the given ID
     const std::string& tab_caption(int id) const { return m_tab_captions[tab_index(id)]; };
     /// Change the caption of the tab with the given ID
-    void set_tab_caption(int id, const std::string &caption) { m_tab_captions[tab_index(id)] = caption; };
+    void set_tab_caption(int id, const std::string &caption) { m_tab_captions[tab_index(id)] = caption; mark_layout_dirty(); };
 
     /// Return whether tabs provide a close button
     bool tabs_closeable() const { return m_tabs_closeable; }
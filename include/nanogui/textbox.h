@@ -49,7 +49,7 @@ public:
     void set_spinnable(bool spinnable) { m_spinnable = spinnable; }
 
     const std::string &value() const { return m_value; }
-    void set_value(const std::string &value) { m_value = value; }
+    void set_value(const std::string &value) { m_value = value; mark_layout_dirty(); }
 
     const std::string &default_value() const { return m_default_value; }
     void set_default_value(const std::string &default_value) { m_default_value = default_value; }
@@ -58,10 +58,10 @@ public:
     void set_alignment(Alignment align) { m_alignment = align; }
 
     const std::string &units() const { return m_units; }
-    void set_units(const std::string &units) { m_units = units; }
+    void set_units(const std::string &units) { m_units = units; mark_layout_dirty(); }
 
     int units_image() const { return m_units_image; }
-    void set_units_image(int image) { m_units_image = image; }
+    void set_units_image(int image) { m_units_image = image; mark_layout_dirty(); }
 
     /// Return the underlying regular expression specifying valid formats
     const std::string &format() const { return m_format; }
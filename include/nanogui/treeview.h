@@ -141,9 +141,12 @@ public:
     /// Create an empty treeview
     TreeView(Widget* parent);
 
-    /// Create a new treeview with the given items
+    /// Create a new treeview with the given items, which it takes ownership of
     TreeView(Widget* parent, NanoTree* items);
 
+    /// Deletes the items (but not their nodes, which NanoTree leaves to its user)
+    virtual ~TreeView();
+
     /// Override of the Widget set_size
     virtual void set_fixed_size(const Vector2i& fixed_size) override;
 
@@ -153,6 +156,7 @@ public:
     void set_expand_callback(const std::function<void(std::string)>& expand_callback) { m_expand_callback = expand_callback; }
 
     /// Sets the items for this Treeview. Execute this every time you ake a change to the NanoTree tructure
+    /// The view owns the items and deletes the previous ones; nullptr clears the view
     void set_items(NanoTree* items);
     /// The items associated with this Treeview.
     NanoTree* items() { return m_data_tree; }
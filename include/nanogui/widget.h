@@ -14,6 +14,7 @@
 
 #include <nanogui/object.h>
 #include <nanogui/theme.h>
+#include <nanogui/layout.h>
 #include <algorithm>
 #include <vector>
 
@@ -56,7 +57,26 @@ public:
     /// Return the used \ref Layout generator
     const Layout* layout() const { return m_layout.get(); }
     /// Set the used \ref Layout generator
-    void set_layout(Layout* layout) { m_layout = layout; }
+    void set_layout(Layout* layout) { m_layout = layout; mark_layout_dirty(); }
+
+    /**
+     * \brief Return the flex properties used when the parent has a \ref FlexLayout
+     *
+     * Stored on the widget rather than in the layout, so that they go away
+     * with the widget and stay with it when it moves to another container.
+     */
+    const FlexLayout::FlexItem& flex_item() const { return m_flex_item; }
+    /// Set the flex properties used when the parent has a \ref FlexLayout
+    void set_flex_item(const FlexLayout::FlexItem& item) { m_flex_item = item; mark_layout_dirty(); }
+
+    /// Return the cell used when the parent has an \ref AdvancedGridLayout (\c nullptr if none)
+    const AdvancedGridLayout::Anchor* grid_anchor() const { return m_has_grid_anchor ? &m_grid_anchor : nullptr; }
+    /// Set the cell used when the parent has an \ref AdvancedGridLayout
+    void set_grid_anchor(const AdvancedGridLayout::Anchor& anchor) {
+        m_grid_anchor = anchor;
+        m_has_grid_anchor = true;
+        mark_layout_dirty();
+    }
 
     /// Return the \ref Theme used to draw this widget
     Theme* theme() { return m_theme; }
@@ -68,7 +88,12 @@ public:
     /// Return the position relative to the parent widget
     const Vector2i& position() const { return m_pos; }
     /// Set the position relative to the parent widget
-    void set_position(const Vector2i& pos)  {m_pos = pos; }
+    void set_position(const Vector2i& pos) {
+        if (m_pos != pos) {
+            m_pos = pos;
+            invalidate_parent_hit_index();
+        }
+    }
 
     /// Return the absolute position on screen
     Vector2i absolute_position() const {
@@ -80,23 +105,30 @@ public:
     //const Vector2i& size() const { if (this == NULL) return 0; else  return m_size; }
     const Vector2i& size() const { return m_size; }
     /// set the size of the widget
-    void set_size(const Vector2i& size) 
-    {  m_size = size; }
+    void set_size(const Vector2i& size) {
+        if (m_size != size) {
+            m_size = size;
+            // The parent's preferred size and layout may depend on it
+            if (m_parent)
+                m_parent->mark_layout_dirty();
+            invalidate_parent_hit_index();
+        }
+    }
 
 	const Vector2i& min_size() const { return m_min_size; }
-    void set_min_size(const Vector2i& size) {  m_min_size = size; }
+    void set_min_size(const Vector2i& size) {  m_min_size = size; mark_layout_dirty(); }
 	const Vector2i& max_size() const { return m_min_size; }
-    void set_max_size(const Vector2i& size) {  m_max_size = size; }
+    void set_max_size(const Vector2i& size) {  m_max_size = size; mark_layout_dirty(); }
 
     /// Return the width of the widget
     int width() const { return m_size.x(); }
     /// Set the width of the widget
-    void set_width(int width) { m_size.x() = width; m_min_size.x() = width; }
+    void set_width(int width) { set_size(Vector2i(width, m_size.y())); m_min_size.x() = width; }
 
     /// Return the height of the widget
     int height() const { return m_size.y(); }
     /// Set the height of the widget
-    void set_height(int height) { m_size.y() = height; }
+    void set_height(int height) { set_size(Vector2i(m_size.x(), height)); }
 
     /**
      * \brief Set the fixed size of this widget
@@ -108,7 +140,12 @@ public:
      * in the parent widget.
      */
     //virtual void set_fixed_size(const Vector2i& fixed_size) {  m_fixed_size = fixed_size; }
-	virtual void set_fixed_size(const Vector2i& fixed_size) {  m_min_size = fixed_size; }
+	virtual void set_fixed_size(const Vector2i& fixed_size) {
+        if (m_min_size != fixed_size) {
+            m_min_size = fixed_size;
+            mark_layout_dirty();
+        }
+    }
 
     /// Return the fixed size (see \ref set_fixed_size())
 	// FIXME Should be min size??
@@ -119,24 +156,30 @@ public:
     // Return the fixed height (see \ref set_fixed_size())
     int fixed_height() const { return m_fixed_size.y(); }
     /// Set the fixed width (see \ref set_fixed_size())
-    void set_fixed_width(int width) { m_fixed_size.x() = width; }
+    void set_fixed_width(int width) { m_fixed_size.x() = width; mark_layout_dirty(); }
     /// Set the fixed height (see \ref set_fixed_size())
-    void set_fixed_height(int height) { m_fixed_size.y() = height; }
+    void set_fixed_height(int height) { m_fixed_size.y() = height; mark_layout_dirty(); }
 	/// Set the fixed width (see \ref set_fixed_size())
-    void set_min_width(int width) { m_min_size.x() = width; }
+    void set_min_width(int width) { m_min_size.x() = width; mark_layout_dirty(); }
     /// Set the fixed height (see \ref set_fixed_size())
-    void set_min_height(int height) { m_min_size.y() = height; }
+    void set_min_height(int height) { m_min_size.y() = height; mark_layout_dirty(); }
 
 	// New flex sizing 
-	void set_width_flex(SizeMode mode) { m_width_mode = mode; }
-    void set_height_flex(SizeMode mode) { m_height_mode = mode; }
+	void set_width_flex(SizeMode mode) { m_width_mode = mode; mark_layout_dirty(); }
+    void set_height_flex(SizeMode mode) { m_height_mode = mode; mark_layout_dirty(); }
     SizeMode width_mode() const { return m_width_mode; }
     SizeMode height_mode() const { return m_height_mode; }
 
     /// Return whether or not the widget is currently visible (assuming all parents are visible)
     bool visible() const { return m_visible; }
     /// Set whether or not the widget is currently visible (assuming all parents are visible)
-    void set_visible(bool visible) { m_visible = visible; }
+    void set_visible(bool visible) {
+        if (m_visible != visible) {
+            m_visible = visible;
+            mark_layout_dirty();
+            invalidate_parent_hit_index();
+        }
+    }
 
     /// Check if this widget is currently visible, taking parent widgets into account
     bool visible_recursive() const {
@@ -210,6 +253,8 @@ public:
     void set_focused(bool focused) { m_focused = focused; }
     /// Request the focus to be moved to this widget
     void request_focus();
+    /// Ask the screen to repaint just the area covered by this widget
+    void mark_dirty();
 
     const std::string& tooltip() const { return m_tooltip; }
     void set_tooltip(const std::string& tooltip) { m_tooltip = tooltip; }
@@ -220,7 +265,12 @@ public:
     /// Return current font size. If not set the default of the current theme will be returned
     int font_size() const;
     /// Set the font size of this widget
-    void set_font_size(int font_size) { m_font_size = font_size; }
+    void set_font_size(int font_size) {
+        if (m_font_size != font_size) {
+            m_font_size = font_size;
+            mark_layout_dirty();
+        }
+    }
     /// Return whether the font size is explicitly specified for this widget
     bool has_font_size() const { return m_font_size > 0; }
 
@@ -234,7 +284,7 @@ public:
      * Sets the amount of extra scaling applied to *icon* fonts.
      * See \ref nanogui::Widget::m_icon_extra_scale.
      */
-    void set_icon_extra_scale(float scale) { m_icon_extra_scale = scale; }
+    void set_icon_extra_scale(float scale) { m_icon_extra_scale = scale; mark_layout_dirty(); }
 
     /// Return a pointer to the cursor of the widget
     Cursor cursor() const { return m_cursor; }
@@ -252,6 +302,21 @@ public:
     Widget* find_widget(const Vector2i& p);
     const Widget* find_widget(const Vector2i& p) const;
 
+    /**
+     * \brief Index the children of this widget for hit tests
+     *
+     * \ref find_widget() and the mouse and scroll event handlers normally
+     * test every child in turn. With the index enabled, the children are
+     * bucketed in a uniform grid over their bounding box, and a hit test
+     * only looks at the children in the cell under the cursor. The grid is
+     * rebuilt on the next hit test after a child was moved, resized, shown,
+     * hidden, added or removed. Worth it for containers with thousands of
+     * children, such as a large grid of tiles.
+     */
+    void set_hit_index(bool enabled);
+    /// Return whether hit tests on the children use an index
+    bool hit_index() const { return m_hit_index != nullptr; }
+
     /// Handle a mouse button event (default implementation: propagate to children)
     virtual bool mouse_button_event(const Vector2i& p, int button, bool down, int modifiers);
 
@@ -279,9 +344,65 @@ public:
     /// Compute the preferred size of the widget
     virtual Vector2i preferred_size(NVGcontext* ctx) const;
 
+    /**
+     * \brief Return the distance from the top of the widget to the baseline
+     * of its (first line of) text, when the widget is \c height tall
+     *
+     * Used by \ref FlexLayout to align items along their baselines. The
+     * default is the bottom edge, for widgets without text.
+     */
+    virtual int baseline(NVGcontext* ctx, int height) const;
+
+    /**
+     * \brief Return \ref preferred_size(), computed once per constraint
+     *
+     * Layout generators call this for their children. The size is kept until
+     * \ref mark_layout_dirty() is called on this widget or a descendant, a
+     * descendant is resized, or the constraint it was computed under (the
+     * size of this widget and of its parent) changes.
+     */
+    Vector2i cached_preferred_size(NVGcontext* ctx) const;
+
     /// Invoke the associated layout generator to properly place child widgets, if any
     virtual void perform_layout(NVGcontext* ctx);
 
+    /**
+     * \brief Tell the layout that this widget's preferred size may have changed
+     *
+     * Marks this widget and all its ancestors for layout and drops their
+     * cached preferred sizes. The setters of \ref Widget and of the stock
+     * widgets call this; a subclass whose \ref preferred_size() depends on
+     * other state must call it when that state changes.
+     */
+    void mark_layout_dirty();
+
+    /// Return whether this widget or a descendant needs to be laid out again
+    bool layout_dirty() const { return m_layout_dirty; }
+
+    /**
+     * \brief Lay out this widget if needed
+     *
+     * Calls \ref perform_layout() if the layout is dirty or the widget or
+     * its parent was resized since its last layout, and does nothing
+     * otherwise. Resizing a child marks its parent dirty, so a layout that
+     * changed the size of a child is run again on the next pass. Layout
+     * generators use this for their children, so that only the dirty
+     * subtrees of a widget are recomputed.
+     */
+    void update_layout(NVGcontext* ctx);
+
+    /**
+     * \brief Lay out the children of this widget again before the next frame
+     *
+     * Marks the widget dirty and queues it with its \ref Screen, which runs
+     * the queued layouts once in \ref Screen::draw_all(), so a burst of
+     * changes costs a single layout. The widget is the root of that layout:
+     * its own size is kept, so call this on the nearest ancestor whose size
+     * does not depend on the change (a window, a scroll panel, a container
+     * with a fixed size). Outside of a screen, only the mark is set.
+     */
+    void request_layout();
+
     /// Draw the widget (and all child widgets)
     virtual void draw(NVGcontext* ctx);
 
@@ -387,6 +508,35 @@ protected:
 	virtual void apply_animation_transform(NVGcontext* ctx, float progress);
     virtual void end_animation();
 	std::pair<bool, float> get_animation_progress();
+
+    /* Layout state. m_layout_dirty is set on a widget and its ancestors by
+       mark_layout_dirty() and cleared by update_layout(). Both the last layout
+       and the preferred size cache record the sizes of the widget and of its
+       parent they were computed with */
+    bool m_layout_dirty = true;
+    Vector2i m_layout_constraint[2];
+    mutable bool m_preferred_valid = false;
+    mutable Vector2i m_preferred_cache, m_preferred_constraint[2];
+
+    /* Per-widget data of the parent's layout generator */
+    FlexLayout::FlexItem m_flex_item;
+    AdvancedGridLayout::Anchor m_grid_anchor;
+    bool m_has_grid_anchor = false;
+
+    /// Mark the hit index of the parent stale after writing m_pos, m_size or m_visible directly
+    void invalidate_parent_hit_index() {
+        if (m_parent)
+            m_parent->m_hit_index_valid = false;
+    }
+
+    /* Uniform grid over the children, see set_hit_index(). Stale once a
+       child moved, resized, changed visibility, or the children changed */
+    struct HitIndex;
+    HitIndex* m_hit_index = nullptr;
+    mutable bool m_hit_index_valid = false;
+
+private:
+    bool hit_candidates(const Vector2i& p, const uint32_t*& begin, const uint32_t*& end) const;
 };
 
 NAMESPACE_END(nanogui)
@@ -44,7 +44,7 @@ struct WindowConfig {
         /// Return the window title
         const std::string& title() const { return m_title; }
         /// Set the window title
-        void set_title(const std::string& title) { m_title = title; }
+        void set_title(const std::string& title) { m_title = title; mark_layout_dirty(); }
 
         /// Is this a model dialog?
         bool modal() const { return m_modal; }
@@ -0,0 +1,175 @@
+// layout_bench -- cost of full and incremental layouts of large widget trees
+//
+// Usage: layout_bench [runs]
+//
+// Builds two trees out of plain widgets, no window or GL context is needed:
+//   deep: 20 nested vertical BoxLayouts with 10 leaves each
+//   wide: a vertical BoxLayout of 100 rows with 100 leaves each (10k leaves)
+//   tiles: 2000 leaves in a wrapping FlexLayout, a dashboard of tiles
+// The leaves stand in for labels and buttons: their preferred_size() does a
+// little work, as measuring a caption would, and counts how often it is
+// called. For each tree three layouts are timed (the best of `runs`):
+//   cold:    every preferred size dropped (mark_layout_dirty() on each leaf)
+//   clean:   nothing changed since the last layout
+//   changed: one leaf in the middle of the tree changed its preferred size
+// The layout of the root is repeated until no widget is dirty anymore, which
+// a layout that changed the size of a widget needs once more. After the
+// changed run, the geometry must equal the one a cold layout computes for the
+// same tree. Exits with 1 if it does not.
+
+#include <nanogui/widget.h>
+#include <nanogui/layout.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace nanogui;
+using Clock = std::chrono::steady_clock;
+
+static long measures = 0;
+
+class Leaf : public Widget {
+public:
+    Leaf(Widget* parent, const std::string& caption) : Widget(parent), m_caption(caption) { }
+
+    void set_caption(const std::string& caption) {
+        m_caption = caption;
+        mark_layout_dirty();
+    }
+
+    virtual Vector2i preferred_size(NVGcontext*) const override {
+        // Something like summing glyph advances
+        int width = 0;
+        for (char c : m_caption)
+            width += 5 + (c * 7) % 4;
+        measures++;
+        return Vector2i(width + 10, 20);
+    }
+
+private:
+    std::string m_caption;
+};
+
+struct Tree {
+    const char* name;
+    Widget* root;
+    std::vector<Leaf*> leaves;
+};
+
+static Tree deep_tree(int depth, int leaves_per_level) {
+    Tree tree { "deep", new Widget(nullptr), {} };
+    tree.root->inc_ref();
+    tree.root->set_size(Vector2i(8000, 8000));
+    Widget* level = tree.root;
+    for (int d = 0; d < depth; ++d) {
+        level->set_layout(new BoxLayout(Orientation::Vertical, Alignment::Minimum, 2, 2));
+        for (int i = 0; i < leaves_per_level; ++i)
+            tree.leaves.push_back(new Leaf(level, "item " + std::to_string(d * 100 + i)));
+        level = new Widget(level);
+    }
+    return tree;
+}
+
+static Tree wide_tree(int rows, int columns) {
+    Tree tree { "wide", new Widget(nullptr), {} };
+    tree.root->inc_ref();
+    tree.root->set_size(Vector2i(8000, 4000));
+    tree.root->set_layout(new BoxLayout(Orientation::Vertical, Alignment::Minimum, 4, 2));
+    for (int r = 0; r < rows; ++r) {
+        Widget* row = new Widget(tree.root);
+        row->set_layout(new BoxLayout(Orientation::Horizontal, Alignment::Middle, 0, 2));
+        for (int c = 0; c < columns; ++c)
+            tree.leaves.push_back(new Leaf(row, "cell " + std::to_string(r * columns + c)));
+    }
+    return tree;
+}
+
+static Tree tile_tree(int tiles) {
+    Tree tree { "tiles", new Widget(nullptr), {} };
+    tree.root->inc_ref();
+    tree.root->set_size(Vector2i(1600, 8000));
+    FlexLayout* flex = new FlexLayout(FlexDirection::Row, JustifyContent::SpaceBetween, AlignItems::Stretch, 4, 4);
+    flex->set_flex_wrap(FlexWrap::Wrap);
+    flex->set_align_content(AlignContent::FlexStart);
+    tree.root->set_layout(flex);
+    for (int i = 0; i < tiles; ++i) {
+        Leaf* leaf = new Leaf(tree.root, "tile " + std::to_string(i));
+        leaf->set_flex_item(FlexLayout::FlexItem(i % 3 == 0 ? 1.f : 0.f));
+        tree.leaves.push_back(leaf);
+    }
+    return tree;
+}
+
+static int layout(Widget* root) {
+    int passes = 0;
+    do {
+        root->update_layout(nullptr);
+        passes++;
+    } while (root->layout_dirty() && passes < 8);
+    return passes;
+}
+
+static void geometry(const Widget* widget, std::vector<int>& out) {
+    out.insert(out.end(), { widget->position().x(), widget->position().y(),
+                            widget->size().x(), widget->size().y() });
+    for (auto child : widget->children())
+        geometry(child, out);
+}
+
+// Times a layout after `prepare`, the best of a few runs
+template <typename Prepare>
+static void time_layout(const char* what, Widget* root, int runs, Prepare prepare) {
+    double best = 1e30;
+    long calls = 0;
+    int passes = 0;
+    for (int i = 0; i < runs; ++i) {
+        prepare(i);
+        measures = 0;
+        auto start = Clock::now();
+        passes = layout(root);
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        calls = measures;
+    }
+    printf("  %-8s %8.3f ms, %6ld measures, %d passes\n", what, best, calls, passes);
+}
+
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 20;
+    if (runs <= 0) {
+        fprintf(stderr, "usage: %s [runs]\n", argv[0]);
+        return 1;
+    }
+
+    int failures = 0;
+    for (Tree tree : { deep_tree(20, 10), wide_tree(100, 100), tile_tree(2000) }) {
+        printf("%s: %zu leaves\n", tree.name, tree.leaves.size());
+        layout(tree.root);
+
+        time_layout("cold", tree.root, runs, [&](int) {
+            for (auto leaf : tree.leaves)
+                leaf->mark_layout_dirty();
+        });
+        time_layout("clean", tree.root, runs, [](int) { });
+        Leaf* leaf = tree.leaves[tree.leaves.size() / 2];
+        time_layout("changed", tree.root, runs, [&](int i) {
+            leaf->set_caption(i % 2 ? "short" : "a much longer caption");
+        });
+
+        std::vector<int> incremental, full;
+        geometry(tree.root, incremental);
+        for (auto leaf : tree.leaves)
+            leaf->mark_layout_dirty();
+        layout(tree.root);
+        geometry(tree.root, full);
+        if (incremental != full) {
+            fprintf(stderr, "  FAILED: the incremental layout differs from a full one\n");
+            failures++;
+        }
+        tree.root->dec_ref();
+    }
+    printf("  %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,345 @@
+#pragma once
+
+// ngevents.h -- compact event transport between ngserver and its runtime
+//
+// UI events are encoded as fixed-size binary records (plus the widget id and
+// an optional text payload), collected for one main loop iteration, merged
+// where that loses nothing useful (consecutive drag/motion events of one
+// widget), and shipped as a single batch over a Unix domain socket. A sender
+// thread does the socket I/O so a slow runtime never stalls the UI.
+//
+// Wire format (native byte order, the peer is always on the same host):
+//
+//   NGEventBatchHeader  magic, total size, record count, batch sequence
+//   NGEventRecord       repeated `count` times, each followed by
+//                       id_len bytes of widget id and text_len bytes of text
+//
+// Record timestamps come from std::chrono::steady_clock (CLOCK_MONOTONIC on
+// Linux), so a runtime on the same machine can measure delivery latency.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#  include <cerrno>
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+enum NGEventType : uint16_t {
+    NG_EVENT_MOUSE_ENTER = 1,
+    NG_EVENT_MOUSE_LEAVE,
+    NG_EVENT_MOUSE_DOWN,
+    NG_EVENT_MOUSE_UP,
+    NG_EVENT_MOUSE_DRAG,
+    NG_EVENT_WINDOW_DRAG,
+    NG_EVENT_BUTTON_CLICK,
+    NG_EVENT_LABEL_CLICK,
+    NG_EVENT_VALUE_CHANGE   // the user changed a widget's value, which is the text
+};
+
+inline const char* ng_event_type_name(uint16_t type) {
+    switch (type) {
+        case NG_EVENT_MOUSE_ENTER:  return "mouse_enter";
+        case NG_EVENT_MOUSE_LEAVE:  return "mouse_leave";
+        case NG_EVENT_MOUSE_DOWN:   return "mouse_down";
+        case NG_EVENT_MOUSE_UP:     return "mouse_up";
+        case NG_EVENT_MOUSE_DRAG:   return "mouse_drag";
+        case NG_EVENT_WINDOW_DRAG:  return "window_drag";
+        case NG_EVENT_BUTTON_CLICK: return "button_click";
+        case NG_EVENT_LABEL_CLICK:  return "label_click";
+        case NG_EVENT_VALUE_CHANGE: return "value_change";
+        default:                    return "unknown";
+    }
+}
+
+// Motion-like events: a run of them collapses into one record
+inline bool ng_event_mergeable(uint16_t type) {
+    return type == NG_EVENT_MOUSE_DRAG || type == NG_EVENT_WINDOW_DRAG;
+}
+
+#define NG_EVENT_BATCH_MAGIC 0x5645474eu // "NGEV"
+
+struct NGEventBatchHeader {
+    uint32_t magic;
+    uint32_t size;      // bytes, including this header
+    uint32_t count;     // records in the batch
+    uint32_t seq;       // batch sequence number, starts at 0
+};
+
+struct NGEventRecord {
+    uint64_t time_ns;   // steady_clock time of the first (oldest) merged event
+    uint16_t type;      // NGEventType
+    uint16_t id_len;
+    uint16_t text_len;
+    uint16_t merged;    // number of events folded into this record
+    int32_t x, y;       // latest position
+    int32_t dx, dy;     // accumulated relative motion
+    int32_t button;
+    int32_t reserved;
+};
+
+static_assert(sizeof(NGEventBatchHeader) == 16, "unexpected NGEventBatchHeader padding");
+static_assert(sizeof(NGEventRecord) == 40, "unexpected NGEventRecord padding");
+
+inline uint64_t ng_event_now_ns() {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Collects the events of one frame into an encoded batch
+class NGEventQueue {
+public:
+    NGEventQueue() { clear(); }
+
+    // Append an event, merging it into the last record when that is a drag
+    // of the same kind by the same widget. Only the last record can take
+    // more events, so records stay in the order their events happened
+    void push(uint16_t type, const char* id, size_t id_len, int32_t x, int32_t y,
+              int32_t dx = 0, int32_t dy = 0, int32_t button = 0,
+              const char* text = nullptr, size_t text_len = 0) {
+        if (id_len > UINT16_MAX) id_len = UINT16_MAX;
+        if (text_len > UINT16_MAX) text_len = UINT16_MAX;
+        m_pushed++;
+
+        if (m_open != SIZE_MAX && ng_event_mergeable(type)) {
+            NGEventRecord rec;
+            memcpy(&rec, m_buffer.data() + m_open, sizeof(rec));
+            if (rec.type == type && rec.button == button && rec.merged < UINT16_MAX &&
+                rec.id_len == id_len &&
+                memcmp(m_buffer.data() + m_open + sizeof(rec), id, id_len) == 0) {
+                rec.x = x;
+                rec.y = y;
+                rec.dx += dx;
+                rec.dy += dy;
+                rec.merged++;
+                memcpy(m_buffer.data() + m_open, &rec, sizeof(rec));
+                return;
+            }
+        }
+
+        NGEventRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.time_ns = ng_event_now_ns();
+        rec.type = type;
+        rec.id_len = (uint16_t) id_len;
+        rec.text_len = (uint16_t) text_len;
+        rec.merged = 1;
+        rec.x = x;
+        rec.y = y;
+        rec.dx = dx;
+        rec.dy = dy;
+        rec.button = button;
+
+        size_t offset = m_buffer.size();
+        m_buffer.resize(offset + sizeof(rec) + id_len + text_len);
+        uint8_t* out = m_buffer.data() + offset;
+        memcpy(out, &rec, sizeof(rec));
+        if (id_len) memcpy(out + sizeof(rec), id, id_len);
+        if (text_len) memcpy(out + sizeof(rec) + id_len, text, text_len);
+        m_count++;
+
+        // Any other record ends the run
+        m_open = ng_event_mergeable(type) ? offset : SIZE_MAX;
+    }
+
+    bool empty() const { return m_count == 0; }
+    uint32_t count() const { return m_count; }
+    uint64_t pushed() const { return m_pushed; }
+
+    // Finish the batch: fills in the header and hands the bytes over
+    // (the queue is left empty and ready for the next frame)
+    std::vector<uint8_t> take(uint32_t seq) {
+        NGEventBatchHeader header = { NG_EVENT_BATCH_MAGIC, (uint32_t) m_buffer.size(), m_count, seq };
+        memcpy(m_buffer.data(), &header, sizeof(header));
+        std::vector<uint8_t> batch;
+        batch.swap(m_buffer);
+        clear();
+        return batch;
+    }
+
+private:
+    void clear() {
+        m_buffer.clear();
+        m_buffer.resize(sizeof(NGEventBatchHeader));
+        m_open = SIZE_MAX;
+        m_count = 0;
+    }
+
+    std::vector<uint8_t> m_buffer;  // header placeholder + encoded records
+    size_t m_open = SIZE_MAX;       // offset of the last record if it can still merge
+    uint32_t m_count = 0;
+    uint64_t m_pushed = 0;
+};
+
+// Walk the records of a received batch. Returns false on a malformed batch.
+template <typename F>
+bool ng_event_decode(const uint8_t* data, size_t size, F&& visit) {
+    NGEventBatchHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != NG_EVENT_BATCH_MAGIC || header.size != size) return false;
+    size_t pos = sizeof(header);
+    for (uint32_t i = 0; i < header.count; ++i) {
+        NGEventRecord rec;
+        if (size - pos < sizeof(rec)) return false;
+        memcpy(&rec, data + pos, sizeof(rec));
+        pos += sizeof(rec);
+        if (size - pos < (size_t) rec.id_len + rec.text_len) return false;
+        const char* id = (const char*) data + pos;
+        const char* text = id + rec.id_len;
+        pos += (size_t) rec.id_len + rec.text_len;
+        visit(rec, id, text);
+    }
+    return pos == size;
+}
+
+// Unix domain socket sender. Batches are queued by the UI thread and written
+// by a background thread; if the runtime falls more than `max_pending` bytes
+// behind, new batches are dropped (and counted) instead of blocking the UI.
+class NGEventSocket {
+public:
+    explicit NGEventSocket(size_t max_pending = 4 * 1024 * 1024) : m_max_pending(max_pending) {}
+    ~NGEventSocket() { close(); }
+
+    // Connect to a runtime listening on `path`. Returns false on failure.
+    bool connect(const std::string& path) {
+#if defined(_WIN32)
+        (void) path;
+        return false;
+#else
+        close();
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) return false;
+        memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+#if defined(SO_NOSIGPIPE)
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        if (::connect(fd, (sockaddr*) &addr, sizeof(addr)) != 0) {
+            ::close(fd);
+            return false;
+        }
+        m_fd = fd;
+        m_running = true;
+        m_thread = std::thread([this]() { run(); });
+        return true;
+#endif
+    }
+
+    bool connected() const { return m_fd >= 0; }
+
+    // Queue one encoded batch for delivery
+    void send(std::vector<uint8_t>&& batch) {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            if (!m_running) return;
+            if (m_pending_bytes + batch.size() > m_max_pending) {
+                m_dropped++;
+                return;
+            }
+            m_pending_bytes += batch.size();
+            m_pending.push_back(std::move(batch));
+        }
+        m_cv.notify_one();
+    }
+
+    // Stop the sender thread. What is queued is still delivered if the
+    // runtime takes it within `linger_ms`; then the rest is dropped and a
+    // send() in progress is cut short by shutting the socket down, so a
+    // runtime that stopped reading cannot keep the UI from quitting
+    void close(int linger_ms = 250) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_running = false;
+            m_idle.wait_for(lock, std::chrono::milliseconds(linger_ms),
+                            [this]() { return m_pending.empty() && !m_sending; });
+            m_pending.clear();
+            m_pending_bytes = 0;
+        }
+        m_cv.notify_one();
+#if !defined(_WIN32)
+        if (m_fd >= 0)
+            ::shutdown(m_fd, SHUT_WR);
+#endif
+        if (m_thread.joinable())
+            m_thread.join();
+#if !defined(_WIN32)
+        if (m_fd >= 0)
+            ::close(m_fd);
+#endif
+        m_fd = -1;
+        m_pending.clear();
+        m_pending_bytes = 0;
+    }
+
+    uint64_t dropped() const { return m_dropped; }
+
+private:
+    void run() {
+#if !defined(_WIN32)
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_cv.wait(lock, [this]() { return !m_pending.empty() || !m_running; });
+            if (m_pending.empty())
+                return;
+            std::vector<uint8_t> batch = std::move(m_pending.front());
+            m_pending.pop_front();
+            m_pending_bytes -= batch.size();
+            m_sending = true;
+            lock.unlock();
+
+            size_t pos = 0;
+            while (pos < batch.size()) {
+#if defined(MSG_NOSIGNAL)
+                ssize_t n = ::send(m_fd, batch.data() + pos, batch.size() - pos, MSG_NOSIGNAL);
+#else
+                ssize_t n = ::send(m_fd, batch.data() + pos, batch.size() - pos, 0);
+#endif
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0) {
+                    // Runtime went away: stop sending, keep the UI running
+                    lock.lock();
+                    m_running = false;
+                    m_pending.clear();
+                    m_pending_bytes = 0;
+                    m_sending = false;
+                    m_idle.notify_all();
+                    return;
+                }
+                pos += (size_t) n;
+            }
+            lock.lock();
+            m_sending = false;
+            m_idle.notify_all();
+        }
+#endif
+    }
+
+    int m_fd = -1;
+    bool m_running = false;
+    bool m_sending = false;     // the sender thread is writing a batch
+    size_t m_max_pending;
+    size_t m_pending_bytes = 0;
+    std::atomic<uint64_t> m_dropped{0};
+    std::deque<std::vector<uint8_t>> m_pending;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_idle;     // a batch was written or sending stopped
+    std::thread m_thread;
+};
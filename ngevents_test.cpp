@@ -0,0 +1,239 @@
+// ngevents_test -- test client for the ngserver event transport (ngevents.h)
+//
+// Usage:
+//   ngevents_test listen <socket>                  print events sent by
+//                                                  `ngserver --events <socket>`
+//   ngevents_test bench [frames] [events_per_frame]  measure the transport
+//
+// The bench mode runs both ends in one process: a producer thread plays the
+// part of ngserver (a burst of drag, hover and click events per frame,
+// coalesced and batched by NGEventQueue, sent through NGEventSocket) and the
+// main thread receives, decodes and reports events/sec, batches/sec and
+// end-to-end latency from event creation to decode. It runs once flat out
+// (throughput; latency is then mostly queueing) and once paced at one frame
+// per millisecond (latency of an idle transport).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ngevents.h"
+
+#if defined(_WIN32)
+int main() {
+    fprintf(stderr, "ngevents_test: Unix domain sockets are not supported on this platform\n");
+    return 1;
+}
+#else
+
+using Clock = std::chrono::steady_clock;
+
+static int listen_on(const std::string& path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "socket path too long: %s\n", path.c_str());
+        return -1;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+        perror("listen");
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Read complete batches from a stream socket and pass each one to `handle`.
+// Returns when the peer closes the connection.
+template <typename F>
+static bool receive_batches(int fd, F&& handle) {
+    std::vector<uint8_t> buf(1 << 20);
+    size_t len = 0;
+    for (;;) {
+        if (len == buf.size())
+            buf.resize(buf.size() * 2);
+        ssize_t n = recv(fd, buf.data() + len, buf.size() - len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return len == 0;
+        len += (size_t) n;
+
+        size_t pos = 0;
+        while (len - pos >= sizeof(NGEventBatchHeader)) {
+            NGEventBatchHeader header;
+            memcpy(&header, buf.data() + pos, sizeof(header));
+            if (header.magic != NG_EVENT_BATCH_MAGIC || header.size < sizeof(header)) {
+                fprintf(stderr, "corrupt batch header\n");
+                return false;
+            }
+            if (len - pos < header.size) {
+                if (header.size > buf.size())
+                    buf.resize(header.size);
+                break;
+            }
+            if (!handle(buf.data() + pos, (size_t) header.size)) {
+                fprintf(stderr, "corrupt batch %u\n", header.seq);
+                return false;
+            }
+            pos += header.size;
+        }
+        memmove(buf.data(), buf.data() + pos, len - pos);
+        len -= pos;
+    }
+}
+
+static int run_listen(const std::string& path) {
+    int server = listen_on(path);
+    if (server < 0)
+        return 1;
+    printf("listening on %s\n", path.c_str());
+
+    for (;;) {
+        int fd = accept(server, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            break;
+        }
+        printf("ngserver connected\n");
+        receive_batches(fd, [](const uint8_t* data, size_t size) {
+            uint64_t now = ng_event_now_ns();
+            return ng_event_decode(data, size, [now](const NGEventRecord& rec, const char* id, const char* text) {
+                printf("%-12s id=%.*s pos=(%d,%d)", ng_event_type_name(rec.type),
+                       (int) rec.id_len, id, rec.x, rec.y);
+                if (ng_event_mergeable(rec.type))
+                    printf(" rel=(%d,%d) merged=%u", rec.dx, rec.dy, rec.merged);
+                if (rec.type == NG_EVENT_MOUSE_DOWN || rec.type == NG_EVENT_MOUSE_UP)
+                    printf(" button=%d", rec.button);
+                if (rec.text_len)
+                    printf(" text='%.*s'", (int) rec.text_len, text);
+                printf(" latency=%.1f us\n", (now - rec.time_ns) / 1000.0);
+            });
+        });
+        close(fd);
+        printf("ngserver disconnected\n");
+    }
+    close(server);
+    unlink(path.c_str());
+    return 0;
+}
+
+static int run_bench(int frames, int events_per_frame, int frame_interval_us) {
+    std::string path = "/tmp/ngevents_test." + std::to_string(getpid()) + ".sock";
+    int server = listen_on(path);
+    if (server < 0)
+        return 1;
+
+    // Producer: one NGEventQueue batch per simulated frame
+    uint64_t produced = 0, dropped = 0;
+    std::thread producer([&]() {
+        NGEventSocket socket;
+        if (!socket.connect(path)) {
+            fprintf(stderr, "producer: connect failed\n");
+            return;
+        }
+        NGEventQueue queue;
+        static const std::string ids[4] = { "main_window", "view_1", "slider_2", "canvas_3" };
+        static const std::string caption = "Hello World";
+        for (int frame = 0; frame < frames; ++frame) {
+            for (int i = 0; i < events_per_frame; ++i) {
+                const std::string& id = ids[(frame + i / 16) & 3];
+                int x = frame + i, y = 2 * i;
+                switch (i % 16) {
+                    case 0:  queue.push(NG_EVENT_MOUSE_ENTER, id.data(), id.size(), x, y); break;
+                    case 1:  queue.push(NG_EVENT_MOUSE_DOWN, id.data(), id.size(), x, y, 0, 0, 1); break;
+                    case 14: queue.push(NG_EVENT_MOUSE_UP, id.data(), id.size(), x, y, 0, 0, 1); break;
+                    case 15: queue.push(NG_EVENT_BUTTON_CLICK, id.data(), id.size(), x, y, 0, 0, 1,
+                                        caption.data(), caption.size()); break;
+                    default: queue.push(NG_EVENT_MOUSE_DRAG, id.data(), id.size(), x, y, 1, 2, 1); break;
+                }
+            }
+            socket.send(queue.take((uint32_t) frame));
+            if (frame_interval_us > 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(frame_interval_us));
+        }
+        socket.close();
+        produced = queue.pushed();
+        dropped = socket.dropped();
+    });
+
+    int fd = accept(server, nullptr, nullptr);
+    if (fd < 0) {
+        perror("accept");
+        producer.join();
+        close(server);
+        return 1;
+    }
+
+    uint64_t batches = 0, records = 0, events = 0, bytes = 0;
+    std::vector<float> latency_us;
+    latency_us.reserve((size_t) frames * 8);
+    auto start = Clock::now();
+    bool ok = receive_batches(fd, [&](const uint8_t* data, size_t size) {
+        uint64_t now = ng_event_now_ns();
+        batches++;
+        bytes += size;
+        return ng_event_decode(data, size, [&](const NGEventRecord& rec, const char*, const char*) {
+            records++;
+            events += rec.merged;
+            latency_us.push_back((float) ((now - rec.time_ns) / 1000.0));
+        });
+    });
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    producer.join();
+    close(fd);
+    close(server);
+    unlink(path.c_str());
+
+    if (!ok || latency_us.empty()) {
+        fprintf(stderr, "bench failed\n");
+        return 1;
+    }
+    std::sort(latency_us.begin(), latency_us.end());
+    auto pct = [&](double p) { return latency_us[(size_t) (p * (latency_us.size() - 1))]; };
+
+    if (frame_interval_us > 0)
+        printf("paced: %d frames, %d events/frame, one frame every %d us\n", frames, events_per_frame, frame_interval_us);
+    else
+        printf("flat out: %d frames, %d events/frame\n", frames, events_per_frame);
+    printf("  events   : %llu produced, %llu delivered in %llu records (%.1fx coalescing)\n",
+           (unsigned long long) produced, (unsigned long long) events, (unsigned long long) records,
+           records ? (double) events / records : 0.0);
+    if (dropped)
+        printf("  dropped  : %llu batches (receiver fell behind)\n", (unsigned long long) dropped);
+    printf("  rate     : %.0f events/s, %.0f batches/s, %.1f MB/s wire\n",
+           events / seconds, batches / seconds,
+           bytes / seconds / (1024.0 * 1024.0));
+    printf("  latency  : p50 %.1f us  p99 %.1f us  max %.1f us (oldest merged event to decode)\n",
+           pct(0.5), pct(0.99), latency_us.back());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && strcmp(argv[1], "listen") == 0)
+        return run_listen(argv[2]);
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        int frames = argc > 2 ? atoi(argv[2]) : 20000;
+        int events_per_frame = argc > 3 ? atoi(argv[3]) : 64;
+        if (frames > 0 && events_per_frame > 0) {
+            int status = run_bench(frames, events_per_frame, 0);
+            return status ? status : run_bench(std::min(frames, 2000), events_per_frame, 1000);
+        }
+    }
+    fprintf(stderr, "usage: %s listen <socket>\n"
+                    "       %s bench [frames] [events_per_frame]\n", argv[0], argv[0]);
+    return 1;
+}
+
+#endif
@@ -5,45 +5,96 @@
 #include <nanogui/label.h>
 #include <nanogui/button.h>
 #include <nanogui/widget.h>
+#include <nanogui/popupbutton.h>
+#include <nanogui/checkbox.h>
+#include <nanogui/textbox.h>
+#include <nanogui/textarea.h>
+#include <nanogui/slider.h>
+#include <nanogui/progressbar.h>
+#include <nanogui/combobox.h>
+#include <nanogui/menu.h>
+#include <nanogui/colorwheel.h>
+#include <nanogui/colorpicker.h>
+#include <nanogui/graph.h>
+#include <nanogui/imagepanel.h>
+#include <nanogui/imageview.h>
+#include <nanogui/scrollpanel.h>
+#include <nanogui/split.h>
+#include <nanogui/tabwidget.h>
+#include <nanogui/treeview.h>
+#include <nanogui/texture.h>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
 #include <fstream>
 #include <memory>
 #include <functional>
+#include <vector>
 #include <unordered_map>
+#include <thread>
+#include <atomic>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 // Include the dict.h for JSON parsing
 #include "dict.h"
+#include "dict_file.h"
+#include "ngevents.h"
 
 using namespace nanogui;
 
-// Event structure for runtime communication
+// Event structure for runtime communication. It only references the
+// widget's id and caption, so building one allocates nothing; the
+// references are valid for the duration of the callback.
 struct GuiEvent {
-    std::string id;
-    std::string type;
-    std::string data;
-    
-    GuiEvent(const std::string& id, const std::string& type, const std::string& data = "")
-        : id(id), type(type), data(data) {}
+    const std::string& id;
+    NGEventType type;
+    Vector2i pos;
+    Vector2i rel;
+    int button;
+    const std::string* text;
+
+    GuiEvent(const std::string& id, NGEventType type, const Vector2i& pos = Vector2i(0),
+             const Vector2i& rel = Vector2i(0), int button = 0, const std::string* text = nullptr)
+        : id(id), type(type), pos(pos), rel(rel), button(button), text(text) {}
+
+    const char* typeName() const { return ng_event_type_name(type); }
 };
 
 // Global event callback function - runtime can set this
 std::function<void(const GuiEvent&)> g_eventCallback = nullptr;
 
+// Socket transport to the runtime (see ngevents.h): events of one main loop
+// iteration are coalesced into a batch that is sent at the start of the next
+NGEventSocket g_eventSocket;
+NGEventQueue g_eventQueue;
+uint32_t g_eventBatchSeq = 0;
+
+void flushEventsToRuntime() {
+    if (!g_eventQueue.empty())
+        g_eventSocket.send(g_eventQueue.take(g_eventBatchSeq++));
+}
+
 // Helper function to send events to runtime
 void sendEventToRuntime(const GuiEvent& event) {
-    if (g_eventCallback) {
+    if (g_eventCallback)
         g_eventCallback(event);
-    } else {
-        // Default behavior - print to console
-		// TODO: Send events back to runtime
-		/*
-        std::cout << "Event: id='" << event.id << "', type='" << event.type << "'";
-        if (!event.data.empty()) {
-            std::cout << ", data='" << event.data << "'";
-        }
-        std::cout << std::endl;
-		*/
+
+    if (g_eventSocket.connected()) {
+        if (g_eventQueue.empty())
+            nanogui::async(flushEventsToRuntime);
+        g_eventQueue.push(event.type, event.id.data(), event.id.size(),
+                          event.pos.x(), event.pos.y(), event.rel.x(), event.rel.y(), event.button,
+                          event.text ? event.text->data() : nullptr, event.text ? event.text->size() : 0);
     }
 }
 
@@ -53,27 +104,19 @@ public:
     EventWidget(Widget* parent, const std::string& id) : Widget(parent), m_id(id) {}
     
     virtual bool mouse_enter_event(const Vector2i& p, bool enter) override {
-        if (enter) {
-            sendEventToRuntime(GuiEvent(m_id, "mouse_enter"));
-        } else {
-            sendEventToRuntime(GuiEvent(m_id, "mouse_leave"));
-        }
+        sendEventToRuntime(GuiEvent(m_id, enter ? NG_EVENT_MOUSE_ENTER : NG_EVENT_MOUSE_LEAVE, p));
         return Widget::mouse_enter_event(p, enter);
     }
     
     virtual bool mouse_button_event(const Vector2i& p, int button, bool down, int modifiers) override {
-        std::string eventType = down ? "mouse_down" : "mouse_up";
-        std::string data = "button=" + std::to_string(button) + ",x=" + std::to_string(p.x()) + ",y=" + std::to_string(p.y());
-        sendEventToRuntime(GuiEvent(m_id, eventType, data));
+        sendEventToRuntime(GuiEvent(m_id, down ? NG_EVENT_MOUSE_DOWN : NG_EVENT_MOUSE_UP, p, Vector2i(0), button));
         return Widget::mouse_button_event(p, button, down, modifiers);
     }
     
     virtual bool mouse_motion_event(const Vector2i& p, const Vector2i& rel, int button, int modifiers) override {
         // Only send motion events if a button is pressed (to avoid spam)
         if (button != 0) {
-            std::string data = "x=" + std::to_string(p.x()) + ",y=" + std::to_string(p.y()) + 
-                             ",dx=" + std::to_string(rel.x()) + ",dy=" + std::to_string(rel.y());
-            sendEventToRuntime(GuiEvent(m_id, "mouse_drag", data));
+            sendEventToRuntime(GuiEvent(m_id, NG_EVENT_MOUSE_DRAG, p, rel, button));
         }
         return Widget::mouse_motion_event(p, rel, button, modifiers);
     }
@@ -84,6 +127,29 @@ protected:
     std::string m_id;
 };
 
+// Report a value the user changed on widget `id`; see the *Text() helpers
+// below for how values are written
+void sendValueToRuntime(const std::string& id, const std::string& value) {
+    sendEventToRuntime(GuiEvent(id, NG_EVENT_VALUE_CHANGE, Vector2i(0), Vector2i(0), 0, &value));
+}
+
+std::string boolText(bool value) { return value ? "true" : "false"; }
+
+std::string numberText(double value) {
+    char str[32];
+    snprintf(str, sizeof(str), "%g", value);
+    return str;
+}
+
+// "#rrggbbaa", as the "color" property accepts it
+std::string colorText(const Color& color) {
+    char str[16];
+    auto byte = [](float c) { return (int) std::lround(std::min(std::max(c, 0.f), 1.f) * 255.f); };
+    snprintf(str, sizeof(str), "#%02x%02x%02x%02x", byte(color.r()), byte(color.g()), byte(color.b()),
+             byte(color.w()));
+    return str;
+}
+
 // Custom Button class with event support
 class EventButton : public Button {
 public:
@@ -91,23 +157,17 @@ public:
         : Button(parent, caption), m_id(id) {}
     
     virtual bool mouse_enter_event(const Vector2i& p, bool enter) override {
-        if (enter) {
-            sendEventToRuntime(GuiEvent(m_id, "mouse_enter"));
-        } else {
-            sendEventToRuntime(GuiEvent(m_id, "mouse_leave"));
-        }
+        sendEventToRuntime(GuiEvent(m_id, enter ? NG_EVENT_MOUSE_ENTER : NG_EVENT_MOUSE_LEAVE, p));
         return Button::mouse_enter_event(p, enter);
     }
     
     virtual bool mouse_button_event(const Vector2i& p, int button, bool down, int modifiers) override {
         // Send our custom button click event
         if (down && button == GLFW_MOUSE_BUTTON_1) {
-            sendEventToRuntime(GuiEvent(m_id, "button_click", caption()));
+            sendEventToRuntime(GuiEvent(m_id, NG_EVENT_BUTTON_CLICK, p, Vector2i(0), button, &caption()));
         }
         
-        std::string eventType = down ? "mouse_down" : "mouse_up";
-        std::string data = "button=" + std::to_string(button) + ",x=" + std::to_string(p.x()) + ",y=" + std::to_string(p.y());
-        sendEventToRuntime(GuiEvent(m_id, eventType, data));
+        sendEventToRuntime(GuiEvent(m_id, down ? NG_EVENT_MOUSE_DOWN : NG_EVENT_MOUSE_UP, p, Vector2i(0), button));
         
         return Button::mouse_button_event(p, button, down, modifiers);
     }
@@ -125,25 +185,17 @@ public:
         : Window(parent, title, resizable), m_id(id) {}
     
     virtual bool mouse_enter_event(const Vector2i& p, bool enter) override {
-        if (enter) {
-            sendEventToRuntime(GuiEvent(m_id, "mouse_enter"));
-        } else {
-            sendEventToRuntime(GuiEvent(m_id, "mouse_leave"));
-        }
+        sendEventToRuntime(GuiEvent(m_id, enter ? NG_EVENT_MOUSE_ENTER : NG_EVENT_MOUSE_LEAVE, p));
         return Window::mouse_enter_event(p, enter);
     }
     
     virtual bool mouse_button_event(const Vector2i& p, int button, bool down, int modifiers) override {
-        std::string eventType = down ? "mouse_down" : "mouse_up";
-        std::string data = "button=" + std::to_string(button) + ",x=" + std::to_string(p.x()) + ",y=" + std::to_string(p.y());
-        sendEventToRuntime(GuiEvent(m_id, eventType, data));
+        sendEventToRuntime(GuiEvent(m_id, down ? NG_EVENT_MOUSE_DOWN : NG_EVENT_MOUSE_UP, p, Vector2i(0), button));
         return Window::mouse_button_event(p, button, down, modifiers);
     }
     
     virtual bool mouse_drag_event(const Vector2i& p, const Vector2i& rel, int button, int modifiers) override {
-        std::string data = "x=" + std::to_string(p.x()) + ",y=" + std::to_string(p.y()) + 
-                         ",dx=" + std::to_string(rel.x()) + ",dy=" + std::to_string(rel.y());
-        sendEventToRuntime(GuiEvent(m_id, "window_drag", data));
+        sendEventToRuntime(GuiEvent(m_id, NG_EVENT_WINDOW_DRAG, p, rel, button));
         return Window::mouse_drag_event(p, rel, button, modifiers);
     }
 
@@ -164,22 +216,16 @@ public:
         : Label(parent, caption), m_id(id) {}
     
     virtual bool mouse_enter_event(const Vector2i& p, bool enter) override {
-        if (enter) {
-            sendEventToRuntime(GuiEvent(m_id, "mouse_enter"));
-        } else {
-            sendEventToRuntime(GuiEvent(m_id, "mouse_leave"));
-        }
+        sendEventToRuntime(GuiEvent(m_id, enter ? NG_EVENT_MOUSE_ENTER : NG_EVENT_MOUSE_LEAVE, p));
         return Label::mouse_enter_event(p, enter);
     }
     
     virtual bool mouse_button_event(const Vector2i& p, int button, bool down, int modifiers) override {
         if (down && button == GLFW_MOUSE_BUTTON_1) {
-            sendEventToRuntime(GuiEvent(m_id, "label_click", caption()));
+            sendEventToRuntime(GuiEvent(m_id, NG_EVENT_LABEL_CLICK, p, Vector2i(0), button, &caption()));
         }
         
-        std::string eventType = down ? "mouse_down" : "mouse_up";
-        std::string data = "button=" + std::to_string(button) + ",x=" + std::to_string(p.x()) + ",y=" + std::to_string(p.y());
-        sendEventToRuntime(GuiEvent(m_id, eventType, data));
+        sendEventToRuntime(GuiEvent(m_id, down ? NG_EVENT_MOUSE_DOWN : NG_EVENT_MOUSE_UP, p, Vector2i(0), button));
         
         return Label::mouse_button_event(p, button, down, modifiers);
     }
@@ -194,172 +240,1199 @@ class JsonGuiApplication : public Screen {
 private:
 	EventWindow* m_rootWindow = nullptr;
 
+    // Incremental parser for UI descriptions streamed in from the runtime
+    DictJsonStream m_stream;
+
+    // Reader thread feeding m_stream (see startStreamReader()). Callbacks it
+    // posts to the main thread check m_alive, which the destructor clears
+    std::thread m_streamReader;
+    std::shared_ptr<std::atomic<bool>> m_alive = std::make_shared<std::atomic<bool>>(true);
+#if !defined(_WIN32)
+    int m_streamWake[2] = { -1, -1 };   // written to by the destructor to stop the reader
+#endif
+
+    struct WidgetFactory;
+
+    // What the registry knows about a live widget: its id (pointing at the
+    // registry's own key, so removed subtrees can be unregistered) and the
+    // factory it was built with, which patches dispatch through
+    struct WidgetEntry {
+        const std::string* id;
+        const WidgetFactory* factory;
+    };
+
+    // id -> widget registry for patches, and the reverse mapping
+    std::unordered_map<std::string, Widget*> m_widgetsById;
+    std::unordered_map<const Widget*, WidgetEntry> m_widgetEntries;
+
+    void registerWidget(const std::string& id, Widget* widget, const WidgetFactory* factory) {
+        auto result = m_widgetsById.emplace(id, widget);
+        m_widgetEntries[widget] = WidgetEntry{ &result.first->first, factory };
+    }
+
+    void unregisterSubtree(Widget* widget) {
+        for (Widget* child : widget->children())
+            unregisterSubtree(child);
+        auto it = m_widgetEntries.find(widget);
+        if (it != m_widgetEntries.end()) {
+            if (it->second.factory->dispose)
+                it->second.factory->dispose(*this, widget);
+            m_widgetsById.erase(*it->second.id);
+            m_widgetEntries.erase(it);
+        }
+        // Don't leave dangling focus/drag pointers in the screen
+        notify_widget_destroyed(widget);
+    }
+
+    Widget* findWidget(const std::string& id) const {
+        auto it = m_widgetsById.find(id);
+        return it != m_widgetsById.end() ? it->second : nullptr;
+    }
+
+    // Factory of a registered widget (nullptr for the screen and for
+    // internal containers such as a PopupButton's popup)
+    const WidgetFactory* factoryOf(const Widget* widget) const {
+        auto it = m_widgetEntries.find(widget);
+        return it != m_widgetEntries.end() ? it->second.factory : nullptr;
+    }
+
     // Extract and validate ID from JSON object
     std::string extractId(DictValue* jsonObj) {
         DictValue* idVal = dict_object_get(jsonObj, "id");
         if (!idVal || idVal->type != DICT_STRING) {
             throw std::runtime_error("Missing mandatory 'id' field in widget definition");
         }
-        
+
         std::string id = idVal->string_value;
         if (id.empty()) {
             throw std::runtime_error("Widget 'id' field cannot be empty");
         }
-        
+
         return id;
     }
-    
-    // Widget factory to create widgets based on JSON type
-    Widget* createWidgetFromJson(DictValue* jsonObj, Widget* parent) {
+
+    // --- Widget registry ---
+    //
+    // Widget types and property keys are interned in the hash tables below:
+    // building a widget costs one lookup for its type and one per key of its
+    // description, after which everything dispatches through the factory's
+    // function pointers and a switch on WidgetProp.
+
+    enum class WidgetProp : uint8_t {
+        Unknown,
+        // Read by the constructors and the tree builder, never set afterwards
+        Id, Type, Children, RootWindow, Tab, Scroll, Orientation, Mode,
+        // Settable properties (also through "set" patches)
+        Layout, Tooltip, Visible, Enabled, Width, Height, FontSize,
+        Caption, Title, Font, Color, BackgroundColor, TextColor, Icon, Toggle,
+        Pushed, Resizable, Modal, Checked, Value, Min, Max, Items, Selected,
+        Editable, Spinnable, Placeholder, Units, Format, Header, Footer, Values,
+        Image, Images
+    };
+
+    static WidgetProp propertyFor(const char* key) {
+        static const std::unordered_map<std::string_view, WidgetProp> props = {
+            { "id", WidgetProp::Id }, { "type", WidgetProp::Type },
+            { "children", WidgetProp::Children }, { "rootWindow", WidgetProp::RootWindow },
+            { "tab", WidgetProp::Tab }, { "scroll", WidgetProp::Scroll },
+            { "orientation", WidgetProp::Orientation }, { "mode", WidgetProp::Mode },
+            { "layout", WidgetProp::Layout }, { "tooltip", WidgetProp::Tooltip },
+            { "visible", WidgetProp::Visible }, { "enabled", WidgetProp::Enabled },
+            { "width", WidgetProp::Width }, { "height", WidgetProp::Height },
+            { "font_size", WidgetProp::FontSize },
+            { "caption", WidgetProp::Caption }, { "label", WidgetProp::Caption }, { "text", WidgetProp::Caption },
+            { "title", WidgetProp::Title }, { "font", WidgetProp::Font }, { "color", WidgetProp::Color },
+            { "background_color", WidgetProp::BackgroundColor }, { "text_color", WidgetProp::TextColor },
+            { "icon", WidgetProp::Icon }, { "toggle", WidgetProp::Toggle }, { "pushed", WidgetProp::Pushed },
+            { "resizable", WidgetProp::Resizable }, { "modal", WidgetProp::Modal },
+            { "checked", WidgetProp::Checked }, { "value", WidgetProp::Value },
+            { "min", WidgetProp::Min }, { "max", WidgetProp::Max },
+            { "items", WidgetProp::Items }, { "selected", WidgetProp::Selected },
+            { "editable", WidgetProp::Editable }, { "spinnable", WidgetProp::Spinnable },
+            { "placeholder", WidgetProp::Placeholder }, { "units", WidgetProp::Units },
+            { "format", WidgetProp::Format }, { "header", WidgetProp::Header },
+            { "footer", WidgetProp::Footer }, { "values", WidgetProp::Values },
+            { "image", WidgetProp::Image }, { "images", WidgetProp::Images },
+        };
+        auto it = props.find(key);
+        return it != props.end() ? it->second : WidgetProp::Unknown;
+    }
+
+    // Properties that only change how a widget is drawn, not its size
+    static bool propAffectsLayout(WidgetProp prop) {
+        switch (prop) {
+            case WidgetProp::Tooltip: case WidgetProp::Enabled: case WidgetProp::Color:
+            case WidgetProp::BackgroundColor: case WidgetProp::TextColor: case WidgetProp::Toggle:
+            case WidgetProp::Pushed: case WidgetProp::Resizable: case WidgetProp::Modal:
+            case WidgetProp::Checked: case WidgetProp::Min: case WidgetProp::Max:
+            case WidgetProp::Editable: case WidgetProp::Spinnable: case WidgetProp::Values:
+                return false;
+            default:
+                return true;
+        }
+    }
+
+    struct WidgetFactory {
+        // Construct the widget; constructor-only arguments come from `desc`
+        Widget* (*create)(JsonGuiApplication& app, Widget* parent, const std::string& id, DictValue* desc);
+        // Apply one property. Returns false if the type doesn't support it
+        // (or the value has the wrong type).
+        bool (*set)(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val);
+        // Optional: the widget children are actually added to
+        Widget* (*container)(Widget* widget) = nullptr;
+        // Optional: hooks run when `child` becomes / stops being a child at
+        // `index` of the container (TabWidget tabs)
+        void (*adopt)(Widget* widget, Widget* child, const std::string& caption, int index) = nullptr;
+        void (*release)(Widget* widget, Widget* child) = nullptr;
+        // Optional: free what the setters allocated for the widget, run when
+        // it is removed (not at shutdown, where the NanoVG context goes first)
+        void (*dispose)(JsonGuiApplication& app, Widget* widget) = nullptr;
+    };
+
+    static bool numberValue(const DictValue* val, double& out) {
+        if (val->type == DICT_NUMBER) { out = val->number_value; return true; }
+        if (val->type == DICT_INT64) { out = (double) val->int64_value; return true; }
+        return false;
+    }
+
+    static const char* stringValue(const DictValue* val) {
+        return val->type == DICT_STRING ? val->string_value : nullptr;
+    }
+
+    // "#rrggbb", "#rrggbbaa" or [r, g, b(, a)] with components in 0..1
+    static bool colorValue(const DictValue* val, Color& out) {
+        if (val->type == DICT_STRING) {
+            const char* str = val->string_value;
+            size_t len = strlen(str);
+            if (str[0] != '#' || (len != 7 && len != 9))
+                return false;
+            int rgba[4] = { 0, 0, 0, 255 };
+            for (size_t i = 0; i < (len - 1) / 2; i++) {
+                char hex[3] = { str[1 + 2 * i], str[2 + 2 * i], 0 };
+                char* end = nullptr;
+                rgba[i] = (int) strtol(hex, &end, 16);
+                if (*end)
+                    return false;
+            }
+            out = Color(rgba[0], rgba[1], rgba[2], rgba[3]);
+            return true;
+        }
+        if (val->type == DICT_ARRAY && (val->array_value.length == 3 || val->array_value.length == 4)) {
+            float rgba[4] = { 0.f, 0.f, 0.f, 1.f };
+            for (size_t i = 0; i < val->array_value.length; i++) {
+                double num;
+                if (!numberValue(val->array_value.items[i], num))
+                    return false;
+                rgba[i] = (float) num;
+            }
+            out = Color(rgba[0], rgba[1], rgba[2], rgba[3]);
+            return true;
+        }
+        return false;
+    }
+
+    static bool stringList(const DictValue* val, std::vector<std::string>& out) {
+        if (val->type != DICT_ARRAY)
+            return false;
+        out.clear();
+        for (size_t i = 0; i < val->array_value.length; i++) {
+            const char* str = stringValue(val->array_value.items[i]);
+            if (!str)
+                return false;
+            out.push_back(str);
+        }
+        return true;
+    }
+
+    static bool floatList(const DictValue* val, std::vector<float>& out) {
+        if (val->type != DICT_ARRAY)
+            return false;
+        out.clear();
+        for (size_t i = 0; i < val->array_value.length; i++) {
+            double num;
+            if (!numberValue(val->array_value.items[i], num))
+                return false;
+            out.push_back((float) num);
+        }
+        return true;
+    }
+
+    static int intParam(const DictValue* obj, const char* key, int fallback) {
+        DictValue* val = obj && obj->type == DICT_OBJECT ? dict_object_get(obj, key) : nullptr;
+        double num;
+        return val && numberValue(val, num) ? (int) num : fallback;
+    }
+
+    // Position of the string value of `key` in `names`, or `fallback` if the
+    // key is absent or holds something else
+    static int enumParam(const DictValue* obj, const char* key,
+                         std::initializer_list<const char*> names, int fallback) {
+        DictValue* val = obj && obj->type == DICT_OBJECT ? dict_object_get(obj, key) : nullptr;
+        if (!val || val->type != DICT_STRING)
+            return fallback;
+        int index = 0;
+        for (const char* name : names) {
+            if (strcmp(name, val->string_value) == 0)
+                return index;
+            index++;
+        }
+        std::cout << "Warning: Unknown " << key << " '" << val->string_value << "'" << std::endl;
+        return fallback;
+    }
+
+    // --- Layout registry ---
+    //
+    // "layout" is a layout name, or an object {"type": name, ...} whose other
+    // keys are that layout's parameters (margin, spacing, alignment, ...).
+
+    using LayoutFactory = Layout* (*)(const DictValue* spec);
+
+    static Alignment alignmentParam(const DictValue* spec, Alignment fallback) {
+        return (Alignment) enumParam(spec, "alignment", { "minimum", "middle", "maximum", "fill" }, (int) fallback);
+    }
+
+    static nanogui::Orientation orientationParam(const DictValue* spec, nanogui::Orientation fallback) {
+        return (nanogui::Orientation) enumParam(spec, "orientation", { "horizontal", "vertical" }, (int) fallback);
+    }
+
+    static std::vector<int> intListParam(const DictValue* spec, const char* key) {
+        std::vector<int> out;
+        DictValue* val = spec && spec->type == DICT_OBJECT ? dict_object_get(spec, key) : nullptr;
+        if (val && val->type == DICT_ARRAY) {
+            for (size_t i = 0; i < val->array_value.length; i++) {
+                double num;
+                if (numberValue(val->array_value.items[i], num))
+                    out.push_back((int) num);
+            }
+        }
+        return out;
+    }
+
+    static Layout* createLayout(const DictValue* val) {
+        static const std::unordered_map<std::string_view, LayoutFactory> layouts = {
+            { "GroupLayout", [](const DictValue* s) -> Layout* {
+                return new GroupLayout(intParam(s, "margin", 15), intParam(s, "spacing", 6),
+                                       intParam(s, "group_spacing", 14), intParam(s, "group_indent", 20));
+            } },
+            { "VBoxLayout", [](const DictValue* s) -> Layout* {
+                return new BoxLayout(nanogui::Orientation::Vertical, alignmentParam(s, Alignment::Middle),
+                                     intParam(s, "margin", 0), intParam(s, "spacing", 0));
+            } },
+            { "HBoxLayout", [](const DictValue* s) -> Layout* {
+                return new BoxLayout(nanogui::Orientation::Horizontal, alignmentParam(s, Alignment::Middle),
+                                     intParam(s, "margin", 0), intParam(s, "spacing", 0));
+            } },
+            { "BoxLayout", [](const DictValue* s) -> Layout* {
+                return new BoxLayout(orientationParam(s, nanogui::Orientation::Vertical),
+                                     alignmentParam(s, Alignment::Middle),
+                                     intParam(s, "margin", 0), intParam(s, "spacing", 0));
+            } },
+            { "GridLayout", [](const DictValue* s) -> Layout* {
+                return new GridLayout(orientationParam(s, nanogui::Orientation::Horizontal),
+                                      intParam(s, "columns", intParam(s, "resolution", 2)),
+                                      alignmentParam(s, Alignment::Middle),
+                                      intParam(s, "margin", 0), intParam(s, "spacing", 0));
+            } },
+            { "AdvancedGridLayout", [](const DictValue* s) -> Layout* {
+                return new AdvancedGridLayout(intListParam(s, "columns"), intListParam(s, "rows"),
+                                              intParam(s, "margin", 0));
+            } },
+            { "FlexLayout", [](const DictValue* s) -> Layout* {
+                FlexLayout* layout = new FlexLayout(
+                    (FlexDirection) enumParam(s, "direction", { "row", "row-reverse", "column", "column-reverse" }, 0),
+                    (JustifyContent) enumParam(s, "justify", { "flex-start", "flex-end", "center", "space-between",
+                                                               "space-around", "space-evenly" }, 0),
+                    (AlignItems) enumParam(s, "align_items", { "flex-start", "flex-end", "center", "stretch",
+                                                               "baseline" }, 3),
+                    intParam(s, "margin", 0), intParam(s, "gap", 0));
+                layout->set_flex_wrap((FlexWrap) enumParam(s, "wrap", { "nowrap", "wrap", "wrap-reverse" }, 0));
+                layout->set_align_content((AlignContent) enumParam(s, "align_content", { "flex-start", "flex-end", "center",
+                                                                         "space-between", "space-around",
+                                                                         "space-evenly", "stretch" }, 6));
+                return layout;
+            } },
+        };
+
+        const char* type = stringValue(val);
+        if (val->type == DICT_OBJECT) {
+            DictValue* typeVal = dict_object_get(val, "type");
+            type = typeVal ? stringValue(typeVal) : nullptr;
+        }
+        if (!type)
+            return nullptr;
+        auto it = layouts.find(type);
+        if (it == layouts.end()) {
+            if (strcmp(type, "default") != 0)
+                std::cout << "Warning: Unknown layout type '" << type << "', using GroupLayout" << std::endl;
+            return new GroupLayout();
+        }
+        return it->second(val->type == DICT_OBJECT ? val : nullptr);
+    }
+
+    // --- Property setters, one per widget class; each falls back to its
+    // base class's setter ---
+
+    static bool setCommon(JsonGuiApplication&, Widget* widget, WidgetProp prop, const DictValue* val) {
+        double num;
+        switch (prop) {
+            case WidgetProp::Layout: {
+                Layout* layout = createLayout(val);
+                if (!layout)
+                    return false;
+                widget->set_layout(layout);
+                return true;
+            }
+            case WidgetProp::Tooltip:
+                if (!stringValue(val)) return false;
+                widget->set_tooltip(val->string_value);
+                return true;
+            case WidgetProp::Visible:
+                if (val->type != DICT_BOOL) return false;
+                widget->set_visible(val->bool_value != 0);
+                return true;
+            case WidgetProp::Enabled:
+                if (val->type != DICT_BOOL) return false;
+                widget->set_enabled(val->bool_value != 0);
+                return true;
+            case WidgetProp::Width:
+                if (!numberValue(val, num)) return false;
+                widget->set_fixed_width((int) num);
+                return true;
+            case WidgetProp::Height:
+                if (!numberValue(val, num)) return false;
+                widget->set_fixed_height((int) num);
+                return true;
+            case WidgetProp::FontSize:
+                if (!numberValue(val, num)) return false;
+                widget->set_font_size((int) num);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static bool setWindow(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        Window* window = static_cast<Window*>(widget);
+        switch (prop) {
+            case WidgetProp::Title:
+                if (!stringValue(val)) return false;
+                window->set_title(val->string_value);
+                return true;
+            case WidgetProp::Resizable:
+                if (val->type != DICT_BOOL) return false;
+                window->set_resizable(val->bool_value != 0);
+                return true;
+            case WidgetProp::Modal:
+                if (val->type != DICT_BOOL) return false;
+                window->set_modal(val->bool_value != 0);
+                return true;
+            case WidgetProp::Width:
+            case WidgetProp::Height:
+                // The root window always covers the screen
+                if (widget == app.m_rootWindow)
+                    return true;
+                return setCommon(app, widget, prop, val);
+            default:
+                return setCommon(app, widget, prop, val);
+        }
+    }
+
+    static bool setLabel(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        Label* label = static_cast<Label*>(widget);
+        Color color;
+        switch (prop) {
+            case WidgetProp::Caption:
+                if (!stringValue(val)) return false;
+                label->set_caption(val->string_value);
+                return true;
+            case WidgetProp::Font:
+                if (!stringValue(val)) return false;
+                label->set_font(val->string_value);
+                return true;
+            case WidgetProp::Color:
+                if (!colorValue(val, color)) return false;
+                label->set_color(color);
+                return true;
+            default:
+                return setCommon(app, widget, prop, val);
+        }
+    }
+
+    static bool setButton(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        Button* button = static_cast<Button*>(widget);
+        Color color;
+        double num;
+        switch (prop) {
+            case WidgetProp::Caption:
+                if (!stringValue(val)) return false;
+                button->set_caption(val->string_value);
+                return true;
+            case WidgetProp::Icon:
+                if (!numberValue(val, num)) return false;
+                button->set_icon((int) num);
+                return true;
+            case WidgetProp::Toggle:
+                if (val->type != DICT_BOOL) return false;
+                button->set_flags(val->bool_value ? Button::ToggleButton : Button::NormalButton);
+                return true;
+            case WidgetProp::Pushed:
+                if (val->type != DICT_BOOL) return false;
+                button->set_pushed(val->bool_value != 0);
+                return true;
+            case WidgetProp::BackgroundColor:
+                if (!colorValue(val, color)) return false;
+                button->set_background_color(color);
+                return true;
+            case WidgetProp::TextColor:
+                if (!colorValue(val, color)) return false;
+                button->set_text_color(color);
+                return true;
+            default:
+                return setCommon(app, widget, prop, val);
+        }
+    }
+
+    static bool setCheckBox(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        CheckBox* checkbox = static_cast<CheckBox*>(widget);
+        switch (prop) {
+            case WidgetProp::Caption:
+                if (!stringValue(val)) return false;
+                checkbox->set_caption(val->string_value);
+                return true;
+            case WidgetProp::Checked:
+                if (val->type != DICT_BOOL) return false;
+                checkbox->set_checked(val->bool_value != 0);
+                return true;
+            default:
+                return setCommon(app, widget, prop, val);
+        }
+    }
+
+    static bool setTextBox(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        TextBox* textbox = static_cast<TextBox*>(widget);
+        double num;
+        switch (prop) {
+            case WidgetProp::Value:
+                if (stringValue(val)) {
+                    textbox->set_value(val->string_value);
+                } else if (numberValue(val, num)) {
+                    char str[32];
+                    snprintf(str, sizeof(str), "%g", num);
+                    textbox->set_value(str);
+                } else {
+                    return false;
+                }
+                return true;
+            case WidgetProp::Editable:
+                if (val->type != DICT_BOOL) return false;
+                textbox->set_editable(val->bool_value != 0);
+                return true;
+            case WidgetProp::Spinnable:
+                if (val->type != DICT_BOOL) return false;
+                textbox->set_spinnable(val->bool_value != 0);
+                return true;
+            case WidgetProp::Placeholder:
+                if (!stringValue(val)) return false;
+                textbox->set_placeholder(val->string_value);
+                return true;
+            case WidgetProp::Units:
+                if (!stringValue(val)) return false;
+                textbox->set_units(val->string_value);
+                return true;
+            case WidgetProp::Format:
+                if (!stringValue(val)) return false;
+                textbox->set_format(val->string_value);
+                return true;
+            default:
+                return setCommon(app, widget, prop, val);
+        }
+    }
+
+    // IntBox<int> and FloatBox<float>
+    template <typename Box>
+    static bool setNumberBox(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        Box* box = static_cast<Box*>(widget);
+        double num;
+        if (prop == WidgetProp::Value || prop == WidgetProp::Min || prop == WidgetProp::Max) {
+            if (!numberValue(val, num))
+                return prop == WidgetProp::Value && setTextBox(app, widget, prop, val);
+            if (prop == WidgetProp::Value)
+                box->set_value(static_cast<decltype(box->value())>(num));
+            else if (prop == WidgetProp::Min)
+                box->set_min_value(static_cast<decltype(box->value())>(num));
+            else
+                box->set_max_value(static_cast<decltype(box->value())>(num));
+            return true;
+        }
+        return setTextBox(app, widget, prop, val);
+    }
+
+    static bool setTextArea(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        TextArea* area = static_cast<TextArea*>(widget);
+        Color color;
+        switch (prop) {
+            case WidgetProp::Caption:
+                if (!stringValue(val)) return false;
+                area->clear();
+                area->append(val->string_value);
+                return true;
+            case WidgetProp::Font:
+                if (!stringValue(val)) return false;
+                area->set_font(val->string_value);
+                return true;
+            case WidgetProp::TextColor:
+                if (!colorValue(val, color)) return false;
+                area->set_foreground_color(color);
+                return true;
+            case WidgetProp::BackgroundColor:
+                if (!colorValue(val, color)) return false;
+                area->set_background_color(color);
+                return true;
+            default:
+                return setCommon(app, widget, prop, val);
+        }
+    }
+
+    static bool setSlider(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        Slider* slider = static_cast<Slider*>(widget);
+        double num;
+        switch (prop) {
+            case WidgetProp::Value:
+                if (!numberValue(val, num)) return false;
+                slider->set_value((float) num);
+                return true;
+            case WidgetProp::Min:
+                if (!numberValue(val, num)) return false;
+                slider->set_range({ (float) num, slider->range().second });
+                return true;
+            case WidgetProp::Max:
+                if (!numberValue(val, num)) return false;
+                slider->set_range({ slider->range().first, (float) num });
+                return true;
+            default:
+                return setCommon(app, widget, prop, val);
+        }
+    }
+
+    static bool setProgressBar(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        double num;
+        if (prop == WidgetProp::Value) {
+            if (!numberValue(val, num)) return false;
+            static_cast<ProgressBar*>(widget)->set_value((float) num);
+            return true;
+        }
+        return setCommon(app, widget, prop, val);
+    }
+
+    static bool setComboBox(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        ComboBox* combo = static_cast<ComboBox*>(widget);
+        std::vector<std::string> items;
+        double num;
+        switch (prop) {
+            case WidgetProp::Items:
+                if (!stringList(val, items)) return false;
+                combo->set_items(items);
+                return true;
+            case WidgetProp::Selected:
+                if (!numberValue(val, num)) return false;
+                if (num >= 0 && num < (double) combo->items().size())
+                    combo->set_selected_index((int) num);
+                return true;
+            default:
+                return setButton(app, widget, prop, val);
+        }
+    }
+
+    static bool setDropdown(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        Dropdown* dropdown = static_cast<Dropdown*>(widget);
+        double num;
+        if (prop == WidgetProp::Selected) {
+            if (!numberValue(val, num)) return false;
+            if (num >= 0 && num < (double) dropdown->popup()->child_count())
+                dropdown->set_selected_index((int) num);
+            return true;
+        }
+        return setButton(app, widget, prop, val);
+    }
+
+    static bool setColorWheel(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        Color color;
+        if (prop == WidgetProp::Color) {
+            if (!colorValue(val, color)) return false;
+            static_cast<ColorWheel*>(widget)->set_color(color);
+            return true;
+        }
+        return setCommon(app, widget, prop, val);
+    }
+
+    static bool setColorPicker(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        Color color;
+        if (prop == WidgetProp::Color) {
+            if (!colorValue(val, color)) return false;
+            static_cast<ColorPicker*>(widget)->set_color(color);
+            return true;
+        }
+        return setButton(app, widget, prop, val);
+    }
+
+    static bool setGraph(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        Graph* graph = static_cast<Graph*>(widget);
+        Color color;
+        std::vector<float> values;
+        switch (prop) {
+            case WidgetProp::Caption:
+                if (!stringValue(val)) return false;
+                graph->set_caption(val->string_value);
+                return true;
+            case WidgetProp::Header:
+                if (!stringValue(val)) return false;
+                graph->set_header(val->string_value);
+                return true;
+            case WidgetProp::Footer:
+                if (!stringValue(val)) return false;
+                graph->set_footer(val->string_value);
+                return true;
+            case WidgetProp::Values:
+                if (!floatList(val, values)) return false;
+                graph->set_values(values);
+                return true;
+            case WidgetProp::Color:
+                if (!colorValue(val, color)) return false;
+                graph->set_stroke_color(color);
+                return true;
+            case WidgetProp::BackgroundColor:
+                if (!colorValue(val, color)) return false;
+                graph->set_background_color(color);
+                return true;
+            case WidgetProp::TextColor:
+                if (!colorValue(val, color)) return false;
+                graph->set_text_color(color);
+                return true;
+            default:
+                return setCommon(app, widget, prop, val);
+        }
+    }
+
+    static bool setTabWidget(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        TabWidget* tabs = static_cast<TabWidget*>(widget);
+        double num;
+        if (prop == WidgetProp::Selected) {
+            if (!numberValue(val, num)) return false;
+            if (num >= 0 && num < tabs->tab_count())
+                tabs->set_selected_index((int) num);
+            return true;
+        }
+        return setCommon(app, widget, prop, val);
+    }
+
+    // "items": {"root": {"child": {"grandchild": {}}, "leaf": {}}}, a single
+    // root; each key is a node's name and caption and must be unique in the
+    // tree. Clicking a node sends a button_click with the node's name.
+    static bool addTreeNodes(NanoTree* tree, const std::string& parent, const DictValue* children,
+                             const std::string& id) {
+        if (children->type != DICT_OBJECT)
+            return false;
+        for (size_t i = 0; i < children->object_value.count; i++) {
+            std::string key = children->object_value.pairs[i].key;
+            if (tree->add_node(parent, key) != NanoTree::NanoTreeErrors::NoError)
+                return false;
+            initTreeNode(tree->Objects[key], id);
+            if (!addTreeNodes(tree, key, children->object_value.pairs[i].value, id))
+                return false;
+        }
+        return true;
+    }
+
+    static void initTreeNode(NanoTree::NanoTreeNode* node, const std::string& id) {
+        std::string key = node->KeyString;
+        node->Name = key;
+        node->CallBack = [id, key]() {
+            sendEventToRuntime(GuiEvent(id, NG_EVENT_BUTTON_CLICK, Vector2i(0), Vector2i(0),
+                                        GLFW_MOUSE_BUTTON_1, &key));
+        };
+    }
+
+    // NanoTree leaves its nodes to the owner
+    static void deleteTreeNodes(NanoTree* tree) {
+        if (!tree)
+            return;
+        for (auto& node : tree->Objects)
+            delete node.second;
+        tree->Objects.clear();
+        tree->Root = nullptr;
+    }
+
+    static bool setTreeView(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        if (prop != WidgetProp::Items)
+            return setCommon(app, widget, prop, val);
+        if (val->type != DICT_OBJECT || val->object_value.count != 1)
+            return false;
+        const std::string& id = *app.m_widgetEntries[widget].id;
+        NanoTree* items = new NanoTree();
+        std::string root = val->object_value.pairs[0].key;
+        items->set_root(root);
+        items->Objects[root]->Expanded = true;
+        initTreeNode(items->Objects[root], id);
+        if (!addTreeNodes(items, root, val->object_value.pairs[0].value, id)) {
+            deleteTreeNodes(items);
+            delete items;
+            return false;
+        }
+        // set_items() deletes the previous tree, but not its nodes
+        TreeView* tree = static_cast<TreeView*>(widget);
+        deleteTreeNodes(tree->items());
+        tree->set_items(items);
+        return true;
+    }
+
+    // "image": path of the picture to show
+    static bool setImageView(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        if (prop != WidgetProp::Image)
+            return setCommon(app, widget, prop, val);
+        if (!stringValue(val))
+            return false;
+        // Throws if the file cannot be loaded
+        static_cast<ImageView*>(widget)->set_image(new Texture(val->string_value,
+            Texture::InterpolationMode::Trilinear, Texture::InterpolationMode::Nearest));
+        return true;
+    }
+
+    // "images": paths of the thumbnails; clicking one sends a button_click
+    // with its path. The NanoVG images belong to the panel.
+    static bool setImagePanel(JsonGuiApplication& app, Widget* widget, WidgetProp prop, const DictValue* val) {
+        if (prop != WidgetProp::Images)
+            return setCommon(app, widget, prop, val);
+        std::vector<std::string> paths;
+        if (!stringList(val, paths))
+            return false;
+        ImagePanel::Images images;
+        for (const std::string& path : paths) {
+            int handle = nvgCreateImage(app.nvg_context(), path.c_str(), 0);
+            if (!handle) {
+                for (auto& image : images)
+                    nvgDeleteImage(app.nvg_context(), image.first);
+                throw std::runtime_error("Cannot load image '" + path + "'");
+            }
+            images.emplace_back(handle, path);
+        }
+        disposeImagePanel(app, widget);
+        static_cast<ImagePanel*>(widget)->set_images(images);
+        return true;
+    }
+
+    static void disposeImagePanel(JsonGuiApplication& app, Widget* widget) {
+        ImagePanel* panel = static_cast<ImagePanel*>(widget);
+        for (auto& image : panel->images())
+            nvgDeleteImage(app.nvg_context(), image.first);
+        panel->set_images({});
+    }
+
+    static const WidgetFactory& genericFactory() {
+        static const WidgetFactory factory = {
+            [](JsonGuiApplication&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                return new EventWidget(parent, id);
+            },
+            setCommon
+        };
+        return factory;
+    }
+
+    static const WidgetFactory* factoryFor(const char* type) {
+        using App = JsonGuiApplication;
+        static const std::unordered_map<std::string_view, WidgetFactory> factories = {
+            { "Window", { [](App& app, Widget*, const std::string& id, DictValue* desc) -> Widget* {
+                EventWindow* window = new EventWindow(&app, "", id, false);
+                window->set_layout(new GroupLayout());
+                DictValue* rootWindowVal = dict_object_get(desc, "rootWindow");
+                if (rootWindowVal && rootWindowVal->type == DICT_BOOL && rootWindowVal->bool_value) {
+                    // Set window size to match Screen size exactly
+                    window->set_size(app.size());
+                    app.m_rootWindow = window;
+                }
+                return window;
+            }, setWindow } },
+            { "View", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                Widget* view = new EventWidget(parent, id);
+                view->set_layout(new GroupLayout());
+                return view;
+            }, setCommon } },
+            { "Button", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                EventButton* button = new EventButton(parent, "Button", id);
+                button->set_change_callback([id](bool pushed) { sendValueToRuntime(id, boolText(pushed)); });
+                return button;
+            }, setButton } },
+            { "Label", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                return new EventLabel(parent, "Label", id);
+            }, setLabel } },
+            { "ToolButton", { [](App&, Widget* parent, const std::string& id, DictValue* desc) -> Widget* {
+                // What ToolButton sets up, on a button that reports events
+                EventButton* button = new EventButton(parent, "", id);
+                button->set_icon(intParam(desc, "icon", 0));
+                button->set_flags(Button::RadioButton | Button::ToggleButton);
+                button->set_fixed_size(Vector2i(25, 25));
+                button->set_change_callback([id](bool pushed) { sendValueToRuntime(id, boolText(pushed)); });
+                return button;
+            }, setButton } },
+            { "PopupButton", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                PopupButton* button = new PopupButton(parent);
+                button->popup()->set_layout(new GroupLayout());
+                // Reports the popup being opened or closed with the button
+                button->set_change_callback([id](bool pushed) { sendValueToRuntime(id, boolText(pushed)); });
+                return button;
+            }, setButton, [](Widget* widget) -> Widget* {
+                return static_cast<PopupButton*>(widget)->popup();
+            } } },
+            { "CheckBox", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                CheckBox* checkbox = new CheckBox(parent);
+                checkbox->set_callback([id](bool checked) { sendValueToRuntime(id, boolText(checked)); });
+                return checkbox;
+            }, setCheckBox } },
+            { "TextBox", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                TextBox* textbox = new TextBox(parent);
+                textbox->set_editable(true);
+                textbox->set_callback([id](const std::string& value) {
+                    sendValueToRuntime(id, value);
+                    return true;
+                });
+                return textbox;
+            }, setTextBox } },
+            { "IntBox", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                IntBox<int>* box = new IntBox<int>(parent);
+                box->set_editable(true);
+                box->set_callback([id](int value) { sendValueToRuntime(id, std::to_string(value)); });
+                return box;
+            }, setNumberBox<IntBox<int>> } },
+            { "FloatBox", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                FloatBox<float>* box = new FloatBox<float>(parent);
+                box->set_editable(true);
+                box->set_callback([id](float value) { sendValueToRuntime(id, numberText(value)); });
+                return box;
+            }, setNumberBox<FloatBox<float>> } },
+            { "TextArea", { [](App&, Widget* parent, const std::string&, DictValue*) -> Widget* {
+                return new TextArea(parent);
+            }, setTextArea } },
+            { "Slider", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                Slider* slider = new Slider(parent);
+                slider->set_callback([id](float value) { sendValueToRuntime(id, numberText(value)); });
+                return slider;
+            }, setSlider } },
+            { "ProgressBar", { [](App&, Widget* parent, const std::string&, DictValue*) -> Widget* {
+                return new ProgressBar(parent);
+            }, setProgressBar } },
+            { "ComboBox", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                ComboBox* combo = new ComboBox(parent);
+                combo->set_callback([id](int index) { sendValueToRuntime(id, std::to_string(index)); });
+                return combo;
+            }, setComboBox } },
+            { "Dropdown", { [](App&, Widget* parent, const std::string& id, DictValue* desc) -> Widget* {
+                std::vector<std::string> items;
+                DictValue* itemsVal = dict_object_get(desc, "items");
+                if (itemsVal)
+                    stringList(itemsVal, items);
+                Dropdown::Mode mode = (Dropdown::Mode) enumParam(desc, "mode", { "combobox", "menu", "submenu" },
+                                                                 Dropdown::ComboBox);
+                Dropdown* dropdown = new Dropdown(parent, items, {}, mode);
+                dropdown->set_selected_callback([id](int index) { sendValueToRuntime(id, std::to_string(index)); });
+                return dropdown;
+            }, setDropdown } },
+            { "ColorWheel", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                ColorWheel* wheel = new ColorWheel(parent);
+                wheel->set_callback([id](const Color& color) { sendValueToRuntime(id, colorText(color)); });
+                return wheel;
+            }, setColorWheel } },
+            { "ColorPicker", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                // Only the picked color; set_callback() would also fire right away
+                ColorPicker* picker = new ColorPicker(parent);
+                picker->set_final_callback([id](const Color& color) { sendValueToRuntime(id, colorText(color)); });
+                return picker;
+            }, setColorPicker } },
+            { "Graph", { [](App&, Widget* parent, const std::string&, DictValue*) -> Widget* {
+                return new Graph(parent);
+            }, setGraph } },
+            { "ImagePanel", { [](App&, Widget* parent, const std::string& id, DictValue*) -> Widget* {
+                ImagePanel* panel = new ImagePanel(parent);
+                panel->set_callback([panel, id](int index) {
+                    if (index >= 0 && index < (int) panel->images().size())
+                        sendEventToRuntime(GuiEvent(id, NG_EVENT_BUTTON_CLICK, Vector2i(0), Vector2i(0),
+                                                    GLFW_MOUSE_BUTTON_1, &panel->images()[index].second));
+                });
+                return panel;
+            }, setImagePanel, nullptr, nullptr, nullptr, disposeImagePanel } },
+            { "ImageView", { [](App&, Widget* parent, const std::string&, DictValue*) -> Widget* {
+                return new ImageView(parent);
+            }, setImageView } },
+            { "ScrollPanel", { [](App&, Widget* parent, const std::string&, DictValue* desc) -> Widget* {
+                return new ScrollPanel(parent, (ScrollPanel::ScrollTypes) enumParam(
+                    desc, "scroll", { "horizontal", "vertical", "both", "none" },
+                    (int) ScrollPanel::ScrollTypes::Vertical));
+            }, setCommon } },
+            { "Split", { [](App&, Widget* parent, const std::string&, DictValue* desc) -> Widget* {
+                return new Split(parent, (Split::Orientation) enumParam(
+                    desc, "orientation", { "horizontal", "vertical" }, (int) Split::Orientation::Horizontal));
+            }, setCommon } },
+            { "TreeView", { [](App&, Widget* parent, const std::string&, DictValue*) -> Widget* {
+                return new TreeView(parent);
+            }, setTreeView, nullptr, nullptr, nullptr, [](App&, Widget* widget) {
+                // The view deletes the tree itself, the nodes are ours
+                TreeView* tree = static_cast<TreeView*>(widget);
+                deleteTreeNodes(tree->items());
+                tree->set_items(nullptr);
+            } } },
+            { "TabWidget", { [](App&, Widget* parent, const std::string&, DictValue*) -> Widget* {
+                return new TabWidget(parent);
+            }, setTabWidget, nullptr,
+            [](Widget* widget, Widget* child, const std::string& caption, int index) {
+                TabWidget* tabs = static_cast<TabWidget*>(widget);
+                tabs->insert_tab(std::min(index, tabs->tab_count()), caption, child);
+            },
+            [](Widget* widget, Widget* child) {
+                // Tabs are kept in child order; the caller removes the child
+                TabWidget* tabs = static_cast<TabWidget*>(widget);
+                int index = tabs->child_index(child);
+                if (index < 0 || index >= tabs->tab_count())
+                    return;
+                bool removeChildren = tabs->remove_children();
+                tabs->set_remove_children(false);
+                tabs->remove_tab(tabs->tab_id(index));
+                tabs->set_remove_children(removeChildren);
+            } } },
+        };
+        auto it = factories.find(type);
+        return it != factories.end() ? &it->second : nullptr;
+    }
+
+    // Construct and register the widget described by `jsonObj` (properties
+    // are applied separately, see applyProperties())
+    Widget* createWidgetFromJson(DictValue* jsonObj, Widget* parent, const WidgetFactory*& factory) {
         if (!jsonObj || jsonObj->type != DICT_OBJECT) return nullptr;
-        
+
         // Extract mandatory ID first
         std::string id = extractId(jsonObj);
-        
+        if (m_widgetsById.count(id)) {
+            throw std::runtime_error("Duplicate widget id '" + id + "'");
+        }
+
         // Get the type
         DictValue* typeVal = dict_object_get(jsonObj, "type");
         if (!typeVal || typeVal->type != DICT_STRING) {
             throw std::runtime_error("Missing 'type' field for widget with id '" + id + "'");
         }
-        
-        std::string widgetType = typeVal->string_value;
-        Widget* widget = nullptr;
-        
-		if (widgetType == "Window") {
-			// Get title
-			std::string title = "";
-			DictValue* titleVal = dict_object_get(jsonObj, "title");
-			if (titleVal && titleVal->type == DICT_STRING) {
-				title = titleVal->string_value;
-			}
-
-			bool resizable = false;  // Default to false
-			DictValue* resizableVal = dict_object_get(jsonObj, "resizable");
-			if (resizableVal && resizableVal->type == DICT_BOOL) {
-				resizable = resizableVal->bool_value != 0;
-			}
-
-			EventWindow* window = new EventWindow(this, title, id, resizable);
-			widget = window;
-
-			// Check for "rootWindow" key
-			DictValue* rootWindowVal = dict_object_get(jsonObj, "rootWindow");
-			bool isRootWindow = rootWindowVal && rootWindowVal->type == DICT_BOOL && rootWindowVal->bool_value;
-
-			if (isRootWindow) {
-				// Set window size to match Screen size exactly
-				Vector2i screenSize = this->size();
-				window->set_size(screenSize);
-				m_rootWindow = window;
-			} else {
-				// Set dimensions if specified
-				DictValue* widthVal = dict_object_get(jsonObj, "width");
-				DictValue* heightVal = dict_object_get(jsonObj, "height");
-				if (widthVal && heightVal) {
-					int width = 400, height = 300;
-					if (widthVal->type == DICT_NUMBER) width = (int)widthVal->number_value;
-					if (widthVal->type == DICT_INT64) width = (int)widthVal->int64_value;
-					if (heightVal->type == DICT_NUMBER) height = (int)heightVal->number_value;
-					if (heightVal->type == DICT_INT64) height = (int)heightVal->int64_value;
-
-					window->set_fixed_size(Vector2i(width, height));
-				}
-			}
-
-			// Layout setup here stays the same...
-			DictValue* layoutVal = dict_object_get(jsonObj, "layout");
-			if (layoutVal && layoutVal->type == DICT_STRING) {
-				std::string layoutType = layoutVal->string_value;
-
-				if (layoutType == "GroupLayout") {
-					window->set_layout(new GroupLayout());
-				} else if (layoutType == "VBoxLayout") {
-					window->set_layout(new BoxLayout(Orientation::Vertical));
-				} else if (layoutType == "HBoxLayout") {
-					window->set_layout(new BoxLayout(Orientation::Horizontal));
-				} else if (layoutType == "default") {
-					window->set_layout(new GroupLayout());
-				} else {
-					std::cout << "Warning: Unknown layout type '" << layoutType << "', using GroupLayout" << std::endl;
-					window->set_layout(new GroupLayout());
-				}
-			} else {
-				window->set_layout(new GroupLayout());
-			}
-		} else if (widgetType == "View") {
-            widget = new EventWidget(parent, id);
-            
-            // Set layout if specified
-            DictValue* layoutVal = dict_object_get(jsonObj, "layout");
-            if (layoutVal && layoutVal->type == DICT_STRING) {
-                std::string layoutType = layoutVal->string_value;
-                
-                if (layoutType == "GroupLayout") {
-                    widget->set_layout(new GroupLayout());
-                } else if (layoutType == "VBoxLayout") {
-                    widget->set_layout(new BoxLayout(Orientation::Vertical));
-                } else if (layoutType == "HBoxLayout") {
-                    widget->set_layout(new BoxLayout(Orientation::Horizontal));
-                } else if (layoutType == "default") {
-                    widget->set_layout(new GroupLayout());
-                } else {
-                    // Unknown layout type, use default
-                    std::cout << "Warning: Unknown layout type '" << layoutType << "', using GroupLayout" << std::endl;
-                    widget->set_layout(new GroupLayout());
-                }
-            } else {
-                // No layout specified, use default
-                widget->set_layout(new GroupLayout());
-            }
-            
-        } else if (widgetType == "Button") {
-            std::string label = "Button";
-            DictValue* labelVal = dict_object_get(jsonObj, "label");
-            if (labelVal && labelVal->type == DICT_STRING) {
-                label = labelVal->string_value;
-            }
-            
-            widget = new EventButton(parent, label, id);
-            
-        } else if (widgetType == "Label") {
-            std::string text = "Label";
-            DictValue* textVal = dict_object_get(jsonObj, "text");
-            if (textVal && textVal->type == DICT_STRING) {
-                text = textVal->string_value;
-            }
-            
-            widget = new EventLabel(parent, text, id);
-            
-        } else {
+
+        factory = factoryFor(typeVal->string_value);
+        if (!factory) {
             // Unknown widget type, create generic widget
-            std::cout << "Warning: Unknown widget type '" << widgetType << "', creating generic Widget" << std::endl;
-            widget = new EventWidget(parent, id);
+            std::cout << "Warning: Unknown widget type '" << typeVal->string_value << "', creating generic Widget" << std::endl;
+            factory = &genericFactory();
         }
-        
+
+        Widget* widget = factory->create(*this, parent, id, jsonObj);
+        registerWidget(id, widget, factory);
         return widget;
     }
-    
-    // Recursively build widget hierarchy from JSON
-    void buildWidgetHierarchy(DictValue* jsonObj, Widget* parent) {
-        if (!jsonObj || jsonObj->type != DICT_OBJECT) return;
-        
+
+    // Apply every settable key of a description; keys the type doesn't
+    // support are ignored
+    void applyProperties(DictValue* jsonObj, Widget* widget, const WidgetFactory* factory) {
+        for (size_t i = 0; i < jsonObj->object_value.count; i++) {
+            WidgetProp prop = propertyFor(jsonObj->object_value.pairs[i].key);
+            if (prop >= WidgetProp::Layout)
+                factory->set(*this, widget, prop, jsonObj->object_value.pairs[i].value);
+        }
+    }
+
+    // Tab caption of a child: its "tab" key if it has one, else its id
+    std::string childCaption(DictValue* desc, Widget* child) const {
+        DictValue* tabVal = desc ? dict_object_get(desc, "tab") : nullptr;
+        if (tabVal && tabVal->type == DICT_STRING)
+            return tabVal->string_value;
+        auto it = m_widgetEntries.find(child);
+        return it != m_widgetEntries.end() ? *it->second.id : std::string();
+    }
+
+    // Recursively build widget hierarchy from JSON. Properties are applied
+    // once the children exist (a TabWidget's "selected" needs its tabs).
+    Widget* buildWidgetHierarchy(DictValue* jsonObj, Widget* parent) {
+        if (!jsonObj || jsonObj->type != DICT_OBJECT) return nullptr;
+
         // Create the widget
-        Widget* widget = createWidgetFromJson(jsonObj, parent);
-        if (!widget) return;
-        
+        const WidgetFactory* factory = nullptr;
+        Widget* widget = createWidgetFromJson(jsonObj, parent, factory);
+        if (!widget) return nullptr;
+
         // Process children if they exist
         DictValue* childrenVal = dict_object_get(jsonObj, "children");
         if (childrenVal && childrenVal->type == DICT_ARRAY) {
+            Widget* container = factory->container ? factory->container(widget) : widget;
             for (size_t i = 0; i < childrenVal->array_value.length; i++) {
-                DictValue* child = childrenVal->array_value.items[i];
-                buildWidgetHierarchy(child, widget);
+                DictValue* childDesc = childrenVal->array_value.items[i];
+                Widget* child = buildWidgetHierarchy(childDesc, container);
+                if (child && factory->adopt && child->parent() == container)
+                    factory->adopt(widget, child, childCaption(childDesc, child), container->child_count() - 1);
+            }
+        }
+
+        applyProperties(jsonObj, widget, factory);
+        return widget;
+    }
+
+    Widget* requireWidget(DictValue* patch, const char* key) {
+        DictValue* idVal = dict_object_get(patch, key);
+        if (!idVal || idVal->type != DICT_STRING)
+            throw std::runtime_error(std::string("Patch needs a '") + key + "' string");
+        Widget* widget = findWidget(idVal->string_value);
+        if (!widget)
+            throw std::runtime_error(std::string("No widget with id '") + idVal->string_value + "'");
+        return widget;
+    }
+
+    // Optional "index" of a patch, clamped to [0, count]; default: append
+    static int patchIndex(DictValue* patch, int count) {
+        DictValue* indexVal = dict_object_get(patch, "index");
+        double index = count;
+        if (indexVal && numberValue(indexVal, index) && index >= 0 && index < count)
+            return (int) index;
+        return count;
+    }
+
+    // Put `widget` (currently a child of `from`, or just constructed there)
+    // at position `index` of `to`
+    void reparent(Widget* widget, Widget* from, Widget* to, int index) {
+        widget->inc_ref();
+        from->remove_child(widget);
+        to->add_child(std::min(index, to->child_count()), widget);
+        widget->dec_ref();
+    }
+
+    // Where children added to `widget` actually go (a PopupButton's go into
+    // its popup); `factory` is set to the widget's factory, if registered
+    Widget* containerOf(Widget* widget, const WidgetFactory*& factory) const {
+        factory = factoryOf(widget);
+        return factory && factory->container ? factory->container(widget) : widget;
+    }
+
+    // Apply one patch operation, keyed by widget id:
+    //   {"op": "set",    "id": ..., "props": {"label": ..., "visible": ..., ...}}
+    //   {"op": "insert", "parent": ..., "index": n, "widget": {...}}
+    //   {"op": "remove", "id": ...}
+    //   {"op": "move",   "id": ..., "parent": ..., "index": n}
+    // Only the touched widgets change; containers whose geometry may have
+    // changed are marked for layout before the next frame.
+    void applyPatch(DictValue* patch, const std::string& op) {
+        if (op == "set") {
+            Widget* widget = requireWidget(patch, "id");
+            DictValue* props = dict_object_get(patch, "props");
+            if (!props || props->type != DICT_OBJECT)
+                throw std::runtime_error("'set' patch needs a 'props' object");
+            const WidgetFactory* factory = factoryOf(widget);
+            bool relayout = false;
+            for (size_t i = 0; i < props->object_value.count; i++) {
+                const char* key = props->object_value.pairs[i].key;
+                WidgetProp prop = propertyFor(key);
+                if (prop < WidgetProp::Layout || !factory->set(*this, widget, prop, props->object_value.pairs[i].value))
+                    throw std::runtime_error(std::string("Unsupported property '") + key + "' for widget '" +
+                                             *m_widgetEntries[widget].id + "'");
+                relayout |= propAffectsLayout(prop);
+            }
+            if (relayout)
+                scheduleRelayout(widget);
+        } else if (op == "insert") {
+            Widget* parent = requireWidget(patch, "parent");
+            DictValue* desc = dict_object_get(patch, "widget");
+            if (!desc || desc->type != DICT_OBJECT)
+                throw std::runtime_error("'insert' patch needs a 'widget' object");
+            const WidgetFactory* factory = nullptr;
+            Widget* container = containerOf(parent, factory);
+            int count = container->child_count();
+            Widget* child = buildWidgetHierarchy(desc, container);
+            if (child && child->parent() == container) {
+                int index = patchIndex(patch, count);
+                if (index < count)
+                    reparent(child, container, container, index);
+                if (factory->adopt)
+                    factory->adopt(parent, child, childCaption(desc, child), index);
+                scheduleRelayout(parent);
+            } else {
+                // Windows always attach to the screen
+                scheduleRelayout(this);
             }
+        } else if (op == "remove") {
+            Widget* widget = requireWidget(patch, "id");
+            Widget* parent = widget->parent();
+            if (!parent || widget == this)
+                throw std::runtime_error("Cannot remove the screen");
+            if (widget == m_rootWindow)
+                m_rootWindow = nullptr;
+            const WidgetFactory* factory = factoryOf(parent);
+            if (factory && factory->release)
+                factory->release(parent, widget);
+            unregisterSubtree(widget);
+            parent->remove_child(widget);
+            scheduleRelayout(parent);
+        } else if (op == "move") {
+            Widget* widget = requireWidget(patch, "id");
+            Widget* target = requireWidget(patch, "parent");
+            for (Widget* w = target; w; w = w->parent())
+                if (w == widget)
+                    throw std::runtime_error("Cannot move a widget into its own subtree");
+            const WidgetFactory* toFactory = nullptr;
+            Widget* from = widget->parent();
+            Widget* to = containerOf(target, toFactory);
+            const WidgetFactory* fromFactory = factoryOf(from);
+            if (fromFactory && fromFactory->release)
+                fromFactory->release(from, widget);
+            int count = to->child_count() - (from == to ? 1 : 0);
+            int index = patchIndex(patch, count);
+            reparent(widget, from, to, index);
+            if (toFactory->adopt)
+                toFactory->adopt(target, widget, childCaption(nullptr, widget), index);
+            scheduleRelayout(from);
+            if (to != from)
+                scheduleRelayout(target);
+        } else {
+            throw std::runtime_error("Unknown patch op '" + op + "'");
+        }
+    }
+
+    // Lay `widget` out again before the next frame. Top-level windows are
+    // sized by the screen, so the screen is the layout root that is queued;
+    // the dirty marks keep the work to the subtrees that changed, and the
+    // requests of one batch of patches are coalesced into one layout.
+    void scheduleRelayout(Widget* widget) {
+        widget->mark_layout_dirty();
+        request_layout();
+    }
+
+    // Apply one streamed top-level value: a patch ("op" key), a widget
+    // description, or an array of them. New top-level widgets go into the
+    // root window (Windows always go to the screen).
+    void applyStreamValue(DictValue* value) {
+        if (value->type == DICT_ARRAY) {
+            for (size_t i = 0; i < value->array_value.length; i++)
+                applyStreamValue(value->array_value.items[i]);
+            return;
+        }
+        if (value->type != DICT_OBJECT) {
+            std::cerr << "Stream: ignoring non-object value" << std::endl;
+            return;
+        }
+        try {
+            DictValue* opVal = dict_object_get(value, "op");
+            if (opVal && opVal->type == DICT_STRING) {
+                applyPatch(value, opVal->string_value);
+            } else {
+                Widget* parent = m_rootWindow ? (Widget*) m_rootWindow : (Widget*) this;
+                buildWidgetHierarchy(value, parent);
+                scheduleRelayout(parent);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Stream: " << e.what() << std::endl;
         }
     }
 
 public:
     JsonGuiApplication() : Screen(Vector2i(800, 600), "JSON GUI Application") {
         inc_ref();
+        dict_json_stream_init(&m_stream);
         
         // JSON string with mandatory IDs
         const char* jsonString = R"({
@@ -429,39 +1502,54 @@ public:
     // Alternative constructor that reads from file
     JsonGuiApplication(const std::string& jsonFilePath) : Screen(Vector2i(800, 600), "JSON GUI Application") {
         inc_ref();
+        dict_json_stream_init(&m_stream);
         
         try {
-            // Read JSON from file
-            std::ifstream file(jsonFilePath);
-            if (!file.is_open()) {
-                throw std::runtime_error("Failed to open JSON file: " + jsonFilePath);
+            // Map the layout file; BSON is read straight from the mapping
+            DictMappedFile file;
+            if (!dict_file_map(&file, jsonFilePath.c_str())) {
+                throw std::runtime_error("Failed to open layout file: " + jsonFilePath);
             }
-            
-            std::string jsonContent((std::istreambuf_iterator<char>(file)),
-                                   std::istreambuf_iterator<char>());
-            file.close();
-            
-            // Parse JSON
+
             char errorBuffer[1000];
-            DictValue* root = dict_deserialize_json(
-                jsonContent.c_str(),
-                jsonContent.length(),
-                jsonContent.length(),
-                errorBuffer,
-                sizeof(errorBuffer)
-            );
+            DictArena arena;
+            dict_arena_init(&arena);
+            DictValue* root = nullptr;
+            std::string jsonContent;
+            if (dict_is_bson(file.data, file.size)) {
+                root = dict_deserialize_bson_arena(&arena, file.data, file.size,
+                                                   errorBuffer, sizeof(errorBuffer));
+            } else {
+                // JSON is parsed in place, which needs a writable copy
+                jsonContent.assign((const char*) file.data, file.size);
+                dict_file_unmap(&file);
+                if (!jsonContent.empty())
+                    root = dict_deserialize_json_arena(&arena, &jsonContent[0], jsonContent.length(),
+                                                       errorBuffer, sizeof(errorBuffer));
+                else
+                    snprintf(errorBuffer, sizeof(errorBuffer), "Empty file");
+            }
             
             if (!root) {
-                throw std::runtime_error("JSON parsing failed: " + std::string(errorBuffer));
+                dict_arena_release(&arena);
+                dict_file_unmap(&file);
+                throw std::runtime_error("Layout parsing failed: " + std::string(errorBuffer));
             }
             
-            std::cout << "JSON file parsed successfully!" << std::endl;
+            std::cout << "Layout file parsed successfully!" << std::endl;
             
             // Build the GUI from JSON
-            buildWidgetHierarchy(root, nullptr);
+            try {
+                buildWidgetHierarchy(root, nullptr);
+            } catch (...) {
+                dict_arena_release(&arena);
+                dict_file_unmap(&file);
+                throw;
+            }
             
-            // Clean up JSON data
-            dict_destroy(root);
+            // Clean up layout data (a single release, no tree walk)
+            dict_arena_release(&arena);
+            dict_file_unmap(&file);
             
             // Perform layout
             perform_layout();
@@ -472,10 +1560,177 @@ public:
         }
     }
 
+    ~JsonGuiApplication() {
+        stopStreamReader();
+        dict_json_stream_free(&m_stream);
+    }
+
+    // Build a generated window of `count` widgets `iterations` times and
+    // report the cost of construction and teardown (ngserver --bench-build).
+    // The description is parsed once up front; only the factory is timed.
+    void benchmarkBuild(int count, int iterations) {
+        static const char* leaves[] = {
+            R"({"id":"bench_%d","type":"Button","label":"Button %d","tooltip":"button"})",
+            R"({"id":"bench_%d","type":"Label","text":"Label %d","font_size":14})",
+            R"({"id":"bench_%d","type":"CheckBox","caption":"Check %d","checked":true})",
+            R"({"id":"bench_%d","type":"TextBox","value":"text %d","editable":true,"units":"px"})",
+            R"({"id":"bench_%d","type":"Slider","value":0.5,"min":0,"max":%d})",
+            R"({"id":"bench_%d","type":"ProgressBar","value":0.25,"tooltip":"progress %d"})",
+            R"({"id":"bench_%d","type":"IntBox","value":%d,"min":0,"max":1000000})",
+            R"({"id":"bench_%d","type":"Graph","caption":"Graph %d","values":[0.1,0.5,0.3,0.9]})",
+        };
+        const int leavesPerView = 50;
+
+        std::string json = R"({"id":"bench_root","type":"Window","title":"bench","layout":"VBoxLayout","children":[)";
+        char item[256];
+        int id = 0;
+        for (int made = 1; made < count; ) {
+            snprintf(item, sizeof(item), R"(%s{"id":"bench_%d","type":"View","layout":{"type":"GridLayout","columns":5,"spacing":2},"children":[)",
+                     made > 1 ? "," : "", id++);
+            json += item;
+            made++;
+            for (int i = 0; i < leavesPerView && made < count; i++, made++) {
+                if (i) json += ',';
+                snprintf(item, sizeof(item), leaves[made % 8], id, id);
+                id++;
+                json += item;
+            }
+            json += "]}";
+        }
+        json += "]}";
+
+        char errorBuffer[256];
+        DictArena arena;
+        dict_arena_init(&arena);
+        DictValue* root = dict_deserialize_json_arena(&arena, &json[0], json.size(), errorBuffer, sizeof(errorBuffer));
+        if (!root) {
+            std::cerr << "bench: " << errorBuffer << std::endl;
+            dict_arena_release(&arena);
+            return;
+        }
+
+        using Clock = std::chrono::steady_clock;
+        double buildBest = 1e30, buildTotal = 0, teardownTotal = 0;
+        for (int i = 0; i < iterations; i++) {
+            auto t0 = Clock::now();
+            Widget* window = buildWidgetHierarchy(root, nullptr);
+            auto t1 = Clock::now();
+            unregisterSubtree(window);
+            remove_child(window);
+            auto t2 = Clock::now();
+            double build = std::chrono::duration<double, std::milli>(t1 - t0).count();
+            buildBest = std::min(buildBest, build);
+            buildTotal += build;
+            teardownTotal += std::chrono::duration<double, std::milli>(t2 - t1).count();
+        }
+        dict_arena_release(&arena);
+
+        printf("build %d widgets x %d: mean %.2f ms, best %.2f ms (%.0f ns/widget), teardown %.2f ms\n",
+               count, iterations, buildTotal / iterations, buildBest, buildBest * 1e6 / count,
+               teardownTotal / iterations);
+    }
+
+    // Read UI descriptions (JSON or newline-delimited JSON) from a file
+    // descriptor on a background thread; chunks are handed to the main thread
+    // as they arrive, so values are built as soon as their last byte is read.
+    void startStreamReader(int fd) {
+#if !defined(_WIN32)
+        if (pipe(m_streamWake) != 0) {
+            std::cerr << "Stream: cannot create wake-up pipe" << std::endl;
+            return;
+        }
+#endif
+        std::shared_ptr<std::atomic<bool>> alive = m_alive;
+        m_streamReader = std::thread([this, alive, fd]() {
+            std::vector<char> chunk(64 * 1024);
+            while (*alive) {
+#if defined(_WIN32)
+                int n = _read(fd, chunk.data(), (unsigned int) chunk.size());
+#else
+                // Block until input arrives or the destructor wakes us up
+                pollfd fds[2] = { { fd, POLLIN, 0 }, { m_streamWake[0], POLLIN, 0 } };
+                if (poll(fds, 2, -1) < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    break;
+                }
+                if (fds[1].revents)
+                    break;
+                ssize_t n = read(fd, chunk.data(), chunk.size());
+                if (n < 0 && errno == EINTR)
+                    continue;
+#endif
+                bool eof = n <= 0;
+                std::string data = eof ? std::string() : std::string(chunk.data(), (size_t) n);
+                nanogui::async([this, alive, data, eof]() {
+                    if (*alive)
+                        feedStream(data.data(), data.size(), eof);
+                });
+                glfwPostEmptyEvent();
+                if (eof)
+                    break;
+            }
+        });
+    }
+
+    // Stop the reader thread; called by the destructor
+    void stopStreamReader() {
+        *m_alive = false;
+        if (!m_streamReader.joinable())
+            return;
+#if defined(_WIN32)
+        // A blocking _read() cannot be interrupted; the thread exits at the
+        // next chunk and its callbacks see m_alive cleared
+        m_streamReader.detach();
+#else
+        char byte = 0;
+        if (write(m_streamWake[1], &byte, 1) < 0)
+            std::cerr << "Stream: cannot wake the reader" << std::endl;
+        m_streamReader.join();
+        close(m_streamWake[0]);
+        close(m_streamWake[1]);
+#endif
+    }
+
+    // Treat the stream as one value per line: a line with unbalanced
+    // brackets is dropped at its newline instead of stalling the stream
+    void setStreamLineDelimited(bool enabled) {
+        m_stream.ndjson = enabled ? 1 : 0;
+    }
+
+    // Feed a chunk of streamed JSON (main thread only). Every value that
+    // completes is applied right away; layout runs before the next frame,
+    // and only for the subtrees that changed.
+    void feedStream(const char* data, size_t len, bool eof) {
+        if (!dict_json_stream_feed(&m_stream, data, len)) {
+            std::cerr << "Stream: out of memory" << std::endl;
+            return;
+        }
+        if (eof)
+            dict_json_stream_finish(&m_stream);
+
+        bool changed = false;
+        DictStreamStatus status;
+        for (;;) {
+            DictValue* value = dict_json_stream_next(&m_stream, &status);
+            if (value) {
+                applyStreamValue(value);
+                changed = true;
+            } else if (status == DICT_STREAM_ERROR) {
+                std::cerr << "Stream: " << m_stream.error << std::endl;
+            } else {
+                break;
+            }
+        }
+
+        if (changed)
+            redraw();
+    }
+
 	virtual bool resize_event(const Vector2i& size) override {
 		if (m_rootWindow) {
 			m_rootWindow->set_size(size);
-			perform_layout();  // update layouts accordingly
+			request_layout();  // update layouts before the next frame
 		}
 		Screen::resize_event(size);
 		return true;
@@ -513,18 +1768,19 @@ namespace JsonGuiRuntime {
 void handleGuiEvent(const GuiEvent& event) {
 	return;
 
-    std::cout << "Runtime received event: ID='" << event.id << "', Type='" << event.type << "'";
-    if (!event.data.empty()) {
-        std::cout << ", Data='" << event.data << "'";
+    std::cout << "Runtime received event: ID='" << event.id << "', Type='" << event.typeName() << "'"
+              << ", Pos=(" << event.pos.x() << "," << event.pos.y() << ")";
+    if (event.text) {
+        std::cout << ", Text='" << *event.text << "'";
     }
     std::cout << std::endl;
     
     // Example: Handle specific events
-    if (event.id == "hello_button" && event.type == "button_click") {
+    if (event.id == "hello_button" && event.type == NG_EVENT_BUTTON_CLICK) {
         std::cout << "Hello button was clicked! Doing something special..." << std::endl;
-    } else if (event.id == "goodbye_button" && event.type == "button_click") {
+    } else if (event.id == "goodbye_button" && event.type == NG_EVENT_BUTTON_CLICK) {
         std::cout << "Goodbye button was clicked! Preparing to exit..." << std::endl;
-    } else if (event.type == "mouse_enter") {
+    } else if (event.type == NG_EVENT_MOUSE_ENTER) {
         std::cout << "Mouse entered widget: " << event.id << std::endl;
     }
 }
@@ -538,21 +1794,63 @@ int main(int argc, char** argv) {
         
         {
             ref<JsonGuiApplication> app;
+
+            // Usage: ngserver [layout.json|layout.bson] [--stdin [--ndjson]] [--events <socket>]
+            //                 [--atlas-cache <file>] [--bench-build [widgets] [iterations]]
+            std::string jsonFilePath, atlasCache;
+            bool streamStdin = false, streamNdjson = false;
+            int benchWidgets = 0, benchIterations = 10;
+            for (int i = 1; i < argc; i++) {
+                std::string arg = argv[i];
+                if (arg == "--stdin") {
+                    streamStdin = true;
+                } else if (arg == "--ndjson") {
+                    // stdin carries one value per line
+                    streamNdjson = true;
+                } else if (arg == "--bench-build") {
+                    benchWidgets = 50000;
+                    if (i + 1 < argc && isdigit((unsigned char) argv[i + 1][0]))
+                        benchWidgets = std::max(2, atoi(argv[++i]));
+                    if (i + 1 < argc && isdigit((unsigned char) argv[i + 1][0]))
+                        benchIterations = std::max(1, atoi(argv[++i]));
+                } else if (arg == "--atlas-cache" && i + 1 < argc) {
+                    // Glyph atlas kept across runs, for a first frame without rasterizing
+                    atlasCache = argv[++i];
+                } else if (arg == "--events" && i + 1 < argc) {
+                    // Runtime listening on a Unix domain socket for event batches
+                    if (!g_eventSocket.connect(argv[++i]))
+                        std::cerr << "Failed to connect event socket: " << argv[i] << std::endl;
+                } else {
+                    jsonFilePath = arg;
+                }
+            }
             
             // Check if JSON file path provided as argument
-            if (argc > 1) {
-                app = new JsonGuiApplication(std::string(argv[1]));
+            if (!jsonFilePath.empty()) {
+                app = new JsonGuiApplication(jsonFilePath);
             } else {
                 // Use embedded JSON
                 app = new JsonGuiApplication();
             }
             
             app->dec_ref();
-            app->draw_all();
-            app->set_visible(true);
-            nanogui::mainloop(1 / 60.f * 1000);
+            if (!atlasCache.empty())
+                app->set_atlas_cache(atlasCache);
+            if (benchWidgets) {
+                app->benchmarkBuild(benchWidgets, benchIterations);
+            } else {
+                app->draw_all();
+                app->set_visible(true);
+                app->setStreamLineDelimited(streamNdjson);
+                if (streamStdin)
+                    app->startStreamReader(0);
+                nanogui::mainloop(1 / 60.f * 1000);
+            }
         }
         
+        // Deliver whatever the last frame produced
+        flushEventsToRuntime();
+        g_eventSocket.close();
         nanogui::shutdown();
     }
     catch (const std::exception& e) {
@@ -0,0 +1,103 @@
+// redraw_bench -- frame time of full redraws vs. dirty-region repaints
+//
+// Usage: redraw_bench [frames] [widgets]
+//
+// Builds a dashboard of `widgets` buttons, labels, sliders and text boxes,
+// then draws `frames` frames twice: once the way a change used to be shown
+// (Screen::redraw(), i.e. the whole tree), once with just the changed widget
+// marked via Widget::mark_dirty(). Each frame touches a different widget, as
+// hovering across the dashboard would. Vsync is disabled and glFinish() is
+// called after each frame so the numbers include the GPU work.
+
+#include <nanogui/nanogui.h>
+#include <nanogui/opengl.h>
+#include <nanogui/layout.h>
+#include <nanogui/slider.h>
+#include <nanogui/textbox.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace nanogui;
+using Clock = std::chrono::steady_clock;
+
+static double run_frames(Screen* screen, const std::vector<Widget*>& targets,
+                         int frames, bool partial) {
+    auto start = Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        Widget* target = targets[(size_t) i % targets.size()];
+        if (partial)
+            target->mark_dirty();
+        else
+            screen->redraw();
+        screen->draw_all();
+        glFinish();
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 500;
+    int count = argc > 2 ? atoi(argv[2]) : 400;
+    if (frames <= 0 || count <= 0) {
+        fprintf(stderr, "usage: %s [frames] [widgets]\n", argv[0]);
+        return 1;
+    }
+
+    try {
+        nanogui::init();
+        {
+            ref<Screen> screen = new Screen(Vector2i(1280, 800), "redraw_bench", false);
+            glfwSwapInterval(0);
+
+            Window* window = new Window(screen, "Dashboard");
+            window->set_position(Vector2i(0, 0));
+            window->set_layout(new GridLayout(Orientation::Horizontal, 16, Alignment::Fill, 4, 2));
+
+            std::vector<Widget*> targets;
+            for (int i = 0; i < count; ++i) {
+                Widget* widget = nullptr;
+                switch (i % 4) {
+                    case 0: widget = new Button(window, "Button " + std::to_string(i)); break;
+                    case 1: widget = new Label(window, "Label " + std::to_string(i)); break;
+                    case 2: {
+                        Slider* slider = new Slider(window);
+                        slider->set_value((i % 100) / 100.f);
+                        slider->set_fixed_width(70);
+                        widget = slider;
+                        break;
+                    }
+                    default: widget = new TextBox(window, std::to_string(i)); break;
+                }
+                targets.push_back(widget);
+            }
+
+            screen->set_visible(true);
+            screen->perform_layout();
+            window->set_size(screen->size());
+            screen->perform_layout();
+
+            // Warm up glyph caches and the retained frame
+            screen->redraw();
+            screen->draw_all();
+            run_frames(screen, targets, std::min(frames, 20), true);
+
+            double full = run_frames(screen, targets, frames, false);
+            double partial = run_frames(screen, targets, frames, true);
+            printf("%d widgets, %d frames, %dx%d framebuffer\n", count, frames,
+                   screen->framebuffer_size().x(), screen->framebuffer_size().y());
+            printf("  full redraw : %.3f ms/frame\n", full);
+            printf("  mark_dirty  : %.3f ms/frame (%.1fx)%s\n", partial, full / partial,
+                   screen->partial_redraw() ? "" : " [partial repaints unavailable, fell back to full]");
+        }
+        nanogui::shutdown();
+    } catch (const std::exception& e) {
+        std::cerr << "Caught a fatal error: " << e.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -49,9 +49,22 @@ Vector2i Button::preferred_size(NVGcontext* ctx) const {
     return Vector2i((int)(tw + iw) + 20, font_size + 10);
 }
 
+int Button::baseline(NVGcontext* ctx, int height) const {
+    if (!ctx)
+        return Widget::baseline(ctx, height);
+    // The caption is drawn middle-aligned, 1px above the center
+    float ascender, descender;
+    nvgFontSize(ctx, m_font_size == -1 ? m_theme->m_button_font_size : m_font_size);
+    nvgFontFace(ctx, "sans-bold");
+    nvgTextMetrics(ctx, &ascender, &descender, nullptr);
+    return (int) std::round(height * 0.5f - 1 + (ascender + descender) * 0.5f);
+}
+
 bool Button::mouse_enter_event(const Vector2i& p, bool enter) {
     Widget::mouse_enter_event(p, enter);
-    return true;
+    // Hover only changes this widget's look: repaint just its area
+    mark_dirty();
+    return false;
 }
 
 /*
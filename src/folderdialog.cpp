@@ -103,7 +103,7 @@ void FolderDialog::start_items()
             std::string Drive = ((utf8)(Cnt + 'A')) + ":\\";
             CurNanoTree->add_node("This_PC", Drive);
             CurNanoTree->Objects[Drive]->Name = Drive;
-            CurNanoTree->Objects[Drive]->CallBack = [=] {current_location->set_caption(Drive); explore_treeview->perform_layout(screen()->nvg_context()); };
+            CurNanoTree->Objects[Drive]->CallBack = [=] {current_location->set_caption(Drive); explore_treeview->request_layout(); };
             FillChildren(Drive);
         }
     }
@@ -137,7 +137,7 @@ https://stackoverflow.com/questions/7243988/how-to-list-the-harddisks-attached-t
     }
     free(str);
 
-    explore_treeview->perform_layout(screen()->nvg_context());
+    explore_treeview->request_layout();
 }
 
 void FolderDialog::FillChildren(std::string Node)
@@ -154,7 +154,7 @@ void FolderDialog::FillChildren(std::string Node)
                 {
                     explore_treeview->items()->add_node(Node, CompleteName);
                     explore_treeview->items()->Objects[CompleteName]->Name = CurrObject.path().filename().string();
-                    explore_treeview->items()->Objects[CompleteName]->CallBack = [=] {current_location->set_caption(CompleteName); this->perform_layout(screen()->nvg_context()); };
+                    explore_treeview->items()->Objects[CompleteName]->CallBack = [=] {current_location->set_caption(CompleteName); this->request_layout(); };
                 }
             }
         }
@@ -74,6 +74,7 @@ void Label::set_caption(const std::string &caption) {
         m_processed_text = caption; // Reset processed text
         m_cache_valid = false; // Invalidate cache
         m_selection_start = m_selection_end = -1; // Clear selection
+        mark_layout_dirty();
     }
 }
 
@@ -82,6 +83,7 @@ void Label::set_font(const std::string &font) {
         m_font = font;
         m_cache_valid = false; // Invalidate cache
         m_selection_start = m_selection_end = -1; // Clear selection
+        mark_layout_dirty();
     }
 }
 
@@ -90,6 +92,7 @@ void Label::set_line_break_mode(LineBreakMode mode) {
         m_line_break_mode = mode;
         m_cache_valid = false; // Invalidate cache
         m_selection_start = m_selection_end = -1; // Clear selection
+        mark_layout_dirty();
     }
 }
 
@@ -152,6 +155,22 @@ Vector2i Label::preferred_size(NVGcontext *ctx) const {
     return m_cached_size;
 }
 
+int Label::baseline(NVGcontext *ctx, int height) const {
+    if (!ctx)
+        return Widget::baseline(ctx, height);
+    float ascender, descender;
+    nvgFontFace(ctx, m_font.c_str());
+    nvgFontSize(ctx, static_cast<float>(font_size()));
+    nvgTextMetrics(ctx, &ascender, &descender, nullptr);
+    // Wrapped text is drawn top-aligned, everything else middle-aligned
+    bool wrapped = m_fixed_size.x() > 0 &&
+        (m_line_break_mode == LineBreakMode::LineBreakByWordWrapping ||
+         m_line_break_mode == LineBreakMode::LineBreakByCharWrapping);
+    if (wrapped)
+        return (int) std::round(ascender);
+    return (int) std::round(height * 0.5f + (ascender + descender) * 0.5f);
+}
+
 void Label::draw(NVGcontext *ctx) {
     Widget::draw(ctx);
 
@@ -3,7 +3,6 @@
 #include <nanogui/window.h>
 #include <nanogui/theme.h>
 #include <nanogui/label.h>
-#include <nanogui/scrollpanel.h>
 #include <nanogui/opengl.h>
 #include <numeric>
 #include <cmath>
@@ -40,7 +39,7 @@ Vector2i BoxLayout::preferred_size(NVGcontext* ctx, const Widget* widget) const
         else
             size[axis1] += m_spacing;
 
-        Vector2i ps = w->preferred_size(ctx);
+        Vector2i ps = w->cached_preferred_size(ctx);
         Vector2i min_s = w->min_size();
         Vector2i max_s = w->max_size();
 
@@ -84,13 +83,15 @@ void BoxLayout::perform_layout(NVGcontext* ctx, Widget* widget) const {
 
     // Collect visible children and compute total pref, min, max on axis1
     std::vector<Widget*> visible_children;
+    std::vector<Vector2i> preferred;
     float total_pref = 0.f;
     float total_min = 0.f;
     float total_max = 0.f;
     for (auto w : widget->children()) {
         if (w->visible()) {
+            Vector2i ps = w->cached_preferred_size(ctx);
             visible_children.push_back(w);
-            Vector2i ps = w->preferred_size(ctx);
+            preferred.push_back(ps);
             Vector2i min_s = w->min_size();
             Vector2i max_s = w->max_size();
 
@@ -117,8 +118,9 @@ void BoxLayout::perform_layout(NVGcontext* ctx, Widget* widget) const {
         scale_factor = available_axis1 / total_pref;
     }
 
-    for (auto w : visible_children) {
-        Vector2i ps = w->preferred_size(ctx);
+    for (size_t i = 0; i < visible_children.size(); ++i) {
+        Widget* w = visible_children[i];
+        Vector2i ps = preferred[i];
         Vector2i min_s = w->min_size();
         Vector2i max_s = w->max_size();
 
@@ -167,7 +169,7 @@ void BoxLayout::perform_layout(NVGcontext* ctx, Widget* widget) const {
 
         w->set_position(pos);
         w->set_size(target_size);
-        w->perform_layout(ctx);
+        w->update_layout(ctx);
 
         position += target_axis1 + m_spacing;
     }
@@ -195,7 +197,7 @@ Vector2i GroupLayout::preferred_size(NVGcontext* ctx, const Widget* widget) cons
             height += (label == nullptr) ? m_spacing : m_group_spacing;
         first = false;
 
-        Vector2i ps = c->preferred_size(ctx);
+        Vector2i ps = c->cached_preferred_size(ctx);
         Vector2i min_s = c->min_size();
         Vector2i max_s = c->max_size();
 
@@ -238,7 +240,7 @@ void GroupLayout::perform_layout(NVGcontext* ctx, Widget* widget) const {
         first = false;
 
         bool indent_cur = indent && label == nullptr;
-        Vector2i ps = Vector2i(available_width - (indent_cur ? m_group_indent : 0), c->preferred_size(ctx).y());
+        Vector2i ps = Vector2i(available_width - (indent_cur ? m_group_indent : 0), c->cached_preferred_size(ctx).y());
         Vector2i min_s = c->min_size();
         Vector2i max_s = c->max_size();
 
@@ -249,7 +251,7 @@ void GroupLayout::perform_layout(NVGcontext* ctx, Widget* widget) const {
 
         c->set_position(Vector2i(m_margin + (indent_cur ? m_group_indent : 0), height));
         c->set_size(clamped_pref);
-        c->perform_layout(ctx);
+        c->update_layout(ctx);
 
         height += clamped_pref.y();
 
@@ -310,7 +312,7 @@ void GridLayout::compute_layout(NVGcontext* ctx, const Widget* widget, std::vect
                 w = widget->children()[child++];
             } while (!w->visible());
 
-            Vector2i ps = w->preferred_size(ctx);
+            Vector2i ps = w->cached_preferred_size(ctx);
             Vector2i min_s = w->min_size();
             Vector2i max_s = w->max_size();
 
@@ -390,7 +392,7 @@ void GridLayout::compute_layout(NVGcontext* ctx, const Widget* widget, std::vect
             if (!w->visible())
                 continue;
 
-            Vector2i ps = w->preferred_size(ctx);
+            Vector2i ps = w->cached_preferred_size(ctx);
             Vector2i min_s = w->min_size();
             Vector2i max_s = w->max_size();
 
@@ -460,7 +462,7 @@ void GridLayout::perform_layout(NVGcontext* ctx, Widget* widget) const {
                 w = widget->children()[child++];
             } while (!w->visible());
 
-            Vector2i ps = w->preferred_size(ctx);
+            Vector2i ps = w->cached_preferred_size(ctx);
             Vector2i min_s = w->min_size();
             Vector2i max_s = w->max_size();
 
@@ -499,7 +501,7 @@ void GridLayout::perform_layout(NVGcontext* ctx, Widget* widget) const {
             }
             w->set_position(item_pos);
             w->set_size(target_size);
-            w->perform_layout(ctx);
+            w->update_layout(ctx);
             pos[axis1] += grid[axis1][i1] + m_spacing[axis1];
         }
         pos[axis2] += grid[axis2][i2] + m_spacing[axis2];
@@ -724,6 +726,17 @@ AdvancedGridLayout::AdvancedGridLayout(const std::vector<int>& cols, const std::
     m_row_stretch.resize(m_rows.size(), 0);
 }
 
+void AdvancedGridLayout::set_anchor(Widget* widget, const Anchor& anchor) {
+    widget->set_grid_anchor(anchor);
+}
+
+AdvancedGridLayout::Anchor AdvancedGridLayout::anchor(const Widget* widget) const {
+    const Anchor* anchor = widget->grid_anchor();
+    if (!anchor)
+        throw std::runtime_error("Widget was not registered with the grid layout!");
+    return *anchor;
+}
+
 Vector2i AdvancedGridLayout::preferred_size(NVGcontext* ctx, const Widget* widget) const {
     std::vector<int> grid[2];
     compute_layout(ctx, widget, grid);
@@ -767,7 +780,7 @@ void AdvancedGridLayout::perform_layout(NVGcontext* ctx, Widget* widget) const {
 
             int item_pos = grid[axis][anchor.pos[axis]];
             int cell_size = grid[axis][anchor.pos[axis] + anchor.size[axis]] - item_pos;
-            int ps = w->preferred_size(ctx)[axis];
+            int ps = w->cached_preferred_size(ctx)[axis];
             int min_s = w->min_size()[axis];
             int max_s = w->max_size()[axis];
             int target_size = ps;
@@ -781,7 +794,7 @@ void AdvancedGridLayout::perform_layout(NVGcontext* ctx, Widget* widget) const {
             size[axis] = target_size;
             w->set_position(pos);
             w->set_size(size);
-            w->perform_layout(ctx);
+            w->update_layout(ctx);
         }
     }
 }
@@ -806,15 +819,14 @@ void AdvancedGridLayout::compute_layout(NVGcontext* ctx, const Widget* widget, s
         grid = sizes;
 
         for (int phase = 0; phase < 2; ++phase) {
-            for (auto pair : m_anchor) {
-                const Widget* w = pair.first;
-                if (!w->visible() || dynamic_cast<const Window*>(w) != nullptr)
+            for (const Widget* w : widget->children()) {
+                if (!w->visible() || dynamic_cast<const Window*>(w) != nullptr || !w->grid_anchor())
                     continue;
-                const Anchor& anchor = pair.second;
+                const Anchor& anchor = *w->grid_anchor();
                 if ((anchor.size[axis] == 1) != (phase == 0))
                     continue;
 
-                int ps = w->preferred_size(ctx)[axis];
+                int ps = w->cached_preferred_size(ctx)[axis];
                 int min_s = w->min_size()[axis];
                 int max_s = w->max_size()[axis];
                 int target_size = ps;
@@ -885,9 +897,8 @@ void AdvancedGridLayout::draw_table(NVGcontext *ctx, const Widget *widget) {
     if (visible_children.empty()) return;
 
     for (auto w : visible_children) {
-        auto it = m_anchor.find(w);
-        if (it == m_anchor.end()) continue;
-        const Anchor &a = it->second;
+        if (!w->grid_anchor()) continue;
+        const Anchor &a = *w->grid_anchor();
         int row = a.pos[1], col = a.pos[0];
 
         bool is_header = (m_table_theme.first_row_is_header && row == 0) ||
@@ -961,9 +972,8 @@ void AdvancedGridLayout::draw_table(NVGcontext *ctx, const Widget *widget) {
 
     // Override with actual child positions
     for (auto w : visible_children) {
-        auto it = m_anchor.find(w);
-        if (it == m_anchor.end()) continue;
-        const Anchor& a = it->second;
+        if (!w->grid_anchor()) continue;
+        const Anchor& a = *w->grid_anchor();
         int col = a.pos[0];
         int row = a.pos[1];
         Vector2i pos = w->position();
@@ -1057,76 +1067,186 @@ FlexLayout::FlexLayout(FlexDirection direction, JustifyContent justify_content,
                       AlignItems align_items, int margin, int gap)
     : m_direction(direction), m_justify_content(justify_content),
       m_align_items(align_items), m_flex_wrap(FlexWrap::NoWrap),
+      m_align_content(AlignContent::Stretch),
       m_margin(margin), m_gap(gap) {
 }
 
-Vector2i FlexLayout::preferred_size(NVGcontext *ctx, const Widget *widget) const {
-    Vector2i size(2 * m_margin);
-
-    int y_offset = 0;
-    const Window *window = dynamic_cast<const Window*>(widget);
-    if (window && !window->title().empty()) {
-        if (!is_row_direction())
-            size[1] += widget->theme()->m_window_header_height - m_margin / 2;
-        else
-            y_offset = widget->theme()->m_window_header_height;
-    }
-
-    std::vector<Widget*> visible_children;
-    for (auto child : widget->children()) {
-        if (child->visible())
-            visible_children.push_back(child);
-    }
+void FlexLayout::set_flex_item(Widget* widget, const FlexItem& item) {
+    widget->set_flex_item(item);
+}
 
-    if (visible_children.empty())
-        return size + Vector2i(0, y_offset);
+const FlexLayout::FlexItem& FlexLayout::get_flex_item(const Widget* widget) const {
+    return widget->flex_item();
+}
 
+void FlexLayout::compute_lines(NVGcontext *ctx, const Widget *widget, const Vector2i &available,
+                               std::vector<Item> &items, std::vector<Line> &lines) const {
     int main_axis_idx = main_axis();
     int cross_axis_idx = cross_axis();
 
-    int total_main_size = 0;
-    int max_cross_size = 0;
+    items.clear();
+    for (Widget *child : widget->children()) {
+        if (!child->visible())
+            continue;
+        const FlexItem &flex_item = child->flex_item();
+        Vector2i pref = child->cached_preferred_size(ctx);
+        Vector2i min_s = child->min_size();
+        Vector2i max_s = child->max_size();
 
-    Vector2i default_size = widget->parent() && widget->parent()->size() != Vector2i(0, 0)
-        ? widget->parent()->size() : Vector2i(1000, 1000);
-    Vector2i parent_size = widget->size();
-    if (parent_size == Vector2i(0, 0)) parent_size = default_size;
+        Item item;
+        item.widget = child;
+        item.grow = flex_item.flex_grow;
+        item.shrink = flex_item.flex_shrink;
+        item.align = flex_item.align_self == AlignItems::Auto ? m_align_items : flex_item.align_self;
+        // Baselines are horizontal, there is nothing to align in a column
+        if (item.align == AlignItems::Baseline && !is_row_direction())
+            item.align = AlignItems::FlexStart;
+        item.frozen = false;
+
+        item.min_main = min_s[main_axis_idx];
+        item.max_main = std::max(item.min_main, max_s[main_axis_idx] > 0 ? max_s[main_axis_idx] : available[main_axis_idx]);
+        item.base = flex_item.flex_basis >= 0 ? flex_item.flex_basis : pref[main_axis_idx];
+        item.main = std::max(item.min_main, std::min(item.base, item.max_main));
+
+        item.min_cross = min_s[cross_axis_idx];
+        item.max_cross = std::max(item.min_cross, max_s[cross_axis_idx] > 0 ? max_s[cross_axis_idx] : available[cross_axis_idx]);
+        item.cross = std::max(item.min_cross, std::min(pref[cross_axis_idx], item.max_cross));
+
+        item.baseline = item.align == AlignItems::Baseline ? child->baseline(ctx, item.cross) : 0;
+        item.pos = 0;
+        items.push_back(item);
+    }
 
-    // Use half parent size for ScrollPanel/Window children to avoid recursion
-    Vector2i default_child_size = default_size / 2;
-    for (size_t i = 0; i < visible_children.size(); ++i) {
-        Widget *child = visible_children[i];
-        Vector2i child_pref;
-        // Use default size for ScrollPanel/Window to prevent recursion
-        if (dynamic_cast<const ScrollPanel*>(child) || dynamic_cast<const Window*>(child)) {
-            child_pref = default_child_size;
-        } else {
-            child_pref = child->preferred_size(ctx);
+    // Greedy line breaking: an item goes to a new line if it does not fit
+    lines.clear();
+    Line line { 0, 0, 0, 0, 0, 0 };
+    for (size_t i = 0; i < items.size(); ++i) {
+        int size = items[i].main;
+        if (m_flex_wrap != FlexWrap::NoWrap && i > line.begin &&
+            line.main + m_gap + size > available[main_axis_idx]) {
+            line.end = i;
+            lines.push_back(line);
+            line = Line { i, i, 0, 0, 0, 0 };
         }
-        Vector2i min_s = child->min_size();
-        Vector2i max_s = child->max_size();
+        line.main += (i > line.begin ? m_gap : 0) + size;
+    }
+    line.end = items.size();
+    if (!items.empty())
+        lines.push_back(line);
+
+    for (Line &l : lines) {
+        int below = 0;
+        for (size_t i = l.begin; i < l.end; ++i) {
+            const Item &item = items[i];
+            if (item.align == AlignItems::Baseline) {
+                l.above = std::max(l.above, item.baseline);
+                below = std::max(below, item.cross - item.baseline);
+            } else {
+                l.cross = std::max(l.cross, item.cross);
+            }
+        }
+        l.cross = std::max(l.cross, l.above + below);
+    }
+}
 
-        Vector2i clamped_pref = child_pref;
-        clamped_pref = max(clamped_pref, min_s);
-        if (max_s.x() == 0) clamped_pref.x() = std::min(clamped_pref.x(), parent_size.x() - 2 * m_margin);
-        if (max_s.y() == 0) clamped_pref.y() = std::min(clamped_pref.y(), parent_size.y() - 2 * m_margin);
+void FlexLayout::resolve_lengths(std::vector<Item> &items, const Line &line, int available) const {
+    int gaps = (int) (line.end - line.begin - 1) * m_gap;
+    bool grow = line.main < available;
+
+    /* Items that cannot flex in this direction keep their hypothetical size,
+       the others start from their flex base size */
+    std::vector<Item>::iterator begin = items.begin() + line.begin, end = items.begin() + line.end;
+    float initial_free = (float) (available - gaps);
+    for (auto it = begin; it != end; ++it) {
+        it->frozen = (grow ? it->grow : it->shrink) == 0.f ||
+                     (grow && it->base > it->main) || (!grow && it->base < it->main);
+        if (!it->frozen)
+            it->main = it->base;
+        initial_free -= it->main;
+    }
 
-        FlexItem flex_item = get_flex_item(child);
+    /* Share the free space among the unfrozen items; the ones that cross
+       their minimum or maximum size are clamped and frozen, and the rest is
+       shared again. Each round freezes at least one item */
+    while (true) {
+        float free = (float) (available - gaps), factors = 0.f;
+        for (auto it = begin; it != end; ++it) {
+            if (it->frozen)
+                free -= it->main;
+            else {
+                free -= it->base;
+                factors += grow ? it->grow : it->shrink * it->base;
+            }
+        }
+        if (factors == 0.f)
+            break;
+        // Factors below 1 in total take only that fraction of the free space
+        if (grow && factors < 1.f && std::abs(initial_free * factors) < std::abs(free))
+            free = initial_free * factors;
 
-        int main_size = flex_item.flex_basis >= 0 ? flex_item.flex_basis : clamped_pref[main_axis_idx];
-        main_size = std::max(min_s[main_axis_idx], std::min(main_size, max_s[main_axis_idx] > 0 ? max_s[main_axis_idx] : main_size));
-        total_main_size += main_size;
+        int violation = 0;
+        for (auto it = begin; it != end; ++it) {
+            if (it->frozen)
+                continue;
+            float share = grow ? it->grow / factors : it->shrink * it->base / factors;
+            int target = it->base + (int) (free * share);
+            it->main = std::max(it->min_main, std::min(target, it->max_main));
+            violation += it->main - target;
+        }
 
-        int cross_size = clamped_pref[cross_axis_idx];
-        cross_size = std::max(min_s[cross_axis_idx], std::min(cross_size, max_s[cross_axis_idx] > 0 ? max_s[cross_axis_idx] : cross_size));
-        max_cross_size = std::max(max_cross_size, cross_size);
+        if (violation == 0)
+            break;
+        for (auto it = begin; it != end; ++it) {
+            if (it->frozen)
+                continue;
+            float share = grow ? it->grow / factors : it->shrink * it->base / factors;
+            int target = it->base + (int) (free * share);
+            if (violation > 0 ? it->main > target : it->main < target)
+                it->frozen = true;
+        }
+    }
+}
 
-        if (i < visible_children.size() - 1)
-            total_main_size += m_gap;
+Vector2i FlexLayout::preferred_size(NVGcontext *ctx, const Widget *widget) const {
+    Vector2i size(2 * m_margin);
+
+    Vector2i available = widget->size();
+    if (available == Vector2i(0, 0))
+        available = widget->parent() && widget->parent()->size() != Vector2i(0, 0)
+            ? widget->parent()->size() : Vector2i(1000, 1000);
+    available -= Vector2i(2 * m_margin);
+
+    int y_offset = 0;
+    const Window *window = dynamic_cast<const Window*>(widget);
+    if (window && !window->title().empty()) {
+        if (!is_row_direction()) {
+            size[1] += widget->theme()->m_window_header_height - m_margin / 2;
+            available[1] -= widget->theme()->m_window_header_height - m_margin / 2;
+        } else {
+            y_offset = widget->theme()->m_window_header_height;
+            available[1] -= y_offset;
+        }
+    }
+
+    std::vector<Item> own_items;
+    std::vector<Line> own_lines;
+    bool shared = !m_scratch_busy;
+    std::vector<Item> &items = shared ? m_items : own_items;
+    std::vector<Line> &lines = shared ? m_lines : own_lines;
+    m_scratch_busy = true;
+    compute_lines(ctx, widget, available, items, lines);
+
+    // Wrapping: as many lines as the current size needs, else a single one
+    int main_size = 0, cross_size = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        main_size = std::max(main_size, lines[i].main);
+        cross_size += lines[i].cross + (i > 0 ? m_gap : 0);
     }
+    if (shared)
+        m_scratch_busy = false;
 
-    size[main_axis_idx] += total_main_size;
-    size[cross_axis_idx] += max_cross_size;
+    size[main_axis()] += main_size;
+    size[cross_axis()] += cross_size;
 
     return size + Vector2i(0, y_offset);
 }
@@ -1148,205 +1268,167 @@ void FlexLayout::perform_layout(NVGcontext *ctx, Widget *widget) const {
         }
     }
 
-    std::vector<Widget*> visible_children;
-    for (auto child : widget->children()) {
-        if (child->visible())
-            visible_children.push_back(child);
-    }
-
-    if (visible_children.empty())
-        return;
-
     int main_axis_idx = main_axis();
     int cross_axis_idx = cross_axis();
-
-    int available_main_space = container_size[main_axis_idx] - 2 * m_margin;
-    int available_cross_space = container_size[cross_axis_idx] - 2 * m_margin;
-
-    std::vector<int> base_sizes;
-    std::vector<int> final_sizes;
-    float total_flex_grow = 0.0f;
-    float total_flex_shrink_scaled = 0.0f;
-    int total_base_size = 0;
-    int total_gaps = std::max(0, (int)visible_children.size() - 1) * m_gap;
-
-    Vector2i default_child_size = default_container / 2; // Default for ScrollPanel/Window
-    for (Widget *child : visible_children) {
-        Vector2i child_pref;
-        if (dynamic_cast<const ScrollPanel*>(child) || dynamic_cast<const Window*>(child)) {
-            child_pref = default_child_size;
-        } else {
-            child_pref = child->preferred_size(ctx);
-        }
-        Vector2i min_s = child->min_size();
-        Vector2i max_s = child->max_size();
-
-        Vector2i clamped_pref = child_pref;
-        clamped_pref = max(clamped_pref, min_s);
-        if (max_s.x() == 0) clamped_pref.x() = std::min(clamped_pref.x(), available_main_space);
-        if (max_s.y() == 0) clamped_pref.y() = std::min(clamped_pref.y(), available_cross_space);
-
-        FlexItem flex_item = get_flex_item(child);
-
-        int base_size = flex_item.flex_basis >= 0 ? flex_item.flex_basis : clamped_pref[main_axis_idx];
-        int axis_min = min_s[main_axis_idx];
-        int axis_max = max_s[main_axis_idx] > 0 ? max_s[main_axis_idx] : available_main_space;
-        base_size = std::max(axis_min, std::min(base_size, axis_max));
-
-        base_sizes.push_back(base_size);
-        total_base_size += base_size;
-        total_flex_grow += flex_item.flex_grow;
-        total_flex_shrink_scaled += flex_item.flex_shrink * base_size;
-    }
-
-    int remaining_space = available_main_space - total_base_size - total_gaps;
-
-    for (size_t i = 0; i < visible_children.size(); ++i) {
-        Widget *child = visible_children[i];
-        FlexItem flex_item = get_flex_item(child);
-        int final_size = base_sizes[i];
-
-        if (remaining_space > 0 && total_flex_grow > 0) {
-            float grow_factor = flex_item.flex_grow / total_flex_grow;
-            final_size += (int)(remaining_space * grow_factor);
-        } else if (remaining_space < 0 && total_flex_shrink_scaled > 0) {
-            float shrink_factor = (flex_item.flex_shrink * base_sizes[i]) / total_flex_shrink_scaled;
-            final_size += (int)(remaining_space * shrink_factor);
-            final_size = std::max(0, final_size);
-        }
-
-        int axis_min = child->min_size()[main_axis_idx];
-        int axis_max = child->max_size()[main_axis_idx] > 0 ? child->max_size()[main_axis_idx] : available_main_space;
-        final_size = std::max(axis_min, std::min(final_size, axis_max));
-
-        final_sizes.push_back(final_size);
-    }
-
-    std::vector<int> positions;
-    int current_pos = m_margin;
-
-    switch (m_justify_content) {
-        case JustifyContent::FlexStart:
-            for (size_t i = 0; i < visible_children.size(); ++i) {
-                positions.push_back(current_pos);
-                current_pos += final_sizes[i] + (i < visible_children.size() - 1 ? m_gap : 0);
-            }
-            break;
-        case JustifyContent::FlexEnd: {
-            int total_used = std::accumulate(final_sizes.begin(), final_sizes.end(), 0) + total_gaps;
-            current_pos = available_main_space + m_margin - total_used;
-            for (size_t i = 0; i < visible_children.size(); ++i) {
-                positions.push_back(current_pos);
-                current_pos += final_sizes[i] + (i < visible_children.size() - 1 ? m_gap : 0);
-            }
-            break;
-        }
-        case JustifyContent::Center: {
-            int total_used = std::accumulate(final_sizes.begin(), final_sizes.end(), 0) + total_gaps;
-            current_pos = m_margin + (available_main_space - total_used) / 2;
-            for (size_t i = 0; i < visible_children.size(); ++i) {
-                positions.push_back(current_pos);
-                current_pos += final_sizes[i] + (i < visible_children.size() - 1 ? m_gap : 0);
-            }
-            break;
-        }
-        case JustifyContent::SpaceBetween: {
-            if (visible_children.size() == 1) {
-                positions.push_back(m_margin);
-            } else {
-                int total_item_size = std::accumulate(final_sizes.begin(), final_sizes.end(), 0);
-                int space_between = (available_main_space - total_item_size) / ((int)visible_children.size() - 1);
-                current_pos = m_margin;
-                for (size_t i = 0; i < visible_children.size(); ++i) {
-                    positions.push_back(current_pos);
-                    current_pos += final_sizes[i] + space_between;
-                }
-            }
-            break;
-        }
-        case JustifyContent::SpaceAround: {
-            int total_item_size = std::accumulate(final_sizes.begin(), final_sizes.end(), 0);
-            int space_around = (available_main_space - total_item_size) / (2 * (int)visible_children.size());
-            current_pos = m_margin + space_around;
-            for (size_t i = 0; i < visible_children.size(); ++i) {
-                positions.push_back(current_pos);
-                current_pos += final_sizes[i] + 2 * space_around;
-            }
-            break;
-        }
-        case JustifyContent::SpaceEvenly: {
-            int total_item_size = std::accumulate(final_sizes.begin(), final_sizes.end(), 0);
-            int space_evenly = (available_main_space - total_item_size) / ((int)visible_children.size() + 1);
-            current_pos = m_margin + space_evenly;
-            for (size_t i = 0; i < visible_children.size(); ++i) {
-                positions.push_back(current_pos);
-                current_pos += final_sizes[i] + space_evenly;
-            }
-            break;
+    Vector2i available = container_size - Vector2i(2 * m_margin);
+
+    std::vector<Item> own_items;
+    std::vector<Line> own_lines;
+    bool shared = !m_scratch_busy;
+    std::vector<Item> &items = shared ? m_items : own_items;
+    std::vector<Line> &lines = shared ? m_lines : own_lines;
+    m_scratch_busy = true;
+    compute_lines(ctx, widget, available, items, lines);
+
+    // Main axis: flexible lengths, then justify_content within each line
+    for (const Line &line : lines) {
+        resolve_lengths(items, line, available[main_axis_idx]);
+
+        int count = (int) (line.end - line.begin);
+        int used = (count - 1) * m_gap;
+        for (size_t i = line.begin; i < line.end; ++i)
+            used += items[i].main;
+        int free = available[main_axis_idx] - used;
+
+        JustifyContent justify = m_justify_content;
+        if (free < 0 && justify == JustifyContent::SpaceBetween)
+            justify = JustifyContent::FlexStart;
+        else if (free < 0 && (justify == JustifyContent::SpaceAround || justify == JustifyContent::SpaceEvenly))
+            justify = JustifyContent::Center;
+
+        int pos = m_margin, spacing = m_gap;
+        switch (justify) {
+            case JustifyContent::FlexStart:
+                break;
+            case JustifyContent::FlexEnd:
+                pos += free;
+                break;
+            case JustifyContent::Center:
+                pos += free / 2;
+                break;
+            case JustifyContent::SpaceBetween:
+                if (count > 1)
+                    spacing += free / (count - 1);
+                break;
+            case JustifyContent::SpaceAround:
+                pos += free / (2 * count);
+                spacing += free / count;
+                break;
+            case JustifyContent::SpaceEvenly:
+                pos += free / (count + 1);
+                spacing += free / (count + 1);
+                break;
         }
-    }
 
-    if (is_reverse_direction()) {
-        std::reverse(positions.begin(), positions.end());
-        std::reverse(final_sizes.begin(), final_sizes.end());
-        for (size_t i = 0; i < positions.size(); ++i) {
-            positions[i] = container_size[main_axis_idx] - positions[i] - final_sizes[i];
+        for (size_t i = line.begin; i < line.end; ++i) {
+            Item &item = items[i];
+            item.pos = pos;
+            pos += item.main + spacing;
+            if (is_reverse_direction())
+                item.pos = container_size[main_axis_idx] - item.pos - item.main;
         }
     }
 
-    for (size_t i = 0; i < visible_children.size(); ++i) {
-        Widget *child = visible_children[i];
-        Vector2i child_pos = child->position();
-        Vector2i child_size = child->size();
-        FlexItem flex_item = get_flex_item(child);
-
-        child_pos[main_axis_idx] = positions[i];
-        child_size[main_axis_idx] = final_sizes[i];
-
-        Vector2i child_pref;
-        if (dynamic_cast<const ScrollPanel*>(child) || dynamic_cast<const Window*>(child)) {
-            child_pref = default_child_size;
-        } else {
-            child_pref = child->preferred_size(ctx);
+    // Cross axis: a single line takes the whole container, several lines
+    // are placed by align_content
+    if (m_flex_wrap == FlexWrap::NoWrap) {
+        if (!lines.empty()) {
+            lines[0].cross = available[cross_axis_idx];
+            lines[0].pos = m_margin;
         }
-        Vector2i min_s = child->min_size();
-        Vector2i max_s = child->max_size();
-
-        AlignItems align = (flex_item.align_self != AlignItems::FlexStart) ? flex_item.align_self : m_align_items;
-        int cross_size = child_pref[cross_axis_idx];
-        int cross_min = min_s[cross_axis_idx];
-        int cross_max = max_s[cross_axis_idx] > 0 ? max_s[cross_axis_idx] : available_cross_space;
-        cross_size = std::max(cross_min, std::min(cross_size, cross_max));
-
+    } else if (!lines.empty()) {
+        int count = (int) lines.size();
+        int used = (count - 1) * m_gap;
+        for (const Line &line : lines)
+            used += line.cross;
+        int free = available[cross_axis_idx] - used;
+
+        AlignContent align = m_align_content;
+        if (free < 0 && (align == AlignContent::SpaceBetween || align == AlignContent::Stretch))
+            align = AlignContent::FlexStart;
+        else if (free < 0 && (align == AlignContent::SpaceAround || align == AlignContent::SpaceEvenly))
+            align = AlignContent::Center;
+
+        int pos = m_margin, spacing = m_gap, extra = 0;
         switch (align) {
-            case AlignItems::FlexStart:
-                child_pos[cross_axis_idx] = m_margin;
-                child_size[cross_axis_idx] = cross_size;
+            case AlignContent::FlexStart:
+                break;
+            case AlignContent::FlexEnd:
+                pos += free;
                 break;
-            case AlignItems::FlexEnd:
-                child_pos[cross_axis_idx] = container_size[cross_axis_idx] - cross_size - m_margin;
-                child_size[cross_axis_idx] = cross_size;
+            case AlignContent::Center:
+                pos += free / 2;
                 break;
-            case AlignItems::Center:
-                child_pos[cross_axis_idx] = m_margin + (available_cross_space - cross_size) / 2;
-                child_size[cross_axis_idx] = cross_size;
+            case AlignContent::SpaceBetween:
+                if (count > 1)
+                    spacing += free / (count - 1);
                 break;
-            case AlignItems::Stretch:
-                child_pos[cross_axis_idx] = m_margin;
-                child_size[cross_axis_idx] = std::max(cross_min, std::min(available_cross_space, cross_max));
+            case AlignContent::SpaceAround:
+                pos += free / (2 * count);
+                spacing += free / count;
                 break;
-            case AlignItems::Baseline:
-                child_pos[cross_axis_idx] = m_margin;
-                child_size[cross_axis_idx] = cross_size;
+            case AlignContent::SpaceEvenly:
+                pos += free / (count + 1);
+                spacing += free / (count + 1);
+                break;
+            case AlignContent::Stretch:
+                extra = free / count;
                 break;
         }
 
-        if (y_offset > 0)
-            child_pos.y() += y_offset;
+        for (Line &line : lines) {
+            line.cross += extra;
+            if (align == AlignContent::Stretch && &line == &lines.back())
+                line.cross += free - extra * count;
+            line.pos = pos;
+            pos += line.cross + spacing;
+            if (m_flex_wrap == FlexWrap::WrapReverse)
+                line.pos = container_size[cross_axis_idx] - line.pos - line.cross;
+        }
+    }
+
+    for (const Line &line : lines) {
+        for (size_t i = line.begin; i < line.end; ++i) {
+            const Item &item = items[i];
+            Vector2i child_pos, child_size;
+            child_pos[main_axis_idx] = item.pos;
+            child_size[main_axis_idx] = item.main;
+
+            int cross_pos = line.pos, cross_size = item.cross;
+            switch (item.align) {
+                case AlignItems::FlexStart:
+                case AlignItems::Auto:
+                    break;
+                case AlignItems::FlexEnd:
+                    cross_pos += line.cross - item.cross;
+                    break;
+                case AlignItems::Center:
+                    cross_pos += (line.cross - item.cross) / 2;
+                    break;
+                case AlignItems::Stretch:
+                    cross_size = std::max(item.min_cross, std::min(line.cross, item.max_cross));
+                    break;
+                case AlignItems::Baseline:
+                    cross_pos += line.above - item.baseline;
+                    break;
+            }
+            child_pos[cross_axis_idx] = cross_pos;
+            child_size[cross_axis_idx] = cross_size;
+
+            if (y_offset > 0)
+                child_pos.y() += y_offset;
 
-        child->set_position(child_pos);
-        child->set_size(child_size);
-        child->perform_layout(ctx);
+            item.widget->set_position(child_pos);
+            item.widget->set_size(child_size);
+        }
+    }
+    if (shared)
+        m_scratch_busy = false;
+
+    // Laid out once the buffers are released, nested layouts may need them
+    for (Widget *child : widget->children()) {
+        if (child->visible())
+            child->update_layout(ctx);
     }
 }
 
@@ -28,7 +28,7 @@ void Popup::perform_layout(NVGcontext* ctx) {
     else {
         m_children[0]->set_position(Vector2i(0));
         m_children[0]->set_size(m_size);
-        m_children[0]->perform_layout(ctx);
+        m_children[0]->update_layout(ctx);
     }
 }
 
@@ -69,7 +69,10 @@ void Popup::refresh_relative_placement() {
     }
 
     set_anchor_pos(AnchorPos);
-    m_pos = TempPos;
+    if (m_pos != TempPos) {
+        m_pos = TempPos;
+        invalidate_parent_hit_index();
+    }
 
 }
 
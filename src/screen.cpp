@@ -26,6 +26,7 @@
 #include <nanogui/scrollpanel.h>
 #include <map>
 #include <iostream>
+#include <thread>
 
 #if defined(EMSCRIPTEN)
 #  include <emscripten/emscripten.h>
@@ -79,6 +80,19 @@ std::map<GLFWwindow*, Screen*> __nanogui_screens;
 static bool glad_initialized = false;
 #endif
 
+#if !defined(EMSCRIPTEN)
+/* Called on a glyph raster thread once it ran out of glyphs to render: the
+   new bitmaps are picked up by the next frame of the screen */
+static void glyphs_ready(void *window) {
+    async([window]() {
+        auto it = __nanogui_screens.find((GLFWwindow *) window);
+        if (it != __nanogui_screens.end())
+            it->second->redraw();
+    });
+    glfwPostEmptyEvent();
+}
+#endif
+
 /* Calculate pixel ratio for hi-dpi devices. */
 static float get_pixel_ratio(GLFWwindow* window) {
 #if defined(EMSCRIPTEN)
@@ -520,6 +534,15 @@ void Screen::initialize(GLFWwindow* window, bool shutdown_glfw) {
     if (!m_nvg_context)
         throw std::runtime_error("Could not initialize NanoVG!");
 
+#if !defined(EMSCRIPTEN)
+    /* Rasterize new glyphs in the background, so that text in a new script or
+       size does not stall the frame that first shows it */
+    unsigned int cores = std::thread::hardware_concurrency();
+    if (cores > 1)
+        nvgTextRasterThreads(m_nvg_context, (int) std::min(cores - 1, 2u),
+                             glyphs_ready, m_glfw_window);
+#endif
+
     m_visible = glfwGetWindowAttrib(window, GLFW_VISIBLE) != 0;
     set_theme(new Theme(m_nvg_context));
     m_mouse_pos = Vector2i(0);
@@ -545,7 +568,17 @@ Screen::~Screen() {
             glfwDestroyCursor(m_cursors[i]);
     }
 
+#if defined(NANOGUI_USE_OPENGL)
+    if (m_retained_fbo) {
+        GLuint fbo = m_retained_fbo, rbo = m_retained_rbo;
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &rbo);
+    }
+#endif
+
     if (m_nvg_context) {
+        if (!m_atlas_cache.empty())
+            nvgSaveFontAtlas(m_nvg_context, m_atlas_cache.c_str());
 #if defined(NANOGUI_USE_OPENGL)
         nvgDeleteGL3(m_nvg_context);
 #elif defined(NANOGUI_USE_GLES)
@@ -642,14 +675,150 @@ void Screen::draw_teardown() {
 }
 
 void Screen::draw_all() {
-    if (m_redraw) {
-        m_redraw = false;
+    perform_scheduled_layouts();
+
+    bool partial = !m_redraw;
+    if (partial && m_dirty_min.x() >= m_dirty_max.x())
+        return;
+    Vector2i lo = max(m_dirty_min, Vector2i(0)),
+             hi = min(m_dirty_max, m_size);
+    m_redraw = false;
+    m_dirty_min = m_dirty_max = Vector2i(0);
+    if (partial && (lo.x() >= hi.x() || lo.y() >= hi.y()))
+        return;
+
+    draw_setup();
+
+    /* Repaint just the dirty area on top of the previous frame if possible */
+    if (partial && restore_frame()) {
+        Vector2i p0 = Vector2i(Vector2f(lo) * m_pixel_ratio),
+                 p1 = Vector2i(Vector2f(hi) * m_pixel_ratio + Vector2f(0.999f));
+        p1 = min(p1, m_fbsize);
+        m_clip_pos = Vector2i(p0.x(), m_fbsize.y() - p1.y());
+        m_clip_size = p1 - p0;
+#if defined(NANOGUI_USE_OPENGL)
+        CHK(glEnable(GL_SCISSOR_TEST));
+        CHK(glScissor(m_clip_pos.x(), m_clip_pos.y(), m_clip_size.x(), m_clip_size.y()));
+        nvglSetFrameClip(m_nvg_context, m_clip_pos.x(), m_clip_pos.y(), m_clip_size.x(), m_clip_size.y());
+#endif
+    } else {
+        m_clip_pos = Vector2i(0);
+        m_clip_size = Vector2i(-1);
+    }
+
+    draw_contents();
+    draw_widgets();
+
+    if (m_clip_size.x() >= 0) {
+#if defined(NANOGUI_USE_OPENGL)
+        nvglSetFrameClip(m_nvg_context, 0, 0, -1, -1);
+        CHK(glDisable(GL_SCISSOR_TEST));
+#endif
+        retain_frame(m_clip_pos, m_clip_size);
+        m_clip_size = Vector2i(-1);
+    } else {
+        retain_frame(Vector2i(0), m_fbsize);
+    }
+
+    draw_teardown();
+}
+
+void Screen::mark_dirty(const Vector2i& pos, const Vector2i& size) {
+    if (size.x() <= 0 || size.y() <= 0)
+        return;
+    if (!m_partial_redraw) {
+        redraw();
+        return;
+    }
+
+    /* Leave some room for what widgets paint just outside of their bounds
+       (focus rings, borders, button shadows) */
+    Vector2i lo = pos - Vector2i(4), hi = pos + size + Vector2i(4);
+    if (m_dirty_min.x() < m_dirty_max.x()) {
+        m_dirty_min = min(m_dirty_min, lo);
+        m_dirty_max = max(m_dirty_max, hi);
+        return;
+    }
+    m_dirty_min = lo;
+    m_dirty_max = hi;
+#if !defined(EMSCRIPTEN)
+    if (!m_redraw)
+        glfwPostEmptyEvent();
+#endif
+}
+
+/* Copy the retained previous frame into the back buffer. Returns false if
+   there is none matching the current framebuffer, or partial repaints are
+   unsupported (everything but desktop OpenGL) or disabled */
+bool Screen::restore_frame() {
+#if defined(NANOGUI_USE_OPENGL)
+    if (!m_partial_redraw || !m_retained_valid || m_retained_size != m_fbsize)
+        return false;
+    CHK(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_retained_fbo));
+    CHK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+    CHK(glBlitFramebuffer(0, 0, m_fbsize.x(), m_fbsize.y(), 0, 0, m_fbsize.x(), m_fbsize.y(),
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    CHK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    return true;
+#else
+    return false;
+#endif
+}
 
-        draw_setup();
-        draw_contents();
-        draw_widgets();
-        draw_teardown();
+/* Save the freshly drawn region (framebuffer pixels, GL orientation) of the
+   back buffer for the next partial repaint */
+void Screen::retain_frame(const Vector2i& pos, const Vector2i& size) {
+#if defined(NANOGUI_USE_OPENGL)
+    if (!m_partial_redraw) {
+        m_retained_valid = false;
+        return;
     }
+
+    if (m_retained_size != m_fbsize || !m_retained_fbo) {
+        /* Blits out of a multisampled window framebuffer resolve it, but
+           blits into it are not allowed: no partial repaints in that case */
+        GLint samples = 0;
+        CHK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+        CHK(glGetIntegerv(GL_SAMPLE_BUFFERS, &samples));
+        if (samples > 0 || m_fbsize.x() <= 0 || m_fbsize.y() <= 0) {
+            m_partial_redraw = false;
+            m_retained_valid = false;
+            return;
+        }
+
+        if (!m_retained_fbo) {
+            GLuint fbo = 0, rbo = 0;
+            CHK(glGenFramebuffers(1, &fbo));
+            CHK(glGenRenderbuffers(1, &rbo));
+            m_retained_fbo = fbo;
+            m_retained_rbo = rbo;
+        }
+        CHK(glBindRenderbuffer(GL_RENDERBUFFER, m_retained_rbo));
+        CHK(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_fbsize.x(), m_fbsize.y()));
+        CHK(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+        CHK(glBindFramebuffer(GL_FRAMEBUFFER, m_retained_fbo));
+        CHK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                      GL_RENDERBUFFER, m_retained_rbo));
+        CHK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+        m_retained_size = m_fbsize;
+        m_retained_valid = false;
+    }
+
+    /* A partial frame can only be kept if the rest is already there */
+    bool full = pos == Vector2i(0) && size == m_fbsize;
+    if (!full && !m_retained_valid)
+        return;
+
+    CHK(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+    CHK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_retained_fbo));
+    CHK(glBlitFramebuffer(pos.x(), pos.y(), pos.x() + size.x(), pos.y() + size.y(),
+                          pos.x(), pos.y(), pos.x() + size.x(), pos.y() + size.y(),
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    CHK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    m_retained_valid = true;
+#else
+    (void) pos; (void) size;
+#endif
 }
 
 void Screen::draw_contents() {
@@ -665,6 +834,15 @@ void Screen::nvg_flush() {
 void Screen::draw_widgets() {
     nvgBeginFrame(m_nvg_context, m_size[0], m_size[1], m_pixel_ratio);
 
+    /* During a partial repaint, children outside of the repainted area are
+       culled against this scissor by Widget::draw() */
+    if (m_clip_size.x() >= 0) {
+        float inv = 1.f / m_pixel_ratio;
+        nvgScissor(m_nvg_context, m_clip_pos.x() * inv,
+                   (m_fbsize.y() - m_clip_pos.y() - m_clip_size.y()) * inv,
+                   m_clip_size.x() * inv, m_clip_size.y() * inv);
+    }
+
     draw(m_nvg_context);
 
 	// Draw light cyan border around focused widget
@@ -918,6 +1096,11 @@ bool Screen::resize_event(const Vector2i& size) {
     return true;
 }
 
+bool Screen::set_atlas_cache(const std::string &path) {
+    m_atlas_cache = path;
+    return !path.empty() && nvgLoadFontAtlas(m_nvg_context, path.c_str());
+}
+
 void Screen::redraw() {
     if (!m_redraw) {
         m_redraw = true;
@@ -1308,15 +1491,58 @@ void Screen::dispose_window(Window* window) {
 
 void Screen::center_window(Window* window) {
     if (window->size() == 0) {
-        window->set_size(window->preferred_size(m_nvg_context));
+        window->set_size(window->cached_preferred_size(m_nvg_context));
         window->perform_layout(m_nvg_context);
     }
     window->set_position((m_size - window->size()) / 2);
 }
 
+void Screen::schedule_layout(Widget* root) {
+    m_layouts_requested++;
+    if (std::find(m_layout_queue.begin(), m_layout_queue.end(), root) == m_layout_queue.end())
+        m_layout_queue.push_back(root);
+    redraw();
+}
+
+void Screen::cancel_layouts(const Widget* widget) {
+    if (m_layout_queue.empty())
+        return;
+    m_layout_queue.erase(std::remove_if(m_layout_queue.begin(), m_layout_queue.end(),
+        [widget](const Widget* root) {
+            for (; root; root = root->parent())
+                if (root == widget)
+                    return true;
+            return false;
+        }), m_layout_queue.end());
+}
+
+void Screen::perform_scheduled_layouts() {
+    if (m_layout_queue.empty())
+        return;
+    /* Roots queued by these layouts wait for the next frame */
+    std::vector<Widget*> queue;
+    queue.swap(m_layout_queue);
+    std::vector<Widget*> sorted(queue);
+    std::sort(sorted.begin(), sorted.end());
+
+    for (Widget* root : queue) {
+        /* Requesting a layout marked the path up to the outer root dirty,
+           so its layout reaches this one */
+        bool nested = false;
+        for (Widget* widget = root->parent(); widget && !nested; widget = widget->parent())
+            nested = std::binary_search(sorted.begin(), sorted.end(), widget);
+        /* Not dirty: laid out directly since it was queued */
+        if (nested || !root->layout_dirty())
+            continue;
+        root->update_layout(m_nvg_context);
+        m_layouts_performed++;
+    }
+}
+
 void Screen::move_window_to_front(Window* window) {
     m_children.erase(std::remove(m_children.begin(), m_children.end(), window), m_children.end());
     m_children.push_back(window);
+    m_hit_index_valid = false;
     /* Brute force topological sort (no problem for a few windows..) */
     bool changed = false;
     do {
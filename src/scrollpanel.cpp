@@ -40,10 +40,9 @@ void ScrollPanel::perform_layout(NVGcontext* ctx) {
 
     // FIRST: Give child the available space as a constraint
     child->set_size(available);
-    child->perform_layout(ctx);
-    
+
     // THEN: Get child's preferred size within that constraint
-    Vector2i constrained_preferred = child->preferred_size(ctx);
+    Vector2i constrained_preferred = child->cached_preferred_size(ctx);
     
     // Update stored preferred size for scrolling calculations
     m_child_preferred_size = constrained_preferred;
@@ -67,8 +66,8 @@ void ScrollPanel::perform_layout(NVGcontext* ctx) {
     child->set_position(Vector2i(offset_x, offset_y));
     child->set_size(Vector2i(child_width, child_height));
 
-    // Final layout with correct size and position
-    child->perform_layout(ctx);
+    // Lay the child out once, with its final size and position
+    child->update_layout(ctx);
 }
 
 // FIXME: Need to be able to capture side-scroll events DOES NOT WORK WITH TEXTBOX (focus problem)
@@ -88,7 +87,7 @@ bool ScrollPanel::keyboard_event(int key, int scancode, int action, int modifier
 Vector2i ScrollPanel::preferred_size(NVGcontext* ctx) const {
     if (m_children.empty())
         return Vector2i(0);
-    return m_children[0]->preferred_size(ctx) + Vector2i(12, 0);
+    return m_children[0]->cached_preferred_size(ctx) + Vector2i(12, 0);
 }
 
 bool ScrollPanel::mouse_drag_event(const Vector2i& p, const Vector2i& rel, int button, int modifiers) {
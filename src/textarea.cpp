@@ -52,15 +52,19 @@ void TextArea::append(const std::string& text) {
         }
     } while (*str++ != 0);
 
+    /* The scroll panel picks up the new size before the next frame, once
+       for any number of appends */
+    mark_layout_dirty();
     ScrollPanel* vscroll = dynamic_cast<ScrollPanel*>(m_parent);
     if (vscroll)
-        vscroll->perform_layout(ctx);
+        vscroll->request_layout();
 }
 
 void TextArea::clear() {
     m_blocks.clear();
     m_offset = m_max_size = 0;
     m_selection_start = m_selection_end = -1;
+    mark_layout_dirty();
 }
 
 bool TextArea::keyboard_event(int key, int /* scancode */, int action, int modifiers) {
@@ -282,7 +282,9 @@ void TextBox::draw(NVGcontext* ctx) {
 
 bool TextBox::mouse_enter_event(const Vector2i &p, bool enter) {
     Widget::mouse_enter_event(p, enter);
-    return true;
+    // Hover only changes this widget's look: repaint just its area
+    mark_dirty();
+    return false;
 }
 
 bool TextBox::mouse_button_event(const Vector2i &p, int button, bool down,
@@ -321,6 +323,7 @@ bool TextBox::mouse_button_event(const Vector2i &p, int button, bool down,
                 if (time - m_last_click < 0.25) {
                     /* Double-click: reset to default value */
                     m_value = m_default_value;
+                    mark_layout_dirty();
                     if (m_callback)
                         m_callback(m_value);
 
@@ -385,6 +388,8 @@ bool TextBox::focus_event(bool focused) {
 
             if (m_callback && !m_callback(m_value))
                 m_value = backup;
+            if (m_value != backup)
+                mark_layout_dirty();
 
             m_valid_format = true;
             m_committed = true;
@@ -98,7 +98,7 @@ void TreeView::arrow_callback(std::string keystring)
     for (auto CurrItem : m_data_tree->Objects[keystring]->Children)
         update_tree_items(CurrItem.second->KeyString, m_data_tree->Objects[keystring]->Level + 1, m_data_tree->Objects[keystring]->Expanded, ChildrenCnt++);
 
-    perform_layout(screen()->nvg_context());
+    request_layout();
 }
 
 void TreeView::set_fixed_size(const Vector2i& fixed_size)
@@ -107,16 +107,20 @@ void TreeView::set_fixed_size(const Vector2i& fixed_size)
     Widget::set_fixed_size(fixed_size);
 }
 
+TreeView::~TreeView() {
+    delete m_data_tree;
+}
+
 void TreeView::set_items(NanoTree* items) {
-    if (m_data_tree != items)free(m_data_tree);
+    if (m_data_tree != items)delete m_data_tree;
     m_data_tree = items;
-    //Screen* My_Screen = screen();
+    Screen* My_Screen = screen();
     while (m_items_container->children().size() > 0)
     {
-        screen()->m_focus_path.erase(std::remove(screen()->m_focus_path.begin(), screen()->m_focus_path.end(), m_items_container->child_at(0)), screen()->m_focus_path.end());
+        if (My_Screen)My_Screen->m_focus_path.erase(std::remove(My_Screen->m_focus_path.begin(), My_Screen->m_focus_path.end(), m_items_container->child_at(0)), My_Screen->m_focus_path.end());
         m_items_container->remove_child_at(0);
     }
-    if (m_data_tree->Objects.size() == 0)return;
+    if (m_data_tree == nullptr || m_data_tree->Objects.size() == 0)return;
 
     update_tree_items(m_data_tree->Root->KeyString, 0, true);
 }
@@ -18,6 +18,7 @@
 
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <climits>
 #include <GLFW/glfw3.h>
 
 /* Uncomment the following definition to draw red bounding
@@ -27,6 +28,13 @@
 
 NAMESPACE_BEGIN(nanogui)
 
+struct Widget::HitIndex {
+    Vector2i origin, cell, cells;
+    /* Indices of the children overlapping each cell, ascending, cell i
+       holds entries[start[i]] .. entries[start[i + 1] - 1] */
+    std::vector<uint32_t> start, entries;
+};
+
 Widget::Widget(Widget* parent)
     : m_parent(nullptr), m_theme(nullptr), m_layout(nullptr),
     m_pos(0), m_size(0), m_fixed_size(0), m_visible(true), m_enabled(true),
@@ -57,6 +65,7 @@ Widget::~Widget() {
     if (screen_widget) {
         this->screen()->notify_widget_destroyed(this);
     }
+    delete m_hit_index;
 
     if (std::uncaught_exceptions() > 0) {
         /* If a widget constructor throws an exception, it is immediately
@@ -77,6 +86,7 @@ void Widget::set_theme(Theme* theme) {
     m_theme = theme;
     for (auto child : m_children)
         child->set_theme(theme);
+    mark_layout_dirty();
 }
 
 int Widget::font_size() const {
@@ -90,34 +100,171 @@ Vector2i Widget::preferred_size(NVGcontext* ctx) const {
         return m_size;
 }
 
+int Widget::baseline(NVGcontext*, int height) const {
+    return height;
+}
+
+Vector2i Widget::cached_preferred_size(NVGcontext* ctx) const {
+    Vector2i parent_size = m_parent ? m_parent->size() : Vector2i(0);
+    if (!m_preferred_valid || m_preferred_constraint[0] != m_size ||
+        m_preferred_constraint[1] != parent_size) {
+        m_preferred_cache = preferred_size(ctx);
+        m_preferred_constraint[0] = m_size;
+        m_preferred_constraint[1] = parent_size;
+        m_preferred_valid = true;
+    }
+    return m_preferred_cache;
+}
+
 void Widget::perform_layout(NVGcontext* ctx) {
     if (m_layout) {
         m_layout->perform_layout(ctx, this);
     }
     else {
         for (auto c : m_children) {
-            Vector2i pref = c->preferred_size(ctx), fix = c->fixed_size();
+            Vector2i pref = c->cached_preferred_size(ctx), fix = c->fixed_size();
             c->set_size(Vector2i(
                 fix[0] ? fix[0] : pref[0],
                 fix[1] ? fix[1] : pref[1]
             ));
-            c->perform_layout(ctx);
+            c->update_layout(ctx);
         }
     }
 }
 
-Widget* Widget::find_widget(const Vector2i& p) {
-    for (auto it = m_children.rbegin(); it != m_children.rend(); ++it) {
-        Widget* child = *it;
-        if (child->visible() && child->contains(p - m_pos))
-            return child->find_widget(p - m_pos);
+void Widget::update_layout(NVGcontext* ctx) {
+    /* The layouts fall back to the size of the parent while a widget has
+       none, so that is part of the constraint as well */
+    Vector2i parent_size = m_parent ? m_parent->size() : Vector2i(0);
+    if (!m_layout_dirty && m_layout_constraint[0] == m_size &&
+        m_layout_constraint[1] == parent_size)
+        return;
+    /* Cleared first: the preferred sizes of resized children may differ, so
+       a layout that resizes any of them leaves the widget dirty again */
+    m_layout_dirty = false;
+    m_layout_constraint[0] = m_size;
+    m_layout_constraint[1] = parent_size;
+    perform_layout(ctx);
+}
+
+void Widget::mark_layout_dirty() {
+    /* No early exit at an already dirty ancestor: layouts skip invisible
+       children, so a dirty widget can sit below a clean one */
+    for (Widget* widget = this; widget; widget = widget->parent()) {
+        widget->m_layout_dirty = true;
+        widget->m_preferred_valid = false;
     }
-    return contains(p) ? this : nullptr;
+}
+
+void Widget::request_layout() {
+    mark_layout_dirty();
+    if (Screen* screen = this->screen())
+        screen->schedule_layout(this);
+}
+
+void Widget::set_hit_index(bool enabled) {
+    if (enabled == (m_hit_index != nullptr))
+        return;
+    if (enabled) {
+        m_hit_index = new HitIndex();
+        m_hit_index_valid = false;
+    } else {
+        delete m_hit_index;
+        m_hit_index = nullptr;
+    }
+}
+
+bool Widget::hit_candidates(const Vector2i& p, const uint32_t*& begin,
+                            const uint32_t*& end) const {
+    HitIndex* index = m_hit_index;
+    if (!index)
+        return false;
+
+    auto hittable = [](const Widget* child) {
+        return child->visible() && child->width() > 0 && child->height() > 0;
+    };
+
+    if (!m_hit_index_valid) {
+        Vector2i lo(INT_MAX), hi(INT_MIN);
+        uint32_t count = 0;
+        for (const Widget* child : m_children) {
+            if (!hittable(child))
+                continue;
+            lo = min(lo, child->position());
+            hi = max(hi, child->position() + child->size());
+            count++;
+        }
+
+        /* About one cell per child, shaped like the bounding box */
+        Vector2i extent(1), cells(0);
+        if (count > 0) {
+            extent = hi - lo;
+            float aspect = (float) extent.x() / (float) extent.y();
+            cells.x() = std::min(std::max((int) std::ceil(std::sqrt(count * aspect)), 1), 1024);
+            cells.y() = std::min(std::max((int) std::ceil((float) count / cells.x()), 1), 1024);
+        }
+        index->origin = lo;
+        index->cells = cells;
+        index->cell = max((extent + cells - Vector2i(1)) / max(cells, Vector2i(1)), Vector2i(1));
+
+        /* Counting sort of the children into the cells they overlap: the
+           first pass counts, the second one fills in child order */
+        index->start.assign((size_t) cells.x() * cells.y() + 1, 0);
+        for (int pass = 0; pass < 2; ++pass) {
+            for (uint32_t i = 0; i < (uint32_t) m_children.size(); ++i) {
+                const Widget* child = m_children[i];
+                if (!hittable(child))
+                    continue;
+                Vector2i c0 = (child->position() - lo) / index->cell,
+                         c1 = min((child->position() + child->size() - lo - Vector2i(1)) / index->cell,
+                                  cells - Vector2i(1));
+                for (int y = c0.y(); y <= c1.y(); ++y) {
+                    for (int x = c0.x(); x <= c1.x(); ++x) {
+                        size_t cell = (size_t) y * cells.x() + x;
+                        if (pass == 0)
+                            index->start[cell + 1]++;
+                        else
+                            index->entries[index->start[cell]++] = i;
+                    }
+                }
+            }
+            if (pass == 0) {
+                for (size_t cell = 1; cell < index->start.size(); ++cell)
+                    index->start[cell] += index->start[cell - 1];
+                index->entries.resize(index->start.back());
+            } else {
+                /* Filling advanced each start to the start of the next cell */
+                for (size_t cell = index->start.size() - 1; cell > 0; --cell)
+                    index->start[cell] = index->start[cell - 1];
+                index->start[0] = 0;
+            }
+        }
+        m_hit_index_valid = true;
+    }
+
+    begin = end = index->entries.data();
+    Vector2i d = p - index->origin;
+    if (d.x() < 0 || d.y() < 0)
+        return true;
+    Vector2i c = d / index->cell;
+    if (c.x() >= index->cells.x() || c.y() >= index->cells.y())
+        return true;
+    size_t cell = (size_t) c.y() * index->cells.x() + c.x();
+    begin = index->entries.data() + index->start[cell];
+    end = index->entries.data() + index->start[cell + 1];
+    return true;
+}
+
+Widget* Widget::find_widget(const Vector2i& p) {
+    return const_cast<Widget*>(static_cast<const Widget*>(this)->find_widget(p));
 }
 
 const Widget* Widget::find_widget(const Vector2i& p) const {
-    for (auto it = m_children.rbegin(); it != m_children.rend(); ++it) {
-        Widget* child = *it;
+    /* Children in reverse order, the candidates of the hit index if any */
+    const uint32_t *begin, *end;
+    bool indexed = hit_candidates(p - m_pos, begin, end);
+    for (size_t n = indexed ? (size_t) (end - begin) : m_children.size(); n > 0; --n) {
+        const Widget* child = m_children[indexed ? begin[n - 1] : n - 1];
         if (child->visible() && child->contains(p - m_pos))
             return child->find_widget(p - m_pos);
     }
@@ -125,10 +272,11 @@ const Widget* Widget::find_widget(const Vector2i& p) const {
 }
 
 bool Widget::mouse_button_event(const Vector2i& p, int button, bool down, int modifiers) {
-    Screen* CanICastSreen = dynamic_cast<Screen*>(this);
-    bool screen_widget = CanICastSreen != NULL;
-    for (auto it = m_children.rbegin(); it != m_children.rend(); ++it) {
-        Widget* child = *it;
+    bool screen_widget = m_parent == nullptr; // only the screen has no parent
+    const uint32_t *begin, *end;
+    bool indexed = hit_candidates(p - m_pos, begin, end);
+    for (size_t n = indexed ? (size_t) (end - begin) : m_children.size(); n > 0; --n) {
+        Widget* child = m_children[indexed ? begin[n - 1] : n - 1];
         if (child->visible() && child->contains(p - m_pos))
         {
             if (child->mouse_button_event(p - m_pos, button, down, modifiers))
@@ -144,10 +292,9 @@ bool Widget::mouse_button_event(const Vector2i& p, int button, bool down, int mo
 bool Widget::mouse_motion_event(const Vector2i& p, const Vector2i& rel, int button, int modifiers) {
     bool handled = false;
 
-    for (auto it = m_children.rbegin(); it != m_children.rend(); ++it) {
-        Widget* child = *it;
+    auto dispatch = [&](Widget* child) {
         if (!child->visible())
-            continue;
+            return;
 
         bool contained = child->contains(p - m_pos),
             prev_contained = child->contains(p - m_pos - rel);
@@ -157,14 +304,37 @@ bool Widget::mouse_motion_event(const Vector2i& p, const Vector2i& rel, int butt
 
         if (contained || prev_contained)
             handled |= child->mouse_motion_event(p - m_pos, rel, button, modifiers);
+    };
+
+    const uint32_t *begin, *end, *prev_begin, *prev_end;
+    if (hit_candidates(p - m_pos, begin, end)) {
+        /* Merge the candidates at the new and at the previous position,
+           in reverse order and without duplicates */
+        hit_candidates(p - m_pos - rel, prev_begin, prev_end);
+        while (end != begin || prev_end != prev_begin) {
+            uint32_t i;
+            if (prev_end == prev_begin || (end != begin && end[-1] >= prev_end[-1])) {
+                i = *--end;
+                if (prev_end != prev_begin && prev_end[-1] == i)
+                    --prev_end;
+            } else {
+                i = *--prev_end;
+            }
+            dispatch(m_children[i]);
+        }
+    } else {
+        for (auto it = m_children.rbegin(); it != m_children.rend(); ++it)
+            dispatch(*it);
     }
 
     return handled;
 }
 
 bool Widget::scroll_event(const Vector2i& p, const Vector2f& rel) {
-    for (auto it = m_children.rbegin(); it != m_children.rend(); ++it) {
-        Widget* child = *it;
+    const uint32_t *begin, *end;
+    bool indexed = hit_candidates(p - m_pos, begin, end);
+    for (size_t n = indexed ? (size_t) (end - begin) : m_children.size(); n > 0; --n) {
+        Widget* child = m_children[indexed ? begin[n - 1] : n - 1];
         if (!child->visible())
             continue;
         if (child->contains(p - m_pos) && child->scroll_event(p - m_pos, rel))
@@ -174,8 +344,8 @@ bool Widget::scroll_event(const Vector2i& p, const Vector2f& rel) {
 }
 
 bool Widget::mouse_drag_event(const Vector2i& p, const Vector2i& rel, int button, int  modifiers) {
-    Screen* CanICastSreen = dynamic_cast<Screen*>(this);
-    if (CanICastSreen != NULL)return false;
+    if (!m_parent) // the screen
+        return false;
 
     if (parent()->mouse_drag_event(p, rel, button, modifiers))
         return true;
@@ -207,6 +377,8 @@ void Widget::add_child(int index, Widget* widget) {
     widget->inc_ref();
     widget->set_parent(this);
     widget->set_theme(m_theme);
+    mark_layout_dirty();
+    m_hit_index_valid = false;
 }
 
 void Widget::add_child(Widget* widget) {
@@ -219,7 +391,11 @@ void Widget::remove_child(const Widget* widget) {
         m_children.end());
     if (m_children.size() == child_count)
         throw std::runtime_error("Widget::remove_child(): widget not found!");
+    if (Screen* screen = this->screen())
+        screen->cancel_layouts(widget);
     widget->dec_ref();
+    mark_layout_dirty();
+    m_hit_index_valid = false;
 }
 
 void Widget::remove_child_at(int index) {
@@ -227,7 +403,11 @@ void Widget::remove_child_at(int index) {
         throw std::runtime_error("Widget::remove_child_at(): out of bounds!");
     Widget* widget = m_children[index];
     m_children.erase(m_children.begin() + index);
+    if (Screen* screen = this->screen())
+        screen->cancel_layouts(widget);
     widget->dec_ref();
+    mark_layout_dirty();
+    m_hit_index_valid = false;
 }
 
 int Widget::child_index(Widget* widget) const {
@@ -271,6 +451,18 @@ void Widget::request_focus() {
     ((Screen*)widget)->update_focus(this);
 }
 
+void Widget::mark_dirty() {
+    Widget* widget = this;
+    while (widget->parent()) {
+        if (!widget->visible())
+            return;
+        widget = widget->parent();
+    }
+    Screen* screen = dynamic_cast<Screen*>(widget);
+    if (screen && m_visible)
+        screen->mark_dirty(absolute_position(), m_size);
+}
+
 std::pair<bool, float> Widget::get_animation_progress() {
     double current_time = glfwGetTime();
     float progress = -1.0f;
@@ -315,11 +507,15 @@ void Widget::apply_animation_transform(NVGcontext* ctx, float progress) {
             printf("sproing %.2f for %s\n", progress, m_id.c_str());
             float scale = 1.0f + 0.5f * std::sin(progress * 4.0f * float(M_PI)) * std::exp(-progress * 3.0f);
             nvgScale(ctx, scale, scale);
+            // A new text size every frame: scale one distance field per glyph instead of
+            // rasterizing every size
+            nvgTextSDF(ctx, 1);
             break;
         }
         case AnimationType::Warble: {
             float scale = 1.0f + 0.1f * std::sin(progress * 10.0f * float(M_PI));
             nvgScale(ctx, scale, scale);
+            nvgTextSDF(ctx, 1);
             break;
         }
         case AnimationType::Rotate: {
@@ -347,6 +543,7 @@ void Widget::apply_animation_transform(NVGcontext* ctx, float progress) {
 void Widget::end_animation() {
     if (m_animation_type == AnimationType::SlideClose) {
         m_visible = false;
+        invalidate_parent_hit_index();
         printf("End animation for %s\n", m_id.c_str());
     }
     // Subclasses can override for more logic
@@ -365,13 +562,19 @@ void Widget::draw(NVGcontext* ctx) {
     if (!m_visible)
         return;
 
+    // Leaf widgets without a layout table or animation have nothing to do here
+    bool animating = m_animation_start >= 0.0;
+    if (m_children.empty() && !m_layout && !animating)
+        return;
+
     nvgSave(ctx);
     nvgTranslate(ctx, m_pos.x(), m_pos.y());
 
     // Apply animation transform for this widget
-    auto [anim_active, progress] = get_animation_progress();
-    if (anim_active) {
-        apply_animation_transform(ctx, progress);
+    if (animating) {
+        auto [anim_active, progress] = get_animation_progress();
+        if (anim_active)
+            apply_animation_transform(ctx, progress);
     }
 
 	// Draw table layout if enabled
@@ -381,9 +584,31 @@ void Widget::draw(NVGcontext* ctx) {
 
     // Draw children (their animations are handled in their own draw calls)
     if (!m_children.empty()) {
+        /* Children entirely outside of the current scissor (scrolled out of
+           a ScrollPanel, or away from the dirty area of a partial repaint)
+           are skipped before any NanoVG call is made for them. Only possible
+           under a pure translation; popups/windows reset the scissor for
+           their shadows, hence the margin */
+        float scissor[4], xform[6];
+        bool cull = nvgCurrentScissor(ctx, scissor) != 0;
+        if (cull) {
+            nvgCurrentTransform(ctx, xform);
+            cull = xform[0] == 1.f && xform[1] == 0.f && xform[2] == 0.f && xform[3] == 1.f;
+        }
+        float margin = m_theme ? (float) m_theme->m_window_drop_shadow_size : 0.f;
+
         for (auto child : m_children) {
             if (!child->visible())
                 continue;
+            if (cull) {
+                float x0 = xform[4] + child->m_pos.x() - margin,
+                      y0 = xform[5] + child->m_pos.y() - margin,
+                      x1 = x0 + child->m_size.x() + 2 * margin,
+                      y1 = y0 + child->m_size.y() + 2 * margin;
+                if (x1 <= scissor[0] || y1 <= scissor[1] ||
+                    x0 >= scissor[2] || y0 >= scissor[3])
+                    continue;
+            }
         #if !defined(NANOGUI_SHOW_WIDGET_BOUNDS)
             nvgSave(ctx);
             nvgIntersectScissor(ctx, child->m_pos.x(), child->m_pos.y(),
@@ -285,6 +285,7 @@ bool Window::mouse_drag_event(const Vector2i& p, const Vector2i& rel, int button
 		} else {
 			m_pos = min(m_pos, parent()->size() - m_size);
 		}
+        invalidate_parent_hit_index();
         return true;
     }
     else if (m_resizable && m_resize && (button & (1 << GLFW_MOUSE_BUTTON_1)) != 0) {
@@ -382,6 +383,7 @@ bool Window::mouse_drag_event(const Vector2i& p, const Vector2i& rel, int button
         }
 
         m_size = max(m_size, m_min_size);
+        invalidate_parent_hit_index();
 
         if (resized)
             perform_layout(ctx);
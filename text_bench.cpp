@@ -0,0 +1,416 @@
+// text_bench -- draw calls and CPU time of nvgText/nvgTextBox
+//
+// Usage: text_bench [glyphs] [iterations]   (run from the repository root, it
+//                                            loads resources/Roboto-Regular.ttf
+//                                            and, if present,
+//                                            resources/NotoColorEmoji.ttf)
+//
+// Lays out a paragraph of `glyphs` characters (10k by default) with
+// nvgTextBox() into a NanoVG context whose back-end only counts the
+// triangle batches it receives, i.e. the GL draw calls a real back-end would
+// issue. Reports calls, glyphs per call and CPU time per paragraph. If the
+// color emoji font is available a second, mixed paragraph is measured where
+// every tenth word is an emoji; each switch between color and grayscale
+// glyphs necessarily starts a new call.
+//
+// Every paragraph is laid out once with the text cache disabled and once
+// with it enabled (see nvgTextCacheSize()); both must submit the same
+// vertices. The cache statistics are printed at the end.
+//
+// Finally a cold start is measured: a fresh context draws a few thousand
+// glyphs it has never rasterized, once rendering them synchronously and once
+// on raster threads (see nvgTextRasterThreads()), in which case frames are
+// drawn until all bitmaps arrived. Both must end with the same vertices and
+// the same atlas texture contents. The synchronous run saves its atlas
+// (see nvgSaveFontAtlas()), and a last run starts from that file instead;
+// it must show everything in its first frame with the same result. Loading
+// the file with different data for the font, or a truncated copy, or a copy
+// whose atlas skyline was damaged, must fail.
+//
+// Last, a zoom animation scales a line of text a little every frame, drawn
+// from bitmaps and from distance fields (see nvgTextSDF()). Bitmaps are
+// rendered again for every new size, distance fields must not be rendered
+// again after the first frame.
+
+#include <nanovg.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static int calls = 0, vertices = 0;
+static long uploaded = 0;
+static double checksum = 0.0;
+
+struct Texture {
+    int width, height, bpp;
+    std::vector<unsigned char> data;
+};
+static std::map<int, Texture> textures;
+
+// Back-end that draws nothing, counts the text batches and keeps the textures
+static int count_create(void*) { return 1; }
+static int count_update_texture(void*, int image, int x, int y, int w, int h, const unsigned char* data) {
+    Texture& tex = textures[image];
+    uploaded += (long) w * h;
+    for (int row = y; row < y + h; ++row)
+        memcpy(&tex.data[(size_t) (row * tex.width + x) * tex.bpp],
+               &data[(size_t) (row * tex.width + x) * tex.bpp], (size_t) w * tex.bpp);
+    return 1;
+}
+static int count_create_texture(void*, int type, int w, int h, int, const unsigned char* data) {
+    static int next_image = 1;
+    Texture& tex = textures[next_image];
+    tex.width = w;
+    tex.height = h;
+    tex.bpp = type == NVG_TEXTURE_RGBA ? 4 : 1;
+    tex.data.assign((size_t) w * h * tex.bpp, 0);
+    if (data)
+        count_update_texture(nullptr, next_image, 0, 0, w, h, data);
+    return next_image++;
+}
+static int count_delete_texture(void*, int image) { textures.erase(image); return 1; }
+static int count_texture_size(void*, int image, int* w, int* h) {
+    *w = textures[image].width;
+    *h = textures[image].height;
+    return 1;
+}
+static void count_viewport(void*, float, float, float) { }
+static void count_cancel(void*) { }
+static void count_flush(void*) { }
+static void count_fill(void*, NVGpaint*, NVGcompositeOperationState, NVGscissor*, float,
+                       const float*, const NVGpath*, int) { calls++; }
+static void count_stroke(void*, NVGpaint*, NVGcompositeOperationState, NVGscissor*, float,
+                         float, const NVGpath*, int) { calls++; }
+static void count_triangles(void*, NVGpaint*, NVGcompositeOperationState, NVGscissor*,
+                            const NVGvertex* verts, int nverts, float) {
+    calls++;
+    vertices += nverts;
+    for (int i = 0; i < nverts; ++i)
+        checksum += verts[i].x * 3.0 + verts[i].y * 5.0 + verts[i].u * 7.0 + verts[i].v * 11.0;
+}
+static void count_delete(void*) { }
+
+static NVGcontext* create_counting_context(bool sdf = false) {
+    NVGparams params;
+    memset(&params, 0, sizeof(params));
+    params.edgeAntiAlias = 1;
+    params.imageSDF = sdf;
+    params.renderCreate = count_create;
+    params.renderCreateTexture = count_create_texture;
+    params.renderDeleteTexture = count_delete_texture;
+    params.renderUpdateTexture = count_update_texture;
+    params.renderGetTextureSize = count_texture_size;
+    params.renderViewport = count_viewport;
+    params.renderCancel = count_cancel;
+    params.renderFlush = count_flush;
+    params.renderFill = count_fill;
+    params.renderStroke = count_stroke;
+    params.renderTriangles = count_triangles;
+    params.renderDelete = count_delete;
+    return nvgCreateInternal(&params);
+}
+
+static std::string make_paragraph(size_t glyphs, const char* emoji) {
+    static const char* words[] = {
+        "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit",
+        "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore",
+        "magna", "aliqua"
+    };
+    std::string text;
+    size_t count = 0, n = 0;
+    while (count < glyphs) {
+        const char* word = (emoji && n % 10 == 9) ? emoji : words[n % (sizeof(words) / sizeof(words[0]))];
+        if (!text.empty()) {
+            text += ' ';
+            count++;
+        }
+        text += word;
+        count += emoji && word == emoji ? 1 : strlen(word);
+        n++;
+    }
+    return text;
+}
+
+static double run(NVGcontext* ctx, const char* name, const std::string& text, int iterations) {
+    int per_call = 0;
+    double best = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+        calls = vertices = 0;
+        checksum = 0.0;
+        auto start = Clock::now();
+        nvgBeginFrame(ctx, 1200.f, 800.f, 1.f);
+        nvgFontFace(ctx, "sans");
+        nvgFontSize(ctx, 16.f);
+        nvgFillColor(ctx, nvgRGBA(0, 0, 0, 255));
+        nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+        nvgTextBox(ctx, 10.f, 10.f, 1180.f, text.c_str(), nullptr);
+        nvgEndFrame(ctx);
+        best = std::min(best, std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        per_call = calls ? vertices / 6 / calls : 0;
+    }
+    printf("  %-16s: %d draw calls, %d glyphs/call, %.1f us per paragraph (best of %d)\n",
+           name, calls, per_call, best, iterations);
+    return checksum;
+}
+
+// Lays `text` out without and with the text cache, returns false if they differ
+static bool compare(NVGcontext* ctx, const char* name, const std::string& text, int iterations) {
+    std::string label = std::string(name) + " (uncached)";
+    nvgTextCacheSize(ctx, 0);
+    double uncached = run(ctx, label.c_str(), text, iterations);
+    label = std::string(name) + " (cached)";
+    nvgTextCacheSize(ctx, 4 * 1024 * 1024);
+    double cached = run(ctx, label.c_str(), text, iterations);
+    if (uncached != cached) {
+        printf("  %s: cached and uncached layouts differ\n", name);
+        return false;
+    }
+    return true;
+}
+
+// FNV-1a over the contents of the live textures, in the order they were created
+static unsigned int texture_hash() {
+    unsigned int hash = 2166136261u;
+    for (auto& it : textures)
+        for (unsigned char c : it.second.data)
+            hash = (hash ^ c) * 16777619u;
+    return hash;
+}
+
+// Copies the atlas file `src` to `dst`, either without its last byte or with the first
+// skyline node of the first page moved above the page. Offsets follow fontstash's
+// FONScacheHeader, FONScacheFont and FONScachePage.
+static bool damage_atlas(const char* src, const char* dst, bool truncate) {
+    FILE* fp = fopen(src, "rb");
+    if (!fp)
+        return false;
+    std::vector<unsigned char> data;
+    unsigned char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(fp);
+    auto read_int = [&](size_t at) {
+        int v = 0;
+        if (at + sizeof(v) <= data.size())
+            memcpy(&v, &data[at], sizeof(v));
+        return v;
+    };
+    if (truncate) {
+        if (data.empty())
+            return false;
+        data.pop_back();
+    } else {
+        const size_t header_size = 36, font_size = 168, page_size = 20;
+        size_t at = header_size;
+        int glyph_size = read_int(8), nfonts = read_int(24);
+        for (int i = 0; i < nfonts; ++i)
+            at += font_size + (size_t) glyph_size * read_int(at + font_size - 8);
+        at += page_size;
+        if (at + 6 > data.size())
+            return false;
+        short y = -64;
+        memcpy(&data[at + 2], &y, sizeof(y));
+    }
+    fp = fopen(dst, "wb");
+    if (!fp)
+        return false;
+    bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    return fclose(fp) == 0 && ok;
+}
+
+// Draws the printable ASCII and Latin-1 characters at 16 sizes with a fresh context, i.e.
+// without any rasterized glyph unless it loads the atlas file `load`, until all bitmaps are
+// in; then saves the atlas to `save` if given. Returns false if the last frame differs from
+// `reference` (vertex checksum, texture hash), which it sets if empty.
+static bool cold_start(int threads, std::pair<double, unsigned int>& reference,
+                       const char* load = nullptr, const char* save = nullptr) {
+    std::string text;
+    for (unsigned int c = 0x21; c <= 0xFF; ++c) {
+        if (c >= 0x7F && c < 0xA1)
+            continue;
+        if (c < 0x80) {
+            text += (char) c;
+        } else {
+            text += (char) (0xC0 | (c >> 6));
+            text += (char) (0x80 | (c & 0x3F));
+        }
+    }
+
+    textures.clear();
+    NVGcontext* ctx = create_counting_context();
+    if (!ctx || nvgCreateFont(ctx, "sans", "resources/Roboto-Regular.ttf") == -1)
+        return false;
+    int started = nvgTextRasterThreads(ctx, threads, nullptr, nullptr);
+    auto start = Clock::now();
+    if (load && !nvgLoadFontAtlas(ctx, load)) {
+        printf("  could not load the atlas from %s\n", load);
+        nvgDeleteInternal(ctx);
+        return false;
+    }
+    double load_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    double first_ms = 0, total_ms = 0;
+    int frames = 0;
+    bool complete = false;
+    while (!complete) {
+        calls = vertices = 0;
+        checksum = 0.0;
+        start = Clock::now();
+        nvgBeginFrame(ctx, 1200.f, 800.f, 1.f);
+        bool delivered = nvgTextPendingGlyphs(ctx) == 0;
+        nvgFontFace(ctx, "sans");
+        nvgFillColor(ctx, nvgRGBA(0, 0, 0, 255));
+        nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+        for (int size = 10; size < 42; size += 2) {
+            nvgFontSize(ctx, (float) size);
+            nvgText(ctx, 0.f, (float) (size * size) / 2.f, text.c_str(), nullptr);
+        }
+        nvgEndFrame(ctx);
+        complete = delivered && nvgTextPendingGlyphs(ctx) == 0;
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (frames++ == 0)
+            first_ms = ms;
+        total_ms += ms;
+        if (!complete)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::pair<double, unsigned int> result(checksum, texture_hash());
+    if (save && !nvgSaveFontAtlas(ctx, save))
+        printf("  could not save the atlas to %s\n", save);
+    nvgDeleteInternal(ctx);
+
+    char label[32];
+    if (load)
+        snprintf(label, sizeof(label), "atlas file");
+    else
+        snprintf(label, sizeof(label), started ? "%d raster threads" : "synchronous", started);
+    printf("  %-18s: first frame %.2f ms", label, first_ms);
+    if (load)
+        printf(" (loading %.2f ms)", load_ms);
+    printf(", all glyphs shown after %d frame(s)\n", frames);
+    if (reference.second == 0)
+        reference = result;
+    return result == reference;
+}
+
+// Draws a line of text growing from 16 to 40 pixels over 60 frames, as a widget animation does.
+// Returns false if distance fields are used and glyphs were rendered after the first frame.
+static bool zoom(bool sdf) {
+    textures.clear();
+    NVGcontext* ctx = create_counting_context(sdf);
+    if (!ctx || nvgCreateFont(ctx, "sans", "resources/Roboto-Regular.ttf") == -1)
+        return false;
+    if (sdf && !nvgTextSDF(ctx, 1)) {
+        printf("  (FreeType without SDF rendering, skipping distance fields)\n");
+        nvgDeleteInternal(ctx);
+        return true;
+    }
+    nvgTextSDF(ctx, 0);
+    std::string text = make_paragraph(120, nullptr);
+
+    const int frames = 60;
+    long first = 0;
+    double first_ms = 0, total_ms = 0;
+    uploaded = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        auto start = Clock::now();
+        nvgBeginFrame(ctx, 1200.f, 800.f, 1.f);
+        nvgTextSDF(ctx, sdf);
+        nvgFontFace(ctx, "sans");
+        nvgFillColor(ctx, nvgRGBA(0, 0, 0, 255));
+        nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+        nvgTranslate(ctx, 10.f, 10.f);
+        nvgScale(ctx, 1.f + 1.5f * frame / frames, 1.f + 1.5f * frame / frames);
+        nvgFontSize(ctx, 16.f);
+        nvgText(ctx, 0.f, 0.f, text.c_str(), nullptr);
+        nvgEndFrame(ctx);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (frame == 0) {
+            first = uploaded;
+            first_ms = ms;
+        } else {
+            total_ms += ms;
+        }
+    }
+    nvgDeleteInternal(ctx);
+
+    printf("  %-18s: first frame %.2f ms, then %.3f ms per frame; %ld texels uploaded in the first frame, %ld after\n",
+           sdf ? "distance fields" : "bitmaps", first_ms, total_ms / (frames - 1), first, uploaded - first);
+    return !sdf || uploaded == first;
+}
+
+int main(int argc, char** argv) {
+    int glyphs = argc > 1 ? atoi(argv[1]) : 10000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 50;
+    if (glyphs <= 0 || iterations <= 0) {
+        fprintf(stderr, "usage: %s [glyphs] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    NVGcontext* ctx = create_counting_context();
+    if (!ctx || nvgCreateFont(ctx, "sans", "resources/Roboto-Regular.ttf") == -1) {
+        fprintf(stderr, "could not load resources/Roboto-Regular.ttf (run from the repository root)\n");
+        return 1;
+    }
+    int emoji = nvgCreateFont(ctx, "emoji", "resources/NotoColorEmoji.ttf");
+    if (emoji != -1)
+        nvgAddFallbackFont(ctx, "sans", "emoji");
+
+    printf("%d glyph paragraph:\n", glyphs);
+    bool ok = compare(ctx, "text", make_paragraph((size_t) glyphs, nullptr), iterations);
+    if (emoji != -1)
+        ok &= compare(ctx, "mixed", make_paragraph((size_t) glyphs, "\xF0\x9F\x98\x80"), iterations);
+    else
+        printf("  (resources/NotoColorEmoji.ttf not found, skipping the mixed paragraph)\n");
+
+    NVGtextCacheStats stats;
+    nvgTextCacheStats(ctx, &stats);
+    printf("text cache: %d entries, %d of %d bytes, %u hits, %u misses, %u evictions\n",
+           stats.entries, stats.bytes, stats.capacity, stats.hits, stats.misses, stats.evictions);
+    nvgDeleteInternal(ctx);
+
+    printf("cold start, 3000 new glyphs:\n");
+    const char* atlas = "text_bench_atlas.tmp";
+    std::pair<double, unsigned int> reference(0.0, 0u);
+    if (!cold_start(0, reference, nullptr, atlas) || !cold_start(2, reference) ||
+        !cold_start(4, reference) || !cold_start(0, reference, atlas)) {
+        printf("  raster threads or the atlas file produced a different atlas or layout\n");
+        ok = false;
+    }
+    ctx = create_counting_context();
+    if (ctx && nvgCreateFont(ctx, "sans", "resources/Roboto-Bold.ttf") != -1 && nvgLoadFontAtlas(ctx, atlas)) {
+        printf("  the atlas file was loaded for a different font\n");
+        ok = false;
+    }
+    nvgDeleteInternal(ctx);
+    const char* damaged = "text_bench_damaged.tmp";
+    for (bool truncate : { true, false }) {
+        ctx = create_counting_context();
+        if (!damage_atlas(atlas, damaged, truncate) || !ctx ||
+            nvgCreateFont(ctx, "sans", "resources/Roboto-Regular.ttf") == -1 ||
+            nvgLoadFontAtlas(ctx, damaged)) {
+            printf("  a %s atlas file was not rejected\n", truncate ? "truncated" : "damaged");
+            ok = false;
+        }
+        nvgDeleteInternal(ctx);
+    }
+    remove(damaged);
+    remove(atlas);
+
+    printf("zoom animation, 120 glyphs at 60 sizes:\n");
+    if (!zoom(false) || !zoom(true)) {
+        printf("  distance fields were rendered again for a new size\n");
+        ok = false;
+    }
+
+    return ok ? 0 : 1;
+}